@@ -28,6 +28,25 @@ public static bool[] AreParametersSupported(ParameterBoxingInstructions[] tokens
             return supported;
         }
 
+        /// <summary>
+        /// Gets the type of each parameter that the typed probe passes through its primitive argument buffer,
+        /// or <see cref="SpecialCaseBoxingTypes.Unknown"/> for parameters that are passed as objects (or not at all).
+        /// </summary>
+        public static SpecialCaseBoxingTypes[] GetPrimitiveParameterTypes(ParameterBoxingInstructions[] tokens)
+        {
+            SpecialCaseBoxingTypes[] types = new SpecialCaseBoxingTypes[tokens.Length];
+            for (int i = 0; i < types.Length; i++)
+            {
+                if (tokens[i].InstructionType == InstructionType.SpecialCaseToken &&
+                    TypedProbeArguments.IsPrimitive((SpecialCaseBoxingTypes)tokens[i].Token))
+                {
+                    types[i] = (SpecialCaseBoxingTypes)tokens[i].Token;
+                }
+            }
+
+            return types;
+        }
+
         public static ParameterBoxingInstructions[] GetBoxingInstructions(MethodInfo method)
         {
             ParameterInfo[] formalParameters = method.GetParameters();
@@ -31,6 +31,11 @@ public void CacheMethods(IList<MethodInfo> methods)
         }
 
         public bool EnterProbe(ulong uniquifier, object[] args)
+        {
+            return args != null && EnterProbe(uniquifier, new ProbeArguments(args));
+        }
+
+        public bool EnterProbe(ulong uniquifier, ProbeArguments args)
         {
             if (!_eventSource.IsEnabled)
             {
@@ -39,7 +44,6 @@ public bool EnterProbe(ulong uniquifier, object[] args)
 
             FunctionProbesState? state = FunctionProbesStub.State;
             if (state == null ||
-                args == null ||
                 !state.InstrumentedMethods.TryGetValue(uniquifier, out InstrumentedMethod? instrumentedMethod) ||
                 args.Length != instrumentedMethod?.SupportedParameters.Length ||
                 args.Length != instrumentedMethod?.MethodSignature.Parameters.Count)
@@ -63,13 +67,16 @@ public bool EnterProbe(ulong uniquifier, object[] args)
                     {
                         evalResult = ObjectFormatterResult.Unsupported;
                     }
-                    else if (args[i] == null)
+                    else if (args.IsPrimitive(i))
                     {
-                        evalResult = ObjectFormatterResult.Null;
+                        evalResult = new ObjectFormatterResult(args.FormatPrimitive(i));
                     }
                     else
                     {
-                        evalResult = ObjectFormatter.FormatObject(_objectFormatterCache.GetFormatter(args[i].GetType()), args[i], FormatSpecifier.NoQuotes);
+                        object? arg = args.GetObject(i);
+                        evalResult = arg == null
+                            ? ObjectFormatterResult.Null
+                            : ObjectFormatter.FormatObject(_objectFormatterCache.GetFormatter(arg.GetType()), arg, FormatSpecifier.NoQuotes);
                     }
                     resolvedArgs[i] = new ResolvedParameterInfo(
                         instrumentedMethod.MethodSignature.Parameters[i].Name,
@@ -21,26 +21,32 @@ internal sealed class FunctionProbesManager : IFunctionProbesManager
         private static extern void RequestFunctionProbeRegistration(ulong enterProbeId);
 
         [DllImport(ProfilerIdentifiers.MutatingProfiler.LibraryRootFileName, CallingConvention = CallingConvention.StdCall, PreserveSig = false)]
-        private static extern void RequestFunctionProbeUninstallation();
-
-        [DllImport(ProfilerIdentifiers.MutatingProfiler.LibraryRootFileName, CallingConvention = CallingConvention.StdCall, PreserveSig = false)]
-        private static extern void RequestFunctionProbeInstallation(
+        private static extern void RequestFunctionProbeAddition(
             [MarshalAs(UnmanagedType.LPArray)] ulong[] funcIds,
             uint count,
             [MarshalAs(UnmanagedType.LPArray)] ParameterBoxingInstructions[] boxingInstructions,
-            [MarshalAs(UnmanagedType.LPArray)] uint[] parameterCounts);
+            [MarshalAs(UnmanagedType.LPArray)] uint[] parameterCounts,
+            [MarshalAs(UnmanagedType.LPArray)] uint[]? samplingIntervals,
+            [MarshalAs(UnmanagedType.LPArray)] ProbePredicate[]? predicates);
+
+        [DllImport(ProfilerIdentifiers.MutatingProfiler.LibraryRootFileName, CallingConvention = CallingConvention.StdCall, PreserveSig = false)]
+        private static extern void RequestFunctionProbeRemoval(
+            [MarshalAs(UnmanagedType.LPArray)] ulong[] funcIds,
+            uint count);
 
         private delegate void FunctionProbeRegistrationCallback(int hresult);
         private delegate void FunctionProbeInstallationCallback(int hresult);
         private delegate void FunctionProbeUninstallationCallback(int hresult);
         private delegate void FunctionProbeFaultCallback(ulong uniquifier);
+        private delegate void FunctionProbeDisabledCallback(ulong uniquifier);
 
         [DllImport(ProfilerIdentifiers.MutatingProfiler.LibraryRootFileName, CallingConvention = CallingConvention.StdCall, PreserveSig = false)]
         private static extern void RegisterFunctionProbeCallbacks(
             IntPtr onRegistration,
             IntPtr onInstallation,
             IntPtr onUninstallation,
-            IntPtr onFault);
+            IntPtr onFault,
+            IntPtr onDisabled);
 
         [DllImport(ProfilerIdentifiers.MutatingProfiler.LibraryRootFileName, CallingConvention = CallingConvention.StdCall, PreserveSig = false)]
         private static extern void UnregisterFunctionProbeCallbacks();
@@ -49,6 +55,7 @@ internal sealed class FunctionProbesManager : IFunctionProbesManager
         private readonly FunctionProbeInstallationCallback _onInstallationDelegate;
         private readonly FunctionProbeUninstallationCallback _onUninstallationDelegate;
         private readonly FunctionProbeFaultCallback _onFaultDelegate;
+        private readonly FunctionProbeDisabledCallback _onDisabledDelegate;
 
         private long _probeState;
         private const long ProbeStateUninitialized = default(long);
@@ -58,6 +65,9 @@ internal sealed class FunctionProbesManager : IFunctionProbesManager
         private const long ProbeStateInstalled = 4;
         private const long ProbeStateUnrecoverable = 5;
 
+        // The state to return to if an installation fails; the profiler leaves already installed probes untouched.
+        private long _installationFailedState = ProbeStateUninstalled;
+
         private readonly TaskCompletionSource _probeRegistrationTaskSource = new(TaskCreationOptions.RunContinuationsAsynchronously);
         private TaskCompletionSource? _installationTaskSource;
         private TaskCompletionSource? _uninstallationTaskSource;
@@ -69,6 +79,8 @@ internal sealed class FunctionProbesManager : IFunctionProbesManager
 
         public event EventHandler<InstrumentedMethod>? OnProbeFault;
 
+        public event EventHandler<InstrumentedMethod>? OnProbeDisabled;
+
         public FunctionProbesManager()
         {
             ProfilerResolver.InitializeResolver<FunctionProbesManager>();
@@ -86,12 +98,14 @@ public FunctionProbesManager()
             _onInstallationDelegate = OnInstallation;
             _onUninstallationDelegate = OnUninstallation;
             _onFaultDelegate = OnFault;
+            _onDisabledDelegate = OnDisabled;
 
             RegisterFunctionProbeCallbacks(
                 Marshal.GetFunctionPointerForDelegate(_onRegistrationDelegate),
                 Marshal.GetFunctionPointerForDelegate(_onInstallationDelegate),
                 Marshal.GetFunctionPointerForDelegate(_onUninstallationDelegate),
-                Marshal.GetFunctionPointerForDelegate(_onFaultDelegate));
+                Marshal.GetFunctionPointerForDelegate(_onFaultDelegate),
+                Marshal.GetFunctionPointerForDelegate(_onDisabledDelegate));
 
             RequestFunctionProbeRegistration(FunctionProbesStub.GetProbeFunctionId());
         }
@@ -109,7 +123,7 @@ private void OnInstallation(int hresult)
             TransitionStateFromHr(_installationTaskSource, hresult,
                 expectedState: ProbeStateInstalling,
                 succeededState: ProbeStateInstalled,
-                failedState: ProbeStateUninstalled);
+                failedState: _installationFailedState);
         }
 
         private void OnUninstallation(int hresult)
@@ -137,6 +151,22 @@ private void OnFault(ulong uniquifier)
             OnProbeFault?.Invoke(this, instrumentedMethod);
         }
 
+        private void OnDisabled(ulong uniquifier)
+        {
+            //
+            // The profiler removed this method's probe because it exceeded its overhead budget; the other probes are still installed.
+            // The method stays in the cache so that it is not instrumented again until capturing stops.
+            //
+            var cache = FunctionProbesStub.State?.InstrumentedMethods;
+            if (cache == null ||
+                !cache.TryGetValue(uniquifier, out InstrumentedMethod? instrumentedMethod))
+            {
+                return;
+            }
+
+            OnProbeDisabled?.Invoke(this, instrumentedMethod);
+        }
+
         private void TransitionStateFromHr(TaskCompletionSource? taskCompletionSource, int hresult, long expectedState, long succeededState, long failedState)
         {
             Exception? ex = Marshal.GetExceptionForHR(hresult);
@@ -217,12 +247,29 @@ private void StopCapturingCore()
                 return;
             }
 
+            FunctionProbesState? state = FunctionProbesStub.State;
             FunctionProbesStub.State = null;
-            RequestFunctionProbeUninstallation();
+            if (state == null)
+            {
+                return;
+            }
+
+            // The manager holds one reference on each instrumented method's probe, see StartCapturingAsync.
+            ulong[] functionIds = new ulong[state.InstrumentedMethods.Count];
+            state.InstrumentedMethods.Keys.CopyTo(functionIds, 0);
+            RequestFunctionProbeRemoval(functionIds, (uint)functionIds.Length);
         }
 
+        public Task StartCapturingAsync(IList<MethodInfo> methods, IFunctionProbes probes, CancellationToken token)
+        {
+            return StartCapturingAsync(methods, predicates: null, probes, token);
+        }
 
-        public async Task StartCapturingAsync(IList<MethodInfo> methods, IFunctionProbes probes, CancellationToken token)
+        /// <summary>
+        /// Adds probes to the methods, as <see cref="StartCapturingAsync(IList{MethodInfo}, IFunctionProbes, CancellationToken)"/> does.
+        /// Each method's probe is only called when its predicate (at the same index) holds; methods that are already instrumented keep their predicate.
+        /// </summary>
+        public async Task StartCapturingAsync(IList<MethodInfo> methods, IList<ProbePredicate>? predicates, IFunctionProbes probes, CancellationToken token)
         {
             DisposableHelper.ThrowIfDisposed<FunctionProbesManager>(ref _disposedState);
 
@@ -231,24 +278,42 @@ public async Task StartCapturingAsync(IList<MethodInfo> methods, IFunctionProbes
                 throw new ArgumentException(nameof(methods));
             }
 
+            if (predicates != null && predicates.Count != methods.Count)
+            {
+                throw new ArgumentException(nameof(predicates));
+            }
+
             // _probeRegistrationTaskSource will be cancelled (if needed) on dispose
             await _probeRegistrationTaskSource.Task.WaitAsync(token).ConfigureAwait(false);
 
-            if (ProbeStateUninstalled != Interlocked.CompareExchange(ref _probeState, ProbeStateInstalling, ProbeStateUninstalled))
+            // Probes can be added to those that are already installed.
+            long previousProbeState = Interlocked.CompareExchange(ref _probeState, ProbeStateInstalling, ProbeStateUninstalled);
+            if (ProbeStateInstalled == previousProbeState)
+            {
+                previousProbeState = Interlocked.CompareExchange(ref _probeState, ProbeStateInstalling, ProbeStateInstalled);
+            }
+
+            if (ProbeStateUninstalled != previousProbeState &&
+                ProbeStateInstalled != previousProbeState)
             {
                 throw new InvalidOperationException(string.Format(CultureInfo.InvariantCulture, ParameterCapturingStrings.ErrorMessage_ProbeStateMismatchFormatString, ProbeStateUninstalled, _probeState));
             }
 
+            FunctionProbesState? previousState = FunctionProbesStub.State;
             ObjectFormatterCache newObjectFormatterCache = new(useDebuggerDisplayAttribute: false);
-            Dictionary<ulong, InstrumentedMethod> newMethodCache = new(methods.Count);
+            Dictionary<ulong, InstrumentedMethod> newMethodCache = previousState != null
+                ? new(previousState.InstrumentedMethods)
+                : new(methods.Count);
             try
             {
                 List<ulong> functionIds = new(methods.Count);
                 List<ParameterBoxingInstructions> allBoxingInstructions = new();
                 List<uint> parameterCounts = new(methods.Count);
+                List<ProbePredicate>? newPredicates = predicates != null ? new(methods.Count) : null;
 
-                foreach (MethodInfo method in methods)
+                for (int i = 0; i < methods.Count; i++)
                 {
+                    MethodInfo method = methods[i];
                     ulong functionId = method.GetFunctionId();
                     if (functionId == 0)
                     {
@@ -258,31 +323,48 @@ public async Task StartCapturingAsync(IList<MethodInfo> methods, IFunctionProbes
                     ParameterBoxingInstructions[] boxingInstructionsForMethod = BoxingInstructions.GetBoxingInstructions(method);
                     if (!newMethodCache.TryAdd(functionId, new InstrumentedMethod(method, boxingInstructionsForMethod)))
                     {
-                        // Duplicate, ignore
+                        // Duplicate or already instrumented, ignore
                         continue;
                     }
 
                     functionIds.Add(functionId);
                     parameterCounts.Add((uint)boxingInstructionsForMethod.Length);
+                    newPredicates?.Add(predicates![i]);
                     allBoxingInstructions.AddRange(boxingInstructionsForMethod);
                 }
 
-                probes.CacheMethods(methods);
+                // The probes serve every instrumented method, including those added by earlier calls.
+                List<MethodInfo> instrumentedMethods = new(newMethodCache.Count);
+                foreach (InstrumentedMethod instrumentedMethod in newMethodCache.Values)
+                {
+                    instrumentedMethods.Add(instrumentedMethod.Method);
+                }
+
+                probes.CacheMethods(instrumentedMethods);
                 FunctionProbesStub.State = new FunctionProbesState(new ReadOnlyDictionary<ulong, InstrumentedMethod>(newMethodCache), probes);
 
+                if (functionIds.Count == 0)
+                {
+                    _probeState = ProbeStateInstalled;
+                    return;
+                }
+
+                _installationFailedState = previousProbeState;
                 _installationTaskSource = new TaskCompletionSource(TaskCreationOptions.RunContinuationsAsynchronously);
-                RequestFunctionProbeInstallation(
+                RequestFunctionProbeAddition(
                     functionIds.ToArray(),
                     (uint)functionIds.Count,
                     allBoxingInstructions.ToArray(),
-                    parameterCounts.ToArray());
+                    parameterCounts.ToArray(),
+                    samplingIntervals: null,
+                    predicates: newPredicates?.ToArray());
             }
             catch
             {
-                FunctionProbesStub.State = null;
+                FunctionProbesStub.State = previousState;
                 newObjectFormatterCache?.Clear();
 
-                _probeState = ProbeStateUninstalled;
+                _probeState = previousProbeState;
                 _installationTaskSource = null;
                 throw;
             }
@@ -299,7 +381,7 @@ public async Task StartCapturingAsync(IList<MethodInfo> methods, IFunctionProbes
                     // We need to uninstall the probes ourselves here if dispose has happened  otherwise the probes could be left in an installed state.
                     //
                     // NOTE: It's possible that StopCapturingCore could be called twice by doing this - once by Dispose and once by us, this is OK
-                    // as the native layer will gracefully handle multiple RequestFunctionProbeUninstallation calls.
+                    // as the second call finds no probes left to remove.
                     //
                     if (_disposalToken.IsCancellationRequested)
                     {
@@ -315,6 +397,12 @@ public async Task StartCapturingAsync(IList<MethodInfo> methods, IFunctionProbes
 
                 await _installationTaskSource.Task.ConfigureAwait(false);
             }
+            catch (Exception) when (!linkedCancellationToken.IsCancellationRequested)
+            {
+                // The probes that were already installed are still in place.
+                FunctionProbesStub.State = previousState;
+                throw;
+            }
             finally
             {
                 _installationTaskSource = null;
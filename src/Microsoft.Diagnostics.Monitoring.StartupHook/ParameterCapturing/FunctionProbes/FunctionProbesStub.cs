@@ -41,5 +41,33 @@ public static void EnterProbeStub(ulong uniquifier, object[] args)
                 s_inProbe = false;
             }
         }
+
+        /// <summary>
+        /// Called by instrumented methods instead of <see cref="EnterProbeStub"/> so that primitive arguments are passed
+        /// through to the probes without being boxed. The profiler locates this method by name and signature.
+        /// </summary>
+        public static void EnterProbeStubTyped(IntPtr primitiveArgs, ulong uniquifier, object[]? args)
+        {
+            FunctionProbesState? state = State;
+            IFunctionProbes? probes = state?.Probes;
+            if (state == null || probes == null || s_inProbe)
+            {
+                return;
+            }
+
+            try
+            {
+                s_inProbe = true;
+                if (!MonitorExecutionContextTracker.IsInMonitorContext() &&
+                    state.InstrumentedMethods.TryGetValue(uniquifier, out InstrumentedMethod? instrumentedMethod))
+                {
+                    _ = probes.EnterProbe(uniquifier, new ProbeArguments(instrumentedMethod.PrimitiveParameterTypes, primitiveArgs, args));
+                }
+            }
+            finally
+            {
+                s_inProbe = false;
+            }
+        }
     }
 }
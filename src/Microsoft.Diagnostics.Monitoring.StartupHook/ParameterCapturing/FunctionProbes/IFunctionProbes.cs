@@ -17,5 +17,13 @@ internal interface IFunctionProbes
         /// <param name="args">The arguments passed into the method.</param>
         /// <returns>True if the the arguments were captured by the probe.</returns>
         public bool EnterProbe(ulong uniquifier, object[] args);
+
+        /// <summary>
+        /// Called by the typed probe. Implementations that can read primitive arguments without boxing them should override this.
+        /// </summary>
+        /// <param name="uniquifier">The uniquifier which identifies the method calling the probe.</param>
+        /// <param name="args">The arguments passed into the method, only valid until the probe returns.</param>
+        /// <returns>True if the the arguments were captured by the probe.</returns>
+        public bool EnterProbe(ulong uniquifier, ProbeArguments args) => EnterProbe(uniquifier, args.ToArray());
     }
 }
@@ -11,10 +11,21 @@ namespace Microsoft.Diagnostics.Monitoring.StartupHook.ParameterCapturing.Functi
 {
     internal interface IFunctionProbesManager : IDisposable
     {
+        /// <summary>
+        /// Adds probes to the methods, alongside any that are already installed. The probes handle every instrumented method.
+        /// </summary>
         public Task StartCapturingAsync(IList<MethodInfo> methods, IFunctionProbes probes, CancellationToken token);
 
+        /// <summary>
+        /// Removes every probe that was added.
+        /// </summary>
         public Task StopCapturingAsync(CancellationToken token);
 
         public event EventHandler<InstrumentedMethod> OnProbeFault;
+
+        /// <summary>
+        /// Raised when the profiler removes a method's probe because it exceeded its overhead budget. The other probes stay installed.
+        /// </summary>
+        public event EventHandler<InstrumentedMethod> OnProbeDisabled;
     }
 }
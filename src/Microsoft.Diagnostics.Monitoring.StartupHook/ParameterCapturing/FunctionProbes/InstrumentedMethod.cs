@@ -21,6 +21,7 @@ public InstrumentedMethod(MethodInfo method, ParameterBoxingInstructions[] boxin
         {
             FunctionId = method.GetFunctionId();
             SupportedParameters = BoxingInstructions.AreParametersSupported(boxingInstructions);
+            PrimitiveParameterTypes = BoxingInstructions.GetPrimitiveParameterTypes(boxingInstructions);
             MethodSignature = new MethodSignature(method);
             foreach (bool isParameterSupported in SupportedParameters)
             {
@@ -67,6 +68,11 @@ private static ParameterCaptureMode ComputeCaptureMode(MethodInfo method)
         /// </summary>
         public bool[] SupportedParameters { get; }
 
+        /// <summary>
+        /// The type of each parameter (implicit and explicit) that the typed probe passes without boxing.
+        /// </summary>
+        public SpecialCaseBoxingTypes[] PrimitiveParameterTypes { get; }
+
         /// <summary>
         /// Information about the method (name, parameter types, parameter names).
         /// </summary>
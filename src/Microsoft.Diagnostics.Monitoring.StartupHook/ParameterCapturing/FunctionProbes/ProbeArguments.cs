@@ -0,0 +1,60 @@
+﻿// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+using System;
+
+namespace Microsoft.Diagnostics.Monitoring.StartupHook.ParameterCapturing.FunctionProbes
+{
+    /// <summary>
+    /// The arguments of an instrumented method. Primitive arguments passed by <see cref="FunctionProbesStub.EnterProbeStubTyped"/>
+    /// are read from the profiler's buffer and are only boxed if <see cref="ToArray"/> is called.
+    /// </summary>
+    /// <remarks>
+    /// The primitive buffer lives on the instrumented method's stack, so the arguments are only valid until the probe returns.
+    /// </remarks>
+    internal readonly ref struct ProbeArguments
+    {
+        private readonly SpecialCaseBoxingTypes[] _primitiveParameterTypes;
+        private readonly IntPtr _primitiveArgs;
+        private readonly object[]? _args;
+
+        public ProbeArguments(object[] args)
+            : this(Array.Empty<SpecialCaseBoxingTypes>(), IntPtr.Zero, args)
+        {
+        }
+
+        public ProbeArguments(SpecialCaseBoxingTypes[] primitiveParameterTypes, IntPtr primitiveArgs, object[]? args)
+        {
+            _primitiveParameterTypes = primitiveParameterTypes;
+            _primitiveArgs = primitiveArgs;
+            _args = args;
+        }
+
+        public int Length => _args?.Length ?? _primitiveParameterTypes.Length;
+
+        public bool IsPrimitive(int index)
+        {
+            return _primitiveArgs != IntPtr.Zero &&
+                index < _primitiveParameterTypes.Length &&
+                TypedProbeArguments.IsPrimitive(_primitiveParameterTypes[index]);
+        }
+
+        /// <summary>
+        /// Gets an argument that is not primitive.
+        /// </summary>
+        public object? GetObject(int index) => _args?[index];
+
+        /// <summary>
+        /// Formats a primitive argument the same way as its boxed value is formatted.
+        /// </summary>
+        public unsafe string FormatPrimitive(int index)
+        {
+            return TypedProbeArguments.FormatPrimitive(_primitiveParameterTypes[index], ((ulong*)_primitiveArgs)[index]);
+        }
+
+        /// <summary>
+        /// Gets every argument, boxing the primitive ones.
+        /// </summary>
+        public object[] ToArray() => TypedProbeArguments.GetArguments(_primitiveParameterTypes, _primitiveArgs, _args);
+    }
+}
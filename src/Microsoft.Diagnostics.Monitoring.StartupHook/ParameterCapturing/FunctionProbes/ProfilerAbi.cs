@@ -72,4 +72,33 @@ internal unsafe struct ParameterBoxingInstructions
             };
         }
     }
+
+    internal enum ProbePredicateComparison : uint
+    {
+        None = 0,
+        Equal,
+        NotEqual,
+        LessThan,
+        LessThanOrEqual,
+        GreaterThan,
+        GreaterThanOrEqual
+    }
+
+    /// <summary>
+    /// Restricts a probe to calls where "argument &lt;comparison&gt; constant" holds. Evaluated in the instrumented method itself.
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    internal struct ProbePredicate
+    {
+        public ProbePredicateComparison Comparison;
+
+        // Must refer to a primitive parameter.
+        public uint ArgumentIndex;
+
+        //
+        // NOTE: The bits of a long, a ulong or (for floating point parameters) a double,
+        // depending on the parameter's type.
+        //
+        public long Constant;
+    }
 }
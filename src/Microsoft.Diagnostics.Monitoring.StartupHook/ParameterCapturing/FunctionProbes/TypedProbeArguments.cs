@@ -0,0 +1,113 @@
+﻿// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+using System;
+using System.Globalization;
+
+namespace Microsoft.Diagnostics.Monitoring.StartupHook.ParameterCapturing.FunctionProbes
+{
+    /// <summary>
+    /// Decodes the arguments passed to <see cref="FunctionProbesStub.EnterProbeStubTyped"/>.
+    /// </summary>
+    /// <remarks>
+    /// The profiler stores each primitive argument in an 8-byte slot of a stack-allocated buffer, at the argument's index:
+    /// integers are zero or sign extended to 64 bits and floating point values are stored as doubles.
+    /// All other supported arguments are stored at their index in an object array, which is null if there are none.
+    /// This layout must be kept in sync with the profiler (src\Profilers\MutatingMonitorProfiler\ProbeInstrumentation\ProbeInjector.cpp).
+    /// </remarks>
+    internal static class TypedProbeArguments
+    {
+        public static bool IsPrimitive(SpecialCaseBoxingTypes type)
+        {
+            return type >= SpecialCaseBoxingTypes.Boolean && type <= SpecialCaseBoxingTypes.Double;
+        }
+
+        public static unsafe object[] GetArguments(SpecialCaseBoxingTypes[] primitiveParameterTypes, IntPtr primitiveArgs, object[]? args)
+        {
+            object[] arguments = args ?? new object[primitiveParameterTypes.Length];
+            if (primitiveArgs == IntPtr.Zero)
+            {
+                return arguments;
+            }
+
+            ulong* slots = (ulong*)primitiveArgs;
+            int count = Math.Min(arguments.Length, primitiveParameterTypes.Length);
+            for (int i = 0; i < count; i++)
+            {
+                ulong slot = slots[i];
+                switch (primitiveParameterTypes[i])
+                {
+                    case SpecialCaseBoxingTypes.Boolean:
+                        arguments[i] = slot != 0;
+                        break;
+                    case SpecialCaseBoxingTypes.Char:
+                        arguments[i] = (char)slot;
+                        break;
+                    case SpecialCaseBoxingTypes.SByte:
+                        arguments[i] = (sbyte)slot;
+                        break;
+                    case SpecialCaseBoxingTypes.Byte:
+                        arguments[i] = (byte)slot;
+                        break;
+                    case SpecialCaseBoxingTypes.Int16:
+                        arguments[i] = (short)slot;
+                        break;
+                    case SpecialCaseBoxingTypes.UInt16:
+                        arguments[i] = (ushort)slot;
+                        break;
+                    case SpecialCaseBoxingTypes.Int32:
+                        arguments[i] = (int)slot;
+                        break;
+                    case SpecialCaseBoxingTypes.UInt32:
+                        arguments[i] = (uint)slot;
+                        break;
+                    case SpecialCaseBoxingTypes.Int64:
+                        arguments[i] = (long)slot;
+                        break;
+                    case SpecialCaseBoxingTypes.UInt64:
+                        arguments[i] = slot;
+                        break;
+                    case SpecialCaseBoxingTypes.IntPtr:
+                        arguments[i] = (nint)(long)slot;
+                        break;
+                    case SpecialCaseBoxingTypes.UIntPtr:
+                        arguments[i] = (nuint)slot;
+                        break;
+                    case SpecialCaseBoxingTypes.Single:
+                        arguments[i] = (float)BitConverter.UInt64BitsToDouble(slot);
+                        break;
+                    case SpecialCaseBoxingTypes.Double:
+                        arguments[i] = BitConverter.UInt64BitsToDouble(slot);
+                        break;
+                }
+            }
+
+            return arguments;
+        }
+
+        /// <summary>
+        /// Formats a primitive slot with the invariant culture, matching how the object formatters format its boxed value.
+        /// </summary>
+        public static string FormatPrimitive(SpecialCaseBoxingTypes type, ulong slot)
+        {
+            return type switch
+            {
+                SpecialCaseBoxingTypes.Boolean => (slot != 0).ToString(CultureInfo.InvariantCulture),
+                SpecialCaseBoxingTypes.Char => ((char)slot).ToString(CultureInfo.InvariantCulture),
+                SpecialCaseBoxingTypes.SByte => ((sbyte)slot).ToString(CultureInfo.InvariantCulture),
+                SpecialCaseBoxingTypes.Byte => ((byte)slot).ToString(CultureInfo.InvariantCulture),
+                SpecialCaseBoxingTypes.Int16 => ((short)slot).ToString(CultureInfo.InvariantCulture),
+                SpecialCaseBoxingTypes.UInt16 => ((ushort)slot).ToString(CultureInfo.InvariantCulture),
+                SpecialCaseBoxingTypes.Int32 => ((int)slot).ToString(CultureInfo.InvariantCulture),
+                SpecialCaseBoxingTypes.UInt32 => ((uint)slot).ToString(CultureInfo.InvariantCulture),
+                SpecialCaseBoxingTypes.Int64 => ((long)slot).ToString(CultureInfo.InvariantCulture),
+                SpecialCaseBoxingTypes.UInt64 => slot.ToString(CultureInfo.InvariantCulture),
+                SpecialCaseBoxingTypes.IntPtr => ((nint)(long)slot).ToString(null, CultureInfo.InvariantCulture),
+                SpecialCaseBoxingTypes.UIntPtr => ((nuint)slot).ToString(null, CultureInfo.InvariantCulture),
+                SpecialCaseBoxingTypes.Single => ((float)BitConverter.UInt64BitsToDouble(slot)).ToString(CultureInfo.InvariantCulture),
+                SpecialCaseBoxingTypes.Double => BitConverter.UInt64BitsToDouble(slot).ToString(CultureInfo.InvariantCulture),
+                _ => throw new ArgumentOutOfRangeException(nameof(type)),
+            };
+        }
+    }
+}
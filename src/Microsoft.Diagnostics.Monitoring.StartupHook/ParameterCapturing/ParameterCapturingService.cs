@@ -101,6 +101,21 @@ public void ProbeFault(Guid requestId, InstrumentedMethod faultingMethod)
 
             }
         }
+
+        public void ProbeDisabled(Guid requestId, InstrumentedMethod disabledMethod)
+        {
+            // Capturing continues in the other methods.
+            _eventSource.FailedToCapture(
+                requestId,
+                ParameterCapturingEvents.CapturingFailedReason.ProbeDisabled,
+                string.Format(
+                    CultureInfo.InvariantCulture,
+                    ParameterCapturingStrings.StoppedCapturingParametersDueToProbeOverhead,
+                    disabledMethod.MethodSignature.ModuleName,
+                    disabledMethod.MethodSignature.TypeName,
+                    disabledMethod.MethodSignature.MethodName
+                ));
+        }
         #endregion
 
         private bool IsAvailable()
@@ -97,6 +97,15 @@ internal class ParameterCapturingStrings {
             }
         }
         
+        /// <summary>
+        ///   Looks up a localized string similar to Stopped capturing parameters in &apos;{0}!{1}.{2}&apos; because its probe exceeded the overhead budget..
+        /// </summary>
+        internal static string StoppedCapturingParametersDueToProbeOverhead {
+            get {
+                return ResourceManager.GetString("StoppedCapturingParametersDueToProbeOverhead", resourceCulture);
+            }
+        }
+        
         /// <summary>
         ///   Looks up a localized string similar to Parameter capturing encountered an internal error when processing &apos;{0}!{1}.{2}&apos;, stopping..
         /// </summary>
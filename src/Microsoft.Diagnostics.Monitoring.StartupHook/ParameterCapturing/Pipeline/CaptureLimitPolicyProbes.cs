@@ -36,7 +36,21 @@ public bool EnterProbe(ulong uniquifier, object[] args)
                 return false;
             }
 
-            bool didCapture = _probes.EnterProbe(uniquifier, args);
+            return OnEnterProbe(_probes.EnterProbe(uniquifier, args));
+        }
+
+        public bool EnterProbe(ulong uniquifier, ProbeArguments args)
+        {
+            if (_stopped)
+            {
+                return false;
+            }
+
+            return OnEnterProbe(_probes.EnterProbe(uniquifier, args));
+        }
+
+        private bool OnEnterProbe(bool didCapture)
+        {
             if (didCapture && Interlocked.Increment(ref _captureCount) == _captureLimit)
             {
                 _stopped = true;
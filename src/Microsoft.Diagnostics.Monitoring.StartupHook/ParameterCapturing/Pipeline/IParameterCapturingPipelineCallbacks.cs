@@ -15,5 +15,6 @@ internal interface IParameterCapturingPipelineCallbacks
         public void CapturingStop(Guid requestId);
         public void FailedToCapture(Guid requestId, ParameterCapturingEvents.CapturingFailedReason reason, string details);
         public void ProbeFault(Guid requestId, InstrumentedMethod faultingMethod);
+        public void ProbeDisabled(Guid requestId, InstrumentedMethod disabledMethod);
     }
 }
@@ -65,9 +65,15 @@ void onFault(object? sender, InstrumentedMethod faultingMethod)
                     _callbacks.ProbeFault(request.Payload.RequestId, faultingMethod);
                 }
 
+                void onDisabled(object? sender, InstrumentedMethod disabledMethod)
+                {
+                    _callbacks.ProbeDisabled(request.Payload.RequestId, disabledMethod);
+                }
+
                 try
                 {
                     _probeManager.OnProbeFault += onFault;
+                    _probeManager.OnProbeDisabled += onDisabled;
 
                     if (!await TryStartCapturingAsync(request, stoppingToken).ConfigureAwait(false))
                     {
@@ -102,6 +108,7 @@ void onFault(object? sender, InstrumentedMethod faultingMethod)
                 finally
                 {
                     _probeManager.OnProbeFault -= onFault;
+                    _probeManager.OnProbeDisabled -= onDisabled;
                 }
             }
         }
@@ -20,6 +20,9 @@ public sealed class ProfilerChannel
     {
         private const int MaxPayloadSize = 4 * 1024 * 1024; // 4 MiB
 
+        private const int JobAcceptedPayloadSize = sizeof(int) + sizeof(ulong);
+        private const int JobStatusPayloadSize = sizeof(ulong) + sizeof(uint) + sizeof(int) + sizeof(ulong) + sizeof(ulong);
+
         private IOptionsMonitor<StorageOptions> _storageOptions;
 
         public ProfilerChannel(IOptionsMonitor<StorageOptions> storageOptions)
@@ -27,14 +30,81 @@ public ProfilerChannel(IOptionsMonitor<StorageOptions> storageOptions)
             _storageOptions = storageOptions;
         }
 
-        public async Task SendMessage(IEndpointInfo endpointInfo, IProfilerMessage message, CancellationToken token, TimeSpan timeout)
+        public async Task<ulong> SendMessage(IEndpointInfo endpointInfo, IProfilerMessage message, CancellationToken token, TimeSpan timeout)
         {
             using CancellationTokenSource cancellationTokenSource = new(timeout);
             using CancellationTokenSource linkedCts = CancellationTokenSource.CreateLinkedTokenSource(token, cancellationTokenSource.Token);
-            await SendMessage(endpointInfo, message, linkedCts.Token);
+            return await SendMessage(endpointInfo, message, linkedCts.Token);
+        }
+
+        /// <summary>
+        /// Queues the message in the profiler and returns the id of the job that processes it.
+        /// </summary>
+        public async Task<ulong> SendMessage(IEndpointInfo endpointInfo, IProfilerMessage message, CancellationToken token)
+        {
+            byte[] payload = await SendAndReceiveAsync(endpointInfo, message, ServerResponseCommand.JobAccepted, JobAcceptedPayloadSize, token);
+
+            int hresult = BitConverter.ToInt32(payload, startIndex: 0);
+            Marshal.ThrowExceptionForHR(hresult);
+
+            return BitConverter.ToUInt64(payload, startIndex: sizeof(int));
+        }
+
+        public async Task SendMessageAndWaitForCompletion(IEndpointInfo endpointInfo, IProfilerMessage message, CancellationToken token, TimeSpan timeout)
+        {
+            using CancellationTokenSource cancellationTokenSource = new(timeout);
+            using CancellationTokenSource linkedCts = CancellationTokenSource.CreateLinkedTokenSource(token, cancellationTokenSource.Token);
+
+            ulong jobId = await SendMessage(endpointInfo, message, linkedCts.Token);
+            ProfilerJobStatus status = await WaitForJobCompletion(endpointInfo, jobId, linkedCts.Token);
+            Marshal.ThrowExceptionForHR(status.HResult);
         }
 
-        public async Task SendMessage(IEndpointInfo endpointInfo, IProfilerMessage message, CancellationToken token)
+        public Task<ProfilerJobStatus> GetJobStatus(IEndpointInfo endpointInfo, ulong jobId, CancellationToken token)
+        {
+            return SendJobControlMessage(endpointInfo, JobControlCommand.GetJobStatus, jobId, token);
+        }
+
+        /// <summary>
+        /// Completes once the profiler has finished processing the job.
+        /// </summary>
+        public Task<ProfilerJobStatus> WaitForJobCompletion(IEndpointInfo endpointInfo, ulong jobId, CancellationToken token)
+        {
+            return SendJobControlMessage(endpointInfo, JobControlCommand.WaitForJobCompletion, jobId, token);
+        }
+
+        private async Task<ProfilerJobStatus> SendJobControlMessage(IEndpointInfo endpointInfo, JobControlCommand command, ulong jobId, CancellationToken token)
+        {
+            byte[] payload = await SendAndReceiveAsync(endpointInfo, new JobControlProfilerMessage(command, jobId), ServerResponseCommand.JobStatus, JobStatusPayloadSize, token);
+
+            int offset = 0;
+            ulong statusJobId = BitConverter.ToUInt64(payload, startIndex: offset);
+            offset += sizeof(ulong);
+            JobState state = (JobState)BitConverter.ToUInt32(payload, startIndex: offset);
+            offset += sizeof(uint);
+            int hresult = BitConverter.ToInt32(payload, startIndex: offset);
+            offset += sizeof(int);
+            ulong queuedMicroseconds = BitConverter.ToUInt64(payload, startIndex: offset);
+            offset += sizeof(ulong);
+            ulong runMicroseconds = BitConverter.ToUInt64(payload, startIndex: offset);
+            offset += sizeof(ulong);
+
+            Debug.Assert(offset == payload.Length);
+
+            if (state == JobState.Unknown)
+            {
+                throw new InvalidOperationException("Profiler job status is not available.");
+            }
+
+            return new ProfilerJobStatus(
+                statusJobId,
+                state,
+                hresult,
+                TimeSpan.FromTicks((long)queuedMicroseconds * (TimeSpan.TicksPerMillisecond / 1000)),
+                TimeSpan.FromTicks((long)runMicroseconds * (TimeSpan.TicksPerMillisecond / 1000)));
+        }
+
+        private async Task<byte[]> SendAndReceiveAsync(IEndpointInfo endpointInfo, IProfilerMessage message, ServerResponseCommand expectedResponse, int expectedPayloadSize, CancellationToken token)
         {
             if (message.Payload.Length > MaxPayloadSize)
             {
@@ -69,11 +139,10 @@ public async Task SendMessage(IEndpointInfo endpointInfo, IProfilerMessage messa
                 await socket.SendAsync(new ReadOnlyMemory<byte>(message.Payload), SocketFlags.None, token);
             }
 
-            int hresult = await ReceiveStatusMessageAsync(socket, token);
-            Marshal.ThrowExceptionForHR(hresult);
+            return await ReceiveResponseMessageAsync(socket, expectedResponse, expectedPayloadSize, token);
         }
 
-        private static async Task<int> ReceiveStatusMessageAsync(Socket socket, CancellationToken token)
+        private static async Task<byte[]> ReceiveResponseMessageAsync(Socket socket, ServerResponseCommand expectedResponse, int expectedPayloadSize, CancellationToken token)
         {
             byte[] headersBuffer = new byte[sizeof(ushort) + sizeof(ushort) + sizeof(int)];
             int received = await socket.ReceiveAsync(new Memory<byte>(headersBuffer), SocketFlags.None, token);
@@ -95,7 +164,7 @@ private static async Task<int> ReceiveStatusMessageAsync(Socket socket, Cancella
             ushort command = BitConverter.ToUInt16(headersBuffer, startIndex: headerOffset);
             headerOffset += sizeof(ushort);
 
-            if (command != (ushort)ServerResponseCommand.Status)
+            if (command != (ushort)expectedResponse)
             {
                 throw new InvalidOperationException("Received unexpected command from server.");
             }
@@ -109,7 +178,7 @@ private static async Task<int> ReceiveStatusMessageAsync(Socket socket, Cancella
             // End of header, headerOffset should not be used after this point
             //
 
-            byte[] payloadBuffer = new byte[sizeof(int)];
+            byte[] payloadBuffer = new byte[expectedPayloadSize];
             if (payloadSize != payloadBuffer.Length)
             {
                 throw new InvalidOperationException("Received unexpected payload size from server.");
@@ -121,7 +190,7 @@ private static async Task<int> ReceiveStatusMessageAsync(Socket socket, Cancella
                 throw new InvalidOperationException("Could not receive message payload from server.");
             }
 
-            return BitConverter.ToInt32(payloadBuffer);
+            return payloadBuffer;
         }
 
         private string ComputeChannelPath(IEndpointInfo endpointInfo)
@@ -16,12 +16,31 @@ public enum CommandSet : ushort
     {
         ServerResponse,
         Profiler,
-        StartupHook
+        StartupHook,
+        JobControl,
+        HoldPoint
     }
 
     public enum ServerResponseCommand : ushort
     {
-        Status
+        Status,
+        JobAccepted,
+        JobStatus,
+        UnhandledException
+    };
+
+    public enum JobControlCommand : ushort
+    {
+        GetJobStatus,
+        WaitForJobCompletion
+    };
+
+    public enum JobState : uint
+    {
+        Unknown,
+        Queued,
+        Running,
+        Completed
     };
 
     public enum ProfilerCommand : ushort
@@ -69,6 +88,37 @@ private static byte[] SerializePayload(object payloadObject)
         }
     }
 
+    public struct JobControlProfilerMessage : IProfilerMessage
+    {
+        public ushort CommandSet { get; } = (ushort)Monitoring.CommandSet.JobControl;
+        public ushort Command { get; }
+        public byte[] Payload { get; }
+
+        public JobControlProfilerMessage(JobControlCommand command, ulong jobId)
+        {
+            Command = (ushort)command;
+            Payload = BitConverter.GetBytes(jobId);
+        }
+    }
+
+    public readonly struct ProfilerJobStatus
+    {
+        public ulong JobId { get; }
+        public JobState State { get; }
+        public int HResult { get; }
+        public TimeSpan QueuedDuration { get; }
+        public TimeSpan RunDuration { get; }
+
+        public ProfilerJobStatus(ulong jobId, JobState state, int hresult, TimeSpan queuedDuration, TimeSpan runDuration)
+        {
+            JobId = jobId;
+            State = state;
+            HResult = hresult;
+            QueuedDuration = queuedDuration;
+            RunDuration = runDuration;
+        }
+    }
+
     public struct CommandOnlyProfilerMessage : IProfilerMessage
     {
         public ushort CommandSet { get; }
@@ -4,14 +4,53 @@
 #pragma once
 
 #include <queue>
+#include <vector>
 #include <mutex>
+#include <utility>
 #include <condition_variable>
 
+/// <summary>
+/// Single consumer queue. Items are moved in and out of the queue so that payloads owning buffers
+/// are never deep copied between threads.
+/// When constructed with a non-zero capacity, Enqueue blocks once the queue is full until the consumer
+/// catches up or the queue is completed, and TryEnqueue fails instead of waiting.
+/// </summary>
 template<typename T>
 class BlockingQueue final
 {
 public:
+    explicit BlockingQueue(size_t capacity = 0) : _capacity(capacity)
+    {
+    }
+
+    BlockingQueue(const BlockingQueue&) = delete;
+    BlockingQueue& operator=(const BlockingQueue&) = delete;
+
     HRESULT Enqueue(const T& item)
+    {
+        return Enqueue(T(item));
+    }
+
+    HRESULT Enqueue(T&& item)
+    {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _notFullCondition.wait(lock, [this]() { return !IsFull() || _complete; });
+            if (_complete)
+            {
+                return E_UNEXPECTED;
+            }
+            _queue.push(std::move(item));
+        }
+        _notEmptyCondition.notify_one();
+
+        return S_OK;
+    }
+
+    /// <summary>
+    /// Enqueues without waiting for capacity. Returns S_FALSE and leaves item untouched if the queue is full.
+    /// </summary>
+    HRESULT TryEnqueue(T&& item)
     {
         {
             std::lock_guard<std::mutex> lock(_mutex);
@@ -19,27 +58,65 @@ public:
             {
                 return E_UNEXPECTED;
             }
-            _queue.push(item);
+            if (IsFull())
+            {
+                return S_FALSE;
+            }
+            _queue.push(std::move(item));
         }
-        _condition.notify_all();
+        _notEmptyCondition.notify_one();
 
         return S_OK;
     }
 
     HRESULT BlockingDequeue(T& item)
+    {
+        HRESULT hr;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _notEmptyCondition.wait(lock, [this]() { return !_queue.empty() || _complete; });
+
+            //We can't really tell if the caller wants to drain the remaining entries or simply abandon the queue
+            if (_queue.empty())
+            {
+                return E_FAIL;
+            }
+
+            item = std::move(_queue.front());
+            _queue.pop();
+            hr = _complete ? S_FALSE : S_OK;
+        }
+        _notFullCondition.notify_one();
+
+        return hr;
+    }
+
+    /// <summary>
+    /// Blocks until at least one item is available, then moves up to maxCount items into items.
+    /// Return values follow BlockingDequeue.
+    /// </summary>
+    HRESULT BlockingDequeueBatch(std::vector<T>& items, size_t maxCount)
     {
         std::unique_lock<std::mutex> lock(_mutex);
-        _condition.wait(lock, [this]() { return !_queue.empty() || _complete; });
+        _notEmptyCondition.wait(lock, [this]() { return !_queue.empty() || _complete; });
 
-        //We can't really tell if the caller wants to drain the remaining entries or simply abandon the queue
-        if (!_queue.empty())
+        return DequeueBatch(lock, items, maxCount);
+    }
+
+    /// <summary>
+    /// Moves up to maxCount items into items without blocking.
+    /// Returns S_OK if any items were dequeued, S_FALSE if the queue was empty, and E_FAIL if the queue is complete and empty.
+    /// </summary>
+    HRESULT TryDequeueBatch(std::vector<T>& items, size_t maxCount)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        if (_queue.empty())
         {
-            item = _queue.front();
-            _queue.pop();
-            return _complete ? S_FALSE : S_OK;
+            return _complete ? E_FAIL : S_FALSE;
         }
 
-        return E_FAIL;
+        HRESULT hr = DequeueBatch(lock, items, maxCount);
+        return SUCCEEDED(hr) ? S_OK : hr;
     }
 
     void Complete()
@@ -48,12 +125,51 @@ public:
             std::lock_guard<std::mutex> lock(_mutex);
             _complete = true;
         }
-        _condition.notify_all();
+        _notEmptyCondition.notify_all();
+        _notFullCondition.notify_all();
     }
 
 private:
+    bool IsFull() const
+    {
+        return _capacity != 0 && _queue.size() >= _capacity;
+    }
+
+    // Releases the lock before waking producers.
+    HRESULT DequeueBatch(std::unique_lock<std::mutex>& lock, std::vector<T>& items, size_t maxCount)
+    {
+        if (_queue.empty())
+        {
+            return E_FAIL;
+        }
+
+        size_t count = 0;
+        while (!_queue.empty() && count < maxCount)
+        {
+            items.push_back(std::move(_queue.front()));
+            _queue.pop();
+            count++;
+        }
+
+        HRESULT hr = _complete ? S_FALSE : S_OK;
+        lock.unlock();
+
+        if (count == 1)
+        {
+            _notFullCondition.notify_one();
+        }
+        else if (count > 1)
+        {
+            _notFullCondition.notify_all();
+        }
+
+        return hr;
+    }
+
+    const size_t _capacity;
     std::queue<T> _queue;
     std::mutex _mutex;
-    std::condition_variable _condition;
+    std::condition_variable _notEmptyCondition;
+    std::condition_variable _notFullCondition;
     bool _complete = false;
-};
\ No newline at end of file
+};
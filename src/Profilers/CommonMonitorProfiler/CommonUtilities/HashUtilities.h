@@ -0,0 +1,25 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+class HashUtilities final
+{
+public:
+    /// <summary>
+    /// Spreads every bit of the value into the low bits of the result, so that ids and pointers, whose
+    /// low bits are mostly zero, can index a power of two sized table. This is the MurmurHash3 finalizer.
+    /// </summary>
+    static size_t Mix(uint64_t value)
+    {
+        value ^= value >> 33;
+        value *= 0xff51afd7ed558ccdULL;
+        value ^= value >> 33;
+        value *= 0xc4ceb9fe1a85ec53ULL;
+        value ^= value >> 33;
+        return static_cast<size_t>(value);
+    }
+};
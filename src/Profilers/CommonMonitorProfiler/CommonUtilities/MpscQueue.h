@@ -0,0 +1,172 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include "WakeSignal.h"
+
+/// <summary>
+/// Link embedded in items stored in an MpscQueue.
+/// </summary>
+class MpscQueueNode
+{
+public:
+    MpscQueueNode() : _next(nullptr)
+    {
+    }
+
+private:
+    template<typename T>
+    friend class MpscQueue;
+
+    std::atomic<MpscQueueNode*> _next;
+};
+
+/// <summary>
+/// Lock-free intrusive multi-producer/single-consumer queue, for handing work from profiler callbacks
+/// running on application threads to a background thread.
+/// Enqueue never takes a lock or waits on the consumer; it only enters the kernel to wake a parked consumer.
+/// The queue owns enqueued items until they are dequeued. T must derive from MpscQueueNode.
+/// </summary>
+template<typename T>
+class MpscQueue final
+{
+public:
+    MpscQueue() :
+        _head(&_stub),
+        _tail(&_stub),
+        _complete(false)
+    {
+    }
+
+    ~MpscQueue()
+    {
+        T* item;
+        while ((item = TryPop()) != nullptr)
+        {
+            delete item;
+        }
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    HRESULT Enqueue(std::unique_ptr<T>&& item)
+    {
+        if (_complete.load(std::memory_order_acquire))
+        {
+            return E_UNEXPECTED;
+        }
+
+        Push(item.release());
+        _signal.Signal();
+
+        return S_OK;
+    }
+
+    /// <summary>
+    /// Consumer only. Returns S_OK and an item if one is available, S_FALSE if the queue is empty.
+    /// </summary>
+    HRESULT TryDequeue(std::unique_ptr<T>& item)
+    {
+        T* pItem = TryPop();
+        if (pItem == nullptr)
+        {
+            return S_FALSE;
+        }
+
+        item.reset(pItem);
+        return S_OK;
+    }
+
+    /// <summary>
+    /// Consumer only. Return values follow BlockingQueue::BlockingDequeue.
+    /// </summary>
+    HRESULT BlockingDequeue(std::unique_ptr<T>& item)
+    {
+        while (true)
+        {
+            // Read completion before popping so that items enqueued before Complete are always observed.
+            bool complete = _complete.load(std::memory_order_acquire);
+
+            T* pItem = TryPop();
+            if (pItem != nullptr)
+            {
+                item.reset(pItem);
+                return complete ? S_FALSE : S_OK;
+            }
+
+            if (complete)
+            {
+                return E_FAIL;
+            }
+
+            _signal.Wait();
+        }
+    }
+
+    void Complete()
+    {
+        _complete.store(true, std::memory_order_release);
+        _signal.Signal();
+    }
+
+private:
+    void Push(MpscQueueNode* node)
+    {
+        node->_next.store(nullptr, std::memory_order_relaxed);
+        MpscQueueNode* prev = _head.exchange(node, std::memory_order_acq_rel);
+        // Between the exchange and this store, the consumer sees the queue as empty past prev.
+        // The producer signals after linking, so the consumer is always woken to retry.
+        prev->_next.store(node, std::memory_order_release);
+    }
+
+    T* TryPop()
+    {
+        MpscQueueNode* tail = _tail;
+        MpscQueueNode* next = tail->_next.load(std::memory_order_acquire);
+
+        if (tail == &_stub)
+        {
+            if (next == nullptr)
+            {
+                return nullptr;
+            }
+            _tail = next;
+            tail = next;
+            next = next->_next.load(std::memory_order_acquire);
+        }
+
+        if (next != nullptr)
+        {
+            _tail = next;
+            return static_cast<T*>(tail);
+        }
+
+        if (tail != _head.load(std::memory_order_acquire))
+        {
+            // A producer is between its exchange and link.
+            return nullptr;
+        }
+
+        // tail is the last item, re-insert the stub so that it can be detached.
+        Push(&_stub);
+
+        next = tail->_next.load(std::memory_order_acquire);
+        if (next != nullptr)
+        {
+            _tail = next;
+            return static_cast<T*>(tail);
+        }
+
+        return nullptr;
+    }
+
+    std::atomic<MpscQueueNode*> _head;
+    MpscQueueNode* _tail;
+    MpscQueueNode _stub;
+    std::atomic_bool _complete;
+    WakeSignal _signal;
+};
@@ -0,0 +1,95 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#include "WakeSignal.h"
+#if TARGET_WINDOWS
+#include <Windows.h>
+#elif TARGET_LINUX
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+WakeSignal::WakeSignal() :
+    _state(StateIdle)
+{
+#if TARGET_WINDOWS
+    // Auto-reset, initially unset.
+    _event = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+#endif
+}
+
+WakeSignal::~WakeSignal()
+{
+#if TARGET_WINDOWS
+    if (_event != nullptr)
+    {
+        CloseHandle(_event);
+    }
+#endif
+}
+
+void WakeSignal::Signal()
+{
+    // Producers that find the signal already set do not need to do anything.
+    if (_state.load(std::memory_order_relaxed) == StateSignaled)
+    {
+        return;
+    }
+
+    if (_state.exchange(StateSignaled) == StateWaiting)
+    {
+        Unpark();
+    }
+}
+
+void WakeSignal::Wait()
+{
+    while (true)
+    {
+        int state = _state.load();
+        if (state == StateSignaled)
+        {
+            if (_state.compare_exchange_weak(state, StateIdle))
+            {
+                return;
+            }
+            continue;
+        }
+
+        if (state == StateIdle && !_state.compare_exchange_weak(state, StateWaiting))
+        {
+            continue;
+        }
+
+        // Returns early if the state is no longer StateWaiting. Spurious wake-ups loop back around.
+        Park();
+    }
+}
+
+void WakeSignal::Park()
+{
+#if TARGET_WINDOWS
+    WaitForSingleObject(_event, INFINITE);
+#elif TARGET_LINUX
+    syscall(SYS_futex, reinterpret_cast<int*>(&_state), FUTEX_WAIT_PRIVATE, StateWaiting, nullptr, nullptr, 0);
+#else
+    std::unique_lock<std::mutex> lock(_mutex);
+    _condition.wait(lock, [this]() { return _state.load() != StateWaiting; });
+#endif
+}
+
+void WakeSignal::Unpark()
+{
+#if TARGET_WINDOWS
+    SetEvent(_event);
+#elif TARGET_LINUX
+    syscall(SYS_futex, reinterpret_cast<int*>(&_state), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#else
+    {
+        // Taking the lock orders this with the waiter's predicate check.
+        std::lock_guard<std::mutex> lock(_mutex);
+    }
+    _condition.notify_one();
+#endif
+}
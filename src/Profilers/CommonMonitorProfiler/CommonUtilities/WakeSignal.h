@@ -0,0 +1,52 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#pragma once
+
+#include <atomic>
+#if !TARGET_WINDOWS && !TARGET_LINUX
+#include <mutex>
+#include <condition_variable>
+#endif
+
+/// <summary>
+/// Auto-reset wake-up signal for a single waiting thread.
+/// Signal only enters the kernel when the waiter is parked, so signaling an awake consumer is a single atomic exchange.
+/// Uses a futex on Linux and an event on Windows.
+/// </summary>
+class WakeSignal final
+{
+public:
+    WakeSignal();
+    ~WakeSignal();
+
+    WakeSignal(const WakeSignal&) = delete;
+    WakeSignal& operator=(const WakeSignal&) = delete;
+
+    /// <summary>
+    /// Wakes the waiting thread, or lets its next Wait call return immediately. Safe to call from any thread.
+    /// </summary>
+    void Signal();
+
+    /// <summary>
+    /// Blocks until Signal is called. Only one thread may wait at a time.
+    /// </summary>
+    void Wait();
+
+private:
+    static const int StateIdle = 0;
+    static const int StateSignaled = 1;
+    static const int StateWaiting = 2;
+
+    void Park();
+    void Unpark();
+
+    std::atomic<int> _state;
+
+#if TARGET_WINDOWS
+    void* _event;
+#elif !TARGET_LINUX
+    std::mutex _mutex;
+    std::condition_variable _condition;
+#endif
+};
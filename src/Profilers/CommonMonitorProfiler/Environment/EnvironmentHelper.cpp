@@ -83,6 +83,11 @@ HRESULT EnvironmentHelper::GetStdErrLoggerLevel(LogLevel& level)
     return S_OK;
 }
 
+HRESULT EnvironmentHelper::GetIsStdErrLoggerAsync(bool& isAsync)
+{
+    return GetIsFeatureEnabled(StdErrLoggerAsyncEnvVar, isAsync);
+}
+
 HRESULT EnvironmentHelper::GetTempFolder(tstring& tempFolder)
 {
     HRESULT hr = S_OK;
@@ -132,5 +137,45 @@ HRESULT EnvironmentHelper::GetIsFeatureEnabled(const LPCWSTR featureName, bool&
     }
 
 
+    return S_OK;
+}
+
+HRESULT EnvironmentHelper::GetUInt32Value(const LPCWSTR name, UINT32& value)
+{
+    HRESULT hr;
+
+    tstring envValue;
+    hr = _environment->GetEnvironmentVariable(name, envValue);
+    if (FAILED(hr))
+    {
+        if (hr != HRESULT_FROM_WIN32(ERROR_ENVVAR_NOT_FOUND))
+        {
+            return hr;
+        }
+        return S_OK;
+    }
+
+    if (envValue.empty())
+    {
+        return E_INVALIDARG;
+    }
+
+    UINT64 result = 0;
+    for (tstring::value_type c : envValue)
+    {
+        if (c < _T('0') || c > _T('9'))
+        {
+            return E_INVALIDARG;
+        }
+
+        result = result * 10 + (c - _T('0'));
+        if (result > UINT32_MAX)
+        {
+            return E_INVALIDARG;
+        }
+    }
+
+    value = static_cast<UINT32>(result);
+
     return S_OK;
 }
\ No newline at end of file
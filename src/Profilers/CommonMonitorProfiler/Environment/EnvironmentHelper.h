@@ -23,6 +23,7 @@ private:
     static constexpr LPCWSTR RuntimeInstanceEnvVar = _T("DotnetMonitor_Profiler_RuntimeInstanceId");
     static constexpr LPCWSTR SharedPathEnvVar = _T("DotnetMonitor_Profiler_SharedPath");
     static constexpr LPCWSTR StdErrLoggerLevelEnvVar = _T("DotnetMonitor_Profiler_StdErrLogger_Level");
+    static constexpr LPCWSTR StdErrLoggerAsyncEnvVar = _T("DotnetMonitor_Profiler_StdErrLogger_Async");
 
     std::shared_ptr<IEnvironment> _environment;
     std::shared_ptr<ILogger> _logger;
@@ -62,7 +63,17 @@ public:
     /// </summary>
     HRESULT GetStdErrLoggerLevel(LogLevel& level);
 
+    /// <summary>
+    /// Gets whether the stderr logger writes on a background thread.
+    /// </summary>
+    HRESULT GetIsStdErrLoggerAsync(bool& isAsync);
+
     HRESULT GetTempFolder(tstring& tempFolder);
 
     HRESULT GetIsFeatureEnabled(const LPCWSTR featureName, bool& isEnabled);
+
+    /// <summary>
+    /// Gets an unsigned integer setting from the environment. value is left unchanged if the variable is not set.
+    /// </summary>
+    HRESULT GetUInt32Value(const LPCWSTR name, UINT32& value);
 };
@@ -0,0 +1,217 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#include "AsyncLogger.h"
+#include "macros.h"
+#include <cstring>
+#include <system_error>
+
+using namespace std;
+
+AsyncLogger::AsyncLogger(const shared_ptr<ILogger>& pLogger) :
+    _logger(pLogger),
+    _enqueuePosition(0),
+    _droppedCount(0),
+    _activeProducers(0),
+    _dequeuePosition(0),
+    _isRunning(false)
+{
+}
+
+AsyncLogger::~AsyncLogger()
+{
+    Shutdown();
+}
+
+HRESULT AsyncLogger::Start()
+{
+    if (_records)
+    {
+        return E_UNEXPECTED;
+    }
+
+    _records.reset(new (nothrow) Record[Capacity]);
+    IfNullRet(_records);
+
+    for (size_t i = 0; i < Capacity; i++)
+    {
+        _records[i].Sequence.store(i, memory_order_relaxed);
+    }
+
+    // Set before the thread starts, so that the thread does not see a shutdown.
+    _isRunning.store(true);
+
+    try
+    {
+        _writerThread = thread(&AsyncLogger::WriterThread, this);
+    }
+    catch (const bad_alloc&)
+    {
+        _isRunning.store(false);
+        return E_OUTOFMEMORY;
+    }
+    catch (const system_error&)
+    {
+        _isRunning.store(false);
+        return E_FAIL;
+    }
+
+    return S_OK;
+}
+
+void AsyncLogger::Shutdown()
+{
+    // Only the first call stops the thread.
+    if (!_isRunning.exchange(false))
+    {
+        return;
+    }
+
+    if (_stoppingCallback)
+    {
+        _stoppingCallback();
+    }
+
+    _signal.Signal();
+    _writerThread.join();
+
+    lock_guard<mutex> lock(_writeMutex);
+    DrainAfterShutdown();
+}
+
+void AsyncLogger::SetStoppingCallback(function<void()> callback)
+{
+    _stoppingCallback = std::move(callback);
+}
+
+STDMETHODIMP_(bool) AsyncLogger::IsEnabled(LogLevel level)
+{
+    return _logger->IsEnabled(level);
+}
+
+STDMETHODIMP AsyncLogger::Log(LogLevel level, const lstring& message)
+{
+    if (!IsEnabled(level))
+    {
+        return S_FALSE;
+    }
+
+    //
+    // Counted before _isRunning is read, and both are sequentially consistent: either Shutdown sees this thread
+    // and waits for its record, or this thread sees the shutdown.
+    //
+    _activeProducers.fetch_add(1);
+    if (!_isRunning.load())
+    {
+        _activeProducers.fetch_sub(1, memory_order_release);
+
+        // Anything queued before the shutdown is written first.
+        lock_guard<mutex> lock(_writeMutex);
+        DrainAfterShutdown();
+        return _logger->Log(level, message);
+    }
+
+    // Claim the record at the enqueue position; the position only advances past records the writer has freed.
+    Record* record;
+    size_t position = _enqueuePosition.load(memory_order_relaxed);
+    while (true)
+    {
+        record = &_records[position & (Capacity - 1)];
+        size_t sequence = record->Sequence.load(memory_order_acquire);
+        intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+        if (difference == 0)
+        {
+            if (_enqueuePosition.compare_exchange_weak(position, position + 1, memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (difference < 0)
+        {
+            // The writer has not freed this record since the last time around the ring.
+            _droppedCount.fetch_add(1, memory_order_relaxed);
+            _activeProducers.fetch_sub(1, memory_order_release);
+            return S_FALSE;
+        }
+        else
+        {
+            // Another thread claimed this position.
+            position = _enqueuePosition.load(memory_order_relaxed);
+        }
+    }
+
+    size_t length = min(message.length(), MaxEntrySize - 1);
+    memcpy(record->Message, message.c_str(), length * sizeof(LCHAR));
+    record->Message[length] = _LS('\0');
+    record->Length = length;
+    record->Level = level;
+
+    // Publishes the record to the writer thread.
+    record->Sequence.store(position + 1, memory_order_release);
+    _activeProducers.fetch_sub(1, memory_order_release);
+
+    _signal.Signal();
+
+    return S_OK;
+}
+
+void AsyncLogger::WriterThread()
+{
+    while (_isRunning.load())
+    {
+        {
+            lock_guard<mutex> lock(_writeMutex);
+            Drain();
+        }
+
+        _signal.Wait();
+    }
+}
+
+void AsyncLogger::DrainAfterShutdown()
+{
+    if (!_records)
+    {
+        return;
+    }
+
+    // Producers that claimed a record before the shutdown are about to publish it.
+    while (_activeProducers.load() != 0)
+    {
+        this_thread::yield();
+    }
+
+    Drain();
+}
+
+void AsyncLogger::Drain()
+{
+    while (true)
+    {
+        Record& record = _records[_dequeuePosition & (Capacity - 1)];
+        if (record.Sequence.load(memory_order_acquire) != _dequeuePosition + 1)
+        {
+            // Empty, or the next record is still being written; its producer signals once it is published.
+            break;
+        }
+
+        try
+        {
+            _logger->Log(record.Level, lstring(record.Message, record.Length));
+        }
+        catch (const bad_alloc&)
+        {
+            _droppedCount.fetch_add(1, memory_order_relaxed);
+        }
+
+        // Frees the record for the producer that is one time around the ring ahead.
+        record.Sequence.store(_dequeuePosition + Capacity, memory_order_release);
+        _dequeuePosition++;
+    }
+
+    UINT64 droppedCount = _droppedCount.exchange(0, memory_order_relaxed);
+    if (droppedCount > 0)
+    {
+        _logger->Log(LogLevel::Warning, _LS("Dropped %llu log messages"), static_cast<unsigned long long>(droppedCount));
+    }
+}
@@ -0,0 +1,94 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "Logger.h"
+#include "../CommonUtilities/WakeSignal.h"
+
+/// <summary>
+/// Hands messages to another ILogger implementation on a background thread, so that logging from
+/// profiler callbacks does not wait on the underlying stream.
+/// </summary>
+/// <remarks>
+/// Messages are copied into a fixed size ring of preformatted records. While the writer thread runs, Log never takes
+/// a lock or allocates; when the ring is full the message is dropped and counted, and the count is logged by the
+/// writer thread. Shutdown writes the messages still in the ring, and the profiler must call it before the process
+/// exits. After Shutdown, Log writes on the calling thread, after anything still queued.
+/// </remarks>
+class AsyncLogger final :
+    public ILogger
+{
+private:
+    // Must be a power of two.
+    static const size_t Capacity = 256;
+    const static size_t MaxEntrySize = 1000;
+
+    class Record
+    {
+        public:
+            // Equals the enqueue position when the record is free, and the enqueue position plus one once written.
+            std::atomic<size_t> Sequence{ 0 };
+            LogLevel Level = LogLevel::None;
+            size_t Length = 0;
+            LCHAR Message[MaxEntrySize];
+    };
+
+    std::shared_ptr<ILogger> _logger;
+
+    std::unique_ptr<Record[]> _records;
+    std::atomic<size_t> _enqueuePosition;
+    std::atomic<UINT64> _droppedCount;
+    // Threads in Log that may be claiming or writing a record.
+    std::atomic<size_t> _activeProducers;
+
+    // Serializes draining and every write to _logger, so that messages are never interleaved
+    // and are written in order once Log stops queuing them.
+    std::mutex _writeMutex;
+    size_t _dequeuePosition;
+
+    std::thread _writerThread;
+    WakeSignal _signal;
+    // Set from Start until Shutdown; messages are only queued while it is set.
+    std::atomic_bool _isRunning;
+    std::function<void()> _stoppingCallback;
+
+public:
+    AsyncLogger(const std::shared_ptr<ILogger>& pLogger);
+    ~AsyncLogger();
+
+    HRESULT Start();
+
+    /// <summary>
+    /// Stops the writer thread and writes the queued messages, including those still being queued by other threads.
+    /// </summary>
+    void Shutdown();
+
+    /// <summary>
+    /// Sets a callback that Shutdown calls once Log has stopped queuing messages, before waiting for the writer thread.
+    /// Must be set before Shutdown is called.
+    /// </summary>
+    void SetStoppingCallback(std::function<void()> callback);
+
+public:
+    // ILogger Members
+
+    /// <inheritdoc />
+    STDMETHOD_(bool, IsEnabled)(LogLevel level) override;
+
+    /// <summary>
+    /// Queues the message for the writer thread. Returns S_FALSE if the message was dropped.
+    /// </summary>
+    STDMETHOD(Log)(LogLevel level, const lstring& message) override;
+
+private:
+    void WriterThread();
+    // Both called with _writeMutex held.
+    void DrainAfterShutdown();
+    void Drain();
+};
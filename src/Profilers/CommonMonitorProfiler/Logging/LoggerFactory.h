@@ -5,16 +5,23 @@
 
 #include "Logger.h"
 #include "AggregateLogger.h"
+#include "AsyncLogger.h"
 #include "DebugLogger.h"
+#include "NullLogger.h"
 #include "StdErrLogger.h"
 #include "Environment/Environment.h"
+#include "Environment/EnvironmentHelper.h"
 
 #include <memory>
 
 class LoggerFactory
 {
     public:
-        static HRESULT Create(std::shared_ptr<IEnvironment> pEnvironment, std::shared_ptr<ILogger>& pLogger)
+        /// <summary>
+        /// Creates the logger. pAsyncLogger is set when stderr is written on a background thread,
+        /// and must be shut down by the profiler's Shutdown so that queued messages are written.
+        /// </summary>
+        static HRESULT Create(std::shared_ptr<IEnvironment> pEnvironment, std::shared_ptr<ILogger>& pLogger, std::shared_ptr<AsyncLogger>& pAsyncLogger)
         {
             HRESULT hr = S_OK;
 
@@ -24,7 +31,30 @@ class LoggerFactory
 
             std::shared_ptr<StdErrLogger> pStdErrLogger = std::make_shared<StdErrLogger>(pEnvironment);
             IfNullRet(pStdErrLogger);
-            pAggregateLogger->Add(pStdErrLogger);
+
+            // Optionally move writes to stderr off of the logging threads
+            bool isAsync = false;
+            EnvironmentHelper helper(pEnvironment, NullLogger::Instance);
+            pAsyncLogger.reset();
+            if (SUCCEEDED(helper.GetIsStdErrLoggerAsync(isAsync)) && isAsync)
+            {
+                std::shared_ptr<AsyncLogger> pNewAsyncLogger = std::make_shared<AsyncLogger>(pStdErrLogger);
+                IfNullRet(pNewAsyncLogger);
+                if (SUCCEEDED(pNewAsyncLogger->Start()))
+                {
+                    pAggregateLogger->Add(pNewAsyncLogger);
+                    pAsyncLogger = pNewAsyncLogger;
+                }
+                else
+                {
+                    // Fallback to writing on the logging threads
+                    pAggregateLogger->Add(pStdErrLogger);
+                }
+            }
+            else
+            {
+                pAggregateLogger->Add(pStdErrLogger);
+            }
 
 #ifdef _DEBUG
 #ifdef TARGET_WINDOWS
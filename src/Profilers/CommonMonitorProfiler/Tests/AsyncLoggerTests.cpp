@@ -0,0 +1,325 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+//
+// Logs through AsyncLogger to an in-memory logger, without a runtime.
+// Returns the number of failed checks.
+//
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Logging/AsyncLogger.h"
+#include "TestChecks.h"
+
+using namespace std;
+
+namespace
+{
+    const lstring DroppedPrefix = _LS("Dropped ");
+
+    lstring ToLString(size_t value)
+    {
+#ifdef TARGET_WINDOWS
+        return to_wstring(value);
+#else
+        return to_string(value);
+#endif
+    }
+
+    /// <summary>
+    /// Manual reset event, set once the expected number of threads have called Set.
+    /// </summary>
+    class Event final
+    {
+    private:
+        mutex _mutex;
+        condition_variable _condition;
+        size_t _remaining;
+
+    public:
+        Event(size_t count = 1) : _remaining(count)
+        {
+        }
+
+        void Set()
+        {
+            lock_guard<mutex> lock(_mutex);
+            if (_remaining > 0 && --_remaining == 0)
+            {
+                _condition.notify_all();
+            }
+        }
+
+        void Wait()
+        {
+            unique_lock<mutex> lock(_mutex);
+            _condition.wait(lock, [this]() { return _remaining == 0; });
+        }
+    };
+
+    /// <summary>
+    /// Keeps every message, and can hold the writer inside Log until it is opened.
+    /// </summary>
+    class RecordingLogger final :
+        public ILogger
+    {
+    private:
+        mutex _mutex;
+        condition_variable _condition;
+        bool _isOpen = true;
+        bool _isWaiting = false;
+        atomic_bool _isLogging{ false };
+        vector<lstring> _messages;
+
+    public:
+        STDMETHOD_(bool, IsEnabled)(LogLevel level) override
+        {
+            return true;
+        }
+
+        STDMETHOD(Log)(LogLevel level, const lstring& message) override
+        {
+            // AsyncLogger never calls the logger it wraps from two threads at once.
+            CHECK(!_isLogging.exchange(true));
+
+            {
+                unique_lock<mutex> lock(_mutex);
+                _isWaiting = true;
+                _condition.notify_all();
+                _condition.wait(lock, [this]() { return _isOpen; });
+                _isWaiting = false;
+                _messages.push_back(message);
+            }
+
+            _isLogging.store(false);
+            return S_OK;
+        }
+
+        void Close()
+        {
+            lock_guard<mutex> lock(_mutex);
+            _isOpen = false;
+        }
+
+        void Open()
+        {
+            lock_guard<mutex> lock(_mutex);
+            _isOpen = true;
+            _condition.notify_all();
+        }
+
+        void WaitForWaitingWriter()
+        {
+            unique_lock<mutex> lock(_mutex);
+            _condition.wait(lock, [this]() { return _isWaiting; });
+        }
+
+        vector<lstring> GetMessages()
+        {
+            lock_guard<mutex> lock(_mutex);
+            return _messages;
+        }
+    };
+
+    /// <summary>
+    /// Splits the messages into those that were logged and the sum of the reported drops.
+    /// </summary>
+    size_t SplitDropped(const vector<lstring>& messages, vector<lstring>& logged)
+    {
+        size_t droppedCount = 0;
+        for (const lstring& message : messages)
+        {
+            if (message.compare(0, DroppedPrefix.length(), DroppedPrefix) == 0)
+            {
+                droppedCount += stoull(message.substr(DroppedPrefix.length()));
+            }
+            else
+            {
+                logged.push_back(message);
+            }
+        }
+        return droppedCount;
+    }
+
+    void Overflow_DropsAndCountsMessages()
+    {
+        const size_t MessageCount = 1000;
+
+        shared_ptr<RecordingLogger> pRecordingLogger = make_shared<RecordingLogger>();
+        AsyncLogger logger(pRecordingLogger);
+        CHECK(SUCCEEDED(logger.Start()));
+
+        // Holds the writer inside the first message, so that nothing else is written until the ring has filled.
+        pRecordingLogger->Close();
+        CHECK(logger.Log(LogLevel::Information, _LS("first")) == S_OK);
+        pRecordingLogger->WaitForWaitingWriter();
+
+        size_t queuedCount = 0;
+        size_t droppedCount = 0;
+        for (size_t i = 0; i < MessageCount; i++)
+        {
+            HRESULT hr = logger.Log(LogLevel::Information, ToLString(i));
+            CHECK(SUCCEEDED(hr));
+            if (hr == S_OK)
+            {
+                // Once the ring is full, every later message is dropped.
+                CHECK(droppedCount == 0);
+                queuedCount++;
+            }
+            else
+            {
+                droppedCount++;
+            }
+        }
+        CHECK(queuedCount > 0);
+        CHECK(droppedCount > 0);
+
+        pRecordingLogger->Open();
+        logger.Shutdown();
+
+        vector<lstring> messages = pRecordingLogger->GetMessages();
+        CHECK(messages.size() == queuedCount + 2);
+        if (messages.size() != queuedCount + 2)
+        {
+            return;
+        }
+
+        CHECK(messages.front() == _LS("first"));
+        for (size_t i = 0; i < queuedCount; i++)
+        {
+            CHECK(messages[i + 1] == ToLString(i));
+        }
+        CHECK(messages.back() == DroppedPrefix + ToLString(droppedCount) + _LS(" log messages"));
+    }
+
+    void Shutdown_WritesQueuedMessagesBeforeLaterOnes()
+    {
+        shared_ptr<RecordingLogger> pRecordingLogger = make_shared<RecordingLogger>();
+        AsyncLogger logger(pRecordingLogger);
+        CHECK(SUCCEEDED(logger.Start()));
+
+        pRecordingLogger->Close();
+        CHECK(logger.Log(LogLevel::Information, _LS("queued 1")) == S_OK);
+        pRecordingLogger->WaitForWaitingWriter();
+        CHECK(logger.Log(LogLevel::Information, _LS("queued 2")) == S_OK);
+
+        //
+        // Logs on the calling thread once the writer is stopping, while the writer is still held inside the first
+        // message; the late message waits for the writer and is written after the queued ones.
+        //
+        Event stopping;
+        Event logging;
+        logger.SetStoppingCallback([&stopping]() { stopping.Set(); });
+        thread shutdownThread([&logger]() { logger.Shutdown(); });
+        thread lateThread([&logger, &stopping, &logging]()
+        {
+            stopping.Wait();
+            logging.Set();
+            CHECK(logger.Log(LogLevel::Information, _LS("late")) == S_OK);
+        });
+        logging.Wait();
+        pRecordingLogger->Open();
+
+        shutdownThread.join();
+        lateThread.join();
+
+        CHECK(logger.Log(LogLevel::Information, _LS("after")) == S_OK);
+
+        // Shutdown can be called again, as the destructor does.
+        logger.Shutdown();
+
+        vector<lstring> messages = pRecordingLogger->GetMessages();
+        CHECK(messages.size() == 4);
+        if (messages.size() != 4)
+        {
+            return;
+        }
+
+        CHECK(messages[0] == _LS("queued 1"));
+        CHECK(messages[1] == _LS("queued 2"));
+        CHECK(messages[2] == _LS("late"));
+        CHECK(messages[3] == _LS("after"));
+    }
+
+    void ConcurrentShutdown_AccountsForEveryMessage()
+    {
+        const size_t ThreadCount = 4;
+        const size_t MessagesPerThread = 5000;
+
+        shared_ptr<RecordingLogger> pRecordingLogger = make_shared<RecordingLogger>();
+        AsyncLogger logger(pRecordingLogger);
+        CHECK(SUCCEEDED(logger.Start()));
+
+        // Shuts down once every thread is logging, so that some messages are logged before and some after.
+        atomic<size_t> droppedCount(0);
+        Event logging(ThreadCount);
+        vector<thread> threads;
+        for (size_t t = 0; t < ThreadCount; t++)
+        {
+            threads.emplace_back([&logger, &droppedCount, &logging, t]()
+            {
+                for (size_t i = 0; i < MessagesPerThread; i++)
+                {
+                    if (logger.Log(LogLevel::Information, ToLString(t) + _LS(" ") + ToLString(i)) == S_FALSE)
+                    {
+                        droppedCount++;
+                    }
+                    if (i == 0)
+                    {
+                        logging.Set();
+                    }
+                }
+            });
+        }
+
+        logging.Wait();
+        logger.Shutdown();
+
+        for (thread& producer : threads)
+        {
+            producer.join();
+        }
+
+        // Reports drops that happened after the shutdown drain, if any.
+        logger.Log(LogLevel::Information, _LS("end"));
+
+        vector<lstring> logged;
+        size_t reportedDroppedCount = SplitDropped(pRecordingLogger->GetMessages(), logged);
+        CHECK(reportedDroppedCount == droppedCount.load());
+        CHECK(logged.size() + droppedCount.load() == ThreadCount * MessagesPerThread + 1);
+        CHECK(!logged.empty() && logged.back() == _LS("end"));
+
+        // Each thread's messages are written in the order it logged them.
+        vector<size_t> nextIndex(ThreadCount, 0);
+        for (size_t i = 0; i + 1 < logged.size(); i++)
+        {
+            size_t separator = logged[i].find(_LS(' '));
+            size_t t = stoull(logged[i].substr(0, separator));
+            size_t index = stoull(logged[i].substr(separator + 1));
+            CHECK(t < ThreadCount && index >= nextIndex[t]);
+            if (t < ThreadCount)
+            {
+                nextIndex[t] = index + 1;
+            }
+        }
+    }
+}
+
+int main()
+{
+    Overflow_DropsAndCountsMessages();
+    Shutdown_WritesQueuedMessagesBeforeLaterOnes();
+    ConcurrentShutdown_AccountsForEveryMessage();
+
+    if (s_failures == 0)
+    {
+        printf("AsyncLogger tests passed\n");
+    }
+
+    return s_failures;
+}
@@ -0,0 +1,257 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#pragma once
+
+#include "corhlpr.h"
+#include "cor.h"
+#include "corprof.h"
+
+//
+// Runtime interfaces whose methods all fail with E_NOTIMPL, for running profiler code without a runtime.
+// Tests and benchmarks override the methods that the code under test calls.
+// Neither is reference counted: the test owns them and they must outlive their users.
+//
+
+class ProfilerInfoStub :
+    public ICorProfilerInfo12
+{
+    public:
+        virtual ~ProfilerInfoStub() = default;
+
+        // IUnknown
+        STDMETHOD(QueryInterface)(REFIID riid, void** ppvObject) override
+        {
+            if (nullptr != ppvObject)
+            {
+                *ppvObject = nullptr;
+            }
+            return E_NOINTERFACE;
+        }
+
+        STDMETHOD_(ULONG, AddRef)() override { return 1; }
+        STDMETHOD_(ULONG, Release)() override { return 1; }
+
+        // ICorProfilerInfo
+        STDMETHOD(GetClassFromObject)(ObjectID objectId, ClassID *pClassId) override { return E_NOTIMPL; }
+        STDMETHOD(GetClassFromToken)(ModuleID moduleId, mdTypeDef typeDef, ClassID *pClassId) override { return E_NOTIMPL; }
+        STDMETHOD(GetCodeInfo)(FunctionID functionId, LPCBYTE *pStart, ULONG *pcSize) override { return E_NOTIMPL; }
+        STDMETHOD(GetEventMask)(DWORD *pdwEvents) override { return E_NOTIMPL; }
+        STDMETHOD(GetFunctionFromIP)(LPCBYTE ip, FunctionID *pFunctionId) override { return E_NOTIMPL; }
+        STDMETHOD(GetFunctionFromToken)(ModuleID moduleId, mdToken token, FunctionID *pFunctionId) override { return E_NOTIMPL; }
+        STDMETHOD(GetHandleFromThread)(ThreadID threadId, HANDLE *phThread) override { return E_NOTIMPL; }
+        STDMETHOD(GetObjectSize)(ObjectID objectId, ULONG *pcSize) override { return E_NOTIMPL; }
+        STDMETHOD(IsArrayClass)(ClassID classId, CorElementType *pBaseElemType, ClassID *pBaseClassId, ULONG *pcRank) override { return E_NOTIMPL; }
+        STDMETHOD(GetThreadInfo)(ThreadID threadId, DWORD *pdwWin32ThreadId) override { return E_NOTIMPL; }
+        STDMETHOD(GetCurrentThreadID)(ThreadID *pThreadId) override { return E_NOTIMPL; }
+        STDMETHOD(GetClassIDInfo)(ClassID classId, ModuleID *pModuleId, mdTypeDef *pTypeDefToken) override { return E_NOTIMPL; }
+        STDMETHOD(GetFunctionInfo)(FunctionID functionId, ClassID *pClassId, ModuleID *pModuleId, mdToken *pToken) override { return E_NOTIMPL; }
+        STDMETHOD(SetEventMask)(DWORD dwEvents) override { return E_NOTIMPL; }
+        STDMETHOD(SetEnterLeaveFunctionHooks)(FunctionEnter *pFuncEnter, FunctionLeave *pFuncLeave, FunctionTailcall *pFuncTailcall) override { return E_NOTIMPL; }
+        STDMETHOD(SetFunctionIDMapper)(FunctionIDMapper *pFunc) override { return E_NOTIMPL; }
+        STDMETHOD(GetTokenAndMetaDataFromFunction)(FunctionID functionId, REFIID riid, IUnknown **ppImport, mdToken *pToken) override { return E_NOTIMPL; }
+        STDMETHOD(GetModuleInfo)(ModuleID moduleId, LPCBYTE *ppBaseLoadAddress, ULONG cchName, ULONG *pcchName, _Out_writes_to_(cchName, *pcchName) WCHAR szName[], AssemblyID *pAssemblyId) override { return E_NOTIMPL; }
+        STDMETHOD(GetModuleMetaData)(ModuleID moduleId, DWORD dwOpenFlags, REFIID riid, IUnknown **ppOut) override { return E_NOTIMPL; }
+        STDMETHOD(GetILFunctionBody)(ModuleID moduleId, mdMethodDef methodId, LPCBYTE *ppMethodHeader, ULONG *pcbMethodSize) override { return E_NOTIMPL; }
+        STDMETHOD(GetILFunctionBodyAllocator)(ModuleID moduleId, IMethodMalloc **ppMalloc) override { return E_NOTIMPL; }
+        STDMETHOD(SetILFunctionBody)(ModuleID moduleId, mdMethodDef methodid, LPCBYTE pbNewILMethodHeader) override { return E_NOTIMPL; }
+        STDMETHOD(GetAppDomainInfo)(AppDomainID appDomainId, ULONG cchName, ULONG *pcchName, _Out_writes_to_(cchName, *pcchName) WCHAR szName[], ProcessID *pProcessId) override { return E_NOTIMPL; }
+        STDMETHOD(GetAssemblyInfo)(AssemblyID assemblyId, ULONG cchName, ULONG *pcchName, _Out_writes_to_(cchName, *pcchName) WCHAR szName[], AppDomainID *pAppDomainId, ModuleID *pModuleId) override { return E_NOTIMPL; }
+        STDMETHOD(SetFunctionReJIT)(FunctionID functionId) override { return E_NOTIMPL; }
+        STDMETHOD(ForceGC)(void) override { return E_NOTIMPL; }
+        STDMETHOD(SetILInstrumentedCodeMap)(FunctionID functionId, BOOL fStartJit, ULONG cILMapEntries, COR_IL_MAP rgILMapEntries[]) override { return E_NOTIMPL; }
+        STDMETHOD(GetInprocInspectionInterface)(IUnknown **ppicd) override { return E_NOTIMPL; }
+        STDMETHOD(GetInprocInspectionIThisThread)(IUnknown **ppicd) override { return E_NOTIMPL; }
+        STDMETHOD(GetThreadContext)(ThreadID threadId, ContextID *pContextId) override { return E_NOTIMPL; }
+        STDMETHOD(BeginInprocDebugging)(BOOL fThisThreadOnly, DWORD *pdwProfilerContext) override { return E_NOTIMPL; }
+        STDMETHOD(EndInprocDebugging)(DWORD dwProfilerContext) override { return E_NOTIMPL; }
+        STDMETHOD(GetILToNativeMapping)(FunctionID functionId, ULONG32 cMap, ULONG32 *pcMap, COR_DEBUG_IL_TO_NATIVE_MAP map[]) override { return E_NOTIMPL; }
+
+        // ICorProfilerInfo2
+        STDMETHOD(DoStackSnapshot)(ThreadID thread, StackSnapshotCallback *callback, ULONG32 infoFlags, void *clientData, BYTE context[], ULONG32 contextSize) override { return E_NOTIMPL; }
+        STDMETHOD(SetEnterLeaveFunctionHooks2)(FunctionEnter2 *pFuncEnter, FunctionLeave2 *pFuncLeave, FunctionTailcall2 *pFuncTailcall) override { return E_NOTIMPL; }
+        STDMETHOD(GetFunctionInfo2)(FunctionID funcId, COR_PRF_FRAME_INFO frameInfo, ClassID *pClassId, ModuleID *pModuleId, mdToken *pToken, ULONG32 cTypeArgs, ULONG32 *pcTypeArgs, ClassID typeArgs[]) override { return E_NOTIMPL; }
+        STDMETHOD(GetStringLayout)(ULONG *pBufferLengthOffset, ULONG *pStringLengthOffset, ULONG *pBufferOffset) override { return E_NOTIMPL; }
+        STDMETHOD(GetClassLayout)(ClassID classID, COR_FIELD_OFFSET rFieldOffset[], ULONG cFieldOffset, ULONG *pcFieldOffset, ULONG *pulClassSize) override { return E_NOTIMPL; }
+        STDMETHOD(GetClassIDInfo2)(ClassID classId, ModuleID *pModuleId, mdTypeDef *pTypeDefToken, ClassID *pParentClassId, ULONG32 cNumTypeArgs, ULONG32 *pcNumTypeArgs, ClassID typeArgs[]) override { return E_NOTIMPL; }
+        STDMETHOD(GetCodeInfo2)(FunctionID functionID, ULONG32 cCodeInfos, ULONG32 *pcCodeInfos, COR_PRF_CODE_INFO codeInfos[]) override { return E_NOTIMPL; }
+        STDMETHOD(GetClassFromTokenAndTypeArgs)(ModuleID moduleID, mdTypeDef typeDef, ULONG32 cTypeArgs, ClassID typeArgs[], ClassID *pClassID) override { return E_NOTIMPL; }
+        STDMETHOD(GetFunctionFromTokenAndTypeArgs)(ModuleID moduleID, mdMethodDef funcDef, ClassID classId, ULONG32 cTypeArgs, ClassID typeArgs[], FunctionID *pFunctionID) override { return E_NOTIMPL; }
+        STDMETHOD(EnumModuleFrozenObjects)(ModuleID moduleID, ICorProfilerObjectEnum **ppEnum) override { return E_NOTIMPL; }
+        STDMETHOD(GetArrayObjectInfo)(ObjectID objectId, ULONG32 cDimensions, ULONG32 pDimensionSizes[], int pDimensionLowerBounds[], BYTE **ppData) override { return E_NOTIMPL; }
+        STDMETHOD(GetBoxClassLayout)(ClassID classId, ULONG32 *pBufferOffset) override { return E_NOTIMPL; }
+        STDMETHOD(GetThreadAppDomain)(ThreadID threadId, AppDomainID *pAppDomainId) override { return E_NOTIMPL; }
+        STDMETHOD(GetRVAStaticAddress)(ClassID classId, mdFieldDef fieldToken, void **ppAddress) override { return E_NOTIMPL; }
+        STDMETHOD(GetAppDomainStaticAddress)(ClassID classId, mdFieldDef fieldToken, AppDomainID appDomainId, void **ppAddress) override { return E_NOTIMPL; }
+        STDMETHOD(GetThreadStaticAddress)(ClassID classId, mdFieldDef fieldToken, ThreadID threadId, void **ppAddress) override { return E_NOTIMPL; }
+        STDMETHOD(GetContextStaticAddress)(ClassID classId, mdFieldDef fieldToken, ContextID contextId, void **ppAddress) override { return E_NOTIMPL; }
+        STDMETHOD(GetStaticFieldInfo)(ClassID classId, mdFieldDef fieldToken, COR_PRF_STATIC_TYPE *pFieldInfo) override { return E_NOTIMPL; }
+        STDMETHOD(GetGenerationBounds)(ULONG cObjectRanges, ULONG *pcObjectRanges, COR_PRF_GC_GENERATION_RANGE ranges[]) override { return E_NOTIMPL; }
+        STDMETHOD(GetObjectGeneration)(ObjectID objectId, COR_PRF_GC_GENERATION_RANGE *range) override { return E_NOTIMPL; }
+        STDMETHOD(GetNotifiedExceptionClauseInfo)(COR_PRF_EX_CLAUSE_INFO *pinfo) override { return E_NOTIMPL; }
+
+        // ICorProfilerInfo3
+        STDMETHOD(EnumJITedFunctions)(ICorProfilerFunctionEnum **ppEnum) override { return E_NOTIMPL; }
+        STDMETHOD(RequestProfilerDetach)(DWORD dwExpectedCompletionMilliseconds) override { return E_NOTIMPL; }
+        STDMETHOD(SetFunctionIDMapper2)(FunctionIDMapper2 *pFunc, void *clientData) override { return E_NOTIMPL; }
+        STDMETHOD(GetStringLayout2)(ULONG *pStringLengthOffset, ULONG *pBufferOffset) override { return E_NOTIMPL; }
+        STDMETHOD(SetEnterLeaveFunctionHooks3)(FunctionEnter3 *pFuncEnter3, FunctionLeave3 *pFuncLeave3, FunctionTailcall3 *pFuncTailcall3) override { return E_NOTIMPL; }
+        STDMETHOD(SetEnterLeaveFunctionHooks3WithInfo)(FunctionEnter3WithInfo *pFuncEnter3WithInfo, FunctionLeave3WithInfo *pFuncLeave3WithInfo, FunctionTailcall3WithInfo *pFuncTailcall3WithInfo) override { return E_NOTIMPL; }
+        STDMETHOD(GetFunctionEnter3Info)(FunctionID functionId, COR_PRF_ELT_INFO eltInfo, COR_PRF_FRAME_INFO *pFrameInfo, ULONG *pcbArgumentInfo, COR_PRF_FUNCTION_ARGUMENT_INFO *pArgumentInfo) override { return E_NOTIMPL; }
+        STDMETHOD(GetFunctionLeave3Info)(FunctionID functionId, COR_PRF_ELT_INFO eltInfo, COR_PRF_FRAME_INFO *pFrameInfo, COR_PRF_FUNCTION_ARGUMENT_RANGE *pRetvalRange) override { return E_NOTIMPL; }
+        STDMETHOD(GetFunctionTailcall3Info)(FunctionID functionId, COR_PRF_ELT_INFO eltInfo, COR_PRF_FRAME_INFO *pFrameInfo) override { return E_NOTIMPL; }
+        STDMETHOD(EnumModules)(ICorProfilerModuleEnum **ppEnum) override { return E_NOTIMPL; }
+        STDMETHOD(GetRuntimeInformation)(USHORT *pClrInstanceId, COR_PRF_RUNTIME_TYPE *pRuntimeType, USHORT *pMajorVersion, USHORT *pMinorVersion, USHORT *pBuildNumber, USHORT *pQFEVersion, ULONG cchVersionString, ULONG *pcchVersionString, _Out_writes_to_(cchVersionString, *pcchVersionString) WCHAR szVersionString[]) override { return E_NOTIMPL; }
+        STDMETHOD(GetThreadStaticAddress2)(ClassID classId, mdFieldDef fieldToken, AppDomainID appDomainId, ThreadID threadId, void **ppAddress) override { return E_NOTIMPL; }
+        STDMETHOD(GetAppDomainsContainingModule)(ModuleID moduleId, ULONG32 cAppDomainIds, ULONG32 *pcAppDomainIds, AppDomainID appDomainIds[]) override { return E_NOTIMPL; }
+        STDMETHOD(GetModuleInfo2)(ModuleID moduleId, LPCBYTE *ppBaseLoadAddress, ULONG cchName, ULONG *pcchName, _Out_writes_to_(cchName, *pcchName) WCHAR szName[], AssemblyID *pAssemblyId, DWORD *pdwModuleFlags) override { return E_NOTIMPL; }
+
+        // ICorProfilerInfo4
+        STDMETHOD(EnumThreads)(ICorProfilerThreadEnum **ppEnum) override { return E_NOTIMPL; }
+        STDMETHOD(InitializeCurrentThread)(void) override { return E_NOTIMPL; }
+        STDMETHOD(RequestReJIT)(ULONG cFunctions, ModuleID moduleIds[], mdMethodDef methodIds[]) override { return E_NOTIMPL; }
+        STDMETHOD(RequestRevert)(ULONG cFunctions, ModuleID moduleIds[], mdMethodDef methodIds[], HRESULT status[]) override { return E_NOTIMPL; }
+        STDMETHOD(GetCodeInfo3)(FunctionID functionID, ReJITID reJitId, ULONG32 cCodeInfos, ULONG32 *pcCodeInfos, COR_PRF_CODE_INFO codeInfos[]) override { return E_NOTIMPL; }
+        STDMETHOD(GetFunctionFromIP2)(LPCBYTE ip, FunctionID *pFunctionId, ReJITID *pReJitId) override { return E_NOTIMPL; }
+        STDMETHOD(GetReJITIDs)(FunctionID functionId, ULONG cReJitIds, ULONG *pcReJitIds, ReJITID reJitIds[]) override { return E_NOTIMPL; }
+        STDMETHOD(GetILToNativeMapping2)(FunctionID functionId, ReJITID reJitId, ULONG32 cMap, ULONG32 *pcMap, COR_DEBUG_IL_TO_NATIVE_MAP map[]) override { return E_NOTIMPL; }
+        STDMETHOD(EnumJITedFunctions2)(ICorProfilerFunctionEnum **ppEnum) override { return E_NOTIMPL; }
+        STDMETHOD(GetObjectSize2)(ObjectID objectId, SIZE_T *pcSize) override { return E_NOTIMPL; }
+
+        // ICorProfilerInfo5
+        STDMETHOD(GetEventMask2)(DWORD *pdwEventsLow, DWORD *pdwEventsHigh) override { return E_NOTIMPL; }
+        STDMETHOD(SetEventMask2)(DWORD dwEventsLow, DWORD dwEventsHigh) override { return E_NOTIMPL; }
+
+        // ICorProfilerInfo6
+        STDMETHOD(EnumNgenModuleMethodsInliningThisMethod)(ModuleID inlinersModuleId, ModuleID inlineeModuleId, mdMethodDef inlineeMethodId, BOOL *incompleteData, ICorProfilerMethodEnum **ppEnum) override { return E_NOTIMPL; }
+
+        // ICorProfilerInfo7
+        STDMETHOD(ApplyMetaData)(ModuleID moduleId) override { return E_NOTIMPL; }
+        STDMETHOD(GetInMemorySymbolsLength)(ModuleID moduleId, DWORD *pCountSymbolBytes) override { return E_NOTIMPL; }
+        STDMETHOD(ReadInMemorySymbols)(ModuleID moduleId, DWORD symbolsReadOffset, BYTE *pSymbolBytes, DWORD countSymbolBytes, DWORD *pCountSymbolBytesRead) override { return E_NOTIMPL; }
+
+        // ICorProfilerInfo8
+        STDMETHOD(IsFunctionDynamic)(FunctionID functionId, BOOL *isDynamic) override { return E_NOTIMPL; }
+        STDMETHOD(GetFunctionFromIP3)(LPCBYTE ip, FunctionID *functionId, ReJITID *pReJitId) override { return E_NOTIMPL; }
+        STDMETHOD(GetDynamicFunctionInfo)(FunctionID functionId, ModuleID *moduleId, PCCOR_SIGNATURE *ppvSig, ULONG *pbSig, ULONG cchName, ULONG *pcchName, WCHAR wszName[]) override { return E_NOTIMPL; }
+
+        // ICorProfilerInfo9
+        STDMETHOD(GetNativeCodeStartAddresses)(FunctionID functionID, ReJITID reJitId, ULONG32 cCodeStartAddresses, ULONG32 *pcCodeStartAddresses, UINT_PTR codeStartAddresses[]) override { return E_NOTIMPL; }
+        STDMETHOD(GetILToNativeMapping3)(UINT_PTR pNativeCodeStartAddress, ULONG32 cMap, ULONG32 *pcMap, COR_DEBUG_IL_TO_NATIVE_MAP map[]) override { return E_NOTIMPL; }
+        STDMETHOD(GetCodeInfo4)(UINT_PTR pNativeCodeStartAddress, ULONG32 cCodeInfos, ULONG32 *pcCodeInfos, COR_PRF_CODE_INFO codeInfos[]) override { return E_NOTIMPL; }
+
+        // ICorProfilerInfo10
+        STDMETHOD(EnumerateObjectReferences)(ObjectID objectId, ObjectReferenceCallback callback, void *clientData) override { return E_NOTIMPL; }
+        STDMETHOD(IsFrozenObject)(ObjectID objectId, BOOL *pbFrozen) override { return E_NOTIMPL; }
+        STDMETHOD(GetLOHObjectSizeThreshold)(DWORD *pThreshold) override { return E_NOTIMPL; }
+        STDMETHOD(RequestReJITWithInliners)(DWORD dwRejitFlags, ULONG cFunctions, ModuleID moduleIds[], mdMethodDef methodIds[]) override { return E_NOTIMPL; }
+        STDMETHOD(SuspendRuntime)(void) override { return E_NOTIMPL; }
+        STDMETHOD(ResumeRuntime)(void) override { return E_NOTIMPL; }
+
+        // ICorProfilerInfo11
+        STDMETHOD(GetEnvironmentVariable)(const WCHAR *szName, ULONG cchValue, ULONG *pcchValue, _Out_writes_to_(cchValue, *pcchValue) WCHAR szValue[]) override { return E_NOTIMPL; }
+        STDMETHOD(SetEnvironmentVariable)(const WCHAR *szName, const WCHAR *szValue) override { return E_NOTIMPL; }
+
+        // ICorProfilerInfo12
+        STDMETHOD(EventPipeStartSession)(UINT32 cProviderConfigs, COR_PRF_EVENTPIPE_PROVIDER_CONFIG pProviderConfigs[], BOOL requestRundown, EVENTPIPE_SESSION *pSession) override { return E_NOTIMPL; }
+        STDMETHOD(EventPipeAddProviderToSession)(EVENTPIPE_SESSION session, COR_PRF_EVENTPIPE_PROVIDER_CONFIG providerConfig) override { return E_NOTIMPL; }
+        STDMETHOD(EventPipeStopSession)(EVENTPIPE_SESSION session) override { return E_NOTIMPL; }
+        STDMETHOD(EventPipeCreateProvider)(const WCHAR *providerName, EVENTPIPE_PROVIDER *pProvider) override { return E_NOTIMPL; }
+        STDMETHOD(EventPipeGetProviderInfo)(EVENTPIPE_PROVIDER provider, ULONG cchName, ULONG *pcchName, _Out_writes_to_(cchName, *pcchName) WCHAR providerName[]) override { return E_NOTIMPL; }
+        STDMETHOD(EventPipeDefineEvent)(EVENTPIPE_PROVIDER provider, const WCHAR *eventName, UINT32 eventID, UINT64 keywords, UINT32 eventVersion, UINT32 level, UINT8 opcode, BOOL needStack, UINT32 cParamDescs, COR_PRF_EVENTPIPE_PARAM_DESC pParamDescs[], EVENTPIPE_EVENT *pEvent) override { return E_NOTIMPL; }
+        STDMETHOD(EventPipeWriteEvent)(EVENTPIPE_EVENT event, UINT32 cData, COR_PRF_EVENT_DATA data[], LPCGUID pActivityId, LPCGUID pRelatedActivityId) override { return E_NOTIMPL; }
+};
+
+class MetaDataImportStub :
+    public IMetaDataImport2
+{
+    public:
+        virtual ~MetaDataImportStub() = default;
+
+        // IUnknown
+        STDMETHOD(QueryInterface)(REFIID riid, void** ppvObject) override
+        {
+            if (nullptr != ppvObject)
+            {
+                *ppvObject = nullptr;
+            }
+            return E_NOINTERFACE;
+        }
+
+        STDMETHOD_(ULONG, AddRef)() override { return 1; }
+        STDMETHOD_(ULONG, Release)() override { return 1; }
+
+        // IMetaDataImport
+        STDMETHOD_(void, CloseEnum)(HCORENUM hEnum) override { }
+        STDMETHOD(CountEnum)(HCORENUM hEnum, ULONG *pulCount) override { return E_NOTIMPL; }
+        STDMETHOD(ResetEnum)(HCORENUM hEnum, ULONG ulPos) override { return E_NOTIMPL; }
+        STDMETHOD(EnumTypeDefs)(HCORENUM *phEnum, mdTypeDef rTypeDefs[], ULONG cMax, ULONG *pcTypeDefs) override { return E_NOTIMPL; }
+        STDMETHOD(EnumInterfaceImpls)(HCORENUM *phEnum, mdTypeDef td, mdInterfaceImpl rImpls[], ULONG cMax, ULONG* pcImpls) override { return E_NOTIMPL; }
+        STDMETHOD(EnumTypeRefs)(HCORENUM *phEnum, mdTypeRef rTypeRefs[], ULONG cMax, ULONG* pcTypeRefs) override { return E_NOTIMPL; }
+        STDMETHOD(FindTypeDefByName)(LPCWSTR szTypeDef, mdToken tkEnclosingClass, mdTypeDef *ptd) override { return E_NOTIMPL; }
+        STDMETHOD(GetScopeProps)(_Out_writes_to_opt_(cchName, *pchName) LPWSTR szName, ULONG cchName, ULONG *pchName, GUID *pmvid) override { return E_NOTIMPL; }
+        STDMETHOD(GetModuleFromScope)(mdModule *pmd) override { return E_NOTIMPL; }
+        STDMETHOD(GetTypeDefProps)(mdTypeDef td, _Out_writes_to_opt_(cchTypeDef, *pchTypeDef) LPWSTR szTypeDef, ULONG cchTypeDef, ULONG *pchTypeDef, DWORD *pdwTypeDefFlags, mdToken *ptkExtends) override { return E_NOTIMPL; }
+        STDMETHOD(GetInterfaceImplProps)(mdInterfaceImpl iiImpl, mdTypeDef *pClass, mdToken *ptkIface) override { return E_NOTIMPL; }
+        STDMETHOD(GetTypeRefProps)(mdTypeRef tr, mdToken *ptkResolutionScope, _Out_writes_to_opt_(cchName, *pchName) LPWSTR szName, ULONG cchName, ULONG *pchName) override { return E_NOTIMPL; }
+        STDMETHOD(ResolveTypeRef)(mdTypeRef tr, REFIID riid, IUnknown **ppIScope, mdTypeDef *ptd) override { return E_NOTIMPL; }
+        STDMETHOD(EnumMembers)(HCORENUM *phEnum, mdTypeDef cl, mdToken rMembers[], ULONG cMax, ULONG *pcTokens) override { return E_NOTIMPL; }
+        STDMETHOD(EnumMembersWithName)(HCORENUM *phEnum, mdTypeDef cl, LPCWSTR szName, mdToken rMembers[], ULONG cMax, ULONG *pcTokens) override { return E_NOTIMPL; }
+        STDMETHOD(EnumMethods)(HCORENUM *phEnum, mdTypeDef cl, mdMethodDef rMethods[], ULONG cMax, ULONG *pcTokens) override { return E_NOTIMPL; }
+        STDMETHOD(EnumMethodsWithName)(HCORENUM *phEnum, mdTypeDef cl, LPCWSTR szName, mdMethodDef rMethods[], ULONG cMax, ULONG *pcTokens) override { return E_NOTIMPL; }
+        STDMETHOD(EnumFields)(HCORENUM *phEnum, mdTypeDef cl, mdFieldDef rFields[], ULONG cMax, ULONG *pcTokens) override { return E_NOTIMPL; }
+        STDMETHOD(EnumFieldsWithName)(HCORENUM *phEnum, mdTypeDef cl, LPCWSTR szName, mdFieldDef rFields[], ULONG cMax, ULONG *pcTokens) override { return E_NOTIMPL; }
+        STDMETHOD(EnumParams)(HCORENUM *phEnum, mdMethodDef mb, mdParamDef rParams[], ULONG cMax, ULONG *pcTokens) override { return E_NOTIMPL; }
+        STDMETHOD(EnumMemberRefs)(HCORENUM *phEnum, mdToken tkParent, mdMemberRef rMemberRefs[], ULONG cMax, ULONG *pcTokens) override { return E_NOTIMPL; }
+        STDMETHOD(EnumMethodImpls)(HCORENUM *phEnum, mdTypeDef td, mdToken rMethodBody[], mdToken rMethodDecl[], ULONG cMax, ULONG *pcTokens) override { return E_NOTIMPL; }
+        STDMETHOD(EnumPermissionSets)(HCORENUM *phEnum, mdToken tk, DWORD dwActions, mdPermission rPermission[], ULONG cMax, ULONG *pcTokens) override { return E_NOTIMPL; }
+        STDMETHOD(FindMember)(mdTypeDef td, LPCWSTR szName, PCCOR_SIGNATURE pvSigBlob, ULONG cbSigBlob, mdToken *pmb) override { return E_NOTIMPL; }
+        STDMETHOD(FindMethod)(mdTypeDef td, LPCWSTR szName, PCCOR_SIGNATURE pvSigBlob, ULONG cbSigBlob, mdMethodDef *pmb) override { return E_NOTIMPL; }
+        STDMETHOD(FindField)(mdTypeDef td, LPCWSTR szName, PCCOR_SIGNATURE pvSigBlob, ULONG cbSigBlob, mdFieldDef *pmb) override { return E_NOTIMPL; }
+        STDMETHOD(FindMemberRef)(mdTypeRef td, LPCWSTR szName, PCCOR_SIGNATURE pvSigBlob, ULONG cbSigBlob, mdMemberRef *pmr) override { return E_NOTIMPL; }
+        STDMETHOD(GetMethodProps)(mdMethodDef mb, mdTypeDef *pClass, _Out_writes_to_opt_(cchMethod, *pchMethod) LPWSTR szMethod, ULONG cchMethod, ULONG *pchMethod, DWORD *pdwAttr, PCCOR_SIGNATURE *ppvSigBlob, ULONG *pcbSigBlob, ULONG *pulCodeRVA, DWORD *pdwImplFlags) override { return E_NOTIMPL; }
+        STDMETHOD(GetMemberRefProps)(mdMemberRef mr, mdToken *ptk, _Out_writes_to_opt_(cchMember, *pchMember) LPWSTR szMember, ULONG cchMember, ULONG *pchMember, PCCOR_SIGNATURE *ppvSigBlob, ULONG *pbSig) override { return E_NOTIMPL; }
+        STDMETHOD(EnumProperties)(HCORENUM *phEnum, mdTypeDef td, mdProperty rProperties[], ULONG cMax, ULONG *pcProperties) override { return E_NOTIMPL; }
+        STDMETHOD(EnumEvents)(HCORENUM *phEnum, mdTypeDef td, mdEvent rEvents[], ULONG cMax, ULONG *pcEvents) override { return E_NOTIMPL; }
+        STDMETHOD(GetEventProps)(mdEvent ev, mdTypeDef *pClass, LPCWSTR szEvent, ULONG cchEvent, ULONG *pchEvent, DWORD *pdwEventFlags, mdToken *ptkEventType, mdMethodDef *pmdAddOn, mdMethodDef *pmdRemoveOn, mdMethodDef *pmdFire, mdMethodDef rmdOtherMethod[], ULONG cMax, ULONG *pcOtherMethod) override { return E_NOTIMPL; }
+        STDMETHOD(EnumMethodSemantics)(HCORENUM *phEnum, mdMethodDef mb, mdToken rEventProp[], ULONG cMax, ULONG *pcEventProp) override { return E_NOTIMPL; }
+        STDMETHOD(GetMethodSemantics)(mdMethodDef mb, mdToken tkEventProp, DWORD *pdwSemanticsFlags) override { return E_NOTIMPL; }
+        STDMETHOD(GetClassLayout)(mdTypeDef td, DWORD *pdwPackSize, COR_FIELD_OFFSET rFieldOffset[], ULONG cMax, ULONG *pcFieldOffset, ULONG *pulClassSize) override { return E_NOTIMPL; }
+        STDMETHOD(GetFieldMarshal)(mdToken tk, PCCOR_SIGNATURE *ppvNativeType, ULONG *pcbNativeType) override { return E_NOTIMPL; }
+        STDMETHOD(GetRVA)(mdToken tk, ULONG *pulCodeRVA, DWORD *pdwImplFlags) override { return E_NOTIMPL; }
+        STDMETHOD(GetPermissionSetProps)(mdPermission pm, DWORD *pdwAction, void const **ppvPermission, ULONG *pcbPermission) override { return E_NOTIMPL; }
+        STDMETHOD(GetSigFromToken)(mdSignature mdSig, PCCOR_SIGNATURE *ppvSig, ULONG *pcbSig) override { return E_NOTIMPL; }
+        STDMETHOD(GetModuleRefProps)(mdModuleRef mur, _Out_writes_to_opt_(cchName, *pchName) LPWSTR szName, ULONG cchName, ULONG *pchName) override { return E_NOTIMPL; }
+        STDMETHOD(EnumModuleRefs)(HCORENUM *phEnum, mdModuleRef rModuleRefs[], ULONG cmax, ULONG *pcModuleRefs) override { return E_NOTIMPL; }
+        STDMETHOD(GetTypeSpecFromToken)(mdTypeSpec typespec, PCCOR_SIGNATURE *ppvSig, ULONG *pcbSig) override { return E_NOTIMPL; }
+        STDMETHOD(GetNameFromToken)(mdToken tk, MDUTF8CSTR *pszUtf8NamePtr) override { return E_NOTIMPL; }
+        STDMETHOD(EnumUnresolvedMethods)(HCORENUM *phEnum, mdToken rMethods[], ULONG cMax, ULONG *pcTokens) override { return E_NOTIMPL; }
+        STDMETHOD(GetUserString)(mdString stk, _Out_writes_to_opt_(cchString, *pchString) LPWSTR szString, ULONG cchString, ULONG *pchString) override { return E_NOTIMPL; }
+        STDMETHOD(GetPinvokeMap)(mdToken tk, DWORD *pdwMappingFlags, _Out_writes_to_opt_(cchImportName, *pchImportName) LPWSTR szImportName, ULONG cchImportName, ULONG *pchImportName, mdModuleRef *pmrImportDLL) override { return E_NOTIMPL; }
+        STDMETHOD(EnumSignatures)(HCORENUM *phEnum, mdSignature rSignatures[], ULONG cmax, ULONG *pcSignatures) override { return E_NOTIMPL; }
+        STDMETHOD(EnumTypeSpecs)(HCORENUM *phEnum, mdTypeSpec rTypeSpecs[], ULONG cmax, ULONG *pcTypeSpecs) override { return E_NOTIMPL; }
+        STDMETHOD(EnumUserStrings)(HCORENUM *phEnum, mdString rStrings[], ULONG cmax, ULONG *pcStrings) override { return E_NOTIMPL; }
+        STDMETHOD(GetParamForMethodIndex)(mdMethodDef md, ULONG ulParamSeq, mdParamDef *ppd) override { return E_NOTIMPL; }
+        STDMETHOD(EnumCustomAttributes)(HCORENUM *phEnum, mdToken tk, mdToken tkType, mdCustomAttribute rCustomAttributes[], ULONG cMax, ULONG *pcCustomAttributes) override { return E_NOTIMPL; }
+        STDMETHOD(GetCustomAttributeProps)(mdCustomAttribute cv, mdToken *ptkObj, mdToken *ptkType, void const **ppBlob, ULONG *pcbSize) override { return E_NOTIMPL; }
+        STDMETHOD(FindTypeRef)(mdToken tkResolutionScope, LPCWSTR szName, mdTypeRef *ptr) override { return E_NOTIMPL; }
+        STDMETHOD(GetMemberProps)(mdToken mb, mdTypeDef *pClass, _Out_writes_to_opt_(cchMember, *pchMember) LPWSTR szMember, ULONG cchMember, ULONG *pchMember, DWORD *pdwAttr, PCCOR_SIGNATURE *ppvSigBlob, ULONG *pcbSigBlob, ULONG *pulCodeRVA, DWORD *pdwImplFlags, DWORD *pdwCPlusTypeFlag, UVCP_CONSTANT *ppValue, ULONG *pcchValue) override { return E_NOTIMPL; }
+        STDMETHOD(GetFieldProps)(mdFieldDef mb, mdTypeDef *pClass, _Out_writes_to_opt_(cchField, *pchField) LPWSTR szField, ULONG cchField, ULONG *pchField, DWORD *pdwAttr, PCCOR_SIGNATURE *ppvSigBlob, ULONG *pcbSigBlob, DWORD *pdwCPlusTypeFlag, UVCP_CONSTANT *ppValue, ULONG *pcchValue) override { return E_NOTIMPL; }
+        STDMETHOD(GetPropertyProps)(mdProperty prop, mdTypeDef *pClass, LPCWSTR szProperty, ULONG cchProperty, ULONG *pchProperty, DWORD *pdwPropFlags, PCCOR_SIGNATURE *ppvSig, ULONG *pbSig, DWORD *pdwCPlusTypeFlag, UVCP_CONSTANT *ppDefaultValue, ULONG *pcchDefaultValue, mdMethodDef *pmdSetter, mdMethodDef *pmdGetter, mdMethodDef rmdOtherMethod[], ULONG cMax, ULONG *pcOtherMethod) override { return E_NOTIMPL; }
+        STDMETHOD(GetParamProps)(mdParamDef tk, mdMethodDef *pmd, ULONG *pulSequence, _Out_writes_to_opt_(cchName, *pchName) LPWSTR szName, ULONG cchName, ULONG *pchName, DWORD *pdwAttr, DWORD *pdwCPlusTypeFlag, UVCP_CONSTANT *ppValue, ULONG *pcchValue) override { return E_NOTIMPL; }
+        STDMETHOD(GetCustomAttributeByName)(mdToken tkObj, LPCWSTR szName, const void **ppData, ULONG *pcbData) override { return E_NOTIMPL; }
+        STDMETHOD_(BOOL, IsValidToken)(mdToken tk) override { return FALSE; }
+        STDMETHOD(GetNestedClassProps)(mdTypeDef tdNestedClass, mdTypeDef *ptdEnclosingClass) override { return E_NOTIMPL; }
+        STDMETHOD(GetNativeCallConvFromSig)(void const *pvSig, ULONG cbSig, ULONG *pCallConv) override { return E_NOTIMPL; }
+        STDMETHOD(IsGlobal)(mdToken pd, int *pbGlobal) override { return E_NOTIMPL; }
+
+        // IMetaDataImport2
+        STDMETHOD(EnumGenericParams)(HCORENUM *phEnum, mdToken tk, mdGenericParam rGenericParams[], ULONG cMax, ULONG *pcGenericParams) override { return E_NOTIMPL; }
+        STDMETHOD(GetGenericParamProps)(mdGenericParam gp, ULONG *pulParamSeq, DWORD *pdwParamFlags, mdToken *ptOwner, DWORD *reserved, _Out_writes_to_opt_(cchName, *pchName) LPWSTR wzname, ULONG cchName, ULONG *pchName) override { return E_NOTIMPL; }
+        STDMETHOD(GetMethodSpecProps)(mdMethodSpec mi, mdToken *tkParent, PCCOR_SIGNATURE *ppvSigBlob, ULONG *pcbSigBlob) override { return E_NOTIMPL; }
+        STDMETHOD(EnumGenericParamConstraints)(HCORENUM *phEnum, mdGenericParam tk, mdGenericParamConstraint rGenericParamConstraints[], ULONG cMax, ULONG *pcGenericParamConstraints) override { return E_NOTIMPL; }
+        STDMETHOD(GetGenericParamConstraintProps)(mdGenericParamConstraint gpc, mdGenericParam *ptGenericParam, mdToken *ptkConstraintType) override { return E_NOTIMPL; }
+        STDMETHOD(GetPEKind)(DWORD* pdwPEKind, DWORD* pdwMAchine) override { return E_NOTIMPL; }
+        STDMETHOD(GetVersionString)(_Out_writes_to_opt_(ccBufSize, *pccBufSize) LPWSTR pwzBuf, DWORD ccBufSize, DWORD *pccBufSize) override { return E_NOTIMPL; }
+        STDMETHOD(EnumMethodSpecs)(HCORENUM *phEnum, mdToken tk, mdMethodSpec rMethodSpecs[], ULONG cMax, ULONG *pcMethodSpecs) override { return E_NOTIMPL; }
+};
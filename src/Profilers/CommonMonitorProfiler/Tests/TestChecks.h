@@ -0,0 +1,24 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#pragma once
+
+#include <atomic>
+#include <cstdio>
+
+//
+// Checks shared by the native tests. A failed check is reported and counted, and the test keeps running;
+// main returns s_failures. Checks can fail on any thread.
+//
+
+static std::atomic<int> s_failures(0);
+
+#define CHECK(condition) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            fprintf(stderr, "%s(%d): check failed: %s\n", __FILE__, __LINE__, #condition); \
+            s_failures++; \
+        } \
+    } while (false)
@@ -0,0 +1,111 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+/// <summary>
+/// Bump allocator whose memory is only released, all at once, when the arena is destroyed.
+/// </summary>
+/// <remarks>
+/// The first InlineSize bytes come from storage embedded in the arena, so short-lived arenas on the stack
+/// serve small workloads without touching the heap. Later blocks grow geometrically up to MaxBlockSize.
+/// Allocate throws std::bad_alloc when a block cannot be allocated, like operator new.
+/// Objects placed in the arena are never destroyed, so they must be trivially destructible.
+/// </remarks>
+class BumpArena final
+{
+private:
+    static const size_t InlineSize = 4 * 1024;
+    static const size_t MinBlockSize = 16 * 1024;
+    static const size_t MaxBlockSize = 256 * 1024;
+
+    struct Block
+    {
+        Block* Next;
+    };
+
+public:
+    BumpArena() :
+        _current(_inline),
+        _end(_inline + InlineSize),
+        _blocks(nullptr),
+        _nextBlockSize(MinBlockSize)
+    {
+    }
+
+    ~BumpArena()
+    {
+        while (_blocks != nullptr)
+        {
+            Block* next = _blocks->Next;
+            delete[] reinterpret_cast<char*>(_blocks);
+            _blocks = next;
+        }
+    }
+
+    BumpArena(const BumpArena&) = delete;
+    BumpArena& operator=(const BumpArena&) = delete;
+
+    void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t))
+    {
+        char* aligned = Align(_current, alignment);
+        if (aligned > _end || static_cast<size_t>(_end - aligned) < size)
+        {
+            AddBlock(size + alignment);
+            aligned = Align(_current, alignment);
+        }
+
+        _current = aligned + size;
+        return aligned;
+    }
+
+    template<typename T>
+    T* AllocateArray(size_t count)
+    {
+        if (count > SIZE_MAX / sizeof(T))
+        {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(Allocate(count * sizeof(T), alignof(T)));
+    }
+
+private:
+    static char* Align(char* p, size_t alignment)
+    {
+        uintptr_t value = reinterpret_cast<uintptr_t>(p);
+        return p + ((alignment - (value & (alignment - 1))) & (alignment - 1));
+    }
+
+    void AddBlock(size_t minimumSize)
+    {
+        size_t size = _nextBlockSize;
+        if (size - sizeof(Block) < minimumSize)
+        {
+            // Oversized requests get a block of their own.
+            size = minimumSize + sizeof(Block);
+        }
+        else if (_nextBlockSize < MaxBlockSize)
+        {
+            _nextBlockSize *= 2;
+        }
+
+        char* memory = new char[size];
+
+        Block* block = reinterpret_cast<Block*>(memory);
+        block->Next = _blocks;
+        _blocks = block;
+
+        _current = memory + sizeof(Block);
+        _end = memory + size;
+    }
+
+    alignas(std::max_align_t) char _inline[InlineSize];
+    char* _current;
+    char* _end;
+    Block* _blocks;
+    size_t _nextBlockSize;
+};
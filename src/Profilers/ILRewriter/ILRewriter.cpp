@@ -18,11 +18,8 @@ void FASTCALL UnmanagedInspectObject(void* pv)
 }
 #endif // unused
 
-ILRewriter::ILRewriter(ICorProfilerInfo * pICorProfilerInfo, ICorProfilerFunctionControl * pICorProfilerFunctionControl, ModuleID moduleID, mdToken tkMethod)
-    : m_pICorProfilerInfo(pICorProfilerInfo), m_pICorProfilerFunctionControl(pICorProfilerFunctionControl),
-    m_moduleId(moduleID), m_tkMethod(tkMethod), m_fGenerateTinyHeader(false),
-    m_pOffsetToInstr(NULL), m_pOutputBuffer(NULL), m_pIMethodMalloc(NULL),
-    m_pMetaDataImport(NULL), m_pMetaDataEmit(NULL)
+ILRewriter::ILRewriter()
+    : m_fGenerateTinyHeader(false), m_pOffsetToInstr(NULL), m_pOutputBuffer(NULL)
 {
     m_IL.m_pNext = &m_IL;
     m_IL.m_pPrev = &m_IL;
@@ -32,40 +29,7 @@ ILRewriter::ILRewriter(ICorProfilerInfo * pICorProfilerInfo, ICorProfilerFunctio
 
 ILRewriter::~ILRewriter()
 {
-    ILInstr * p = m_IL.m_pNext;
-    while (p != &m_IL)
-    {
-        ILInstr * t = p->m_pNext;
-        delete p;
-        p = t;
-    }
-    delete[] m_pOffsetToInstr;
-    delete[] m_pOutputBuffer;
-
-    if (m_pIMethodMalloc)
-        m_pIMethodMalloc->Release();
-    if (m_pMetaDataImport)
-        m_pMetaDataImport->Release();
-    if (m_pMetaDataEmit)
-        m_pMetaDataEmit->Release();
-}
-
-HRESULT ILRewriter::Initialize()
-{
-    HRESULT hr;
-    /*
-    IfFailRet(m_pICorProfilerInfo->GetFunctionInfo(
-        m_functionId, &m_classId, &m_moduleId, &m_tkMethod));
-        */
-
-        // Get metadata interfaces ready
-
-    IfFailRet(m_pICorProfilerInfo->GetModuleMetaData(
-        m_moduleId, ofRead | ofWrite, IID_IMetaDataImport, (IUnknown**)&m_pMetaDataImport));
-
-    IfFailRet(m_pMetaDataImport->QueryInterface(IID_IMetaDataEmit, (void **)&m_pMetaDataEmit));
-
-    return S_OK;
+    // Instructions, the offset map and the output buffer are released with m_arena.
 }
 
 #if 0 // Unused code from runtime repo
@@ -86,13 +50,9 @@ void ILRewriter::InitializeTiny()
 //
 ////////////////////////////////////////////////////////////////////////////////////////////////
 
-HRESULT ILRewriter::Import()
+HRESULT ILRewriter::Import(LPCBYTE pMethodBytes)
 {
     HRESULT hr = S_OK;
-    LPCBYTE pMethodBytes;
-
-    IfFailRet(m_pICorProfilerInfo->GetILFunctionBody(
-        m_moduleId, m_tkMethod, &pMethodBytes, NULL));
 
     COR_ILMETHOD_DECODER decoder((COR_ILMETHOD*)pMethodBytes);
 
@@ -112,8 +72,7 @@ HRESULT ILRewriter::Import()
 
 HRESULT ILRewriter::ImportIL(LPCBYTE pIL)
 {
-    m_pOffsetToInstr = new ILInstr*[m_CodeSize + 1];
-    IfNullRet(m_pOffsetToInstr);
+    m_pOffsetToInstr = m_arena.AllocateArray<ILInstr*>(m_CodeSize + 1);
 
     memset(m_pOffsetToInstr, 0, m_CodeSize * sizeof(ILInstr*));
 
@@ -287,7 +246,7 @@ HRESULT ILRewriter::ImportEH(const COR_ILMETHOD_SECT_EH* pILEH, unsigned nEH)
 ILInstr* ILRewriter::NewILInstr()
 {
     m_nInstrs++;
-    return new ILInstr();
+    return new (m_arena.Allocate(sizeof(ILInstr), alignof(ILInstr))) ILInstr();
 }
 
 ILInstr* ILRewriter::GetInstrFromOffset(unsigned offset)
@@ -315,6 +274,19 @@ void ILRewriter::InsertTryCatch(ILInstr * pTryStart, ILInstr * pCatchStart, ILIn
     m_ehClauses.push_back(clause);
 }
 
+void ILRewriter::InsertTryFinally(ILInstr * pTryStart, ILInstr * pFinallyStart, ILInstr * pFinallyEnd)
+{
+    EHClause clause = {};
+    clause.m_Flags = CorExceptionFlag::COR_ILEXCEPTION_CLAUSE_FINALLY;
+
+    clause.m_pTryBegin = pTryStart;
+    clause.m_pTryEnd = pFinallyStart;
+    clause.m_pHandlerBegin = pFinallyStart;
+    clause.m_pHandlerEnd = pFinallyEnd;
+
+    m_ehClauses.push_back(clause);
+}
+
 void ILRewriter::InsertBefore(ILInstr * pWhere, ILInstr * pWhat)
 {
     pWhat->m_pNext = pWhere;
@@ -369,14 +341,146 @@ ILInstr * ILRewriter::GetILList()
 // SectEH_Emit (in corhlpr.cpp) also triggers the potential data loss warning, however this function is not used so we can safely ignore it.
 #include <corhlpr.cpp>
 
-HRESULT ILRewriter::Export()
+void ILRewriter::ShortenInstructions()
 {
-    HRESULT hr = S_OK;
-    // One instruction produces 6 bytes in the worst case
-    unsigned maxSize = m_nInstrs * 6;
+    for (ILInstr * pInstr = m_IL.m_pNext; pInstr != &m_IL; pInstr = pInstr->m_pNext)
+    {
+        switch (pInstr->m_opcode)
+        {
+        case CEE_LDARG:
+        case CEE_LDARG_S:
+        case CEE_LDLOC:
+        case CEE_LDLOC_S:
+        case CEE_STLOC:
+        case CEE_STLOC_S:
+        {
+            unsigned index = (pInstr->m_opcode >= 0x100) ? static_cast<UINT16>(pInstr->m_Arg16) : static_cast<UINT8>(pInstr->m_Arg8);
+            unsigned opcode = pInstr->m_opcode;
+            if (index <= 3)
+            {
+                // ldarg.0-3, ldloc.0-3 and stloc.0-3 are contiguous.
+                if (opcode == CEE_LDARG || opcode == CEE_LDARG_S)
+                    pInstr->m_opcode = CEE_LDARG_0 + index;
+                else if (opcode == CEE_LDLOC || opcode == CEE_LDLOC_S)
+                    pInstr->m_opcode = CEE_LDLOC_0 + index;
+                else
+                    pInstr->m_opcode = CEE_STLOC_0 + index;
+            }
+            else if (index <= UINT8_MAX && opcode >= 0x100)
+            {
+                pInstr->m_opcode = (opcode == CEE_LDARG) ? CEE_LDARG_S : (opcode == CEE_LDLOC) ? CEE_LDLOC_S : CEE_STLOC_S;
+                pInstr->m_Arg8 = static_cast<INT8>(index);
+            }
+            break;
+        }
+        case CEE_LDARGA:
+        case CEE_STARG:
+        case CEE_LDLOCA:
+        {
+            unsigned index = static_cast<UINT16>(pInstr->m_Arg16);
+            if (index <= UINT8_MAX)
+            {
+                pInstr->m_opcode = (pInstr->m_opcode == CEE_LDARGA) ? CEE_LDARGA_S : (pInstr->m_opcode == CEE_STARG) ? CEE_STARG_S : CEE_LDLOCA_S;
+                pInstr->m_Arg8 = static_cast<INT8>(index);
+            }
+            break;
+        }
+        case CEE_LDC_I4:
+        case CEE_LDC_I4_S:
+        {
+            INT32 value = (pInstr->m_opcode == CEE_LDC_I4) ? pInstr->m_Arg32 : pInstr->m_Arg8;
+            if (value >= -1 && value <= 8)
+            {
+                // ldc.i4.m1 through ldc.i4.8 are contiguous.
+                pInstr->m_opcode = CEE_LDC_I4_0 + value;
+            }
+            else if (value >= INT8_MIN && value <= INT8_MAX)
+            {
+                pInstr->m_opcode = CEE_LDC_I4_S;
+                pInstr->m_Arg8 = static_cast<INT8>(value);
+            }
+            break;
+        }
+        case CEE_LEAVE:
+            pInstr->m_opcode = CEE_LEAVE_S;
+            break;
+        default:
+            // Branches start short and are only lengthened by LayOutInstructions if their target is out of range.
+            if (pInstr->m_opcode >= CEE_BR && pInstr->m_opcode <= CEE_BLT_UN)
+            {
+                pInstr->m_opcode = pInstr->m_opcode - CEE_BR + CEE_BR_S;
+            }
+            break;
+        }
+    }
+}
 
-    m_pOutputBuffer = new BYTE[maxSize];
-    IfNullRet(m_pOutputBuffer);
+unsigned ILRewriter::GetInstrSize(const ILInstr * pInstr)
+{
+    unsigned opcode = pInstr->m_opcode;
+    BYTE flags = s_OpCodeFlags[opcode];
+
+    unsigned size = (flags & OPCODEFLAGS_SizeMask);
+    if (opcode < CEE_COUNT)
+    {
+        size += (opcode >= 0x100) ? 2 : 1;
+    }
+    if (flags & OPCODEFLAGS_Switch)
+    {
+        // Target count; the targets themselves are CEE_SWITCH_ARG instructions.
+        size += sizeof(INT32);
+    }
+    return size;
+}
+
+unsigned ILRewriter::LayOutInstructions()
+{
+    //
+    // Assign offsets, lengthening any short branch whose target is out of range.
+    // Lengthening a branch can only move other targets further away, so this converges;
+    // it usually takes a single extra pass over the offsets, and nothing is emitted until it does.
+    //
+    bool fChanged;
+    unsigned offset;
+    do
+    {
+        offset = 0;
+        for (ILInstr * pInstr = m_IL.m_pNext; pInstr != &m_IL; pInstr = pInstr->m_pNext)
+        {
+            pInstr->m_offset = offset;
+            offset += GetInstrSize(pInstr);
+        }
+        m_IL.m_offset = offset;
+
+        fChanged = false;
+        for (ILInstr * pInstr = m_IL.m_pNext; pInstr != &m_IL; pInstr = pInstr->m_pNext)
+        {
+            if (s_OpCodeFlags[pInstr->m_opcode] != (1 | OPCODEFLAGS_BranchTarget))
+                continue;
+
+            int delta = static_cast<int>(pInstr->m_pTarget->m_offset) - static_cast<int>(pInstr->m_pNext->m_offset);
+            if (delta >= INT8_MIN && delta <= INT8_MAX)
+                continue;
+
+            if (pInstr->m_opcode == CEE_LEAVE_S)
+            {
+                pInstr->m_opcode = CEE_LEAVE;
+            }
+            else
+            {
+                _ASSERTE(pInstr->m_opcode >= CEE_BR_S && pInstr->m_opcode <= CEE_BLT_UN_S);
+                pInstr->m_opcode = pInstr->m_opcode - CEE_BR_S + CEE_BR;
+            }
+            fChanged = true;
+        }
+    } while (fChanged);
+
+    return offset;
+}
+
+HRESULT ILRewriter::Export(LPBYTE& pBody, unsigned& cbBody)
+{
+    HRESULT hr = S_OK;
 
     if (m_ehClauses.size() > UINT32_MAX)
     {
@@ -384,18 +488,16 @@ HRESULT ILRewriter::Export()
     }
     unsigned m_nEH = static_cast<unsigned>(m_ehClauses.size());
 
-again:
-    // TODO [DAVBR]: Why separate pointer pIL?  Doesn't look like either pIL or
-    // m_pOutputBuffer is moved.
-    BYTE* pIL = m_pOutputBuffer;
+    ShortenInstructions();
+    unsigned codeSize = LayOutInstructions();
 
-    bool fBranch = false;
-    unsigned offset = 0;
+    m_pOutputBuffer = m_arena.AllocateArray<BYTE>(codeSize);
 
-    // Go over all instructions and produce code for them
+    // Offsets are final, so every instruction (including branches) is emitted exactly once.
+    unsigned switchBase = 0;
     for (ILInstr * pInstr = m_IL.m_pNext; pInstr != &m_IL; pInstr = pInstr->m_pNext)
     {
-        pInstr->m_offset = offset;
+        unsigned offset = pInstr->m_offset;
 
         unsigned opcode = pInstr->m_opcode;
         if (opcode < CEE_COUNT)
@@ -406,10 +508,7 @@ again:
             if (opcode >= 0x100)
                 m_pOutputBuffer[offset++] = CEE_PREFIX1;
 
-            // TODO: [DAVBR]: This appears to depend on an implicit conversion from
-            // unsigned opcode down to BYTE, to deliberately lose data and have
-            // opcode >= 0x100 wrap around to 0.
-            m_pOutputBuffer[offset++] = (opcode & 0xFF);
+            m_pOutputBuffer[offset++] = static_cast<BYTE>(opcode & 0xFF);
         }
 
         _ASSERTE(pInstr->m_opcode < dimensionof(s_OpCodeFlags));
@@ -419,104 +518,44 @@ again:
         case 0:
             break;
         case 1:
-            *(UNALIGNED INT8 *)&(pIL[offset]) = pInstr->m_Arg8;
+            *(UNALIGNED INT8 *)&(m_pOutputBuffer[offset]) = pInstr->m_Arg8;
             break;
         case 2:
-            *(UNALIGNED INT16 *)&(pIL[offset]) = pInstr->m_Arg16;
+            *(UNALIGNED INT16 *)&(m_pOutputBuffer[offset]) = pInstr->m_Arg16;
             break;
         case 4:
-            *(UNALIGNED INT32 *)&(pIL[offset]) = pInstr->m_Arg32;
+            *(UNALIGNED INT32 *)&(m_pOutputBuffer[offset]) = pInstr->m_Arg32;
             break;
         case 8:
-            *(UNALIGNED INT64 *)&(pIL[offset]) = pInstr->m_Arg64;
+            *(UNALIGNED INT64 *)&(m_pOutputBuffer[offset]) = pInstr->m_Arg64;
             break;
         case 1 | OPCODEFLAGS_BranchTarget:
-            fBranch = true;
+            // Checked by LayOutInstructions.
+            *(UNALIGNED INT8 *)&(m_pOutputBuffer[offset]) = static_cast<INT8>(pInstr->m_pTarget->m_offset - pInstr->m_pNext->m_offset);
             break;
         case 4 | OPCODEFLAGS_BranchTarget:
-            fBranch = true;
+            if (opcode == CEE_SWITCH_ARG)
+            {
+                // Switch targets are relative to the end of the switch instruction.
+                *(UNALIGNED INT32 *)&(m_pOutputBuffer[offset]) = pInstr->m_pTarget->m_offset - switchBase;
+            }
+            else
+            {
+                *(UNALIGNED INT32 *)&(m_pOutputBuffer[offset]) = pInstr->m_pTarget->m_offset - pInstr->m_pNext->m_offset;
+            }
             break;
         case 0 | OPCODEFLAGS_Switch:
-            *(UNALIGNED INT32 *)&(pIL[offset]) = pInstr->m_Arg32;
-            offset += sizeof(INT32);
+            *(UNALIGNED INT32 *)&(m_pOutputBuffer[offset]) = pInstr->m_Arg32;
+            switchBase = pInstr->m_offset + 1 + sizeof(INT32) * (pInstr->m_Arg32 + 1);
             break;
         default:
             _ASSERTE(false);
             break;
         }
-        offset += (flags & OPCODEFLAGS_SizeMask);
-    }
-    m_IL.m_offset = offset;
-
-    if (fBranch)
-    {
-        bool fTryAgain = false;
-        unsigned switchBase = 0;
-
-        // Go over all control flow instructions and resolve the targets
-        for (ILInstr * pInstr = m_IL.m_pNext; pInstr != &m_IL; pInstr = pInstr->m_pNext)
-        {
-            unsigned opcode = pInstr->m_opcode;
-
-            if (pInstr->m_opcode == CEE_SWITCH)
-            {
-                switchBase = pInstr->m_offset + 1 + sizeof(INT32) * (pInstr->m_Arg32 + 1);
-                continue;
-            }
-            if (opcode == CEE_SWITCH_ARG)
-            {
-                // Switch args are special
-                *(UNALIGNED INT32 *)&(pIL[pInstr->m_offset]) = pInstr->m_pTarget->m_offset - switchBase;
-                continue;
-            }
-
-            BYTE flags = s_OpCodeFlags[pInstr->m_opcode];
-
-            if (flags & OPCODEFLAGS_BranchTarget)
-            {
-                int delta = pInstr->m_pTarget->m_offset - pInstr->m_pNext->m_offset;
-
-                switch (flags)
-                {
-                case 1 | OPCODEFLAGS_BranchTarget:
-                    // Check if delta is too big to fit into an INT8.
-                    //
-                    // (see #pragma at top of file)
-                    if ((INT8)delta != delta)
-                    {
-                        if (opcode == CEE_LEAVE_S)
-                        {
-                            pInstr->m_opcode = CEE_LEAVE;
-                        }
-                        else
-                        {
-                            _ASSERTE(opcode >= CEE_BR_S && opcode <= CEE_BLT_UN_S);
-                            pInstr->m_opcode = opcode - CEE_BR_S + CEE_BR;
-                            _ASSERTE(pInstr->m_opcode >= CEE_BR && pInstr->m_opcode <= CEE_BLT_UN);
-                        }
-                        fTryAgain = true;
-                        continue;
-                    }
-                    *(UNALIGNED INT8 *)&(pIL[pInstr->m_pNext->m_offset - sizeof(INT8)]) = delta;
-                    break;
-                case 4 | OPCODEFLAGS_BranchTarget:
-                    *(UNALIGNED INT32 *)&(pIL[pInstr->m_pNext->m_offset - sizeof(INT32)]) = delta;
-                    break;
-                default:
-                    _ASSERTE(false);
-                    break;
-                }
-            }
-        }
-
-        // Do the whole thing again if we changed the size of some branch targets
-        if (fTryAgain)
-            goto again;
     }
 
-    unsigned codeSize = offset;
     unsigned totalSize;
-    LPBYTE pBody = NULL;
+    pBody = NULL;
     if (m_fGenerateTinyHeader)
     {
         // Make sure we can fit in a tiny header
@@ -540,7 +579,7 @@ again:
     {
         // Use FAT header
 
-        unsigned alignedCodeSize = (offset + 3) & ~3;
+        unsigned alignedCodeSize = (codeSize + 3) & ~3;
 
         totalSize = sizeof(IMAGE_COR_ILMETHOD_FAT) + alignedCodeSize +
             (m_nEH ? (sizeof(IMAGE_COR_ILMETHOD_SECT_FAT) + sizeof(IMAGE_COR_ILMETHOD_SECT_EH_CLAUSE_FAT) * m_nEH) : 0);
@@ -554,7 +593,7 @@ again:
         pHeader->Flags = m_flags | (m_nEH ? CorILMethod_MoreSects : 0) | CorILMethod_FatFormat;
         pHeader->Size = sizeof(IMAGE_COR_ILMETHOD_FAT) / sizeof(DWORD);
         pHeader->MaxStack = m_maxStack;
-        pHeader->CodeSize = offset;
+        pHeader->CodeSize = codeSize;
         pHeader->LocalVarSigTok = m_tkLocalVarSig;
 
         pCurrent = (BYTE*)(pHeader + 1);
@@ -590,8 +629,7 @@ again:
         }
     }
 
-    IfFailRet(SetILFunctionBody(totalSize, pBody));
-    DeallocateILMemory(pBody);
+    cbBody = totalSize;
 
     return S_OK;
 }
@@ -600,50 +638,265 @@ again:
 #pragma runtime_checks( "", restore )
 #endif
 
-HRESULT ILRewriter::SetILFunctionBody(unsigned size, LPBYTE pBody)
+/////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// H O S T
+//
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+LPBYTE ILRewriter::AllocateILMemory(unsigned size)
 {
-    HRESULT hr = S_OK;
-    if (m_pICorProfilerFunctionControl != NULL)
+    try
     {
-        // We're supplying IL for a rejit, so use the rejit mechanism
-        IfFailRet(m_pICorProfilerFunctionControl->SetILFunctionBody(size, pBody));
+        // Fat headers and the EH sections that follow the code are read as DWORDs, so bodies are DWORD aligned.
+        return static_cast<LPBYTE>(m_arena.Allocate(size, sizeof(DWORD)));
     }
-    else
+    catch (const std::bad_alloc&)
     {
-        // "classic-style" instrumentation on first JIT, so use old mechanism
-        IfFailRet(m_pICorProfilerInfo->SetILFunctionBody(m_moduleId, m_tkMethod, pBody));
+        return NULL;
     }
+}
+
+HRESULT ILRewriter::GetSigFromToken(mdSignature tkSig, PCCOR_SIGNATURE& pSig, ULONG& cbSig)
+{
+    return E_NOTIMPL;
+}
+
+HRESULT ILRewriter::GetTokenFromSig(PCCOR_SIGNATURE pSig, ULONG cbSig, mdSignature& tkSig)
+{
+    return E_NOTIMPL;
+}
+
+HRESULT ILRewriter::GetMethodSignature(PCCOR_SIGNATURE& pSig, ULONG& cbSig)
+{
+    return E_NOTIMPL;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// S I G N A T U R E S
+//
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+HRESULT ILRewriter::AddLocal(PCCOR_SIGNATURE pLocalType, ULONG cbLocalType, unsigned& localIndex)
+{
+    HRESULT hr;
+
+    PCCOR_SIGNATURE pOrigSig = NULL;
+    ULONG cbOrigSig = 0;
+    if (!IsNilToken(m_tkLocalVarSig))
+    {
+        IfFailRet(GetSigFromToken(m_tkLocalVarSig, pOrigSig, cbOrigSig));
+    }
+
+    ULONG origOffset = 0;
+    uint32_t cOrigLocals = 0;
+    if (cbOrigSig > 0)
+    {
+        if (pOrigSig[origOffset++] != IMAGE_CEE_CS_CALLCONV_LOCAL_SIG)
+        {
+            return META_E_BAD_SIGNATURE;
+        }
+        IfFailRet(SkipData(pOrigSig, cbOrigSig, origOffset, cOrigLocals));
+    }
+
+    // Local indices are 16-bit, and 0xFFFF is reserved.
+    if (cOrigLocals >= 0xFFFE)
+    {
+        return E_FAIL;
+    }
+
+    std::vector<COR_SIGNATURE> newSig;
+    newSig.reserve(1 + sizeof(uint32_t) + (cbOrigSig - origOffset) + cbLocalType);
+
+    newSig.push_back(IMAGE_CEE_CS_CALLCONV_LOCAL_SIG);
+
+    COR_SIGNATURE compressedCount[sizeof(uint32_t)];
+    ULONG cbCompressedCount = CorSigCompressData(cOrigLocals + 1, compressedCount);
+    newSig.insert(newSig.end(), compressedCount, compressedCount + cbCompressedCount);
+
+    newSig.insert(newSig.end(), pOrigSig + origOffset, pOrigSig + cbOrigSig);
+    newSig.insert(newSig.end(), pLocalType, pLocalType + cbLocalType);
+
+    IfFailRet(GetTokenFromSig(newSig.data(), static_cast<ULONG>(newSig.size()), m_tkLocalVarSig));
+
+    // Locals were appended, so the new local follows every existing one.
+    localIndex = cOrigLocals;
 
     return S_OK;
 }
 
-LPBYTE ILRewriter::AllocateILMemory(unsigned size)
+HRESULT ILRewriter::GetReturnType(PCCOR_SIGNATURE& pReturnType, ULONG& cbReturnType)
 {
-    if (m_pICorProfilerFunctionControl != NULL)
+    HRESULT hr;
+
+    PCCOR_SIGNATURE pSig = NULL;
+    ULONG cbSig = 0;
+    IfFailRet(GetMethodSignature(pSig, cbSig));
+
+    ULONG offset = 0;
+    if (cbSig == 0)
     {
-        // We're supplying IL for a rejit, so we can just allocate from
-        // the heap
-        return new BYTE[size];
+        return META_E_BAD_SIGNATURE;
     }
 
-    // Else, this is "classic-style" instrumentation on first JIT, and
-    // need to use the CLR's IL allocator
+    BYTE callingConvention = pSig[offset++];
 
-    if (FAILED(m_pICorProfilerInfo->GetILFunctionBodyAllocator(m_moduleId, &m_pIMethodMalloc)))
-        return NULL;
+    uint32_t data;
+    if ((callingConvention & IMAGE_CEE_CS_CALLCONV_GENERIC) != 0)
+    {
+        // Generic parameter count
+        IfFailRet(SkipData(pSig, cbSig, offset, data));
+    }
+
+    // Parameter count
+    IfFailRet(SkipData(pSig, cbSig, offset, data));
+
+    ULONG returnTypeOffset = offset;
+    IfFailRet(SkipType(pSig, cbSig, offset));
+
+    pReturnType = pSig + returnTypeOffset;
+    cbReturnType = offset - returnTypeOffset;
+
+    return S_OK;
+}
+
+HRESULT ILRewriter::SkipData(PCCOR_SIGNATURE pSig, ULONG cbSig, ULONG& offset, uint32_t& data)
+{
+    HRESULT hr;
+
+    if (offset >= cbSig)
+    {
+        return META_E_BAD_SIGNATURE;
+    }
 
-    return (LPBYTE)m_pIMethodMalloc->Alloc(size);
+    uint32_t cbData;
+    IfFailRet(CorSigUncompressData(pSig + offset, cbSig - offset, &data, &cbData));
+    offset += cbData;
+
+    return S_OK;
 }
 
-void ILRewriter::DeallocateILMemory(LPBYTE pBody)
+HRESULT ILRewriter::SkipType(PCCOR_SIGNATURE pSig, ULONG cbSig, ULONG& offset)
 {
-    if (m_pICorProfilerFunctionControl == NULL)
+    HRESULT hr;
+
+    if (offset >= cbSig)
+    {
+        return META_E_BAD_SIGNATURE;
+    }
+
+    uint32_t data;
+    CorElementType elementType = static_cast<CorElementType>(pSig[offset++]);
+    switch (elementType)
+    {
+    case ELEMENT_TYPE_VOID:
+    case ELEMENT_TYPE_BOOLEAN:
+    case ELEMENT_TYPE_CHAR:
+    case ELEMENT_TYPE_I1:
+    case ELEMENT_TYPE_U1:
+    case ELEMENT_TYPE_I2:
+    case ELEMENT_TYPE_U2:
+    case ELEMENT_TYPE_I4:
+    case ELEMENT_TYPE_U4:
+    case ELEMENT_TYPE_I8:
+    case ELEMENT_TYPE_U8:
+    case ELEMENT_TYPE_R4:
+    case ELEMENT_TYPE_R8:
+    case ELEMENT_TYPE_STRING:
+    case ELEMENT_TYPE_OBJECT:
+    case ELEMENT_TYPE_I:
+    case ELEMENT_TYPE_U:
+    case ELEMENT_TYPE_TYPEDBYREF:
+        return S_OK;
+
+    case ELEMENT_TYPE_CLASS:
+    case ELEMENT_TYPE_VALUETYPE:
+    case ELEMENT_TYPE_VAR:
+    case ELEMENT_TYPE_MVAR:
+        // Compressed token or generic parameter index
+        return SkipData(pSig, cbSig, offset, data);
+
+    case ELEMENT_TYPE_CMOD_REQD:
+    case ELEMENT_TYPE_CMOD_OPT:
+        // Modifier token, followed by the modified type
+        IfFailRet(SkipData(pSig, cbSig, offset, data));
+        return SkipType(pSig, cbSig, offset);
+
+    case ELEMENT_TYPE_PTR:
+    case ELEMENT_TYPE_BYREF:
+    case ELEMENT_TYPE_PINNED:
+    case ELEMENT_TYPE_SZARRAY:
+        return SkipType(pSig, cbSig, offset);
+
+    case ELEMENT_TYPE_GENERICINST:
+    {
+        IfFailRet(SkipType(pSig, cbSig, offset));
+
+        uint32_t typeArgCount;
+        IfFailRet(SkipData(pSig, cbSig, offset, typeArgCount));
+        for (uint32_t i = 0; i < typeArgCount; i++)
+        {
+            IfFailRet(SkipType(pSig, cbSig, offset));
+        }
+        return S_OK;
+    }
+
+    case ELEMENT_TYPE_ARRAY:
+    {
+        IfFailRet(SkipType(pSig, cbSig, offset));
+
+        // Rank
+        IfFailRet(SkipData(pSig, cbSig, offset, data));
+
+        uint32_t sizeCount;
+        IfFailRet(SkipData(pSig, cbSig, offset, sizeCount));
+        for (uint32_t i = 0; i < sizeCount; i++)
+        {
+            IfFailRet(SkipData(pSig, cbSig, offset, data));
+        }
+
+        uint32_t lowerBoundCount;
+        IfFailRet(SkipData(pSig, cbSig, offset, lowerBoundCount));
+        for (uint32_t i = 0; i < lowerBoundCount; i++)
+        {
+            IfFailRet(SkipData(pSig, cbSig, offset, data));
+        }
+        return S_OK;
+    }
+
+    case ELEMENT_TYPE_FNPTR:
     {
-        // Old-style instrumentation does not provide a way to free up bytes
-        return;
+        if (offset >= cbSig)
+        {
+            return META_E_BAD_SIGNATURE;
+        }
+
+        BYTE callingConvention = pSig[offset++];
+        if ((callingConvention & IMAGE_CEE_CS_CALLCONV_GENERIC) != 0)
+        {
+            IfFailRet(SkipData(pSig, cbSig, offset, data));
+        }
+
+        uint32_t parameterCount;
+        IfFailRet(SkipData(pSig, cbSig, offset, parameterCount));
+
+        // Return type, then parameters. Vararg signatures may contain a sentinel before the optional parameters.
+        IfFailRet(SkipType(pSig, cbSig, offset));
+        for (uint32_t i = 0; i < parameterCount; i++)
+        {
+            if (offset < cbSig && pSig[offset] == ELEMENT_TYPE_SENTINEL)
+            {
+                offset++;
+            }
+            IfFailRet(SkipType(pSig, cbSig, offset));
+        }
+        return S_OK;
     }
 
-    delete[] pBody;
+    default:
+        return META_E_BAD_SIGNATURE;
+    }
 }
 
 #if 0 // Unused code from runtime repo
@@ -6,8 +6,8 @@
 #include <assert.h>
 #include <vector>
 #include "cor.h"
-#include "corprof.h"
 #include "corhlpr.h"
+#include "BumpArena.h"
 
 #if 0 // Unused code from runtime repo
 #ifdef WIN32
@@ -160,17 +160,17 @@ static int k_rgnStackPushes[] = {
 };
 
 
+/// <summary>
+/// Imports a method body into a list of instructions that can be rewritten, and exports it back into a method body.
+/// </summary>
+/// <remarks>
+/// The rewriter works on in-memory method bodies and has no dependency on a running runtime.
+/// Where a rewrite needs metadata (signatures) or the runtime's IL allocator, it calls the protected
+/// virtual methods, which a derived class implements; see ProfilerILRewriter.
+/// </remarks>
 class ILRewriter
 {
 private:
-    ICorProfilerInfo * m_pICorProfilerInfo;
-    ICorProfilerFunctionControl * m_pICorProfilerFunctionControl;
-
-    //FunctionID  m_functionId;
-    //ClassID     m_classId;
-    ModuleID    m_moduleId;
-    mdToken     m_tkMethod;
-
     mdToken     m_tkLocalVarSig;
     unsigned    m_maxStack;
     unsigned    m_flags;
@@ -190,15 +190,13 @@ private:
 
     BYTE *      m_pOutputBuffer;
 
-    IMethodMalloc * m_pIMethodMalloc;
-
-    IMetaDataImport * m_pMetaDataImport;
-    IMetaDataEmit * m_pMetaDataEmit;
+    // Backs every instruction and buffer of a single rewrite, which runs on JIT threads inside GetReJITParameters.
+    // Nothing is freed individually; everything is released at once when the rewriter is destroyed.
+    BumpArena m_arena;
 
 public:
-    ILRewriter(ICorProfilerInfo * pICorProfilerInfo, ICorProfilerFunctionControl * pICorProfilerFunctionControl, ModuleID moduleID, mdToken tkMethod);
-    ~ILRewriter();
-    HRESULT Initialize();
+    ILRewriter();
+    virtual ~ILRewriter();
 #if 0 // Unused code from runtime repo
     void InitializeTiny();
 #endif // unused
@@ -208,7 +206,8 @@ public:
     // I M P O R T
     //
     ////////////////////////////////////////////////////////////////////////////////////////////////
-    HRESULT Import();
+    // Imports a method body (header, code and EH sections) from memory.
+    HRESULT Import(LPCBYTE pMethodBytes);
     HRESULT ImportIL(LPCBYTE pIL);
     HRESULT ImportEH(const COR_ILMETHOD_SECT_EH* pILEH, unsigned nEH);
     ILInstr* NewILInstr();
@@ -216,6 +215,7 @@ public:
     void InsertBefore(ILInstr * pWhere, ILInstr * pWhat);
     void InsertAfter(ILInstr * pWhere, ILInstr * pWhat);
     void InsertTryCatch(ILInstr * pTryStart, ILInstr * pCatchStart, ILInstr * pCatchEnd, mdToken filterClassToken);
+    void InsertTryFinally(ILInstr * pTryStart, ILInstr * pFinallyStart, ILInstr * pFinallyEnd);
     void AdjustState(ILInstr * pNewInstr);
     ILInstr * GetILList();
 
@@ -224,11 +224,47 @@ public:
     // E X P O R T
     //
     ////////////////////////////////////////////////////////////////////////////////////////////////
-    HRESULT Export();
-    HRESULT SetILFunctionBody(unsigned size, LPBYTE pBody);
-    LPBYTE AllocateILMemory(unsigned size);
-    void DeallocateILMemory(LPBYTE pBody);
+    // Exports the method body into memory returned by AllocateILMemory.
+    HRESULT Export(LPBYTE& pBody, unsigned& cbBody);
+
+private:
+    // Rewrites instructions to their smallest encodings; branches are made short and lengthened during layout.
+    void ShortenInstructions();
+    // Assigns final offsets and widens short branches whose targets are out of range. Returns the code size.
+    unsigned LayOutInstructions();
+    static unsigned GetInstrSize(const ILInstr * pInstr);
+
+public:
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    //
+    // S I G N A T U R E S
+    //
+    // These require metadata, see GetSigFromToken, GetTokenFromSig and GetMethodSignature.
+    //
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    HRESULT AddLocal(PCCOR_SIGNATURE pLocalType, ULONG cbLocalType, unsigned& localIndex);
+    HRESULT GetReturnType(PCCOR_SIGNATURE& pReturnType, ULONG& cbReturnType);
 
+protected:
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    //
+    // H O S T
+    //
+    // Without a host, exported bodies are allocated from the rewriter (and are freed with it),
+    // and the metadata methods fail with E_NOTIMPL.
+    //
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    virtual LPBYTE AllocateILMemory(unsigned size);
+    virtual HRESULT GetSigFromToken(mdSignature tkSig, PCCOR_SIGNATURE& pSig, ULONG& cbSig);
+    virtual HRESULT GetTokenFromSig(PCCOR_SIGNATURE pSig, ULONG cbSig, mdSignature& tkSig);
+    virtual HRESULT GetMethodSignature(PCCOR_SIGNATURE& pSig, ULONG& cbSig);
+
+private:
+    static HRESULT SkipType(PCCOR_SIGNATURE pSig, ULONG cbSig, ULONG& offset);
+    static HRESULT SkipData(PCCOR_SIGNATURE pSig, ULONG cbSig, ULONG& offset, uint32_t& data);
+
+public:
 #if 0 // Unused code from runtime repo
     /////////////////////////////////////////////////////////////////////////////////////////////////
     //
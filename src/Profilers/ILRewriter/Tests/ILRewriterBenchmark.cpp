@@ -0,0 +1,158 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+//
+// Compares the allocations of a rewrite backed by BumpArena with per-instruction new/delete,
+// and times complete rewrites. Not run as a test; usage: ILRewriterBenchmark [rewrites] [instructions]
+//
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "ILRewriter.h"
+
+using namespace std;
+using namespace std::chrono;
+
+namespace
+{
+    volatile size_t s_sink = 0;
+
+    /// <summary>
+    /// Allocates what ILRewriter allocated before it used an arena: one heap block per instruction,
+    /// plus the offset map and output buffer, all freed individually.
+    /// </summary>
+    void AllocateWithHeap(unsigned instructionCount)
+    {
+        vector<ILInstr*> instructions;
+        instructions.reserve(instructionCount);
+
+        ILInstr** pOffsetToInstr = new ILInstr*[instructionCount + 1];
+        for (unsigned i = 0; i < instructionCount; i++)
+        {
+            ILInstr* pInstr = new ILInstr();
+            pInstr->m_opcode = CEE_NOP;
+            pOffsetToInstr[i] = pInstr;
+            instructions.push_back(pInstr);
+        }
+        BYTE* pOutputBuffer = new BYTE[instructionCount];
+        s_sink += reinterpret_cast<size_t>(pOffsetToInstr[instructionCount / 2]) + pOutputBuffer[0];
+
+        delete[] pOutputBuffer;
+        for (ILInstr* pInstr : instructions)
+        {
+            delete pInstr;
+        }
+        delete[] pOffsetToInstr;
+    }
+
+    void AllocateWithArena(unsigned instructionCount)
+    {
+        // The instruction list threads through the instructions, so the arena needs no side vector.
+        BumpArena arena;
+
+        ILInstr** pOffsetToInstr = arena.AllocateArray<ILInstr*>(instructionCount + 1);
+        for (unsigned i = 0; i < instructionCount; i++)
+        {
+            ILInstr* pInstr = new (arena.Allocate(sizeof(ILInstr), alignof(ILInstr))) ILInstr();
+            pInstr->m_opcode = CEE_NOP;
+            pOffsetToInstr[i] = pInstr;
+        }
+        BYTE* pOutputBuffer = arena.AllocateArray<BYTE>(instructionCount);
+        s_sink += reinterpret_cast<size_t>(pOffsetToInstr[instructionCount / 2]) + pOutputBuffer[0];
+    }
+
+    vector<BYTE> CreateMethodBody(unsigned instructionCount)
+    {
+        // ldarg.0; brfalse.s over a run of nops; ret. Tiny methods are not worth measuring, so the header is fat.
+        unsigned codeSize = instructionCount;
+        unsigned alignedCodeSize = (codeSize + 3) & ~3;
+        vector<BYTE> body(sizeof(IMAGE_COR_ILMETHOD_FAT) + alignedCodeSize);
+
+        IMAGE_COR_ILMETHOD_FAT* pHeader = reinterpret_cast<IMAGE_COR_ILMETHOD_FAT*>(body.data());
+        pHeader->Flags = CorILMethod_FatFormat;
+        pHeader->Size = sizeof(IMAGE_COR_ILMETHOD_FAT) / sizeof(DWORD);
+        pHeader->MaxStack = 8;
+        pHeader->CodeSize = codeSize;
+        pHeader->LocalVarSigTok = mdSignatureNil;
+
+        BYTE* pCode = reinterpret_cast<BYTE*>(pHeader + 1);
+        memset(pCode, CEE_NOP, codeSize);
+        pCode[0] = CEE_LDARG_0;
+        pCode[1] = CEE_BRFALSE_S;
+        pCode[2] = 0;
+        pCode[codeSize - 1] = CEE_RET;
+
+        return body;
+    }
+
+    bool Rewrite(const vector<BYTE>& body)
+    {
+        ILRewriter rewriter;
+        if (FAILED(rewriter.Import(body.data())))
+        {
+            return false;
+        }
+
+        ILInstr* pList = rewriter.GetILList();
+        ILInstr* pNop = rewriter.NewILInstr();
+        pNop->m_opcode = CEE_NOP;
+        rewriter.InsertAfter(pList->m_pNext, pNop);
+
+        LPBYTE pBody = nullptr;
+        unsigned cbBody = 0;
+        if (FAILED(rewriter.Export(pBody, cbBody)))
+        {
+            return false;
+        }
+        s_sink += cbBody;
+        return true;
+    }
+
+    template<typename TAction>
+    double Measure(unsigned iterations, TAction action)
+    {
+        steady_clock::time_point start = steady_clock::now();
+        for (unsigned i = 0; i < iterations; i++)
+        {
+            action();
+        }
+        return duration<double, milli>(steady_clock::now() - start).count();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    unsigned rewrites = argc > 1 ? static_cast<unsigned>(strtoul(argv[1], nullptr, 10)) : 2000;
+    unsigned instructions = argc > 2 ? static_cast<unsigned>(strtoul(argv[2], nullptr, 10)) : 3000;
+    if (rewrites == 0 || instructions < 4)
+    {
+        fprintf(stderr, "usage: ILRewriterBenchmark [rewrites] [instructions >= 4]\n");
+        return 1;
+    }
+
+    // Warm up the heap and the caches before timing.
+    Measure(rewrites / 10 + 1, [&]() { AllocateWithHeap(instructions); });
+    Measure(rewrites / 10 + 1, [&]() { AllocateWithArena(instructions); });
+
+    double heapMilliseconds = Measure(rewrites, [&]() { AllocateWithHeap(instructions); });
+    double arenaMilliseconds = Measure(rewrites, [&]() { AllocateWithArena(instructions); });
+
+    vector<BYTE> body = CreateMethodBody(instructions);
+    bool succeeded = true;
+    double rewriteMilliseconds = Measure(rewrites, [&]() { succeeded &= Rewrite(body); });
+    if (!succeeded)
+    {
+        fprintf(stderr, "Rewrite failed\n");
+        return 1;
+    }
+
+    printf("%u rewrites of %u instructions\n", rewrites, instructions);
+    printf("  allocation, new/delete: %10.2f ms\n", heapMilliseconds);
+    printf("  allocation, arena:      %10.2f ms (%.0f%% less)\n", arenaMilliseconds, 100.0 * (1.0 - arenaMilliseconds / heapMilliseconds));
+    printf("  import + export:        %10.2f ms\n", rewriteMilliseconds);
+
+    return 0;
+}
@@ -0,0 +1,796 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+//
+// Imports, rewrites and exports method bodies in memory, without a runtime.
+// Returns the number of failed checks.
+//
+
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "ILRewriter.h"
+#include "TestChecks.h"
+
+using namespace std;
+
+namespace
+{
+    const mdToken CatchClassToken = 0x01000001;
+
+    //
+    // static void M(bool a)
+    // {
+    //     try { if (a) { ... } } catch { }
+    //     if (a) { ... }
+    // }
+    //
+    const BYTE TestCode[] =
+    {
+        CEE_NOP,                    // 0
+        CEE_LDARG_0,                // 1  try begin
+        CEE_BRFALSE_S, 0x02,        // 2  -> 6
+        CEE_LDC_I4_1,               // 4
+        CEE_POP,                    // 5
+        CEE_LEAVE_S, 0x03,          // 6  -> 11
+        CEE_POP,                    // 8  handler begin
+        CEE_LEAVE_S, 0x00,          // 9  -> 11
+        CEE_LDARG_0,                // 11
+        CEE_BRTRUE_S, 0x01,         // 12 -> 15
+        CEE_NOP,                    // 14
+        CEE_RET,                    // 15
+    };
+
+    //
+    // Long and short forms whose index fits a shorter one, and a few that do not.
+    //
+    const BYTE ShortFormCode[] =
+    {
+        CEE_PREFIX1, CEE_LDARG - 0x100, 0x02, 0x00,     // 0  ldarg 2       -> ldarg.2
+        CEE_PREFIX1, CEE_LDARG - 0x100, 0xC8, 0x00,     // 4  ldarg 200     -> ldarg.s 200
+        CEE_PREFIX1, CEE_LDARG - 0x100, 0x00, 0x01,     // 8  ldarg 256
+        CEE_LDLOC_S, 0x03,                              // 12 ldloc.s 3     -> ldloc.3
+        CEE_PREFIX1, CEE_LDLOC - 0x100, 0x04, 0x00,     // 14 ldloc 4       -> ldloc.s 4
+        CEE_PREFIX1, CEE_STLOC - 0x100, 0x01, 0x00,     // 18 stloc 1       -> stloc.1
+        CEE_PREFIX1, CEE_STLOC - 0x100, 0x10, 0x00,     // 22 stloc 16      -> stloc.s 16
+        CEE_PREFIX1, CEE_LDARGA - 0x100, 0x01, 0x00,    // 26 ldarga 1      -> ldarga.s 1
+        CEE_PREFIX1, CEE_STARG - 0x100, 0x05, 0x00,     // 30 starg 5       -> starg.s 5
+        CEE_PREFIX1, CEE_LDLOCA - 0x100, 0xFF, 0x00,    // 34 ldloca 255    -> ldloca.s 255
+        CEE_PREFIX1, CEE_LDLOCA - 0x100, 0x00, 0x01,    // 38 ldloca 256
+        CEE_RET,                                        // 42
+    };
+
+    //
+    // Each constant is loaded with ldc.i4 (or ldc.i4.s) and popped.
+    //
+    const INT32 ConstantValues[] = { -1, 0, 8, 9, -2, 127, -128, 128, -129, 100000 };
+    const unsigned ConstantShortFormValue = 5;
+
+    //
+    // switch (a) { case 0: case 2: L0; case 1: L1; } with a branch over both cases.
+    //
+    const BYTE SwitchCode[] =
+    {
+        CEE_LDARG_0,                // 0
+        CEE_SWITCH, 0x03, 0x00, 0x00, 0x00, // 1
+        0x02, 0x00, 0x00, 0x00,     // case 0 -> 20
+        0x03, 0x00, 0x00, 0x00,     // case 1 -> 21
+        0x02, 0x00, 0x00, 0x00,     // case 2 -> 20
+        CEE_BR_S, 0x02,             // 18 -> 22
+        CEE_NOP,                    // 20 L0
+        CEE_NOP,                    // 21 L1
+        CEE_RET,                    // 22
+    };
+
+    const unsigned SwitchTargetCount = 3;
+
+    //
+    // static int M(bool a)
+    // {
+    //     string s;
+    //     if (a) return 1;
+    //     return 2;
+    // }
+    //
+    const BYTE ReturnCode[] =
+    {
+        CEE_LDARG_0,                // 0
+        CEE_BRFALSE_S, 0x02,        // 1  -> 5
+        CEE_LDC_I4_1,               // 3
+        CEE_RET,                    // 4
+        CEE_LDC_I4_2,               // 5
+        CEE_RET,                    // 6
+    };
+
+    const COR_SIGNATURE ReturnMethodSignature[] = { IMAGE_CEE_CS_CALLCONV_DEFAULT, 1, ELEMENT_TYPE_I4, ELEMENT_TYPE_BOOLEAN };
+    const COR_SIGNATURE ReturnLocalsSignature[] = { IMAGE_CEE_CS_CALLCONV_LOCAL_SIG, 1, ELEMENT_TYPE_STRING };
+    const COR_SIGNATURE TimestampLocalType[] = { ELEMENT_TYPE_I8 };
+
+    const unsigned TestMaxStack = 8;
+    const unsigned TestTryOffset = 1;
+    const unsigned TestTryLength = 7;
+    const unsigned TestHandlerOffset = 8;
+    const unsigned TestHandlerLength = 3;
+
+    /// <summary>
+    /// Lays out a method body with a fat header, followed by a fat EH section if there are clauses.
+    /// </summary>
+    vector<BYTE> CreateMethodBody(const BYTE* pCode, unsigned codeSize, const vector<IMAGE_COR_ILMETHOD_SECT_EH_CLAUSE_FAT>& clauses, mdSignature localVarSigTok = mdSignatureNil)
+    {
+        unsigned alignedCodeSize = (codeSize + 3) & ~3;
+        vector<BYTE> body(sizeof(IMAGE_COR_ILMETHOD_FAT) + alignedCodeSize +
+            (clauses.empty() ? 0 : sizeof(IMAGE_COR_ILMETHOD_SECT_FAT) + sizeof(IMAGE_COR_ILMETHOD_SECT_EH_CLAUSE_FAT) * clauses.size()));
+
+        IMAGE_COR_ILMETHOD_FAT* pHeader = reinterpret_cast<IMAGE_COR_ILMETHOD_FAT*>(body.data());
+        pHeader->Flags = CorILMethod_FatFormat | CorILMethod_InitLocals | (clauses.empty() ? 0 : CorILMethod_MoreSects);
+        pHeader->Size = sizeof(IMAGE_COR_ILMETHOD_FAT) / sizeof(DWORD);
+        pHeader->MaxStack = TestMaxStack;
+        pHeader->CodeSize = codeSize;
+        pHeader->LocalVarSigTok = localVarSigTok;
+
+        BYTE* pCurrent = reinterpret_cast<BYTE*>(pHeader + 1);
+        memcpy(pCurrent, pCode, codeSize);
+        pCurrent += alignedCodeSize;
+
+        if (!clauses.empty())
+        {
+            IMAGE_COR_ILMETHOD_SECT_FAT* pSection = reinterpret_cast<IMAGE_COR_ILMETHOD_SECT_FAT*>(pCurrent);
+            pSection->Kind = CorILMethod_Sect_EHTable | CorILMethod_Sect_FatFormat;
+            pSection->DataSize = static_cast<unsigned>(sizeof(IMAGE_COR_ILMETHOD_SECT_FAT) + sizeof(IMAGE_COR_ILMETHOD_SECT_EH_CLAUSE_FAT) * clauses.size());
+            memcpy(pSection + 1, clauses.data(), sizeof(IMAGE_COR_ILMETHOD_SECT_EH_CLAUSE_FAT) * clauses.size());
+        }
+
+        return body;
+    }
+
+    vector<BYTE> CreateTestMethodBody()
+    {
+        IMAGE_COR_ILMETHOD_SECT_EH_CLAUSE_FAT clause = {};
+        clause.Flags = COR_ILEXCEPTION_CLAUSE_NONE;
+        clause.TryOffset = TestTryOffset;
+        clause.TryLength = TestTryLength;
+        clause.HandlerOffset = TestHandlerOffset;
+        clause.HandlerLength = TestHandlerLength;
+        clause.ClassToken = CatchClassToken;
+
+        return CreateMethodBody(TestCode, sizeof(TestCode), { clause });
+    }
+
+    /// <summary>
+    /// Stands in for the metadata of a single method: its signature, and the standalone signatures of its module.
+    /// </summary>
+    class SignatureRewriter final :
+        public ILRewriter
+    {
+    private:
+        vector<COR_SIGNATURE> _methodSignature;
+        vector<vector<COR_SIGNATURE>> _signatures;
+
+    public:
+        SignatureRewriter(PCCOR_SIGNATURE pMethodSignature, ULONG cbMethodSignature) :
+            _methodSignature(pMethodSignature, pMethodSignature + cbMethodSignature)
+        {
+        }
+
+        mdSignature DefineSignature(PCCOR_SIGNATURE pSig, ULONG cbSig)
+        {
+            _signatures.emplace_back(pSig, pSig + cbSig);
+            return TokenFromRid(static_cast<ULONG>(_signatures.size()), mdtSignature);
+        }
+
+        vector<COR_SIGNATURE> GetSignature(mdSignature tkSig)
+        {
+            ULONG rid = RidFromToken(tkSig);
+            if (TypeFromToken(tkSig) != mdtSignature || rid == 0 || rid > _signatures.size())
+            {
+                return {};
+            }
+            return _signatures[rid - 1];
+        }
+
+        size_t GetSignatureCount()
+        {
+            return _signatures.size();
+        }
+
+    protected:
+        HRESULT GetSigFromToken(mdSignature tkSig, PCCOR_SIGNATURE& pSig, ULONG& cbSig) override
+        {
+            ULONG rid = RidFromToken(tkSig);
+            if (TypeFromToken(tkSig) != mdtSignature || rid == 0 || rid > _signatures.size())
+            {
+                return E_INVALIDARG;
+            }
+
+            pSig = _signatures[rid - 1].data();
+            cbSig = static_cast<ULONG>(_signatures[rid - 1].size());
+            return S_OK;
+        }
+
+        HRESULT GetTokenFromSig(PCCOR_SIGNATURE pSig, ULONG cbSig, mdSignature& tkSig) override
+        {
+            tkSig = DefineSignature(pSig, cbSig);
+            return S_OK;
+        }
+
+        HRESULT GetMethodSignature(PCCOR_SIGNATURE& pSig, ULONG& cbSig) override
+        {
+            pSig = _methodSignature.data();
+            cbSig = static_cast<ULONG>(_methodSignature.size());
+            return S_OK;
+        }
+    };
+
+    ILInstr* FindInstr(ILRewriter& rewriter, unsigned opcode, unsigned occurrence = 0)
+    {
+        ILInstr* pList = rewriter.GetILList();
+        for (ILInstr* pInstr = pList->m_pNext; pInstr != pList; pInstr = pInstr->m_pNext)
+        {
+            if (pInstr->m_opcode == opcode && occurrence-- == 0)
+            {
+                return pInstr;
+            }
+        }
+        return nullptr;
+    }
+
+    void InsertNops(ILRewriter& rewriter, ILInstr* pWhere, unsigned count)
+    {
+        for (unsigned i = 0; i < count; i++)
+        {
+            ILInstr* pNop = rewriter.NewILInstr();
+            pNop->m_opcode = CEE_NOP;
+            rewriter.InsertBefore(pWhere, pNop);
+        }
+    }
+
+    void CheckEHClause(LPCBYTE pBody, CorExceptionFlag flags, unsigned tryOffset, unsigned tryLength, unsigned handlerOffset, unsigned handlerLength)
+    {
+        COR_ILMETHOD_DECODER decoder(reinterpret_cast<const COR_ILMETHOD*>(pBody));
+        CHECK(decoder.EHCount() == 1);
+        if (decoder.EHCount() != 1)
+        {
+            return;
+        }
+
+        COR_ILMETHOD_SECT_EH_CLAUSE_FAT scratch;
+        const COR_ILMETHOD_SECT_EH_CLAUSE_FAT* pClause = static_cast<const COR_ILMETHOD_SECT_EH_CLAUSE_FAT*>(decoder.EH->EHClause(0, &scratch));
+        CHECK(pClause->GetFlags() == flags);
+        CHECK(pClause->GetTryOffset() == tryOffset);
+        CHECK(pClause->GetTryLength() == tryLength);
+        CHECK(pClause->GetHandlerOffset() == handlerOffset);
+        CHECK(pClause->GetHandlerLength() == handlerLength);
+        if (flags == COR_ILEXCEPTION_CLAUSE_NONE)
+        {
+            CHECK(pClause->GetClassToken() == CatchClassToken);
+        }
+    }
+
+    void RoundTrip_PreservesBody()
+    {
+        vector<BYTE> body = CreateTestMethodBody();
+
+        ILRewriter rewriter;
+        CHECK(SUCCEEDED(rewriter.Import(body.data())));
+
+        LPBYTE pExported = nullptr;
+        unsigned cbExported = 0;
+        CHECK(SUCCEEDED(rewriter.Export(pExported, cbExported)));
+
+        CHECK(cbExported == body.size());
+        if (pExported == nullptr || cbExported != body.size())
+        {
+            return;
+        }
+
+        // Instructions are counted towards the max stack as they are imported, so it can only grow.
+        vector<BYTE> exported(pExported, pExported + cbExported);
+        IMAGE_COR_ILMETHOD_FAT* pHeader = reinterpret_cast<IMAGE_COR_ILMETHOD_FAT*>(exported.data());
+        CHECK(pHeader->MaxStack >= TestMaxStack);
+        pHeader->MaxStack = TestMaxStack;
+
+        CHECK(exported == body);
+    }
+
+    void Rewrite_LengthensBranchesAndMovesEHClauses()
+    {
+        const unsigned TryNopCount = 130;
+        const unsigned TailNopCount = 200;
+
+        vector<BYTE> body = CreateTestMethodBody();
+
+        ILRewriter rewriter;
+        CHECK(SUCCEEDED(rewriter.Import(body.data())));
+
+        // Pushes the targets of brfalse.s (inside the try) and brtrue.s past the reach of a short branch.
+        InsertNops(rewriter, FindInstr(rewriter, CEE_LEAVE_S), TryNopCount);
+        InsertNops(rewriter, FindInstr(rewriter, CEE_RET), TailNopCount);
+
+        LPBYTE pExported = nullptr;
+        unsigned cbExported = 0;
+        CHECK(SUCCEEDED(rewriter.Export(pExported, cbExported)));
+        if (pExported == nullptr)
+        {
+            return;
+        }
+
+        // nop, ldarg.0, brfalse, ldc.i4.1, pop, nops, leave.s, pop, leave.s, ldarg.0, brtrue, nop, nops, ret
+        const unsigned LeaveOffset = 9 + TryNopCount;
+        const unsigned HandlerOffset = LeaveOffset + 2;
+        const unsigned AfterOffset = HandlerOffset + 3;
+        const unsigned RetOffset = AfterOffset + 7 + TailNopCount;
+
+        COR_ILMETHOD_DECODER decoder(reinterpret_cast<const COR_ILMETHOD*>(pExported));
+        CHECK(decoder.GetCodeSize() == RetOffset + 1);
+        CHECK(decoder.GetMaxStack() >= TestMaxStack);
+        CheckEHClause(pExported, COR_ILEXCEPTION_CLAUSE_NONE, TestTryOffset, HandlerOffset - TestTryOffset, HandlerOffset, AfterOffset - HandlerOffset);
+
+        // Reimporting resolves every branch from the exported offsets.
+        ILRewriter reimported;
+        CHECK(SUCCEEDED(reimported.Import(pExported)));
+
+        CHECK(FindInstr(reimported, CEE_BRFALSE_S) == nullptr);
+        CHECK(FindInstr(reimported, CEE_BRTRUE_S) == nullptr);
+
+        ILInstr* pBrFalse = FindInstr(reimported, CEE_BRFALSE);
+        CHECK(pBrFalse != nullptr && pBrFalse->m_pTarget == reimported.GetInstrFromOffset(LeaveOffset));
+
+        ILInstr* pBrTrue = FindInstr(reimported, CEE_BRTRUE);
+        CHECK(pBrTrue != nullptr && pBrTrue->m_pTarget == reimported.GetInstrFromOffset(RetOffset));
+        CHECK(reimported.GetInstrFromOffset(RetOffset)->m_opcode == CEE_RET);
+
+        // Both leaves stay short.
+        ILInstr* pTryLeave = FindInstr(reimported, CEE_LEAVE_S, 0);
+        ILInstr* pHandlerLeave = FindInstr(reimported, CEE_LEAVE_S, 1);
+        CHECK(pTryLeave != nullptr && pTryLeave->m_pTarget == reimported.GetInstrFromOffset(AfterOffset));
+        CHECK(pHandlerLeave != nullptr && pHandlerLeave->m_pTarget == reimported.GetInstrFromOffset(AfterOffset));
+    }
+
+    /// <summary>
+    /// Exports a rewritten body and imports it again, so that checks see the instructions as they were emitted.
+    /// </summary>
+    bool ExportAndReimport(ILRewriter& rewriter, ILRewriter& reimported, unsigned& codeSize)
+    {
+        LPBYTE pExported = nullptr;
+        unsigned cbExported = 0;
+        CHECK(SUCCEEDED(rewriter.Export(pExported, cbExported)));
+        if (pExported == nullptr)
+        {
+            return false;
+        }
+
+        COR_ILMETHOD_DECODER decoder(reinterpret_cast<const COR_ILMETHOD*>(pExported));
+        codeSize = decoder.GetCodeSize();
+
+        CHECK(SUCCEEDED(reimported.Import(pExported)));
+        return true;
+    }
+
+    void CheckInstr(ILInstr*& pInstr, unsigned opcode)
+    {
+        CHECK(pInstr->m_opcode == opcode);
+        pInstr = pInstr->m_pNext;
+    }
+
+    void CheckInstr8(ILInstr*& pInstr, unsigned opcode, UINT8 arg)
+    {
+        CHECK(pInstr->m_opcode == opcode && static_cast<UINT8>(pInstr->m_Arg8) == arg);
+        pInstr = pInstr->m_pNext;
+    }
+
+    void CheckInstr16(ILInstr*& pInstr, unsigned opcode, UINT16 arg)
+    {
+        CHECK(pInstr->m_opcode == opcode && static_cast<UINT16>(pInstr->m_Arg16) == arg);
+        pInstr = pInstr->m_pNext;
+    }
+
+    void Export_ShortensArgumentAndLocalIndexes()
+    {
+        vector<BYTE> body = CreateMethodBody(ShortFormCode, sizeof(ShortFormCode), {});
+
+        ILRewriter rewriter;
+        CHECK(SUCCEEDED(rewriter.Import(body.data())));
+
+        ILRewriter reimported;
+        unsigned codeSize = 0;
+        if (!ExportAndReimport(rewriter, reimported, codeSize))
+        {
+            return;
+        }
+
+        // Four single byte, six two byte and two four byte instructions, and ret.
+        CHECK(codeSize == 4 * 1 + 6 * 2 + 2 * 4);
+
+        ILInstr* pInstr = reimported.GetILList()->m_pNext;
+        CheckInstr(pInstr, CEE_LDARG_2);
+        CheckInstr8(pInstr, CEE_LDARG_S, 200);
+        CheckInstr16(pInstr, CEE_LDARG, 256);
+        CheckInstr(pInstr, CEE_LDLOC_3);
+        CheckInstr8(pInstr, CEE_LDLOC_S, 4);
+        CheckInstr(pInstr, CEE_STLOC_1);
+        CheckInstr8(pInstr, CEE_STLOC_S, 16);
+        CheckInstr8(pInstr, CEE_LDARGA_S, 1);
+        CheckInstr8(pInstr, CEE_STARG_S, 5);
+        CheckInstr8(pInstr, CEE_LDLOCA_S, 255);
+        CheckInstr16(pInstr, CEE_LDLOCA, 256);
+        CheckInstr(pInstr, CEE_RET);
+        CHECK(pInstr == reimported.GetILList());
+    }
+
+    void Export_CompactsConstants()
+    {
+        vector<BYTE> code;
+        for (INT32 value : ConstantValues)
+        {
+            code.push_back(CEE_LDC_I4);
+            for (unsigned i = 0; i < sizeof(INT32); i++)
+            {
+                code.push_back(static_cast<BYTE>(static_cast<UINT32>(value) >> (8 * i)));
+            }
+            code.push_back(CEE_POP);
+        }
+        code.push_back(CEE_LDC_I4_S);
+        code.push_back(static_cast<BYTE>(ConstantShortFormValue));
+        code.push_back(CEE_POP);
+        code.push_back(CEE_RET);
+
+        vector<BYTE> body = CreateMethodBody(code.data(), static_cast<unsigned>(code.size()), {});
+
+        ILRewriter rewriter;
+        CHECK(SUCCEEDED(rewriter.Import(body.data())));
+
+        ILRewriter reimported;
+        unsigned codeSize = 0;
+        if (!ExportAndReimport(rewriter, reimported, codeSize))
+        {
+            return;
+        }
+
+        unsigned expectedCodeSize = 0;
+        ILInstr* pInstr = reimported.GetILList()->m_pNext;
+        for (INT32 value : ConstantValues)
+        {
+            if (value >= -1 && value <= 8)
+            {
+                CHECK(pInstr->m_opcode == static_cast<unsigned>(CEE_LDC_I4_0 + value));
+                expectedCodeSize += 1;
+            }
+            else if (value >= INT8_MIN && value <= INT8_MAX)
+            {
+                CHECK(pInstr->m_opcode == CEE_LDC_I4_S && pInstr->m_Arg8 == value);
+                expectedCodeSize += 2;
+            }
+            else
+            {
+                CHECK(pInstr->m_opcode == CEE_LDC_I4 && pInstr->m_Arg32 == value);
+                expectedCodeSize += 5;
+            }
+            pInstr = pInstr->m_pNext;
+            CheckInstr(pInstr, CEE_POP);
+            expectedCodeSize += 1;
+        }
+        CheckInstr(pInstr, CEE_LDC_I4_0 + ConstantShortFormValue);
+        CheckInstr(pInstr, CEE_POP);
+        CheckInstr(pInstr, CEE_RET);
+        CHECK(pInstr == reimported.GetILList());
+
+        CHECK(codeSize == expectedCodeSize + 3);
+    }
+
+    void Rewrite_MovesSwitchTargets()
+    {
+        const unsigned CaseNopCount = 200;
+
+        vector<BYTE> body = CreateMethodBody(SwitchCode, sizeof(SwitchCode), {});
+
+        ILRewriter rewriter;
+        CHECK(SUCCEEDED(rewriter.Import(body.data())));
+
+        // Pushes the second case and the end past the reach of br.s, which then moves both cases.
+        ILInstr* pSecondCase = rewriter.GetInstrFromOffset(21);
+        CHECK(pSecondCase != nullptr);
+        if (pSecondCase == nullptr)
+        {
+            return;
+        }
+        InsertNops(rewriter, pSecondCase, CaseNopCount);
+
+        LPBYTE pExported = nullptr;
+        unsigned cbExported = 0;
+        CHECK(SUCCEEDED(rewriter.Export(pExported, cbExported)));
+        if (pExported == nullptr)
+        {
+            return;
+        }
+
+        // ldarg.0, switch, br, nop, nops, nop, ret
+        const unsigned SwitchBase = 1 + 1 + sizeof(INT32) * (SwitchTargetCount + 1);
+        const unsigned FirstCaseOffset = SwitchBase + 5;
+        const unsigned SecondCaseOffset = FirstCaseOffset + 1 + CaseNopCount;
+        const unsigned RetOffset = SecondCaseOffset + 1;
+
+        // The targets are emitted relative to the end of the switch.
+        COR_ILMETHOD_DECODER decoder(reinterpret_cast<const COR_ILMETHOD*>(pExported));
+        CHECK(decoder.GetCodeSize() == RetOffset + 1);
+        const INT32 expectedTargets[SwitchTargetCount] =
+        {
+            static_cast<INT32>(FirstCaseOffset - SwitchBase),
+            static_cast<INT32>(SecondCaseOffset - SwitchBase),
+            static_cast<INT32>(FirstCaseOffset - SwitchBase),
+        };
+        CHECK(decoder.Code[1] == CEE_SWITCH);
+        for (unsigned i = 0; i < SwitchTargetCount; i++)
+        {
+            INT32 target;
+            memcpy(&target, decoder.Code + 1 + 1 + sizeof(INT32) * (i + 1), sizeof(INT32));
+            CHECK(target == expectedTargets[i]);
+        }
+
+        ILRewriter reimported;
+        CHECK(SUCCEEDED(reimported.Import(pExported)));
+
+        ILInstr* pSwitch = FindInstr(reimported, CEE_SWITCH);
+        CHECK(pSwitch != nullptr);
+        if (pSwitch == nullptr)
+        {
+            return;
+        }
+
+        ILInstr* pArg = pSwitch->m_pNext;
+        for (unsigned i = 0; i < SwitchTargetCount; i++, pArg = pArg->m_pNext)
+        {
+            CHECK(pArg->m_opcode == CEE_SWITCH_ARG);
+            CHECK(pArg->m_pTarget == reimported.GetInstrFromOffset(SwitchBase + expectedTargets[i]));
+        }
+
+        CHECK(pArg->m_opcode == CEE_BR);
+        CHECK(pArg->m_pTarget == reimported.GetInstrFromOffset(RetOffset));
+        CHECK(reimported.GetInstrFromOffset(RetOffset)->m_opcode == CEE_RET);
+    }
+
+    void AddLocal_AppendsToLocalsSignature()
+    {
+        const COR_SIGNATURE StringLocalType[] = { ELEMENT_TYPE_STRING };
+        const COR_SIGNATURE ClassLocalType[] = { ELEMENT_TYPE_CLASS, 0x49 }; // TypeRef 0x12
+        const BYTE Code[] = { CEE_RET };
+
+        // Without a host, locals cannot be added.
+        {
+            vector<BYTE> body = CreateMethodBody(Code, sizeof(Code), {});
+            ILRewriter rewriter;
+            CHECK(SUCCEEDED(rewriter.Import(body.data())));
+
+            unsigned localIndex;
+            CHECK(rewriter.AddLocal(TimestampLocalType, sizeof(TimestampLocalType), localIndex) == E_NOTIMPL);
+        }
+
+        // A method without locals gets its first one.
+        {
+            vector<BYTE> body = CreateMethodBody(Code, sizeof(Code), {});
+            SignatureRewriter rewriter(ReturnMethodSignature, sizeof(ReturnMethodSignature));
+            CHECK(SUCCEEDED(rewriter.Import(body.data())));
+
+            unsigned localIndex = UINT_MAX;
+            CHECK(SUCCEEDED(rewriter.AddLocal(TimestampLocalType, sizeof(TimestampLocalType), localIndex)));
+            CHECK(localIndex == 0);
+            CHECK(rewriter.GetSignatureCount() == 1);
+            CHECK(rewriter.GetSignature(TokenFromRid(1, mdtSignature)) == vector<COR_SIGNATURE>({ IMAGE_CEE_CS_CALLCONV_LOCAL_SIG, 1, ELEMENT_TYPE_I8 }));
+        }
+
+        // Locals are appended to the existing ones, and each addition defines a new signature.
+        {
+            SignatureRewriter rewriter(ReturnMethodSignature, sizeof(ReturnMethodSignature));
+            mdSignature tkLocals = rewriter.DefineSignature(ReturnLocalsSignature, sizeof(ReturnLocalsSignature));
+            vector<BYTE> body = CreateMethodBody(Code, sizeof(Code), {}, tkLocals);
+            CHECK(SUCCEEDED(rewriter.Import(body.data())));
+
+            unsigned firstIndex = UINT_MAX;
+            unsigned secondIndex = UINT_MAX;
+            CHECK(SUCCEEDED(rewriter.AddLocal(TimestampLocalType, sizeof(TimestampLocalType), firstIndex)));
+            CHECK(SUCCEEDED(rewriter.AddLocal(ClassLocalType, sizeof(ClassLocalType), secondIndex)));
+            CHECK(firstIndex == 1);
+            CHECK(secondIndex == 2);
+            CHECK(rewriter.GetSignatureCount() == 3);
+
+            // The original signature is left as it was.
+            CHECK(rewriter.GetSignature(tkLocals) == vector<COR_SIGNATURE>(ReturnLocalsSignature, ReturnLocalsSignature + sizeof(ReturnLocalsSignature)));
+            CHECK(rewriter.GetSignature(TokenFromRid(3, mdtSignature)) == vector<COR_SIGNATURE>(
+                { IMAGE_CEE_CS_CALLCONV_LOCAL_SIG, 3, ELEMENT_TYPE_STRING, ELEMENT_TYPE_I8, ELEMENT_TYPE_CLASS, 0x49 }));
+
+            LPBYTE pExported = nullptr;
+            unsigned cbExported = 0;
+            CHECK(SUCCEEDED(rewriter.Export(pExported, cbExported)));
+            if (pExported != nullptr)
+            {
+                COR_ILMETHOD_DECODER decoder(reinterpret_cast<const COR_ILMETHOD*>(pExported));
+                CHECK(decoder.GetLocalVarSigTok() == TokenFromRid(3, mdtSignature));
+            }
+        }
+
+        // A locals signature that cannot be read is reported.
+        {
+            SignatureRewriter rewriter(ReturnMethodSignature, sizeof(ReturnMethodSignature));
+            vector<BYTE> body = CreateMethodBody(Code, sizeof(Code), {}, TokenFromRid(1, mdtSignature));
+            CHECK(SUCCEEDED(rewriter.Import(body.data())));
+
+            unsigned localIndex;
+            CHECK(rewriter.AddLocal(TimestampLocalType, sizeof(TimestampLocalType), localIndex) == E_INVALIDARG);
+        }
+    }
+
+    void CheckReturnType(const vector<COR_SIGNATURE>& methodSignature, const vector<COR_SIGNATURE>& expectedReturnType)
+    {
+        SignatureRewriter rewriter(methodSignature.data(), static_cast<ULONG>(methodSignature.size()));
+
+        PCCOR_SIGNATURE pReturnType = nullptr;
+        ULONG cbReturnType = 0;
+        CHECK(SUCCEEDED(rewriter.GetReturnType(pReturnType, cbReturnType)));
+        CHECK(pReturnType != nullptr && vector<COR_SIGNATURE>(pReturnType, pReturnType + cbReturnType) == expectedReturnType);
+    }
+
+    void GetReturnType_SkipsToReturnType()
+    {
+        // void M()
+        CheckReturnType({ IMAGE_CEE_CS_CALLCONV_DEFAULT, 0, ELEMENT_TYPE_VOID }, { ELEMENT_TYPE_VOID });
+
+        // int M(bool)
+        CheckReturnType(vector<COR_SIGNATURE>(ReturnMethodSignature, ReturnMethodSignature + sizeof(ReturnMethodSignature)), { ELEMENT_TYPE_I4 });
+
+        // List<int> this.M(string, int)
+        CheckReturnType(
+            { IMAGE_CEE_CS_CALLCONV_DEFAULT | IMAGE_CEE_CS_CALLCONV_HASTHIS, 2, ELEMENT_TYPE_GENERICINST, ELEMENT_TYPE_CLASS, 0x49, 1, ELEMENT_TYPE_I4, ELEMENT_TYPE_STRING, ELEMENT_TYPE_I4 },
+            { ELEMENT_TYPE_GENERICINST, ELEMENT_TYPE_CLASS, 0x49, 1, ELEMENT_TYPE_I4 });
+
+        // ref T[] M<T>(T)
+        CheckReturnType(
+            { IMAGE_CEE_CS_CALLCONV_GENERIC, 1, 1, ELEMENT_TYPE_BYREF, ELEMENT_TYPE_SZARRAY, ELEMENT_TYPE_MVAR, 0, ELEMENT_TYPE_MVAR, 0 },
+            { ELEMENT_TYPE_BYREF, ELEMENT_TYPE_SZARRAY, ELEMENT_TYPE_MVAR, 0 });
+
+        // A signature that ends before its return type is reported.
+        SignatureRewriter truncated(ReturnMethodSignature, 2);
+        PCCOR_SIGNATURE pReturnType;
+        ULONG cbReturnType;
+        CHECK(truncated.GetReturnType(pReturnType, cbReturnType) == META_E_BAD_SIGNATURE);
+
+        // Without a host, there is no signature to read.
+        ILRewriter rewriter;
+        CHECK(rewriter.GetReturnType(pReturnType, cbReturnType) == E_NOTIMPL);
+    }
+
+    void InsertTryFinally_WrapsReturns()
+    {
+        SignatureRewriter rewriter(ReturnMethodSignature, sizeof(ReturnMethodSignature));
+        mdSignature tkLocals = rewriter.DefineSignature(ReturnLocalsSignature, sizeof(ReturnLocalsSignature));
+        vector<BYTE> body = CreateMethodBody(ReturnCode, sizeof(ReturnCode), {}, tkLocals);
+        CHECK(SUCCEEDED(rewriter.Import(body.data())));
+
+        // As the latency probes do: each return stores its value and leaves to an epilogue,
+        // and a finally block runs on every exit.
+        PCCOR_SIGNATURE pReturnType = nullptr;
+        ULONG cbReturnType = 0;
+        CHECK(SUCCEEDED(rewriter.GetReturnType(pReturnType, cbReturnType)));
+
+        unsigned startLocal = 0;
+        unsigned returnValueLocal = 0;
+        CHECK(SUCCEEDED(rewriter.AddLocal(TimestampLocalType, sizeof(TimestampLocalType), startLocal)));
+        CHECK(SUCCEEDED(rewriter.AddLocal(pReturnType, cbReturnType, returnValueLocal)));
+        CHECK(startLocal == 1);
+        CHECK(returnValueLocal == 2);
+
+        ILInstr* pILList = rewriter.GetILList();
+        ILInstr* pTryBegin = pILList->m_pNext;
+
+        ILInstr* pEpilogue = rewriter.NewILInstr();
+        pEpilogue->m_opcode = CEE_LDLOC;
+        pEpilogue->m_Arg16 = static_cast<INT16>(returnValueLocal);
+        rewriter.InsertBefore(pILList, pEpilogue);
+
+        ILInstr* pNewInstr = rewriter.NewILInstr();
+        pNewInstr->m_opcode = CEE_RET;
+        rewriter.InsertBefore(pILList, pNewInstr);
+
+        for (ILInstr* pInstr = pTryBegin; pInstr != pEpilogue; pInstr = pInstr->m_pNext)
+        {
+            if (pInstr->m_opcode == CEE_RET)
+            {
+                pInstr->m_opcode = CEE_STLOC;
+                pInstr->m_Arg16 = static_cast<INT16>(returnValueLocal);
+
+                pNewInstr = rewriter.NewILInstr();
+                pNewInstr->m_opcode = CEE_LEAVE;
+                pNewInstr->m_pTarget = pEpilogue;
+                rewriter.InsertAfter(pInstr, pNewInstr);
+                pInstr = pNewInstr;
+            }
+        }
+
+        ILInstr* pFinallyBegin = rewriter.NewILInstr();
+        pFinallyBegin->m_opcode = CEE_LDLOC;
+        pFinallyBegin->m_Arg16 = static_cast<INT16>(startLocal);
+        rewriter.InsertBefore(pEpilogue, pFinallyBegin);
+
+        pNewInstr = rewriter.NewILInstr();
+        pNewInstr->m_opcode = CEE_POP;
+        rewriter.InsertBefore(pEpilogue, pNewInstr);
+
+        ILInstr* pFinallyEnd = rewriter.NewILInstr();
+        pFinallyEnd->m_opcode = CEE_ENDFINALLY;
+        rewriter.InsertBefore(pEpilogue, pFinallyEnd);
+
+        pNewInstr = rewriter.NewILInstr();
+        pNewInstr->m_opcode = CEE_LDC_I4_0;
+        rewriter.InsertBefore(pTryBegin, pNewInstr);
+
+        pNewInstr = rewriter.NewILInstr();
+        pNewInstr->m_opcode = CEE_CONV_I8;
+        rewriter.InsertBefore(pTryBegin, pNewInstr);
+
+        pNewInstr = rewriter.NewILInstr();
+        pNewInstr->m_opcode = CEE_STLOC;
+        pNewInstr->m_Arg16 = static_cast<INT16>(startLocal);
+        rewriter.InsertBefore(pTryBegin, pNewInstr);
+
+        rewriter.InsertTryFinally(pTryBegin, pFinallyBegin, pFinallyEnd);
+
+        LPBYTE pExported = nullptr;
+        unsigned cbExported = 0;
+        CHECK(SUCCEEDED(rewriter.Export(pExported, cbExported)));
+        if (pExported == nullptr)
+        {
+            return;
+        }
+
+        // ldc.i4.0, conv.i8, stloc.1, try { ldarg.0, brfalse.s, ldc.i4.1, stloc.2, leave.s, ldc.i4.2, stloc.2, leave.s }
+        // finally { ldloc.1, pop, endfinally }, ldloc.2, ret
+        const unsigned TryOffset = 3;
+        const unsigned SecondReturnOffset = TryOffset + 7;
+        const unsigned FinallyOffset = SecondReturnOffset + 4;
+        const unsigned EpilogueOffset = FinallyOffset + 3;
+
+        COR_ILMETHOD_DECODER decoder(reinterpret_cast<const COR_ILMETHOD*>(pExported));
+        CHECK(decoder.GetCodeSize() == EpilogueOffset + 2);
+        CHECK((decoder.GetFlags() & CorILMethod_InitLocals) != 0);
+        CheckEHClause(pExported, COR_ILEXCEPTION_CLAUSE_FINALLY, TryOffset, FinallyOffset - TryOffset, FinallyOffset, EpilogueOffset - FinallyOffset);
+
+        // The locals are the original string, then the timestamp and the return value.
+        CHECK(decoder.GetLocalVarSigTok() == TokenFromRid(3, mdtSignature));
+        CHECK(rewriter.GetSignature(decoder.GetLocalVarSigTok()) == vector<COR_SIGNATURE>(
+            { IMAGE_CEE_CS_CALLCONV_LOCAL_SIG, 3, ELEMENT_TYPE_STRING, ELEMENT_TYPE_I8, ELEMENT_TYPE_I4 }));
+
+        ILRewriter reimported;
+        CHECK(SUCCEEDED(reimported.Import(pExported)));
+
+        ILInstr* pBrFalse = FindInstr(reimported, CEE_BRFALSE_S);
+        CHECK(pBrFalse != nullptr && pBrFalse->m_pTarget == reimported.GetInstrFromOffset(SecondReturnOffset));
+
+        for (unsigned i = 0; i < 2; i++)
+        {
+            ILInstr* pLeave = FindInstr(reimported, CEE_LEAVE_S, i);
+            CHECK(pLeave != nullptr && pLeave->m_pPrev->m_opcode == CEE_STLOC_2);
+            CHECK(pLeave != nullptr && pLeave->m_pTarget == reimported.GetInstrFromOffset(EpilogueOffset));
+        }
+
+        CHECK(reimported.GetInstrFromOffset(FinallyOffset)->m_opcode == CEE_LDLOC_1);
+        CHECK(reimported.GetInstrFromOffset(EpilogueOffset)->m_opcode == CEE_LDLOC_2);
+    }
+}
+
+int main()
+{
+    RoundTrip_PreservesBody();
+    Rewrite_LengthensBranchesAndMovesEHClauses();
+    Export_ShortensArgumentAndLocalIndexes();
+    Export_CompactsConstants();
+    Rewrite_MovesSwitchTargets();
+    AddLocal_AppendsToLocalsSignature();
+    GetReturnType_SkipsToReturnType();
+    InsertTryFinally_WrapsReturns();
+
+    if (s_failures == 0)
+    {
+        printf("ILRewriter tests passed\n");
+    }
+
+    return s_failures;
+}
@@ -4,10 +4,15 @@
 #include "CommandServer.h"
 #include <thread>
 #include "Logging/Logger.h"
+#include "macros.h"
 
 CommandServer::CommandServer(const std::shared_ptr<ILogger>& logger, ICorProfilerInfo12* profilerInfo) :
     _shutdown(false),
     _server(logger),
+    _clientQueue(MaxQueuedMessages),
+    _unmanagedOnlyQueue(MaxQueuedMessages),
+    _nextJobId(1),
+    _nextHoldId(1),
     _logger(logger),
     _profilerInfo(profilerInfo)
 {
@@ -57,17 +62,17 @@ void CommandServer::Shutdown()
         _listeningThread.join();
         _clientThread.join();
         _unmanagedOnlyThread.join();
+
+        // Answer any clients still waiting on jobs that will never run.
+        AbortIncompleteJobs();
+
+        ReleaseAllHolds();
     }
 }
 
 void CommandServer::ListeningThread()
 {
     // TODO: Handle oom scenarios
-    IpcMessage response;
-    response.CommandSet = static_cast<unsigned short>(CommandSet::ServerResponse);
-    response.Command = static_cast<unsigned short>(ServerResponseCommand::Status);
-    response.Payload.resize(sizeof(HRESULT));
-
     while (true)
     {
         std::shared_ptr<IpcCommClient> client;
@@ -88,20 +93,32 @@ void CommandServer::ListeningThread()
             continue;
         }
 
-        bool doEnqueueMessage = true;
+        // Job control is handled by the server itself and is never queued.
+        if (message.CommandSet == static_cast<unsigned short>(CommandSet::JobControl))
+        {
+            ProcessJobControlMessage(message, client);
+            continue;
+        }
+
+        // Hold points must be released even when the processing threads are busy, so they are never queued either.
+        if (message.CommandSet == static_cast<unsigned short>(CommandSet::HoldPoint))
+        {
+            ProcessHoldPointMessage(message, client);
+            continue;
+        }
+
         hr = _validateMessageCallback(message);
         if (FAILED(hr))
         {
             _logger->Log(LogLevel::Error, _LS("Failed to validate message: 0x%08x"), hr);
-            *reinterpret_cast<HRESULT*>(response.Payload.data()) = hr;
-            SendMessage(client, response);
+            SendJobAccepted(client, hr, 0);
             Shutdown(client);
             continue;
         }
 
         if (!IsControlCommand(message))
         {
-            ProcessMessage(message, client);
+            ProcessMessage(std::move(message), client);
         }
         else
         {
@@ -110,38 +127,60 @@ void CommandServer::ListeningThread()
     }
 }
 
-void CommandServer::ProcessMessage(const IpcMessage& message, std::shared_ptr<IpcCommClient> client)
+void CommandServer::ProcessMessage(IpcMessage&& message, std::shared_ptr<IpcCommClient> client)
 {
-    IpcMessage response;
-    response.CommandSet = static_cast<unsigned short>(CommandSet::ServerResponse);
-    response.Command = static_cast<unsigned short>(ServerResponseCommand::Status);
-    response.Payload.resize(sizeof(HRESULT));
-
-    *reinterpret_cast<HRESULT*>(response.Payload.data()) = S_OK;
-    SendMessage(client, response);
-    Shutdown(client);
-
     CallbackInfo info;
-    info.Message = message;
+    info.Message = std::move(message);
+
+    HRESULT hr;
+    UINT64 jobId = 0;
     bool unmanagedOnly = false;
     if (SUCCEEDED(_unmanagedOnlyCallback(info.Message.CommandSet, unmanagedOnly)) && unmanagedOnly)
     {
-        _unmanagedOnlyQueue.Enqueue(info);
+        if (TryGetPendingJob(info.Message, jobId))
+        {
+            _logger->Log(LogLevel::Debug, _LS("Coalesced duplicate message into job %llu: %d:%d"), jobId, info.Message.CommandSet, info.Message.Command);
+            hr = S_OK;
+        }
+        else if (SUCCEEDED(hr = CreateJob(jobId)))
+        {
+            // The pending entry must exist before the message can be dequeued, since the processing thread removes it.
+            hr = AddPendingMessage(info.Message, jobId);
+            if (SUCCEEDED(hr))
+            {
+                info.JobId = jobId;
+                info.IsCoalescable = true;
+                hr = SubmitJob(_unmanagedOnlyQueue, std::move(info));
+                if (FAILED(hr))
+                {
+                    // A rejected job leaves info as it was.
+                    RemovePendingMessage(info.Message);
+                }
+            }
+            else
+            {
+                CompleteJob(jobId, hr);
+            }
+        }
     }
-    else
+    else if (SUCCEEDED(hr = CreateJob(jobId)))
     {
-        _clientQueue.Enqueue(info);
+        info.JobId = jobId;
+        hr = SubmitJob(_clientQueue, std::move(info));
     }
+
+    SendJobAccepted(client, hr, jobId);
+    Shutdown(client);
 }
 
 void CommandServer::ProcessResetMessage(const IpcMessage& message, std::shared_ptr<IpcCommClient> client)
 {
-    IpcMessage response;
-    response.CommandSet = static_cast<unsigned short>(CommandSet::ServerResponse);
-    response.Command = static_cast<unsigned short>(ServerResponseCommand::Status);
-    response.Payload.resize(sizeof(HRESULT));
-
-    HRESULT hr = S_OK;
+    //
+    // Control messages are queued like any other message. Clients that need to know when the reset
+    // has been applied wait on the returned job instead of holding up the listening thread.
+    //
+    HRESULT hr = E_UNEXPECTED;
+    UINT64 jobId = 0;
 
     if (message.CommandSet == static_cast<unsigned short>(CommandSet::Profiler))
     {
@@ -149,9 +188,11 @@ void CommandServer::ProcessResetMessage(const IpcMessage& message, std::shared_p
 
         CreateControlMessage(CommandSet::Profiler, message.Command, nativeCallbackInfo);
 
-        _unmanagedOnlyQueue.Enqueue(nativeCallbackInfo);
-
-        hr = nativeCallbackInfo.CompletionPromise->get_future().get();
+        if (SUCCEEDED(hr = CreateJob(jobId)))
+        {
+            nativeCallbackInfo.JobId = jobId;
+            hr = SubmitJob(_unmanagedOnlyQueue, std::move(nativeCallbackInfo));
+        }
     }
     if (message.CommandSet == static_cast<unsigned short>(CommandSet::StartupHook))
     {
@@ -159,16 +200,403 @@ void CommandServer::ProcessResetMessage(const IpcMessage& message, std::shared_p
 
         CreateControlMessage(CommandSet::StartupHook, message.Command, managedCallbackInfo);
 
-        _clientQueue.Enqueue(managedCallbackInfo);
+        if (SUCCEEDED(hr = CreateJob(jobId)))
+        {
+            managedCallbackInfo.JobId = jobId;
+            hr = SubmitJob(_clientQueue, std::move(managedCallbackInfo));
+        }
+    }
+
+    SendJobAccepted(client, hr, jobId);
+    Shutdown(client);
+}
+
+void CommandServer::ProcessJobControlMessage(const IpcMessage& message, std::shared_ptr<IpcCommClient> client)
+{
+    JobStatusPayload status = {};
+    status.State = static_cast<unsigned int>(JobState::Unknown);
+    status.Result = E_INVALIDARG;
+
+    if (message.Payload.size() != sizeof(UINT64) ||
+        (message.Command != static_cast<unsigned short>(JobControlCommand::GetJobStatus) &&
+         message.Command != static_cast<unsigned short>(JobControlCommand::WaitForJobCompletion)))
+    {
+        _logger->Log(LogLevel::Error, _LS("Invalid job control message: %d"), message.Command);
+        SendJobStatus(client, status);
+        Shutdown(client);
+        return;
+    }
+
+    status.JobId = *reinterpret_cast<const UINT64*>(message.Payload.data());
+
+    {
+        std::lock_guard<std::mutex> lock(_jobsMutex);
 
-        hr = managedCallbackInfo.CompletionPromise->get_future().get();
+        auto it = _jobs.find(status.JobId);
+        if (it != _jobs.end())
+        {
+            Job& job = *it->second;
+            if (job.State != JobState::Completed &&
+                message.Command == static_cast<unsigned short>(JobControlCommand::WaitForJobCompletion))
+            {
+                // The client is answered by CompleteJob.
+                try
+                {
+                    job.Subscribers.push_back(client);
+                    return;
+                }
+                catch (const std::bad_alloc&)
+                {
+                    status.Result = E_OUTOFMEMORY;
+                }
+            }
+            else
+            {
+                GetJobStatus(job, status);
+            }
+        }
     }
 
-    *reinterpret_cast<HRESULT*>(response.Payload.data()) = hr;
-    SendMessage(client, response);
+    SendJobStatus(client, status);
     Shutdown(client);
 }
 
+void CommandServer::ProcessHoldPointMessage(const IpcMessage& message, std::shared_ptr<IpcCommClient> client)
+{
+    HRESULT hr = E_INVALIDARG;
+
+    if (message.Command == static_cast<unsigned short>(HoldPointCommand::WaitForUnhandledException))
+    {
+        std::lock_guard<std::mutex> lock(_holdsMutex);
+
+        // The client is answered by HoldUnhandledExceptionThread.
+        try
+        {
+            _unhandledExceptionSubscribers.push_back(client);
+            return;
+        }
+        catch (const std::bad_alloc&)
+        {
+            hr = E_OUTOFMEMORY;
+        }
+    }
+    else if (message.Command == static_cast<unsigned short>(HoldPointCommand::ReleaseHold) &&
+        message.Payload.size() == sizeof(UINT64))
+    {
+        hr = ReleaseHold(*reinterpret_cast<const UINT64*>(message.Payload.data()));
+    }
+    else
+    {
+        _logger->Log(LogLevel::Error, _LS("Invalid hold point message: %d"), message.Command);
+    }
+
+    SendStatus(client, hr);
+    Shutdown(client);
+}
+
+HRESULT CommandServer::HoldUnhandledExceptionThread(UINT32 threadId, FunctionID functionId, UINT32 timeoutMilliseconds)
+{
+    HRESULT hr = S_OK;
+
+    UnhandledExceptionPayload payload = {};
+    payload.ThreadId = threadId;
+    payload.FunctionId = static_cast<UINT64>(functionId);
+    payload.TimeoutMilliseconds = timeoutMilliseconds;
+
+    std::vector<std::shared_ptr<IpcCommClient>> subscribers;
+    {
+        std::lock_guard<std::mutex> lock(_holdsMutex);
+
+        if (_shutdown.load() || _unhandledExceptionSubscribers.empty())
+        {
+            return S_FALSE;
+        }
+
+        payload.HoldId = _nextHoldId++;
+        try
+        {
+            _holds.insert({ payload.HoldId, false });
+        }
+        catch (const std::bad_alloc&)
+        {
+            return E_OUTOFMEMORY;
+        }
+
+        subscribers.swap(_unhandledExceptionSubscribers);
+    }
+
+    bool notified = false;
+    for (std::shared_ptr<IpcCommClient>& subscriber : subscribers)
+    {
+        if (SUCCEEDED(SendUnhandledException(subscriber, payload)))
+        {
+            notified = true;
+        }
+        Shutdown(subscriber);
+    }
+
+    _logger->Log(LogLevel::Debug, _LS("Holding thread %u for unhandled exception (hold %llu)"), threadId, payload.HoldId);
+
+    std::unique_lock<std::mutex> lock(_holdsMutex);
+
+    auto it = _holds.find(payload.HoldId);
+    if (notified)
+    {
+        _holdsCondition.wait_for(
+            lock,
+            std::chrono::milliseconds(timeoutMilliseconds),
+            [this, &it]() { return it->second || _shutdown.load(); });
+    }
+
+    hr = S_OK;
+    if (!notified)
+    {
+        hr = S_FALSE;
+    }
+    else if (!it->second)
+    {
+        _logger->Log(LogLevel::Warning, _LS("Hold %llu for unhandled exception timed out"), payload.HoldId);
+        hr = HRESULT_FROM_WIN32(ERROR_TIMEOUT);
+    }
+
+    // Shutdown waits for every hold to be removed before the server can be destroyed.
+    _holds.erase(it);
+    if (_holds.empty())
+    {
+        _holdsCondition.notify_all();
+    }
+
+    return hr;
+}
+
+HRESULT CommandServer::ReleaseHold(UINT64 holdId)
+{
+    {
+        std::lock_guard<std::mutex> lock(_holdsMutex);
+
+        auto it = _holds.find(holdId);
+        if (it == _holds.end())
+        {
+            return S_FALSE;
+        }
+        it->second = true;
+    }
+    _holdsCondition.notify_all();
+
+    return S_OK;
+}
+
+void CommandServer::ReleaseAllHolds()
+{
+    std::vector<std::shared_ptr<IpcCommClient>> subscribers;
+    {
+        // _shutdown is already set; taking the lock orders it with the held threads' predicate checks.
+        std::unique_lock<std::mutex> lock(_holdsMutex);
+        subscribers.swap(_unhandledExceptionSubscribers);
+
+        _holdsCondition.notify_all();
+        _holdsCondition.wait(lock, [this]() { return _holds.empty(); });
+    }
+
+    for (std::shared_ptr<IpcCommClient>& subscriber : subscribers)
+    {
+        Shutdown(subscriber);
+    }
+}
+
+bool CommandServer::TryGetPendingJob(const IpcMessage& message, UINT64& jobId)
+{
+    std::lock_guard<std::mutex> lock(_pendingMessagesMutex);
+
+    for (const PendingMessage& pendingMessage : _pendingUnmanagedOnlyMessages)
+    {
+        if (IsSameMessage(pendingMessage.Message, message))
+        {
+            jobId = pendingMessage.JobId;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+HRESULT CommandServer::AddPendingMessage(const IpcMessage& message, UINT64 jobId)
+{
+    std::lock_guard<std::mutex> lock(_pendingMessagesMutex);
+
+    START_NO_OOM_THROW_REGION;
+
+    PendingMessage pendingMessage;
+    pendingMessage.Message = message;
+    pendingMessage.JobId = jobId;
+    _pendingUnmanagedOnlyMessages.push_back(std::move(pendingMessage));
+
+    END_NO_OOM_THROW_REGION;
+
+    return S_OK;
+}
+
+void CommandServer::RemovePendingMessage(const IpcMessage& message)
+{
+    std::lock_guard<std::mutex> lock(_pendingMessagesMutex);
+
+    for (auto it = _pendingUnmanagedOnlyMessages.begin(); it != _pendingUnmanagedOnlyMessages.end(); ++it)
+    {
+        if (IsSameMessage(it->Message, message))
+        {
+            _pendingUnmanagedOnlyMessages.erase(it);
+            return;
+        }
+    }
+}
+
+HRESULT CommandServer::CreateJob(UINT64& jobId)
+{
+    std::lock_guard<std::mutex> lock(_jobsMutex);
+
+    START_NO_OOM_THROW_REGION;
+
+    std::shared_ptr<Job> job = std::make_shared<Job>();
+    job->Id = _nextJobId++;
+    job->QueuedTime = std::chrono::steady_clock::now();
+    _jobs.insert({ job->Id, job });
+    jobId = job->Id;
+
+    END_NO_OOM_THROW_REGION;
+
+    return S_OK;
+}
+
+HRESULT CommandServer::SubmitJob(BlockingQueue<CallbackInfo>& queue, CallbackInfo&& info)
+{
+    UINT64 jobId = info.JobId;
+
+    HRESULT hr = queue.TryEnqueue(std::move(info));
+    if (hr == S_FALSE)
+    {
+        _logger->Log(LogLevel::Warning, _LS("Message queue is full, rejecting job %llu"), jobId);
+        hr = E_BUSY;
+    }
+
+    if (FAILED(hr))
+    {
+        CompleteJob(jobId, hr);
+        return hr;
+    }
+
+    return S_OK;
+}
+
+void CommandServer::StartJob(UINT64 jobId)
+{
+    std::lock_guard<std::mutex> lock(_jobsMutex);
+
+    auto it = _jobs.find(jobId);
+    if (it != _jobs.end())
+    {
+        it->second->State = JobState::Running;
+        it->second->StartTime = std::chrono::steady_clock::now();
+    }
+}
+
+void CommandServer::CompleteJob(UINT64 jobId, HRESULT result)
+{
+    JobStatusPayload status = {};
+    std::vector<std::shared_ptr<IpcCommClient>> subscribers;
+
+    {
+        std::lock_guard<std::mutex> lock(_jobsMutex);
+
+        auto it = _jobs.find(jobId);
+        if (it == _jobs.end())
+        {
+            return;
+        }
+
+        Job& job = *it->second;
+        if (job.State == JobState::Completed)
+        {
+            return;
+        }
+
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (job.State == JobState::Queued)
+        {
+            job.StartTime = now;
+        }
+        job.State = JobState::Completed;
+        job.Result = result;
+        job.CompletionTime = now;
+        job.Subscribers.swap(subscribers);
+        GetJobStatus(job, status);
+
+        // Retain a bounded history of completed jobs for clients that poll.
+        // If recording the job fails, drop it right away rather than leaking it.
+        try
+        {
+            _completedJobIds.push_back(jobId);
+        }
+        catch (const std::bad_alloc&)
+        {
+            _jobs.erase(it);
+        }
+
+        while (_completedJobIds.size() > MaxCompletedJobs)
+        {
+            _jobs.erase(_completedJobIds.front());
+            _completedJobIds.pop_front();
+        }
+    }
+
+    for (std::shared_ptr<IpcCommClient>& subscriber : subscribers)
+    {
+        SendJobStatus(subscriber, status);
+        Shutdown(subscriber);
+    }
+}
+
+void CommandServer::AbortIncompleteJobs()
+{
+    std::vector<UINT64> jobIds;
+    {
+        std::lock_guard<std::mutex> lock(_jobsMutex);
+        for (auto const& job : _jobs)
+        {
+            if (job.second->State != JobState::Completed)
+            {
+                jobIds.push_back(job.first);
+            }
+        }
+    }
+
+    for (UINT64 jobId : jobIds)
+    {
+        CompleteJob(jobId, E_ABORT);
+    }
+}
+
+void CommandServer::GetJobStatus(const Job& job, JobStatusPayload& status)
+{
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point startTime = job.State == JobState::Queued ? now : job.StartTime;
+    std::chrono::steady_clock::time_point endTime = job.State == JobState::Completed ? job.CompletionTime : now;
+
+    status.JobId = job.Id;
+    status.State = static_cast<unsigned int>(job.State);
+    status.Result = job.State == JobState::Completed ? job.Result : S_FALSE;
+    status.QueuedDurationMicroseconds = static_cast<UINT64>(
+        std::chrono::duration_cast<std::chrono::microseconds>(startTime - job.QueuedTime).count());
+    status.RunDurationMicroseconds = static_cast<UINT64>(
+        std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime).count());
+}
+
+bool CommandServer::IsSameMessage(const IpcMessage& left, const IpcMessage& right)
+{
+    return left.CommandSet == right.CommandSet &&
+        left.Command == right.Command &&
+        left.Payload == right.Payload;
+}
+
 bool CommandServer::IsControlCommand(const IpcMessage& message)
 {
     switch (message.CommandSet) {
@@ -208,6 +636,58 @@ HRESULT CommandServer::SendMessage(std::shared_ptr<IpcCommClient> client, const
     return S_OK;
 }
 
+HRESULT CommandServer::SendJobAccepted(std::shared_ptr<IpcCommClient> client, HRESULT result, UINT64 jobId)
+{
+    IpcMessage response;
+    response.CommandSet = static_cast<unsigned short>(CommandSet::ServerResponse);
+    response.Command = static_cast<unsigned short>(ServerResponseCommand::JobAccepted);
+
+    JobAcceptedPayload payload;
+    payload.Result = result;
+    payload.JobId = jobId;
+
+    IfOomRetMem(response.Payload.resize(sizeof(JobAcceptedPayload)));
+    memcpy(response.Payload.data(), &payload, sizeof(JobAcceptedPayload));
+
+    return SendMessage(client, response);
+}
+
+HRESULT CommandServer::SendJobStatus(std::shared_ptr<IpcCommClient> client, const JobStatusPayload& status)
+{
+    IpcMessage response;
+    response.CommandSet = static_cast<unsigned short>(CommandSet::ServerResponse);
+    response.Command = static_cast<unsigned short>(ServerResponseCommand::JobStatus);
+
+    IfOomRetMem(response.Payload.resize(sizeof(JobStatusPayload)));
+    memcpy(response.Payload.data(), &status, sizeof(JobStatusPayload));
+
+    return SendMessage(client, response);
+}
+
+HRESULT CommandServer::SendStatus(std::shared_ptr<IpcCommClient> client, HRESULT status)
+{
+    IpcMessage response;
+    response.CommandSet = static_cast<unsigned short>(CommandSet::ServerResponse);
+    response.Command = static_cast<unsigned short>(ServerResponseCommand::Status);
+
+    IfOomRetMem(response.Payload.resize(sizeof(HRESULT)));
+    memcpy(response.Payload.data(), &status, sizeof(HRESULT));
+
+    return SendMessage(client, response);
+}
+
+HRESULT CommandServer::SendUnhandledException(std::shared_ptr<IpcCommClient> client, const UnhandledExceptionPayload& payload)
+{
+    IpcMessage response;
+    response.CommandSet = static_cast<unsigned short>(CommandSet::ServerResponse);
+    response.Command = static_cast<unsigned short>(ServerResponseCommand::UnhandledException);
+
+    IfOomRetMem(response.Payload.resize(sizeof(UnhandledExceptionPayload)));
+    memcpy(response.Payload.data(), &payload, sizeof(UnhandledExceptionPayload));
+
+    return SendMessage(client, response);
+}
+
 HRESULT CommandServer::Shutdown(std::shared_ptr<IpcCommClient> client)
 {
     HRESULT hr = client->Shutdown();
@@ -229,25 +709,36 @@ void CommandServer::ProcessingThread(BlockingQueue<CallbackInfo>& queue)
         return;
     }
 
+    std::vector<CallbackInfo> batch;
+    batch.reserve(MaxMessageBatchSize);
+
     while (true)
     {
-        CallbackInfo info;
-        hr = queue.BlockingDequeue(info);
+        batch.clear();
+        hr = queue.BlockingDequeueBatch(batch, MaxMessageBatchSize);
         if (hr != S_OK)
         {
             //We are complete, discard all messages
             break;
         }
 
-        hr = _callback(info.Message);
-        if (hr != S_OK)
+        for (CallbackInfo& info : batch)
         {
-            _logger->Log(LogLevel::Warning, _LS("IpcMessage callback failed: 0x%08x"), hr);
-        }
+            // Once started, the message no longer satisfies new requests; they need their own run.
+            if (info.IsCoalescable)
+            {
+                RemovePendingMessage(info.Message);
+            }
 
-        if (info.CompletionPromise)
-        {
-            info.CompletionPromise->set_value(hr);
+            StartJob(info.JobId);
+
+            hr = _callback(info.Message);
+            if (hr != S_OK)
+            {
+                _logger->Log(LogLevel::Warning, _LS("IpcMessage callback failed: 0x%08x"), hr);
+            }
+
+            CompleteJob(info.JobId, hr);
         }
     }
 }
@@ -12,10 +12,19 @@
 #include <string>
 #include <atomic>
 #include <thread>
-#include <future>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 #include "Logging/Logger.h"
 #include "CommonUtilities/BlockingQueue.h"
 
+#ifndef ERROR_TIMEOUT
+#define ERROR_TIMEOUT 1460L
+#endif
+
 class CommandServer final
 {
 public:
@@ -27,18 +36,68 @@ public:
         std::function<HRESULT (unsigned short commandSet, bool& unmanagedOnly)> unmanagedOnlyCallback);
     void Shutdown();
 
+    /// <summary>
+    /// Notifies clients waiting for unhandled exceptions, then blocks the calling thread until a client releases it,
+    /// the timeout elapses or the server shuts down.
+    /// Returns S_OK if released, HRESULT_FROM_WIN32(ERROR_TIMEOUT) on timeout, and S_FALSE without blocking if no client was notified.
+    /// </summary>
+    HRESULT HoldUnhandledExceptionThread(UINT32 threadId, FunctionID functionId, UINT32 timeoutMilliseconds);
+
 private:
     class CallbackInfo
     {
         public:
             IpcMessage Message;
-            std::shared_ptr<std::promise<HRESULT>> CompletionPromise;
+            UINT64 JobId = 0;
+            // Set when the message is tracked in _pendingUnmanagedOnlyMessages.
+            bool IsCoalescable = false;
+    };
+
+    //
+    // Every accepted message becomes a job. The client receives the job id immediately and can later
+    // poll (GetJobStatus) or subscribe (WaitForJobCompletion) for the result.
+    //
+    class Job
+    {
+        public:
+            UINT64 Id = 0;
+            JobState State = JobState::Queued;
+            HRESULT Result = S_OK;
+            std::chrono::steady_clock::time_point QueuedTime;
+            std::chrono::steady_clock::time_point StartTime;
+            std::chrono::steady_clock::time_point CompletionTime;
+            // Clients waiting for completion. They are answered and disconnected by the thread that completes the job.
+            std::vector<std::shared_ptr<IpcCommClient>> Subscribers;
+    };
+
+    class PendingMessage
+    {
+        public:
+            IpcMessage Message;
+            UINT64 JobId;
     };
 
     void ListeningThread();
-    void ProcessMessage(const IpcMessage& message, std::shared_ptr<IpcCommClient> client);
+    void ProcessMessage(IpcMessage&& message, std::shared_ptr<IpcCommClient> client);
     void ProcessResetMessage(const IpcMessage& message, std::shared_ptr<IpcCommClient> client);
+    void ProcessJobControlMessage(const IpcMessage& message, std::shared_ptr<IpcCommClient> client);
+    void ProcessHoldPointMessage(const IpcMessage& message, std::shared_ptr<IpcCommClient> client);
+    HRESULT ReleaseHold(UINT64 holdId);
+    void ReleaseAllHolds();
     bool IsControlCommand(const IpcMessage& message);
+    bool TryGetPendingJob(const IpcMessage& message, UINT64& jobId);
+    HRESULT AddPendingMessage(const IpcMessage& message, UINT64 jobId);
+    void RemovePendingMessage(const IpcMessage& message);
+    static bool IsSameMessage(const IpcMessage& left, const IpcMessage& right);
+
+    // Job tracking
+    HRESULT CreateJob(UINT64& jobId);
+    // info is only moved from when the job is queued.
+    HRESULT SubmitJob(BlockingQueue<CallbackInfo>& queue, CallbackInfo&& info);
+    void StartJob(UINT64 jobId);
+    void CompleteJob(UINT64 jobId, HRESULT result);
+    void AbortIncompleteJobs();
+    static void GetJobStatus(const Job& job, JobStatusPayload& status);
 
     template<typename TCommand>
     void CreateControlMessage(CommandSet commandSet, TCommand command, CallbackInfo& info)
@@ -48,16 +107,27 @@ private:
         // Currently the managed payload always uses json deserialization
         // The native payload ignores this
         info.Message.Payload = std::vector<BYTE>({ (BYTE)'{', (BYTE)'}' });
-        info.CompletionPromise = std::make_shared<std::promise<HRESULT>>();
     }
 
     // Wrapper methods for sending and logging
     HRESULT ReceiveMessage(std::shared_ptr<IpcCommClient> client, IpcMessage& message);
     HRESULT SendMessage(std::shared_ptr<IpcCommClient> client, const IpcMessage& message);
     HRESULT Shutdown(std::shared_ptr<IpcCommClient> client);
+    HRESULT SendJobAccepted(std::shared_ptr<IpcCommClient> client, HRESULT result, UINT64 jobId);
+    HRESULT SendJobStatus(std::shared_ptr<IpcCommClient> client, const JobStatusPayload& status);
+    HRESULT SendStatus(std::shared_ptr<IpcCommClient> client, HRESULT status);
+    HRESULT SendUnhandledException(std::shared_ptr<IpcCommClient> client, const UnhandledExceptionPayload& payload);
 
     void ProcessingThread(BlockingQueue<CallbackInfo>& queue);
 
+    // Bounds the number of messages waiting to be processed. Once a queue is full, new messages are rejected with E_BUSY
+    // so that the listening thread never waits on the processing threads.
+    static const size_t MaxQueuedMessages = 64;
+    // Number of messages the processing thread takes off the queue at a time.
+    static const size_t MaxMessageBatchSize = 16;
+    // Number of completed jobs whose status is retained for clients that poll after completion.
+    static const size_t MaxCompletedJobs = 64;
+
     std::atomic_bool _shutdown;
 
     std::function<HRESULT(const IpcMessage& message)> _callback;
@@ -72,6 +142,24 @@ private:
     BlockingQueue<CallbackInfo> _clientQueue;
     BlockingQueue<CallbackInfo> _unmanagedOnlyQueue;
 
+    // Unmanaged-only messages that are queued but not yet started. Commands such as Callstack suspend the runtime,
+    // so an identical message that arrives while one is already pending is satisfied by the pending one instead.
+    std::vector<PendingMessage> _pendingUnmanagedOnlyMessages;
+    std::mutex _pendingMessagesMutex;
+
+    std::unordered_map<UINT64, std::shared_ptr<Job>> _jobs;
+    std::deque<UINT64> _completedJobIds;
+    UINT64 _nextJobId;
+    std::mutex _jobsMutex;
+
+    // Clients waiting for the next unhandled exception, and the threads currently held for them.
+    // The value of each hold is set once the thread is released.
+    std::vector<std::shared_ptr<IpcCommClient>> _unhandledExceptionSubscribers;
+    std::unordered_map<UINT64, bool> _holds;
+    UINT64 _nextHoldId;
+    std::mutex _holdsMutex;
+    std::condition_variable _holdsCondition;
+
     std::shared_ptr<ILogger> _logger;
 
     std::thread _listeningThread;
@@ -2,12 +2,17 @@
 // The .NET Foundation licenses this file to you under the MIT license.
 
 #include "MessageCallbackManager.h"
+#include "CommonUtilities/ThreadUtilities.h"
+#include <atomic>
 
-bool MessageCallbackManager::IsRegistered(unsigned short commandSet)
+MessageCallbackManager::MessageCallbackManager() :
+    m_callbacks(std::make_shared<const CallbackTable>())
 {
-    std::lock_guard<std::mutex> lookupLock(m_lookupMutex);
+}
 
-    std::function<HRESULT (const IpcMessage& message)> existingCallback;
+bool MessageCallbackManager::IsRegistered(unsigned short commandSet)
+{
+    std::shared_ptr<const CallbackInfo> existingCallback;
     return TryGetCallback(commandSet, existingCallback);
 }
 
@@ -21,47 +26,72 @@ bool MessageCallbackManager::TryRegister(unsigned short commandSet, ManagedMessa
 
 bool MessageCallbackManager::TryRegister(unsigned short commandSet, std::function<HRESULT (const IpcMessage& message)> callback, bool unmanagedOnly)
 {
-    std::lock_guard<std::mutex> dispatchLock(m_dispatchMutex);
-    std::lock_guard<std::mutex> lookupLock(m_lookupMutex);
+    std::lock_guard<std::mutex> writerLock(m_writerMutex);
 
-    std::function<HRESULT (const IpcMessage& message)> existingCallback;
-    if (TryGetCallback(commandSet, existingCallback))
+    std::shared_ptr<const CallbackTable> callbacks = std::atomic_load(&m_callbacks);
+    if (callbacks->find(commandSet) != callbacks->end())
     {
         return false;
     }
 
-    m_callbacks[commandSet] = CallbackInfo(unmanagedOnly, callback);
+    std::shared_ptr<CallbackTable> newCallbacks = std::make_shared<CallbackTable>(*callbacks);
+    (*newCallbacks)[commandSet] = std::make_shared<const CallbackInfo>(unmanagedOnly, callback);
+
+    std::atomic_store(&m_callbacks, std::shared_ptr<const CallbackTable>(newCallbacks));
     return true;
 }
 
 HRESULT MessageCallbackManager::DispatchMessage(const IpcMessage& message)
 {
-    std::lock_guard<std::mutex> dispatchLock(m_dispatchMutex);
-
-    std::function<HRESULT (const IpcMessage& message)> callback;
+    std::shared_ptr<const CallbackInfo> callback;
     if (!TryGetCallback(message.CommandSet, callback))
     {
         return E_FAIL;
     }
 
-    return callback(message);
+    return callback->Callback(message);
 }
 
 void MessageCallbackManager::Unregister(unsigned short commandSet)
 {
-    std::lock_guard<std::mutex> dispatchLock(m_dispatchMutex);
-    std::lock_guard<std::mutex> lookupLock(m_lookupMutex);
+    std::shared_ptr<const CallbackInfo> removedCallback;
+    {
+        std::lock_guard<std::mutex> writerLock(m_writerMutex);
+
+        std::shared_ptr<const CallbackTable> callbacks = std::atomic_load(&m_callbacks);
+        auto const& it = callbacks->find(commandSet);
+        if (it == callbacks->end())
+        {
+            return;
+        }
+        removedCallback = it->second;
 
-    m_callbacks.erase(commandSet);
+        std::shared_ptr<CallbackTable> newCallbacks = std::make_shared<CallbackTable>(*callbacks);
+        newCallbacks->erase(commandSet);
+
+        std::atomic_store(&m_callbacks, std::shared_ptr<const CallbackTable>(newCallbacks));
+    }
+
+    //
+    // The entry is no longer reachable from the published table. Any remaining references belong to
+    // dispatches that are in progress, or to readers still holding an older snapshot of the table.
+    // Wait for them so that the callback is never invoked after Unregister returns.
+    //
+    while (removedCallback.use_count() > 1)
+    {
+        ThreadUtilities::Sleep(1);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
 }
 
-bool MessageCallbackManager::TryGetCallback(unsigned short commandSet, std::function<HRESULT (const IpcMessage& message)>& callback)
+bool MessageCallbackManager::TryGetCallback(unsigned short commandSet, std::shared_ptr<const CallbackInfo>& callback)
 {
-    // Do not lock here, this method is private and it's the responsibility of the caller to lock
-    auto const& it = m_callbacks.find(commandSet);
-    if (it != m_callbacks.end())
+    std::shared_ptr<const CallbackTable> callbacks = std::atomic_load(&m_callbacks);
+
+    auto const& it = callbacks->find(commandSet);
+    if (it != callbacks->end())
     {
-        callback = it->second.Callback;
+        callback = it->second;
         return true;
     }
 
@@ -70,12 +100,10 @@ bool MessageCallbackManager::TryGetCallback(unsigned short commandSet, std::func
 
 HRESULT MessageCallbackManager::UnmanagedOnly(unsigned short commandSet, bool& unmanagedOnly)
 {
-    std::lock_guard<std::mutex> lookupLock(m_lookupMutex);
-
-    auto const& it = m_callbacks.find(commandSet);
-    if (it != m_callbacks.end())
+    std::shared_ptr<const CallbackInfo> callback;
+    if (TryGetCallback(commandSet, callback))
     {
-        unmanagedOnly = it->second.UnmanagedOnly;
+        unmanagedOnly = callback->UnmanagedOnly;
         return S_OK;
     }
     return E_FAIL;
@@ -4,6 +4,7 @@
 #pragma once
 
 #include <unordered_map>
+#include <memory>
 #include <mutex>
 #include <functional>
 #include "cor.h"
@@ -27,6 +28,8 @@ struct CallbackInfo
 class MessageCallbackManager
 {
     public:
+        MessageCallbackManager();
+
         HRESULT DispatchMessage(const IpcMessage& message);
         bool IsRegistered(unsigned short commandSet);
 
@@ -34,16 +37,23 @@ class MessageCallbackManager
         // Setting unmanagedOnly to true will queue the work from the command set to a separate thread.
         bool TryRegister(unsigned short commandSet, std::function<HRESULT (const IpcMessage& message)> callback, bool unmanagedOnly);
         bool TryRegister(unsigned short commandSet, ManagedMessageCallback pCallback);
+
+        // Blocks until in-flight dispatches to the command set have returned.
+        // Must not be called from within the callback being unregistered.
         void Unregister(unsigned short commandSet);
         HRESULT UnmanagedOnly(unsigned short commandSet, bool& unmanagedOnly);
     private:
-        bool TryGetCallback(unsigned short commandSet, std::function<HRESULT (const IpcMessage& message)>& callback);
-        std::unordered_map<unsigned short, CallbackInfo> m_callbacks;
+        typedef std::unordered_map<unsigned short, std::shared_ptr<const CallbackInfo>> CallbackTable;
+
+        bool TryGetCallback(unsigned short commandSet, std::shared_ptr<const CallbackInfo>& callback);
+
         //
-        // Ideally we would use a single std::shared_mutex instead, but we are targeting C++11 without
-        // an easy way to upgrade to C++17 at this time, so we use two separate mutexes instead to
-        // allow for IsRegistered to be used while a DispatchMessage call is in progress.
+        // The callback table is never modified once published. Readers take a snapshot of it with
+        // std::atomic_load and so never wait on each other or on callbacks for other command sets.
+        // Writers copy the table, modify the copy and publish it with std::atomic_store.
+        // Each entry is reference counted, so an in-flight dispatch keeps its callback alive after it has
+        // been removed from the table, and Unregister waits for those references to be released.
         //
-        std::mutex m_dispatchMutex;
-        std::mutex m_lookupMutex;
+        std::shared_ptr<const CallbackTable> m_callbacks;
+        std::mutex m_writerMutex;
 };
@@ -14,7 +14,7 @@ enum class ProfilerCommand : unsigned short
     StopAllFeatures,
 
     // Indicate that collection should resume again
-    // Currently a no-op
+    // Captured exception stacks are described again for the new session
     StartAllFeatures,
 };
 
@@ -35,7 +35,51 @@ enum class StartupHookCommand : unsigned short
 
 enum class ServerResponseCommand : unsigned short
 {
-    Status
+    Status,
+
+    // Sent in response to every message that is not a JobControl message. Payload is JobAcceptedPayload.
+    JobAccepted,
+
+    // Sent in response to JobControl messages. Payload is JobStatusPayload.
+    JobStatus,
+
+    // Sent to clients waiting on WaitForUnhandledException. Payload is UnhandledExceptionPayload.
+    UnhandledException,
+};
+
+//
+// Every JobControl message has a UINT64 job id as its payload.
+//
+enum class JobControlCommand : unsigned short
+{
+    // Responds immediately with the current status of the job.
+    GetJobStatus,
+
+    // Responds once the job has completed.
+    WaitForJobCompletion,
+};
+
+//
+// HoldPoint messages are handled by the server itself and are never queued.
+//
+enum class HoldPointCommand : unsigned short
+{
+    // Keeps the connection open until a thread encounters an unhandled exception, then responds with an
+    // UnhandledException message. The thread is held until it is released or the hold times out.
+    WaitForUnhandledException,
+
+    // Releases a held thread. Payload is the UINT64 hold id. Responds with a Status message whose payload is
+    // the HRESULT of the release; S_FALSE if the thread is no longer held.
+    ReleaseHold,
+};
+
+enum class JobState : unsigned int
+{
+    // The job does not exist or its status is no longer retained.
+    Unknown,
+    Queued,
+    Running,
+    Completed,
 };
 
 //
@@ -46,8 +90,37 @@ enum class CommandSet : unsigned short
 {
     ServerResponse,
     Profiler,
-    StartupHook
+    StartupHook,
+    JobControl,
+    HoldPoint
+};
+
+#pragma pack(push, 1)
+struct JobAcceptedPayload
+{
+    HRESULT Result;
+    UINT64 JobId;
+};
+
+struct JobStatusPayload
+{
+    UINT64 JobId;
+    unsigned int State;
+    HRESULT Result;
+    UINT64 QueuedDurationMicroseconds;
+    UINT64 RunDurationMicroseconds;
+};
+
+struct UnhandledExceptionPayload
+{
+    UINT64 HoldId;
+    // Native id of the held thread.
+    UINT32 ThreadId;
+    // Frame in which the exception was found to be unhandled.
+    UINT64 FunctionId;
+    UINT32 TimeoutMilliseconds;
 };
+#pragma pack(pop)
 
 struct IpcMessage
 {
@@ -0,0 +1,201 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#ifdef DOTNETMONITOR_FEATURE_EXCEPTIONS
+#include "ExceptionNameCache.h"
+#include "CommonUtilities/NameCache.h"
+#include "CommonUtilities/TypeNameUtilities.h"
+#include <algorithm>
+
+using namespace std;
+
+namespace
+{
+    void AddModule(vector<ModuleID>& modules, ModuleID moduleId)
+    {
+        if (0 != moduleId && find(modules.begin(), modules.end(), moduleId) == modules.end())
+        {
+            modules.push_back(moduleId);
+        }
+    }
+
+    // Gets every module that a resolved name was built from.
+    void GetModules(NameCache& nameCache, vector<ModuleID>& modules)
+    {
+        for (const auto& classData : nameCache.GetClasses())
+        {
+            AddModule(modules, classData.second->GetModuleId());
+        }
+        for (const auto& functionData : nameCache.GetFunctions())
+        {
+            AddModule(modules, functionData.second->GetModuleId());
+        }
+        for (const auto& typeName : nameCache.GetTypeNames())
+        {
+            AddModule(modules, typeName.first.first);
+        }
+    }
+}
+
+ExceptionNameCache::ExceptionNameCache(ICorProfilerInfo12* corProfilerInfo) :
+    _corProfilerInfo(corProfilerInfo),
+    _unloadGeneration(0)
+{
+}
+
+HRESULT ExceptionNameCache::GetFullyQualifiedTypeName(ClassID classId, tstring& fullTypeName)
+{
+    HRESULT hr = S_OK;
+
+    UINT64 unloadGeneration;
+    if (TryGetName(_typeNames, classId, fullTypeName, unloadGeneration))
+    {
+        return S_OK;
+    }
+
+    // Resolve without holding the lock; metadata lookups can be slow.
+    NameCache cache;
+    TypeNameUtilities typeNameUtilities(_corProfilerInfo);
+
+    IfFailRet(typeNameUtilities.CacheNames(cache, classId));
+    IfFailRet(cache.GetFullyQualifiedTypeName(classId, fullTypeName));
+
+    Entry entry;
+    entry.Name = fullTypeName;
+    GetModules(cache, entry.Modules);
+    AddName(_typeNames, classId, std::move(entry), unloadGeneration);
+
+    return S_OK;
+}
+
+HRESULT ExceptionNameCache::GetFullyQualifiedMethodName(FunctionID functionId, COR_PRF_FRAME_INFO frameInfo, tstring& fullMethodName)
+{
+    HRESULT hr = S_OK;
+
+    // Shared generic code is a single FunctionID for many instantiations; the frame selects the instantiation,
+    // so names resolved from a frame are only cached when the function and its class are not generic.
+    bool cacheable = true;
+    if (0 != frameInfo)
+    {
+        bool isGeneric = false;
+        IfFailRet(IsGenericFunction(functionId, isGeneric));
+        cacheable = !isGeneric;
+    }
+
+    UINT64 unloadGeneration = 0;
+    if (cacheable && TryGetName(_methodNames, functionId, fullMethodName, unloadGeneration))
+    {
+        return S_OK;
+    }
+
+    NameCache cache;
+    TypeNameUtilities typeNameUtilities(_corProfilerInfo);
+
+    IfFailRet(typeNameUtilities.CacheNames(cache, functionId, frameInfo));
+    IfFailRet(cache.GetFullyQualifiedName(functionId, fullMethodName));
+
+    if (!cacheable)
+    {
+        return S_OK;
+    }
+
+    Entry entry;
+    entry.Name = fullMethodName;
+    GetModules(cache, entry.Modules);
+    AddName(_methodNames, functionId, std::move(entry), unloadGeneration);
+
+    return S_OK;
+}
+
+HRESULT ExceptionNameCache::IsGenericFunction(FunctionID functionId, bool& isGeneric)
+{
+    HRESULT hr = S_OK;
+
+    isGeneric = true;
+
+    ClassID classId = 0;
+    ULONG32 typeArgsCount = 0;
+    IfFailRet(_corProfilerInfo->GetFunctionInfo2(
+        functionId,
+        0,
+        &classId,
+        nullptr,
+        nullptr,
+        0,
+        &typeArgsCount,
+        nullptr));
+
+    // The class of shared generic code can't be determined without a frame.
+    if (0 != typeArgsCount || 0 == classId)
+    {
+        return S_OK;
+    }
+
+    IfFailRet(_corProfilerInfo->GetClassIDInfo2(
+        classId,
+        nullptr,
+        nullptr,
+        nullptr,
+        0,
+        &typeArgsCount,
+        nullptr));
+
+    isGeneric = (0 != typeArgsCount);
+
+    return S_OK;
+}
+
+void ExceptionNameCache::ModuleUnloadStarted(ModuleID moduleId)
+{
+    lock_guard<mutex> lock(_mutex);
+
+    _unloadGeneration++;
+    RemoveModule(_typeNames, moduleId);
+    RemoveModule(_methodNames, moduleId);
+}
+
+bool ExceptionNameCache::TryGetName(unordered_map<UINT_PTR, Entry>& names, UINT_PTR id, tstring& name, UINT64& unloadGeneration)
+{
+    lock_guard<mutex> lock(_mutex);
+
+    unloadGeneration = _unloadGeneration;
+
+    unordered_map<UINT_PTR, Entry>::const_iterator it = names.find(id);
+    if (it == names.end())
+    {
+        return false;
+    }
+
+    name = it->second.Name;
+    return true;
+}
+
+void ExceptionNameCache::AddName(unordered_map<UINT_PTR, Entry>& names, UINT_PTR id, Entry&& entry, UINT64 unloadGeneration)
+{
+    lock_guard<mutex> lock(_mutex);
+
+    // A module may have been unloaded while the name was resolved; the name could refer to it.
+    if (unloadGeneration != _unloadGeneration)
+    {
+        return;
+    }
+
+    names[id] = std::move(entry);
+}
+
+void ExceptionNameCache::RemoveModule(unordered_map<UINT_PTR, Entry>& names, ModuleID moduleId)
+{
+    for (unordered_map<UINT_PTR, Entry>::iterator it = names.begin(); it != names.end();)
+    {
+        const vector<ModuleID>& modules = it->second.Modules;
+        if (find(modules.begin(), modules.end(), moduleId) != modules.end())
+        {
+            it = names.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+#endif // DOTNETMONITOR_FEATURE_EXCEPTIONS
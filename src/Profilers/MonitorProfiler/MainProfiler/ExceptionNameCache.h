@@ -0,0 +1,54 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#pragma once
+
+#ifdef DOTNETMONITOR_FEATURE_EXCEPTIONS
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "corhlpr.h"
+#include "corprof.h"
+#include "com.h"
+#include "tstring.h"
+
+/// <summary>
+/// Thread-safe cache of fully qualified type and method names used by exception tracking.
+/// </summary>
+/// <remarks>
+/// Each entry remembers every module that contributed to its name (including the modules of generic arguments)
+/// and is removed when any of those modules begins unloading, so that ids reused after an unload are resolved again.
+/// </remarks>
+class ExceptionNameCache
+{
+private:
+    class Entry
+    {
+        public:
+            tstring Name;
+            std::vector<ModuleID> Modules;
+    };
+
+    ComPtr<ICorProfilerInfo12> _corProfilerInfo;
+
+    std::mutex _mutex;
+    std::unordered_map<ClassID, Entry> _typeNames;
+    std::unordered_map<FunctionID, Entry> _methodNames;
+    // Incremented on every module unload. Names resolved across an unload are not cached.
+    UINT64 _unloadGeneration;
+
+public:
+    ExceptionNameCache(ICorProfilerInfo12* corProfilerInfo);
+
+    HRESULT GetFullyQualifiedTypeName(ClassID classId, tstring& fullTypeName);
+    HRESULT GetFullyQualifiedMethodName(FunctionID functionId, COR_PRF_FRAME_INFO frameInfo, tstring& fullMethodName);
+
+    void ModuleUnloadStarted(ModuleID moduleId);
+
+private:
+    HRESULT IsGenericFunction(FunctionID functionId, bool& isGeneric);
+    bool TryGetName(std::unordered_map<UINT_PTR, Entry>& names, UINT_PTR id, tstring& name, UINT64& unloadGeneration);
+    void AddName(std::unordered_map<UINT_PTR, Entry>& names, UINT_PTR id, Entry&& entry, UINT64 unloadGeneration);
+    static void RemoveModule(std::unordered_map<UINT_PTR, Entry>& names, ModuleID moduleId);
+};
+#endif // DOTNETMONITOR_FEATURE_EXCEPTIONS
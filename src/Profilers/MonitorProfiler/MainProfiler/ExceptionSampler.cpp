@@ -0,0 +1,70 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#ifdef DOTNETMONITOR_FEATURE_EXCEPTIONS
+#include "ExceptionSampler.h"
+#include "CommonUtilities/HashUtilities.h"
+#include <chrono>
+
+using namespace std;
+
+ExceptionSampler::ExceptionSampler(UINT32 sampleLimit, UINT32 windowMilliseconds) :
+    _sampleLimit(sampleLimit),
+    _windowMilliseconds(windowMilliseconds),
+    _sampledCount(0),
+    _unsampledCount(0)
+{
+}
+
+bool ExceptionSampler::ShouldSample(ClassID classId)
+{
+    Group& group = GetGroup(classId);
+
+    UINT64 now = static_cast<UINT64>(chrono::duration_cast<chrono::milliseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count());
+    UINT64 window = now / _windowMilliseconds;
+
+    // The first thread to observe a new window resets the count for everyone.
+    UINT64 groupWindow = group.Window.load(memory_order_relaxed);
+    if (groupWindow != window && group.Window.compare_exchange_strong(groupWindow, window, memory_order_relaxed))
+    {
+        group.Count.store(0, memory_order_relaxed);
+    }
+
+    if (group.Count.fetch_add(1, memory_order_relaxed) < _sampleLimit)
+    {
+        _sampledCount.fetch_add(1, memory_order_relaxed);
+        return true;
+    }
+
+    _unsampledCount.fetch_add(1, memory_order_relaxed);
+    return false;
+}
+
+ExceptionSampler::Group& ExceptionSampler::GetGroup(ClassID classId)
+{
+    size_t bucket = HashUtilities::Mix(classId);
+    for (size_t probe = 0; probe < GroupCapacity; probe++)
+    {
+        Group& group = _groups[(bucket + probe) & (GroupCapacity - 1)];
+
+        ClassID groupClassId = group.ClassId.load(memory_order_acquire);
+        if (groupClassId == classId)
+        {
+            return group;
+        }
+
+        if (groupClassId == 0)
+        {
+            // Claim the empty group; if another thread claimed it first, it may have claimed it for the same type.
+            if (group.ClassId.compare_exchange_strong(groupClassId, classId, memory_order_acq_rel) ||
+                groupClassId == classId)
+            {
+                return group;
+            }
+        }
+    }
+
+    return _overflowGroup;
+}
+#endif // DOTNETMONITOR_FEATURE_EXCEPTIONS
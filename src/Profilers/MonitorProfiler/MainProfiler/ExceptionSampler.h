@@ -0,0 +1,63 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#pragma once
+
+#ifdef DOTNETMONITOR_FEATURE_EXCEPTIONS
+#include <atomic>
+#include "corhlpr.h"
+#include "corprof.h"
+
+/// <summary>
+/// Limits how many exceptions of each type have their details (throwing frame, names) captured.
+/// The first SampleLimit throws of each exception type in every window are sampled; the rest are only counted.
+/// </summary>
+/// <remarks>
+/// Windows are reset without synchronizing with concurrent throws, so a few throws around a window boundary
+/// may be attributed to either window.
+/// </remarks>
+class ExceptionSampler
+{
+public:
+    static const UINT32 DefaultSampleLimit = 100;
+    static const UINT32 DefaultWindowMilliseconds = 1000;
+
+private:
+    // Must be a power of two.
+    static const size_t GroupCapacity = 256;
+
+    class Group
+    {
+        public:
+            std::atomic<ClassID> ClassId{ 0 };
+            std::atomic<UINT64> Window{ 0 };
+            std::atomic<UINT32> Count{ 0 };
+    };
+
+    const UINT32 _sampleLimit;
+    const UINT32 _windowMilliseconds;
+
+    Group _groups[GroupCapacity];
+    // Shared by all exception types once every group is in use.
+    Group _overflowGroup;
+
+    std::atomic<UINT64> _sampledCount;
+    std::atomic<UINT64> _unsampledCount;
+
+public:
+    ExceptionSampler(UINT32 sampleLimit, UINT32 windowMilliseconds);
+
+    /// <summary>
+    /// Returns true if the details of this throw should be captured.
+    /// </summary>
+    bool ShouldSample(ClassID classId);
+
+    UINT32 GetSampleLimit() const { return _sampleLimit; }
+    UINT32 GetWindowMilliseconds() const { return _windowMilliseconds; }
+    UINT64 GetSampledCount() const { return _sampledCount.load(std::memory_order_relaxed); }
+    UINT64 GetUnsampledCount() const { return _unsampledCount.load(std::memory_order_relaxed); }
+
+private:
+    Group& GetGroup(ClassID classId);
+};
+#endif // DOTNETMONITOR_FEATURE_EXCEPTIONS
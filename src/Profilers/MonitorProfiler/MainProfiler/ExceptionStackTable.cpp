@@ -0,0 +1,128 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#ifdef DOTNETMONITOR_FEATURE_EXCEPTIONS
+#include "ExceptionStackTable.h"
+#include "macros.h"
+#include <chrono>
+#include <functional>
+
+using namespace std;
+
+ExceptionStackTable::ExceptionStackTable() :
+    _rundownGeneration(0)
+{
+}
+
+HRESULT ExceptionStackTable::GetStackId(const CapturedStack& stack, ExceptionsEventProvider* eventProvider, UINT64& stackId)
+{
+    HRESULT hr = S_OK;
+
+    stackId = NoStackId;
+
+    size_t hash = Hash(stack);
+    size_t shardIndex = hash & (ShardCount - 1);
+    Shard& shard = _shards[shardIndex];
+
+    UINT64 generation = _rundownGeneration.load(memory_order_acquire);
+    UINT64 now = static_cast<UINT64>(chrono::duration_cast<chrono::milliseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count());
+
+    lock_guard<mutex> lock(shard.Mutex);
+
+    auto range = shard.Stacks.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        Entry& entry = it->second;
+        if (IsSameStack(stack, entry))
+        {
+            if (entry.DescribedGeneration != generation || now - entry.DescribedTime >= RundownIntervalMilliseconds)
+            {
+                IfFailRet(eventProvider->WriteStack(entry.Id, entry.FunctionIds, entry.Ips));
+                entry.DescribedGeneration = generation;
+                entry.DescribedTime = now;
+            }
+
+            entry.LastUsed = ++shard.UseCount;
+            stackId = entry.Id;
+            return S_OK;
+        }
+    }
+
+    START_NO_OOM_THROW_REGION;
+
+    // Ids from different shards never collide.
+    Entry entry;
+    entry.Id = (shard.NextSequence * ShardCount) + shardIndex + 1;
+    entry.FunctionIds.assign(stack.FunctionIds, stack.FunctionIds + stack.FrameCount);
+    entry.Ips.assign(stack.Ips, stack.Ips + stack.FrameCount);
+    entry.DescribedGeneration = generation;
+    entry.DescribedTime = now;
+    entry.LastUsed = ++shard.UseCount;
+
+    IfFailRet(eventProvider->WriteStack(entry.Id, entry.FunctionIds, entry.Ips));
+    shard.NextSequence++;
+
+    if (shard.Stacks.size() >= MaxStacksPerShard)
+    {
+        EvictLeastRecentlyUsed(shard);
+    }
+
+    stackId = entry.Id;
+    shard.Stacks.emplace(hash, std::move(entry));
+
+    END_NO_OOM_THROW_REGION;
+
+    return S_OK;
+}
+
+void ExceptionStackTable::Rundown()
+{
+    _rundownGeneration.fetch_add(1, memory_order_acq_rel);
+}
+
+void ExceptionStackTable::EvictLeastRecentlyUsed(Shard& shard)
+{
+    auto leastRecentlyUsed = shard.Stacks.begin();
+    for (auto it = shard.Stacks.begin(); it != shard.Stacks.end(); ++it)
+    {
+        if (it->second.LastUsed < leastRecentlyUsed->second.LastUsed)
+        {
+            leastRecentlyUsed = it;
+        }
+    }
+
+    if (leastRecentlyUsed != shard.Stacks.end())
+    {
+        shard.Stacks.erase(leastRecentlyUsed);
+    }
+}
+
+size_t ExceptionStackTable::Hash(const CapturedStack& stack)
+{
+    size_t value = stack.FrameCount;
+    for (size_t i = 0; i < stack.FrameCount; i++)
+    {
+        value ^= std::hash<UINT64>()(stack.Ips[i]) + 0x9e3779b9 + (value << 6) + (value >> 2);
+    }
+    return value;
+}
+
+bool ExceptionStackTable::IsSameStack(const CapturedStack& stack, const Entry& entry)
+{
+    if (stack.FrameCount != entry.Ips.size())
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < stack.FrameCount; i++)
+    {
+        if (stack.Ips[i] != entry.Ips[i] || stack.FunctionIds[i] != entry.FunctionIds[i])
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+#endif // DOTNETMONITOR_FEATURE_EXCEPTIONS
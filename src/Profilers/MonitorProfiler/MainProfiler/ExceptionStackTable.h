@@ -0,0 +1,101 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#pragma once
+
+#ifdef DOTNETMONITOR_FEATURE_EXCEPTIONS
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "corhlpr.h"
+#include "corprof.h"
+#include "ExceptionsEventProvider.h"
+
+/// <summary>
+/// Frames of a throw-site stack, captured on the throwing thread without allocating.
+/// </summary>
+class CapturedStack
+{
+public:
+    static const size_t MaxFrames = 64;
+
+    UINT64 FunctionIds[MaxFrames];
+    UINT64 Ips[MaxFrames];
+    size_t FrameCount = 0;
+
+    bool IsFull() const { return FrameCount == MaxFrames; }
+
+    void AddFrame(FunctionID functionId, UINT_PTR ip)
+    {
+        FunctionIds[FrameCount] = functionId;
+        Ips[FrameCount] = ip;
+        FrameCount++;
+    }
+};
+
+/// <summary>
+/// Interns captured stacks so that each distinct stack is described once (StackDesc event) and exceptions only carry its id.
+/// </summary>
+/// <remarks>
+/// The table is split into shards, each with its own lock, so that concurrent throws rarely contend.
+/// A StackDesc event is written while its shard is locked; any event referencing the id is therefore written after it.
+/// Sessions that start later need the descriptions again, so a stack is described again the first time it is used
+/// after Rundown, or once RundownIntervalMilliseconds has passed since it was last described.
+/// When a shard is full its least recently used stack is evicted. Ids are never reused.
+/// </remarks>
+class ExceptionStackTable
+{
+public:
+    // Returned when a stack could not be interned.
+    static const UINT64 NoStackId = 0;
+
+private:
+    // Must be a power of two.
+    static const size_t ShardCount = 16;
+    static const size_t MaxStacksPerShard = 256;
+    static const UINT64 RundownIntervalMilliseconds = 60000;
+
+    class Entry
+    {
+        public:
+            UINT64 Id;
+            std::vector<UINT64> FunctionIds;
+            std::vector<UINT64> Ips;
+            UINT64 DescribedGeneration;
+            UINT64 DescribedTime;
+            UINT64 LastUsed;
+    };
+
+    class Shard
+    {
+        public:
+            std::mutex Mutex;
+            std::unordered_multimap<size_t, Entry> Stacks;
+            // Ids are only consumed once their stack has been described.
+            UINT64 NextSequence = 0;
+            UINT64 UseCount = 0;
+    };
+
+    Shard _shards[ShardCount];
+    std::atomic<UINT64> _rundownGeneration;
+
+public:
+    ExceptionStackTable();
+
+    /// <summary>
+    /// Gets the id of the stack, writing its StackDesc event if it has not been described to current sessions.
+    /// </summary>
+    HRESULT GetStackId(const CapturedStack& stack, ExceptionsEventProvider* eventProvider, UINT64& stackId);
+
+    /// <summary>
+    /// Describes every stack again the next time it is used, for sessions that started after it was first described.
+    /// </summary>
+    void Rundown();
+
+private:
+    static size_t Hash(const CapturedStack& stack);
+    static bool IsSameStack(const CapturedStack& stack, const Entry& entry);
+    static void EvictLeastRecentlyUsed(Shard& shard);
+};
+#endif // DOTNETMONITOR_FEATURE_EXCEPTIONS
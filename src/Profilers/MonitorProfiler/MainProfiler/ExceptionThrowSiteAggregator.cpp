@@ -0,0 +1,347 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#ifdef DOTNETMONITOR_FEATURE_EXCEPTIONS
+#include "ExceptionThrowSiteAggregator.h"
+#include "CommonUtilities/HashUtilities.h"
+#include <chrono>
+#include <unordered_map>
+
+using namespace std;
+
+#define IfFailLogRet(EXPR) IfFailLogRet_(_logger, EXPR)
+
+namespace
+{
+    struct ThrowSiteKey
+    {
+        ClassID ClassId;
+        FunctionID FunctionId;
+        UINT32 ILOffset;
+
+        bool operator==(const ThrowSiteKey& other) const
+        {
+            return ClassId == other.ClassId && FunctionId == other.FunctionId && ILOffset == other.ILOffset;
+        }
+    };
+
+    struct ThrowSiteKeyHash
+    {
+        size_t operator()(const ThrowSiteKey& key) const
+        {
+            size_t value = std::hash<UINT_PTR>()(key.ClassId);
+            value ^= std::hash<UINT_PTR>()(key.FunctionId) + 0x9e3779b9 + (value << 6) + (value >> 2);
+            value ^= std::hash<UINT32>()(key.ILOffset) + 0x9e3779b9 + (value << 6) + (value >> 2);
+            return value;
+        }
+    };
+}
+
+ExceptionThrowSiteAggregator::ExceptionThrowSiteAggregator(
+    const shared_ptr<ILogger>& logger,
+    const shared_ptr<ExceptionNameCache>& nameCache,
+    const shared_ptr<ExceptionSampler>& sampler,
+    ICorProfilerInfo12* corProfilerInfo) :
+    _corProfilerInfo(corProfilerInfo),
+    _logger(logger),
+    _eventProvider(nullptr),
+    _nameCache(nameCache),
+    _sampler(sampler),
+    _reportedSampledCount(0),
+    _reportedUnsampledCount(0),
+    _shutdown(false)
+{
+}
+
+ExceptionThrowSiteAggregator::~ExceptionThrowSiteAggregator()
+{
+    Shutdown();
+}
+
+HRESULT ExceptionThrowSiteAggregator::Start(ExceptionsEventProvider* eventProvider)
+{
+    if (_flushThread.joinable())
+    {
+        return E_UNEXPECTED;
+    }
+
+    _eventProvider = eventProvider;
+
+    _flushThread = thread(&ExceptionThrowSiteAggregator::FlushThread, this);
+
+    return S_OK;
+}
+
+void ExceptionThrowSiteAggregator::Shutdown()
+{
+    {
+        lock_guard<mutex> lock(_flushMutex);
+        _shutdown = true;
+    }
+    _flushCondition.notify_all();
+
+    if (_flushThread.joinable())
+    {
+        _flushThread.join();
+    }
+}
+
+HRESULT ExceptionThrowSiteAggregator::RecordThrow(ClassID classId, FunctionID functionId, UINT_PTR ip)
+{
+    HRESULT hr = S_OK;
+
+    ThreadSiteTable* table = nullptr;
+    IfFailRet(GetThreadSiteTable(&table));
+
+    size_t bucket = HashUtilities::Mix(static_cast<UINT64>(classId) ^ HashUtilities::Mix(ip));
+    for (size_t probe = 0; probe < ThreadSiteCapacity; probe++)
+    {
+        ThreadSite& site = table->Sites[(bucket + probe) & (ThreadSiteCapacity - 1)];
+
+        // Only this thread writes to the table, so a relaxed read-modify-write is sufficient; the flush
+        // thread only needs to observe a consistent value.
+        UINT64 count = site.Count.load(memory_order_relaxed);
+        if (count == 0)
+        {
+            site.ClassId = classId;
+            site.FunctionId = functionId;
+            site.Ip = ip;
+            // Publishes the key fields to the flush thread.
+            site.Count.store(1, memory_order_release);
+            return S_OK;
+        }
+
+        if (site.ClassId == classId && site.Ip == ip && site.FunctionId == functionId)
+        {
+            site.Count.store(count + 1, memory_order_relaxed);
+            return S_OK;
+        }
+    }
+
+    table->DroppedCount.store(table->DroppedCount.load(memory_order_relaxed) + 1, memory_order_relaxed);
+
+    return S_OK;
+}
+
+HRESULT ExceptionThrowSiteAggregator::GetThreadSiteTable(ThreadSiteTable** table)
+{
+    // Tables are registered with the aggregator on the first throw from each thread. The aggregator
+    // keeps its own reference so that counts from exited threads are still reported by the next flush.
+    static thread_local shared_ptr<ThreadSiteTable> s_threadSiteTable;
+
+    if (!s_threadSiteTable)
+    {
+        shared_ptr<ThreadSiteTable> newTable(new (nothrow) ThreadSiteTable());
+        IfNullRet(newTable);
+
+        {
+            lock_guard<mutex> lock(_tablesMutex);
+            _tables.push_back(newTable);
+        }
+
+        s_threadSiteTable = newTable;
+    }
+
+    *table = s_threadSiteTable.get();
+
+    return S_OK;
+}
+
+void ExceptionThrowSiteAggregator::FlushThread()
+{
+    HRESULT hr = _corProfilerInfo->InitializeCurrentThread();
+    if (FAILED(hr))
+    {
+        _logger->Log(LogLevel::Error, _LS("Unable to initialize thread: 0x%08x"), hr);
+        return;
+    }
+
+    while (true)
+    {
+        {
+            unique_lock<mutex> lock(_flushMutex);
+            if (_flushCondition.wait_for(lock, chrono::milliseconds(static_cast<unsigned int>(FlushIntervalMilliseconds)), [this]() { return _shutdown; }))
+            {
+                break;
+            }
+        }
+
+        hr = Flush();
+        if (FAILED(hr))
+        {
+            _logger->Log(LogLevel::Error, _LS("Unable to flush exception throw sites: 0x%08x"), hr);
+        }
+    }
+}
+
+HRESULT ExceptionThrowSiteAggregator::Flush()
+{
+    HRESULT hr = S_OK;
+
+    // Tables only referenced by the aggregator belong to exited threads. They are reported one last time and released.
+    vector<shared_ptr<ThreadSiteTable>> tables;
+    {
+        lock_guard<mutex> lock(_tablesMutex);
+        tables.reserve(_tables.size());
+
+        vector<shared_ptr<ThreadSiteTable>> activeTables;
+        activeTables.reserve(_tables.size());
+        for (shared_ptr<ThreadSiteTable>& table : _tables)
+        {
+            if (table.use_count() > 1)
+            {
+                activeTables.push_back(table);
+            }
+            tables.push_back(std::move(table));
+        }
+        _tables = std::move(activeTables);
+    }
+
+    unordered_map<ThrowSiteKey, UINT64, ThrowSiteKeyHash> siteCounts;
+    UINT64 totalCount = 0;
+    UINT64 droppedCount = 0;
+
+    for (shared_ptr<ThreadSiteTable>& table : tables)
+    {
+        for (ThreadSite& site : table->Sites)
+        {
+            UINT64 count = site.Count.load(memory_order_acquire);
+            if (count == site.ReportedCount)
+            {
+                continue;
+            }
+
+            if (!site.ILOffsetResolved)
+            {
+                if (0 == site.FunctionId || FAILED(GetILOffset(site.FunctionId, site.Ip, site.ILOffset)))
+                {
+                    site.ILOffset = UnknownILOffset;
+                }
+                site.ILOffsetResolved = true;
+            }
+
+            UINT64 delta = count - site.ReportedCount;
+            site.ReportedCount = count;
+
+            siteCounts[{ site.ClassId, site.FunctionId, site.ILOffset }] += delta;
+            totalCount += delta;
+        }
+
+        UINT64 dropped = table->DroppedCount.load(memory_order_relaxed);
+        droppedCount += dropped - table->ReportedDroppedCount;
+        table->ReportedDroppedCount = dropped;
+    }
+
+    if (totalCount == 0 && droppedCount == 0)
+    {
+        return S_OK;
+    }
+
+    for (const pair<const ThrowSiteKey, UINT64>& siteCount : siteCounts)
+    {
+        const ThrowSiteKey& key = siteCount.first;
+
+        // Names are best effort; the ids are always reported.
+        tstring exceptionType;
+        if (FAILED(_nameCache->GetFullyQualifiedTypeName(key.ClassId, exceptionType)))
+        {
+            exceptionType.clear();
+        }
+
+        tstring methodName;
+        if (0 == key.FunctionId ||
+            FAILED(_nameCache->GetFullyQualifiedMethodName(key.FunctionId, 0, methodName)))
+        {
+            methodName.clear();
+        }
+
+        IfFailLogRet(_eventProvider->WriteThrowSite(key.ClassId, key.FunctionId, key.ILOffset, siteCount.second, exceptionType, methodName));
+    }
+
+    UINT32 sampleLimit = 0;
+    UINT32 sampleWindowMilliseconds = 0;
+    UINT64 sampledCount = totalCount + droppedCount;
+    UINT64 unsampledCount = 0;
+    if (_sampler)
+    {
+        sampleLimit = _sampler->GetSampleLimit();
+        sampleWindowMilliseconds = _sampler->GetWindowMilliseconds();
+
+        UINT64 sampled = _sampler->GetSampledCount();
+        UINT64 unsampled = _sampler->GetUnsampledCount();
+        sampledCount = sampled - _reportedSampledCount;
+        unsampledCount = unsampled - _reportedUnsampledCount;
+        _reportedSampledCount = sampled;
+        _reportedUnsampledCount = unsampled;
+    }
+
+    IfFailLogRet(_eventProvider->WriteHistogramEnd(
+        totalCount,
+        static_cast<UINT32>(siteCounts.size()),
+        droppedCount,
+        sampleLimit,
+        sampleWindowMilliseconds,
+        sampledCount,
+        unsampledCount));
+
+    return S_OK;
+}
+
+HRESULT ExceptionThrowSiteAggregator::GetILOffset(FunctionID functionId, UINT_PTR ip, UINT32& ilOffset)
+{
+    HRESULT hr = S_OK;
+
+    // The ip of the throwing frame is the return address of the call into the runtime's throw helper.
+    // Step back into the call instruction so that the ip maps to the throwing IL instruction.
+    LPCBYTE callIp = reinterpret_cast<LPCBYTE>(ip - 1);
+
+    FunctionID ipFunctionId;
+    ReJITID reJitId;
+    IfFailRet(_corProfilerInfo->GetFunctionFromIP2(callIp, &ipFunctionId, &reJitId));
+    if (ipFunctionId != functionId)
+    {
+        return E_UNEXPECTED;
+    }
+
+    ULONG32 codeInfoCount = 0;
+    IfFailRet(_corProfilerInfo->GetCodeInfo3(functionId, reJitId, 0, &codeInfoCount, nullptr));
+    vector<COR_PRF_CODE_INFO> codeInfos(codeInfoCount);
+    IfFailRet(_corProfilerInfo->GetCodeInfo3(functionId, reJitId, codeInfoCount, &codeInfoCount, codeInfos.data()));
+
+    // Native offsets in the IL to native map are relative to the start of the first code region.
+    ULONG32 nativeOffset = 0;
+    bool found = false;
+    for (const COR_PRF_CODE_INFO& codeInfo : codeInfos)
+    {
+        UINT_PTR start = codeInfo.startAddress;
+        if (reinterpret_cast<UINT_PTR>(callIp) >= start && reinterpret_cast<UINT_PTR>(callIp) < start + codeInfo.size)
+        {
+            nativeOffset += static_cast<ULONG32>(reinterpret_cast<UINT_PTR>(callIp) - start);
+            found = true;
+            break;
+        }
+        nativeOffset += static_cast<ULONG32>(codeInfo.size);
+    }
+
+    if (!found)
+    {
+        return E_FAIL;
+    }
+
+    ULONG32 mapCount = 0;
+    IfFailRet(_corProfilerInfo->GetILToNativeMapping2(functionId, reJitId, 0, &mapCount, nullptr));
+    vector<COR_DEBUG_IL_TO_NATIVE_MAP> map(mapCount);
+    IfFailRet(_corProfilerInfo->GetILToNativeMapping2(functionId, reJitId, mapCount, &mapCount, map.data()));
+
+    for (const COR_DEBUG_IL_TO_NATIVE_MAP& entry : map)
+    {
+        if (nativeOffset >= entry.nativeStartOffset && nativeOffset < entry.nativeEndOffset)
+        {
+            ilOffset = entry.ilOffset;
+            return S_OK;
+        }
+    }
+
+    return E_FAIL;
+}
+#endif // DOTNETMONITOR_FEATURE_EXCEPTIONS
@@ -0,0 +1,102 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#pragma once
+
+#ifdef DOTNETMONITOR_FEATURE_EXCEPTIONS
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "corhlpr.h"
+#include "corprof.h"
+#include "com.h"
+#include "Logging/Logger.h"
+#include "ExceptionNameCache.h"
+#include "ExceptionsEventProvider.h"
+#include "ExceptionSampler.h"
+
+/// <summary>
+/// Counts thrown exceptions by throw site, (exception ClassID, throwing FunctionID, IL offset), and periodically
+/// writes the counts as a histogram through ExceptionsEventProvider.
+/// </summary>
+/// <remarks>
+/// Each thread counts into its own fixed size table, so recording a throw never takes a lock or allocates
+/// (other than once per thread). Native instruction pointers are only translated to IL offsets on the flush thread.
+/// </remarks>
+class ExceptionThrowSiteAggregator
+{
+private:
+    static const unsigned int FlushIntervalMilliseconds = 1000;
+
+    // Must be a power of two.
+    static const size_t ThreadSiteCapacity = 128;
+
+    static const UINT32 UnknownILOffset = static_cast<UINT32>(-1);
+
+    class ThreadSite
+    {
+        public:
+            // Key fields are written once by the owning thread before Count is first published.
+            ClassID ClassId = 0;
+            FunctionID FunctionId = 0;
+            UINT_PTR Ip = 0;
+            // Total throws from this site. Zero means the slot is unused.
+            std::atomic<UINT64> Count{ 0 };
+
+            // Only accessed on the flush thread.
+            UINT64 ReportedCount = 0;
+            UINT32 ILOffset = 0;
+            bool ILOffsetResolved = false;
+    };
+
+    class ThreadSiteTable
+    {
+        public:
+            ThreadSite Sites[ThreadSiteCapacity];
+            // Throws that did not fit in the table.
+            std::atomic<UINT64> DroppedCount{ 0 };
+            UINT64 ReportedDroppedCount = 0;
+    };
+
+    ComPtr<ICorProfilerInfo12> _corProfilerInfo;
+    std::shared_ptr<ILogger> _logger;
+    ExceptionsEventProvider* _eventProvider;
+    std::shared_ptr<ExceptionNameCache> _nameCache;
+    std::shared_ptr<ExceptionSampler> _sampler;
+    UINT64 _reportedSampledCount;
+    UINT64 _reportedUnsampledCount;
+
+    std::mutex _tablesMutex;
+    std::vector<std::shared_ptr<ThreadSiteTable>> _tables;
+
+    std::thread _flushThread;
+    std::mutex _flushMutex;
+    std::condition_variable _flushCondition;
+    bool _shutdown;
+
+public:
+    ExceptionThrowSiteAggregator(
+        const std::shared_ptr<ILogger>& logger,
+        const std::shared_ptr<ExceptionNameCache>& nameCache,
+        const std::shared_ptr<ExceptionSampler>& sampler,
+        ICorProfilerInfo12* corProfilerInfo);
+    ~ExceptionThrowSiteAggregator();
+
+    HRESULT Start(ExceptionsEventProvider* eventProvider);
+    void Shutdown();
+
+    /// <summary>
+    /// Counts a throw. Must be called on the throwing thread. functionId is 0 if no managed frame was found.
+    /// </summary>
+    HRESULT RecordThrow(ClassID classId, FunctionID functionId, UINT_PTR ip);
+
+private:
+    HRESULT GetThreadSiteTable(ThreadSiteTable** table);
+    void FlushThread();
+    HRESULT Flush();
+    HRESULT GetILOffset(FunctionID functionId, UINT_PTR ip, UINT32& ilOffset);
+};
+#endif // DOTNETMONITOR_FEATURE_EXCEPTIONS
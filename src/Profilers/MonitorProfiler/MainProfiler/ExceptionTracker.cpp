@@ -3,13 +3,10 @@
 
 #ifdef DOTNETMONITOR_FEATURE_EXCEPTIONS
 #include "ExceptionTracker.h"
-#include "../Utilities/NameCache.h"
-#include "../Utilities/TypeNameUtilities.h"
 
 using namespace std;
 
 #define IfFailLogRet(EXPR) IfFailLogRet_(_logger, EXPR)
-#define IfFalseLogRet(EXPR, hr) IfFalseLogRet_(_logger, EXPR, hr)
 
 #define LogDebugV(format, ...) LogDebugV_(_logger, format, __VA_ARGS__)
 #define LogInformationV(format, ...) LogInformationV_(_logger, format, __VA_ARGS__)
@@ -42,41 +39,148 @@ using namespace std;
 
     Unhandled Exception Detection Algorithm
 
-    A subset of the above described callbacks is used to determine if an unhandled exception has occurred:
-    - ExceptionThrown: Record the originating FunctionID and the existence of the exception.
-    - ExceptionSearchCatcherFound: Record that the exception will be handled in a catching FunctionID.
-    - ExceptionUnwindFunctionEnter: If the exception was not handled (ExceptionSearchCatcherFound was not invoked),
-      then the exception is unhandled at this point. Do some extra bookkeeping in the case when the exception is
-      handled so that the exception is cleared once the frame with the corresponding catching FunctionID is encountered.
-
-    Current pitfalls:
-    - Algorithm doesn't account for exceptions thrown within exception filters. These will be seen as a new set of
-      callback invocations starting with throwing, searching, and unwinding, however, the callstack does not unwind
-      out of the exception filter and the original exception processing is resumed.
-    - Algorithm doesn't account for exceptions thrown within finally blocks. Presumably, these will be seen as new set
-      of callback invocations starting with throwing, searching, and unwinding. The original exception processing is
-      superceded by the new set of callbacks for the new exception.
+    A subset of the above described callbacks is used to determine if an unhandled exception has occurred.
+    Each thread keeps a small stack of the exceptions it is processing (see ThreadData), innermost last:
+    - ExceptionThrown: Push a new exception.
+    - ExceptionSearchCatcherFound: Record that the innermost exception will be handled in a catching FunctionID.
+    - ExceptionUnwindFunctionEnter: If the innermost exception was not handled (ExceptionSearchCatcherFound was not invoked),
+      then the exception is unhandled at this point. If the frame is the one with the corresponding catching FunctionID,
+      pop the exception.
+
+    Nested exceptions:
+    - Exceptions thrown within exception filters are thrown while the enclosing exception is still searching for a
+      handler. The callstack does not unwind out of the exception filter; if the nested exception escapes the filter,
+      the runtime swallows it and the original exception processing is resumed. Such exceptions are never reported as
+      unhandled, and are popped once the enclosing exception finds its handler.
+    - Exceptions thrown within finally blocks are thrown while the enclosing exception is unwinding. If the nested
+      exception unwinds the frame that would have handled the enclosing exception, the enclosing exception processing
+      was superceded and it is discarded.
+    - Handling is tracked per FunctionID, so a nested exception whose handler is in the same function as the
+      enclosing exception's handler is assumed to be handled within the finally block.
 */
 
 
 ExceptionTracker::ExceptionTracker(
     const shared_ptr<ILogger>& logger,
     const shared_ptr<ThreadDataManager> threadDataManager,
-    ICorProfilerInfo12* corProfilerInfo)
+    ICorProfilerInfo12* corProfilerInfo) :
+    _unhandledExceptionCallbackSet(false)
 {
     _corProfilerInfo = corProfilerInfo;
     _logger = logger;
     _threadDataManager = threadDataManager;
+    _nameCache = make_shared<ExceptionNameCache>(corProfilerInfo);
 }
 
 void ExceptionTracker::AddProfilerEventMask(DWORD& eventsLow)
 {
-    if (_logger->IsEnabled(LogLevel::Debug))
+    // Cached names are invalidated when their modules unload.
+    eventsLow |= COR_PRF_MONITOR::COR_PRF_MONITOR_MODULE_LOADS;
+
+    if (_throwSiteAggregator || _stackTable || _logger->IsEnabled(LogLevel::Debug))
     {
         eventsLow |= COR_PRF_MONITOR::COR_PRF_ENABLE_STACK_SNAPSHOT;
     }
 }
 
+HRESULT ExceptionTracker::EnableSampling(UINT32 sampleLimit, UINT32 windowMilliseconds)
+{
+    if (_sampler || _throwSiteAggregator)
+    {
+        return E_UNEXPECTED;
+    }
+
+    if (0 == windowMilliseconds)
+    {
+        return E_INVALIDARG;
+    }
+
+    _sampler = make_shared<ExceptionSampler>(sampleLimit, windowMilliseconds);
+    IfNullRet(_sampler);
+
+    return S_OK;
+}
+
+HRESULT ExceptionTracker::EnableThrowSiteAggregation()
+{
+    if (_throwSiteAggregator)
+    {
+        return E_UNEXPECTED;
+    }
+
+    _throwSiteAggregator.reset(new (nothrow) ExceptionThrowSiteAggregator(_logger, _nameCache, _sampler, _corProfilerInfo));
+    IfNullRet(_throwSiteAggregator);
+
+    return S_OK;
+}
+
+HRESULT ExceptionTracker::EnableStackCapture()
+{
+    if (_stackTable)
+    {
+        return E_UNEXPECTED;
+    }
+
+    _stackTable.reset(new (nothrow) ExceptionStackTable());
+    IfNullRet(_stackTable);
+
+    return S_OK;
+}
+
+HRESULT ExceptionTracker::SetUnhandledExceptionCallback(function<HRESULT(ThreadID, FunctionID)> callback)
+{
+    if (_unhandledExceptionCallbackSet.load(memory_order_acquire))
+    {
+        return E_UNEXPECTED;
+    }
+
+    _unhandledExceptionCallback = std::move(callback);
+
+    // Publishes the callback to threads that are already processing exceptions.
+    _unhandledExceptionCallbackSet.store(true, memory_order_release);
+
+    return S_OK;
+}
+
+HRESULT ExceptionTracker::Start()
+{
+    HRESULT hr = S_OK;
+
+    if (_throwSiteAggregator || _stackTable)
+    {
+        IfFailLogRet(ExceptionsEventProvider::CreateProvider(_corProfilerInfo, _eventProvider));
+    }
+
+    if (_throwSiteAggregator)
+    {
+        IfFailLogRet(_throwSiteAggregator->Start(_eventProvider.get()));
+    }
+
+    return S_OK;
+}
+
+void ExceptionTracker::Shutdown()
+{
+    // Unhandled exceptions raised from now on are no longer held; the callback's owner is going away.
+    _unhandledExceptionCallbackSet.store(false, memory_order_release);
+
+    if (_throwSiteAggregator)
+    {
+        _throwSiteAggregator->Shutdown();
+    }
+
+    if (_sampler)
+    {
+        _logger->Log(
+            LogLevel::Information,
+            _LS("Exception sampling: limit %u per %u ms, %llu sampled, %llu not sampled"),
+            _sampler->GetSampleLimit(),
+            _sampler->GetWindowMilliseconds(),
+            _sampler->GetSampledCount(),
+            _sampler->GetUnsampledCount());
+    }
+}
+
 HRESULT ExceptionTracker::ExceptionThrown(ThreadID threadId, ObjectID objectId)
 {
     // CAUTION: Do not store the exception ObjectID. It is not guaranteed to be correct
@@ -84,30 +188,63 @@ HRESULT ExceptionTracker::ExceptionThrown(ThreadID threadId, ObjectID objectId)
 
     HRESULT hr = S_OK;
 
-    IfFailLogRet(_threadDataManager->SetHasException(threadId));
+    IfFailLogRet(_threadDataManager->PushException(threadId));
 
     // Exception throwing is common; don't pay to calculate method name if it won't be logged.
-    if (_logger->IsEnabled(LogLevel::Debug))
+    bool logThrow = _logger->IsEnabled(LogLevel::Debug);
+    if (logThrow || _throwSiteAggregator || _stackTable)
     {
         ClassID classId;
         IfFailLogRet(_corProfilerInfo->GetClassFromObject(objectId, &classId));
 
-        tstring typeName;
-        IfFailLogRet(GetFullyQualifiedTypeName(classId, typeName));
-        LogDebugV("Exception thrown: %s", typeName);
+        // When many exceptions of the same type are thrown, only capture the details of a bounded number of them.
+        // The throwing frame is still captured for the throw site counts.
+        bool sampled = !_sampler || _sampler->ShouldSample(classId);
+        if (sampled && logThrow)
+        {
+            tstring typeName;
+            IfFailLogRet(GetFullyQualifiedTypeName(classId, typeName));
+            LogDebugV("Exception thrown: %s", typeName);
+        }
+
+        bool captureStack = sampled && _stackTable;
+        ThrownFrame frame;
+        CapturedStack stack;
+        if (sampled || _throwSiteAggregator)
+        {
+            // Walking the current thread does not require suspending the runtime.
+            frame.Tracker = this;
+            frame.LogFrame = sampled && logThrow;
+            frame.Stack = captureStack ? &stack : nullptr;
+
+            hr = _corProfilerInfo->DoStackSnapshot(
+                threadId,
+                ExceptionThrownFrameCallback,
+                COR_PRF_SNAPSHOT_INFO::COR_PRF_SNAPSHOT_DEFAULT,
+                &frame,
+                nullptr,
+                0);
+
+            if (FAILED(hr) && hr != CORPROF_E_STACKSNAPSHOT_ABORTED)
+            {
+                LogErrorV("DoStackSnapshot failed in function %s: 0x%08x", __func__, hr);
+                return hr;
+            }
+        }
 
-        hr = _corProfilerInfo->DoStackSnapshot(
-            threadId,
-            LogExceptionThrownFrameCallback,
-            COR_PRF_SNAPSHOT_INFO::COR_PRF_SNAPSHOT_DEFAULT,
-            this,
-            nullptr,
-            0);
+        if (captureStack)
+        {
+            UINT64 stackId = ExceptionStackTable::NoStackId;
+            if (stack.FrameCount > 0)
+            {
+                IfFailLogRet(_stackTable->GetStackId(stack, _eventProvider.get(), stackId));
+            }
+            IfFailLogRet(_eventProvider->WriteExceptionThrown(classId, stackId));
+        }
 
-        if (FAILED(hr) && hr != CORPROF_E_STACKSNAPSHOT_ABORTED)
+        if (_throwSiteAggregator)
         {
-            LogErrorV("DoStackSnapshot failed in function %s: 0x%08x", __func__, hr);
-            return hr;
+            IfFailLogRet(_throwSiteAggregator->RecordThrow(classId, frame.FunctionId, frame.Ip));
         }
     }
 
@@ -127,25 +264,23 @@ HRESULT ExceptionTracker::ExceptionUnwindFunctionEnter(ThreadID threadId, Functi
 {
     HRESULT hr = S_OK;
 
-    bool hasException = false;
-    FunctionID catcherFunctionId = ThreadData::NoFunctionId;
-    IfFailLogRet(_threadDataManager->GetException(threadId, &hasException, &catcherFunctionId));
-    IfFalseLogRet(hasException, E_UNEXPECTED);
+    ExceptionUnwindResult result = ExceptionUnwindResult::None;
+    IfFailLogRet(_threadDataManager->ExceptionUnwindFunctionEnter(threadId, functionId, result));
 
-    if (ThreadData::NoFunctionId == catcherFunctionId)
+    if (ExceptionUnwindResult::Unhandled == result)
     {
         tstring methodName;
         IfFailLogRet(GetFullyQualifiedMethodName(functionId, methodName));
         LogInformationV("Exception unhandled: %s", methodName);
 
-        // Future: Block thread until collection is initiated of the desired artifact.
-        // Possible serialization of some context of the exception and surrounding method
-        // information such as locals and parameters.
+        // Hold the thread while artifacts are collected; the process terminates once it is released.
+        if (_unhandledExceptionCallbackSet.load(memory_order_acquire))
+        {
+            IfFailLogRet(_unhandledExceptionCallback(threadId, functionId));
+        }
     }
-    else if (functionId == catcherFunctionId)
+    else if (ExceptionUnwindResult::Handled == result)
     {
-        IfFailLogRet(_threadDataManager->ClearException(threadId));
-
         // Exception handling is common; don't pay to calculate method name if it won't be logged.
         if (_logger->IsEnabled(LogLevel::Debug))
         {
@@ -158,17 +293,22 @@ HRESULT ExceptionTracker::ExceptionUnwindFunctionEnter(ThreadID threadId, Functi
     return S_OK;
 }
 
-HRESULT ExceptionTracker::GetFullyQualifiedTypeName(ClassID classId, tstring& fullTypeName)
+void ExceptionTracker::ModuleUnloadStarted(ModuleID moduleId)
 {
-    HRESULT hr = S_OK;
-
-    NameCache cache;
-    TypeNameUtilities typeNameUtilities(_corProfilerInfo);
+    _nameCache->ModuleUnloadStarted(moduleId);
+}
 
-    IfFailRet(typeNameUtilities.CacheNames(cache, classId));
-    IfFailRet(cache.GetFullyQualifiedTypeName(classId, fullTypeName));
+void ExceptionTracker::Rundown()
+{
+    if (_stackTable)
+    {
+        _stackTable->Rundown();
+    }
+}
 
-    return S_OK;
+HRESULT ExceptionTracker::GetFullyQualifiedTypeName(ClassID classId, tstring& fullTypeName)
+{
+    return _nameCache->GetFullyQualifiedTypeName(classId, fullTypeName);
 }
 
 HRESULT ExceptionTracker::GetFullyQualifiedMethodName(FunctionID functionId, tstring& fullMethodName)
@@ -182,15 +322,7 @@ HRESULT ExceptionTracker::GetFullyQualifiedMethodName(FunctionID functionId, tst
 
 HRESULT ExceptionTracker::GetFullyQualifiedMethodName(FunctionID functionId, COR_PRF_FRAME_INFO frameInfo, tstring& fullMethodName)
 {
-    HRESULT hr = S_OK;
-
-    NameCache cache;
-    TypeNameUtilities typeNameUtilities(_corProfilerInfo);
-
-    IfFailRet(typeNameUtilities.CacheNames(cache, functionId, frameInfo));
-    IfFailRet(cache.GetFullyQualifiedName(functionId, fullMethodName));
-
-    return S_OK;
+    return _nameCache->GetFullyQualifiedMethodName(functionId, frameInfo, fullMethodName);
 }
 
 HRESULT ExceptionTracker::LogExceptionThrownFrame(FunctionID functionId, COR_PRF_FRAME_INFO frameInfo)
@@ -204,7 +336,7 @@ HRESULT ExceptionTracker::LogExceptionThrownFrame(FunctionID functionId, COR_PRF
     return S_OK;
 }
 
-HRESULT ExceptionTracker::LogExceptionThrownFrameCallback(
+HRESULT ExceptionTracker::ExceptionThrownFrameCallback(
     FunctionID functionId,
     UINT_PTR ip,
     COR_PRF_FRAME_INFO frameInfo,
@@ -217,13 +349,35 @@ HRESULT ExceptionTracker::LogExceptionThrownFrameCallback(
         return E_POINTER;
     }
 
-    ExceptionTracker* exceptionTracker = static_cast<ExceptionTracker*>(clientData);
+    // Skip native frames above the throwing method, such as the runtime's throw helper.
+    if (0 == functionId)
+    {
+        return S_OK;
+    }
+
+    ThrownFrame* frame = static_cast<ThrownFrame*>(clientData);
 
     HRESULT hr = S_OK;
 
-    IfFailRet(exceptionTracker->LogExceptionThrownFrame(functionId, frameInfo));
+    if (0 == frame->FunctionId)
+    {
+        frame->FunctionId = functionId;
+        frame->Ip = ip;
+
+        if (frame->LogFrame)
+        {
+            IfFailRet(frame->Tracker->LogExceptionThrownFrame(functionId, frameInfo));
+        }
+    }
+
+    if (nullptr == frame->Stack)
+    {
+        // Cancel stack snapshot callbacks after the top frame.
+        return S_FALSE;
+    }
+
+    frame->Stack->AddFrame(functionId, ip);
 
-    // Cancel stack snapshot callbacks after the top frame.
-    return S_FALSE;
+    return frame->Stack->IsFull() ? S_FALSE : S_OK;
 }
 #endif // DOTNETMONITOR_FEATURE_EXCEPTIONS
@@ -4,9 +4,15 @@
 #pragma once
 
 #ifdef DOTNETMONITOR_FEATURE_EXCEPTIONS
+#include <atomic>
+#include <functional>
 #include <memory>
-#include "../Logging/Logger.h"
+#include "Logging/Logger.h"
 #include "ThreadDataManager.h"
+#include "ExceptionNameCache.h"
+#include "ExceptionSampler.h"
+#include "ExceptionStackTable.h"
+#include "ExceptionThrowSiteAggregator.h"
 #include "com.h"
 
 /// <summary>
@@ -18,6 +24,13 @@ private:
     ComPtr<ICorProfilerInfo12> _corProfilerInfo;
     std::shared_ptr<ILogger> _logger;
     std::shared_ptr<ThreadDataManager> _threadDataManager;
+    std::shared_ptr<ExceptionNameCache> _nameCache;
+    std::shared_ptr<ExceptionSampler> _sampler;
+    std::unique_ptr<ExceptionsEventProvider> _eventProvider;
+    std::unique_ptr<ExceptionStackTable> _stackTable;
+    std::unique_ptr<ExceptionThrowSiteAggregator> _throwSiteAggregator;
+    std::function<HRESULT(ThreadID, FunctionID)> _unhandledExceptionCallback;
+    std::atomic_bool _unhandledExceptionCallbackSet;
 
 public:
     ExceptionTracker(
@@ -30,20 +43,65 @@ public:
     /// </summary>
     void AddProfilerEventMask(DWORD& eventsLow);
 
+    /// <summary>
+    /// Limits the number of throws of each exception type per window whose details are captured.
+    /// Must be called before EnableThrowSiteAggregation.
+    /// </summary>
+    HRESULT EnableSampling(UINT32 sampleLimit, UINT32 windowMilliseconds);
+
+    /// <summary>
+    /// Enables counting of thrown exceptions by throw site. Must be called before AddProfilerEventMask.
+    /// </summary>
+    HRESULT EnableThrowSiteAggregation();
+
+    /// <summary>
+    /// Enables writing an event with the interned throw-site stack of each sampled exception.
+    /// Must be called before AddProfilerEventMask.
+    /// </summary>
+    HRESULT EnableStackCapture();
+
+    /// <summary>
+    /// Sets the callback invoked on the faulting thread when an exception is found to be unhandled.
+    /// The thread is held for as long as the callback blocks. May be called once, after exception callbacks have started.
+    /// </summary>
+    HRESULT SetUnhandledExceptionCallback(std::function<HRESULT(ThreadID, FunctionID)> callback);
+
+    HRESULT Start();
+    void Shutdown();
+
     // Exceptions
     HRESULT ExceptionThrown(ThreadID threadId, ObjectID objectId);
     HRESULT ExceptionSearchCatcherFound(ThreadID threadId, FunctionID functionId);
     HRESULT ExceptionUnwindFunctionEnter(ThreadID threadId, FunctionID functionId);
 
+    // Modules
+    void ModuleUnloadStarted(ModuleID moduleId);
+
+    /// <summary>
+    /// Describes captured stacks again for event sessions that started after they were first described.
+    /// </summary>
+    void Rundown();
+
 private:
     // Method and type name utilities
     HRESULT GetFullyQualifiedTypeName(ClassID classId, tstring& fullTypeName);
     HRESULT GetFullyQualifiedMethodName(FunctionID functionId, tstring& fullMethodName);
     HRESULT GetFullyQualifiedMethodName(FunctionID functionId, COR_PRF_FRAME_INFO frameInfo, tstring& fullMethodName);
 
-    // ExceptionThrown frame logging utilities
+    // ExceptionThrown frame utilities
+    class ThrownFrame
+    {
+        public:
+            ExceptionTracker* Tracker = nullptr;
+            bool LogFrame = false;
+            FunctionID FunctionId = 0;
+            UINT_PTR Ip = 0;
+            // Set to capture all managed frames rather than just the throwing frame.
+            CapturedStack* Stack = nullptr;
+    };
+
     HRESULT LogExceptionThrownFrame(FunctionID functionId, COR_PRF_FRAME_INFO frameInfo);
-    static HRESULT STDMETHODCALLTYPE LogExceptionThrownFrameCallback(
+    static HRESULT STDMETHODCALLTYPE ExceptionThrownFrameCallback(
         FunctionID functionId,
         UINT_PTR ip,
         COR_PRF_FRAME_INFO frameInfo,
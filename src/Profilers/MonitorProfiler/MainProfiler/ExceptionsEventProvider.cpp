@@ -0,0 +1,66 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#ifdef DOTNETMONITOR_FEATURE_EXCEPTIONS
+#include "ExceptionsEventProvider.h"
+
+const WCHAR* ExceptionsEventProvider::ProviderName = _T("DotnetMonitorExceptionsEventProvider");
+
+HRESULT ExceptionsEventProvider::CreateProvider(ICorProfilerInfo12* profilerInfo, std::unique_ptr<ExceptionsEventProvider>& eventProvider)
+{
+    std::unique_ptr<ProfilerEventProvider> provider;
+    HRESULT hr;
+
+    IfFailRet(ProfilerEventProvider::CreateProvider(ProviderName, profilerInfo, provider));
+
+    eventProvider = std::unique_ptr<ExceptionsEventProvider>(new ExceptionsEventProvider(profilerInfo, provider));
+    IfFailRet(eventProvider->DefineEvents());
+
+    return S_OK;
+}
+
+HRESULT ExceptionsEventProvider::DefineEvents()
+{
+    HRESULT hr;
+
+    IfFailRet(_provider->DefineEvent(_T("ThrowSite"), _throwSiteEvent, ThrowSitePayloads));
+    IfFailRet(_provider->DefineEvent(_T("HistogramEnd"), _histogramEndEvent, HistogramEndPayloads));
+    IfFailRet(_provider->DefineEvent(_T("StackDesc"), _stackEvent, StackPayloads));
+    IfFailRet(_provider->DefineEvent(_T("ExceptionThrown"), _exceptionThrownEvent, ExceptionThrownPayloads));
+
+    return S_OK;
+}
+
+HRESULT ExceptionsEventProvider::WriteThrowSite(ClassID classId, FunctionID functionId, UINT32 ilOffset, UINT64 count, const tstring& exceptionType, const tstring& methodName)
+{
+    return _throwSiteEvent->WritePayload(
+        static_cast<UINT64>(classId),
+        static_cast<UINT64>(functionId),
+        ilOffset,
+        count,
+        exceptionType,
+        methodName);
+}
+
+HRESULT ExceptionsEventProvider::WriteHistogramEnd(UINT64 totalCount, UINT32 siteCount, UINT64 droppedCount, UINT32 sampleLimit, UINT32 sampleWindowMilliseconds, UINT64 sampledCount, UINT64 unsampledCount)
+{
+    return _histogramEndEvent->WritePayload(
+        totalCount,
+        siteCount,
+        droppedCount,
+        sampleLimit,
+        sampleWindowMilliseconds,
+        sampledCount,
+        unsampledCount);
+}
+
+HRESULT ExceptionsEventProvider::WriteStack(UINT64 stackId, const std::vector<UINT64>& functionIds, const std::vector<UINT64>& ips)
+{
+    return _stackEvent->WritePayload(stackId, functionIds, ips);
+}
+
+HRESULT ExceptionsEventProvider::WriteExceptionThrown(ClassID classId, UINT64 stackId)
+{
+    return _exceptionThrownEvent->WritePayload(static_cast<UINT64>(classId), stackId);
+}
+#endif // DOTNETMONITOR_FEATURE_EXCEPTIONS
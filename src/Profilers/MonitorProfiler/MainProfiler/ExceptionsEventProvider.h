@@ -0,0 +1,57 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#pragma once
+
+#ifdef DOTNETMONITOR_FEATURE_EXCEPTIONS
+#include "EventProvider/ProfilerEventProvider.h"
+#include <memory>
+#include <vector>
+
+/// <summary>
+/// Writes exception information. Each histogram is a series of ThrowSite events
+/// followed by a single HistogramEnd event. Individual throws are written as ExceptionThrown events
+/// that reference a stack previously written by a StackDesc event.
+/// </summary>
+class ExceptionsEventProvider
+{
+    public:
+        static HRESULT CreateProvider(ICorProfilerInfo12* profilerInfo, std::unique_ptr<ExceptionsEventProvider>& eventProvider);
+
+        HRESULT WriteThrowSite(ClassID classId, FunctionID functionId, UINT32 ilOffset, UINT64 count, const tstring& exceptionType, const tstring& methodName);
+        HRESULT WriteHistogramEnd(UINT64 totalCount, UINT32 siteCount, UINT64 droppedCount, UINT32 sampleLimit, UINT32 sampleWindowMilliseconds, UINT64 sampledCount, UINT64 unsampledCount);
+        HRESULT WriteStack(UINT64 stackId, const std::vector<UINT64>& functionIds, const std::vector<UINT64>& ips);
+        HRESULT WriteExceptionThrown(ClassID classId, UINT64 stackId);
+
+    private:
+        ExceptionsEventProvider(ICorProfilerInfo12* profilerInfo, std::unique_ptr<ProfilerEventProvider> & eventProvider) :
+            _profilerInfo(profilerInfo), _provider(std::move(eventProvider))
+        {
+        }
+
+        static const WCHAR* ProviderName;
+
+        HRESULT DefineEvents();
+
+        ComPtr<ICorProfilerInfo12> _profilerInfo;
+        std::unique_ptr<ProfilerEventProvider> _provider;
+
+        //Count is the number of throws from the site since the previous histogram.
+        //Throws without a managed throwing frame are reported with a FunctionId of 0.
+        const WCHAR* ThrowSitePayloads[6] = { _T("ClassId"), _T("FunctionId"), _T("ILOffset"), _T("Count"), _T("ExceptionType"), _T("Method") };
+        std::unique_ptr<ProfilerEvent<UINT64, UINT64, UINT32, UINT64, tstring, tstring>> _throwSiteEvent;
+
+        //DroppedCount is the number of throws that could not be assigned to a site.
+        //SampledCount and UnsampledCount are the number of throws whose details were or were not captured since the previous histogram.
+        const WCHAR* HistogramEndPayloads[7] = { _T("TotalCount"), _T("SiteCount"), _T("DroppedCount"), _T("SampleLimit"), _T("SampleWindowMilliseconds"), _T("SampledCount"), _T("UnsampledCount") };
+        std::unique_ptr<ProfilerEvent<UINT64, UINT32, UINT64, UINT32, UINT32, UINT64, UINT64>> _histogramEndEvent;
+
+        //Frames are ordered from the throwing frame outwards, in the same format as the Callstack event of StacksEventProvider.
+        const WCHAR* StackPayloads[3] = { _T("StackId"), _T("FunctionIds"), _T("IpOffsets") };
+        std::unique_ptr<ProfilerEvent<UINT64, std::vector<UINT64>, std::vector<UINT64>>> _stackEvent;
+
+        //StackId is 0 if the stack was not captured.
+        const WCHAR* ExceptionThrownPayloads[2] = { _T("ClassId"), _T("StackId") };
+        std::unique_ptr<ProfilerEvent<UINT64, UINT64>> _exceptionThrownEvent;
+};
+#endif // DOTNETMONITOR_FEATURE_EXCEPTIONS
@@ -46,36 +46,34 @@ STDMETHODIMP MainProfiler::Initialize(IUnknown *pICorProfilerInfoUnk)
 
 STDMETHODIMP MainProfiler::Shutdown()
 {
-    m_pLogger.reset();
-    m_pEnvironment.reset();
+#ifdef DOTNETMONITOR_FEATURE_EXCEPTIONS
+    // Before the command server, so that no unhandled exception starts a hold on a server that is going away.
+    _exceptionTracker->Shutdown();
+#endif // DOTNETMONITOR_FEATURE_EXCEPTIONS
 
+    // Releases any held threads and waits for them to leave the server.
     _commandServer->Shutdown();
     _commandServer.reset();
 
     g_MessageCallbacks.Unregister(static_cast<unsigned short>(CommandSet::Profiler));
 
-    return ProfilerBase::Shutdown();
-}
-
-STDMETHODIMP MainProfiler::ThreadCreated(ThreadID threadId)
-{
-    HRESULT hr = S_OK;
+    m_pLogger.reset();
+    m_pEnvironment.reset();
 
-#ifdef DOTNETMONITOR_FEATURE_EXCEPTIONS
-    IfFailLogRet(_threadDataManager->ThreadCreated(threadId));
-#endif // DOTNETMONITOR_FEATURE_EXCEPTIONS
+    // Last, so that messages logged while stopping the services above are written.
+    if (_asyncLogger)
+    {
+        _asyncLogger->Shutdown();
+        _asyncLogger.reset();
+    }
 
-    return S_OK;
+    return ProfilerBase::Shutdown();
 }
 
 STDMETHODIMP MainProfiler::ThreadDestroyed(ThreadID threadId)
 {
     HRESULT hr = S_OK;
 
-#ifdef DOTNETMONITOR_FEATURE_EXCEPTIONS
-    IfFailLogRet(_threadDataManager->ThreadDestroyed(threadId));
-#endif // DOTNETMONITOR_FEATURE_EXCEPTIONS
-
     _threadNameCache->Remove(threadId);
 
     return S_OK;
@@ -133,6 +131,15 @@ STDMETHODIMP MainProfiler::ExceptionUnwindFunctionEnter(FunctionID functionId)
     return S_OK;
 }
 
+STDMETHODIMP MainProfiler::ModuleUnloadStarted(ModuleID moduleId)
+{
+#ifdef DOTNETMONITOR_FEATURE_EXCEPTIONS
+    _exceptionTracker->ModuleUnloadStarted(moduleId);
+#endif // DOTNETMONITOR_FEATURE_EXCEPTIONS
+
+    return S_OK;
+}
+
 STDMETHODIMP MainProfiler::InitializeForAttach(IUnknown* pCorProfilerInfoUnk, void* pvClientData, UINT cbClientData)
 {
     HRESULT hr = S_OK;
@@ -160,7 +167,7 @@ HRESULT MainProfiler::InitializeCommon()
 
     // These are created in dependency order!
     IfFailRet(InitializeEnvironment());
-    IfFailRet(LoggerFactory::Create(m_pEnvironment, m_pLogger));
+    IfFailRet(LoggerFactory::Create(m_pEnvironment, m_pLogger, _asyncLogger));
     IfFailRet(InitializeEnvironmentHelper());
 
     // Logging is initialized and can now be used
@@ -177,6 +184,46 @@ HRESULT MainProfiler::InitializeCommon()
     IfNullRet(_threadDataManager);
     _exceptionTracker.reset(new (nothrow) ExceptionTracker(m_pLogger, _threadDataManager, m_pCorProfilerInfo));
     IfNullRet(_exceptionTracker);
+
+    UINT32 sampleLimit = ExceptionSampler::DefaultSampleLimit;
+    hr = _environmentHelper->GetUInt32Value(ExceptionSampleLimitEnvVar, sampleLimit);
+    if (FAILED(hr))
+    {
+        m_pLogger->Log(LogLevel::Warning, _LS("Invalid exception sample limit, using the default: 0x%08x"), hr);
+        sampleLimit = ExceptionSampler::DefaultSampleLimit;
+    }
+
+    UINT32 sampleWindowMilliseconds = ExceptionSampler::DefaultWindowMilliseconds;
+    hr = _environmentHelper->GetUInt32Value(ExceptionSampleWindowEnvVar, sampleWindowMilliseconds);
+    if (FAILED(hr) || 0 == sampleWindowMilliseconds)
+    {
+        m_pLogger->Log(LogLevel::Warning, _LS("Invalid exception sample window, using the default: 0x%08x"), FAILED(hr) ? hr : E_INVALIDARG);
+        sampleWindowMilliseconds = ExceptionSampler::DefaultWindowMilliseconds;
+    }
+
+    IfFailLogRet(_exceptionTracker->EnableSampling(sampleLimit, sampleWindowMilliseconds));
+
+    bool throwSiteAggregationEnabled = false;
+    hr = _environmentHelper->GetIsFeatureEnabled(ExceptionThrowSiteAggregationEnvVar, throwSiteAggregationEnabled);
+    if (FAILED(hr))
+    {
+        m_pLogger->Log(LogLevel::Warning, _LS("Unable to read the throw site aggregation setting, aggregation is disabled: 0x%08x"), hr);
+    }
+    if (throwSiteAggregationEnabled)
+    {
+        IfFailLogRet(_exceptionTracker->EnableThrowSiteAggregation());
+    }
+
+    bool stackCaptureEnabled = false;
+    hr = _environmentHelper->GetIsFeatureEnabled(ExceptionStackCaptureEnvVar, stackCaptureEnabled);
+    if (FAILED(hr))
+    {
+        m_pLogger->Log(LogLevel::Warning, _LS("Unable to read the exception stack capture setting, stack capture is disabled: 0x%08x"), hr);
+    }
+    if (stackCaptureEnabled)
+    {
+        IfFailLogRet(_exceptionTracker->EnableStackCapture());
+    }
 #endif // DOTNETMONITOR_FEATURE_EXCEPTIONS
 
     // Set product version environment variable to allow discovery of if the profiler
@@ -197,9 +244,17 @@ HRESULT MainProfiler::InitializeCommon()
         eventsLow,
         COR_PRF_HIGH_MONITOR::COR_PRF_HIGH_MONITOR_NONE));
 
+#ifdef DOTNETMONITOR_FEATURE_EXCEPTIONS
+    IfFailLogRet(_exceptionTracker->Start());
+#endif // DOTNETMONITOR_FEATURE_EXCEPTIONS
+
     //Initialize this last. The CommandServer creates secondary threads, which will be difficult to cleanup if profiler initialization fails.
     IfFailLogRet(InitializeCommandServer());
 
+#ifdef DOTNETMONITOR_FEATURE_EXCEPTIONS
+    IfFailLogRet(InitializeUnhandledExceptionHold());
+#endif // DOTNETMONITOR_FEATURE_EXCEPTIONS
+
     return S_OK;
 }
 
@@ -261,6 +316,63 @@ HRESULT MainProfiler::InitializeCommandServer()
     return S_OK;
 }
 
+#ifdef DOTNETMONITOR_FEATURE_EXCEPTIONS
+HRESULT MainProfiler::InitializeUnhandledExceptionHold()
+{
+    HRESULT hr = S_OK;
+
+    UINT32 timeoutMilliseconds = DefaultUnhandledExceptionHoldTimeoutMilliseconds;
+    hr = _environmentHelper->GetUInt32Value(UnhandledExceptionHoldTimeoutEnvVar, timeoutMilliseconds);
+    if (FAILED(hr))
+    {
+        m_pLogger->Log(LogLevel::Warning, _LS("Invalid unhandled exception hold timeout, using the default: 0x%08x"), hr);
+        timeoutMilliseconds = DefaultUnhandledExceptionHoldTimeoutMilliseconds;
+    }
+    if (0 == timeoutMilliseconds)
+    {
+        return S_OK;
+    }
+
+    _unhandledExceptionHoldTimeoutMilliseconds = timeoutMilliseconds;
+
+    IfFailLogRet(_exceptionTracker->SetUnhandledExceptionCallback(
+        [this](ThreadID threadId, FunctionID functionId)-> HRESULT { return this->HoldUnhandledExceptionThread(threadId, functionId); }));
+
+    return S_OK;
+}
+
+HRESULT MainProfiler::HoldUnhandledExceptionThread(ThreadID threadId, FunctionID functionId)
+{
+    HRESULT hr = S_OK;
+
+    // The profiler is shutting down; there is no one left to release the thread.
+    if (!_commandServer)
+    {
+        return S_FALSE;
+    }
+
+    DWORD nativeThreadId = 0;
+    IfFailLogRet(m_pCorProfilerInfo->GetThreadInfo(threadId, &nativeThreadId));
+
+    // The thread is held inside a runtime callback. Artifacts that do not suspend the runtime (e.g. dumps
+    // through the diagnostic port) can be collected while it is held; a profiler callstack request suspends
+    // the runtime and may not complete until the thread is released.
+    hr = _commandServer->HoldUnhandledExceptionThread(
+        static_cast<UINT32>(nativeThreadId),
+        functionId,
+        _unhandledExceptionHoldTimeoutMilliseconds);
+
+    // A timeout has already been logged; the exception proceeds as if the thread were released.
+    if (HRESULT_FROM_WIN32(ERROR_TIMEOUT) == hr)
+    {
+        return S_OK;
+    }
+    IfFailLogRet(hr);
+
+    return S_OK;
+}
+#endif // DOTNETMONITOR_FEATURE_EXCEPTIONS
+
 HRESULT MainProfiler::MessageCallback(const IpcMessage& message)
 {
     m_pLogger->Log(LogLevel::Debug, _LS("Message received from client %hu:%hu"), message.CommandSet, message.Command);
@@ -284,6 +396,11 @@ HRESULT MainProfiler::ProfilerCommandSetCallback(const IpcMessage& message)
     case ProfilerCommand::Callstack:
         return ProcessCallstackMessage();
     case ProfilerCommand::StartAllFeatures:
+#ifdef DOTNETMONITOR_FEATURE_EXCEPTIONS
+        // A new dotnet-monitor session can't resolve stacks that were described before it started.
+        _exceptionTracker->Rundown();
+#endif // DOTNETMONITOR_FEATURE_EXCEPTIONS
+        return S_OK;
     case ProfilerCommand::StopAllFeatures:
         // TODO We don't do anything here now, but we could interrupt the current stack walk with CORPROF_E_STACKSNAPSHOT_ABORT in the snapshot callback.
         return S_OK;
@@ -9,6 +9,7 @@
 #include "Environment/Environment.h"
 #include "Environment/EnvironmentHelper.h"
 #include "Logging/Logger.h"
+#include "Logging/AsyncLogger.h"
 #include "CommonUtilities/ThreadNameCache.h"
 #include <memory>
 
@@ -22,11 +23,22 @@ class MainProfiler final :
 {
 private:
     static constexpr LPCWSTR ProfilerVersionEnvVar = _T("DotnetMonitor_MonitorProfiler_ProductVersion");
+#ifdef DOTNETMONITOR_FEATURE_EXCEPTIONS
+    static constexpr LPCWSTR ExceptionThrowSiteAggregationEnvVar = _T("DotnetMonitor_Profiler_Exceptions_ThrowSiteAggregation_Enable");
+    static constexpr LPCWSTR ExceptionStackCaptureEnvVar = _T("DotnetMonitor_Profiler_Exceptions_StackCapture_Enable");
+    static constexpr LPCWSTR ExceptionSampleLimitEnvVar = _T("DotnetMonitor_Profiler_Exceptions_SampleLimit");
+    static constexpr LPCWSTR ExceptionSampleWindowEnvVar = _T("DotnetMonitor_Profiler_Exceptions_SampleWindowMilliseconds");
+    static constexpr LPCWSTR UnhandledExceptionHoldTimeoutEnvVar = _T("DotnetMonitor_Profiler_Exceptions_UnhandledExceptionHoldTimeoutMilliseconds");
+    // Holding is opt-in; dotnet-monitor does not subscribe to unhandled exceptions yet.
+    static constexpr UINT32 DefaultUnhandledExceptionHoldTimeoutMilliseconds = 0;
+#endif // DOTNETMONITOR_FEATURE_EXCEPTIONS
 
 private:
     std::shared_ptr<IEnvironment> m_pEnvironment;
     std::shared_ptr<EnvironmentHelper> _environmentHelper;
     std::shared_ptr<ILogger> m_pLogger;
+    // Set when stderr is written on a background thread; flushed by Shutdown.
+    std::shared_ptr<AsyncLogger> _asyncLogger;
     std::shared_ptr<ThreadNameCache> _threadNameCache;
 #ifdef DOTNETMONITOR_FEATURE_EXCEPTIONS
     std::shared_ptr<ThreadDataManager> _threadDataManager;
@@ -39,12 +51,12 @@ public:
 
     STDMETHOD(Initialize)(IUnknown* pICorProfilerInfoUnk) override;
     STDMETHOD(Shutdown)() override;
-    STDMETHOD(ThreadCreated)(ThreadID threadId) override;
     STDMETHOD(ThreadDestroyed)(ThreadID threadId) override;
     STDMETHOD(ThreadNameChanged)(ThreadID threadId, ULONG cchName, WCHAR name[]) override;
     STDMETHOD(ExceptionThrown)(ObjectID thrownObjectId) override;
     STDMETHOD(ExceptionSearchCatcherFound)(FunctionID functionId) override;
     STDMETHOD(ExceptionUnwindFunctionEnter)(FunctionID functionId) override;
+    STDMETHOD(ModuleUnloadStarted)(ModuleID moduleId) override;
     STDMETHOD(InitializeForAttach)(IUnknown* pCorProfilerInfoUnk, void* pvClientData, UINT cbClientData) override;
     STDMETHOD(LoadAsNotificationOnly)(BOOL *pbNotificationOnly) override;
 
@@ -57,7 +69,14 @@ private:
     HRESULT ValidateMessage(const IpcMessage& message);
     HRESULT ProfilerCommandSetCallback(const IpcMessage& message);
     HRESULT ProcessCallstackMessage();
+#ifdef DOTNETMONITOR_FEATURE_EXCEPTIONS
+    HRESULT InitializeUnhandledExceptionHold();
+    HRESULT HoldUnhandledExceptionThread(ThreadID threadId, FunctionID functionId);
+#endif // DOTNETMONITOR_FEATURE_EXCEPTIONS
 private:
     std::unique_ptr<CommandServer> _commandServer;
+#ifdef DOTNETMONITOR_FEATURE_EXCEPTIONS
+    UINT32 _unhandledExceptionHoldTimeoutMilliseconds = 0;
+#endif // DOTNETMONITOR_FEATURE_EXCEPTIONS
 };
 
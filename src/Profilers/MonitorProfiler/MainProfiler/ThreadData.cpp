@@ -5,51 +5,111 @@
 #include "ThreadData.h"
 #include "macros.h"
 
-using namespace std;
-
-#define IfFalseLogRet(EXPR, hr) IfFalseLogRet_(_logger, EXPR, hr)
-
-ThreadData::ThreadData(const shared_ptr<ILogger>& logger) :
-    _exceptionCatcherFunctionId(NoFunctionId),
-    _hasException(false),
-    _logger(logger)
+void ThreadData::Reset(ThreadID threadId)
 {
+    _threadId = threadId;
+    _exceptionCount = 0;
 }
 
-void ThreadData::ClearException()
+void ThreadData::PushException()
 {
-    _exceptionCatcherFunctionId = NoFunctionId;
-    _hasException = false;
+    if (MaxExceptionDepth == _exceptionCount)
+    {
+        RemoveException(0);
+    }
+
+    bool inFilter = _exceptionCount > 0 && !GetInnermostException().Unwinding;
+
+    ExceptionState& state = _exceptions[_exceptionCount++];
+    state = ExceptionState();
+    state.InFilter = inFilter;
 }
 
-HRESULT ThreadData::GetException(bool* hasException, FunctionID* catcherFunctionId)
+HRESULT ThreadData::SetExceptionCatcherFunction(FunctionID functionId)
 {
-    ExpectedPtr(hasException);
-    ExpectedPtr(catcherFunctionId);
+    if (NoFunctionId == functionId)
+    {
+        return E_INVALIDARG;
+    }
 
-    *hasException = _hasException;
-    *catcherFunctionId = _exceptionCatcherFunctionId;
+    PopCompletedFilterExceptions();
+
+    // The exception may have been thrown before tracking started, or discarded because too many were nested.
+    if (0 == _exceptionCount)
+    {
+        return S_FALSE;
+    }
+
+    GetInnermostException().CatcherFunctionId = functionId;
 
     return S_OK;
 }
 
-HRESULT ThreadData::SetHasException()
+HRESULT ThreadData::ExceptionUnwindFunctionEnter(FunctionID functionId, ExceptionUnwindResult& result)
 {
-    IfFalseLogRet(!_hasException, E_UNEXPECTED);
-    IfFalseLogRet(NoFunctionId == _exceptionCatcherFunctionId, E_UNEXPECTED);
+    result = ExceptionUnwindResult::None;
+
+    if (0 == _exceptionCount)
+    {
+        return S_FALSE;
+    }
+
+    ExceptionState& state = GetInnermostException();
+    state.Unwinding = true;
 
-    _hasException = true;
+    if (NoFunctionId == state.CatcherFunctionId)
+    {
+        if (!state.InFilter && !state.ReportedUnhandled)
+        {
+            state.ReportedUnhandled = true;
+            result = ExceptionUnwindResult::Unhandled;
+        }
+        return S_OK;
+    }
+
+    if (functionId != state.CatcherFunctionId)
+    {
+        // If this exception unwinds the frame that would have handled an enclosing exception,
+        // it escaped the enclosing exception's finally block and replaced it.
+        for (size_t i = _exceptionCount - 1; i > 0; i--)
+        {
+            if (_exceptions[i - 1].CatcherFunctionId == functionId)
+            {
+                RemoveException(i - 1);
+            }
+        }
+        return S_OK;
+    }
+
+    _exceptionCount--;
+    result = ExceptionUnwindResult::Handled;
+
+    // Enclosing exceptions that were already reported as unhandled are either replaced by the
+    // handled exception or will terminate the process; neither produces further callbacks worth tracking.
+    while (_exceptionCount > 0 && GetInnermostException().ReportedUnhandled)
+    {
+        _exceptionCount--;
+    }
 
     return S_OK;
 }
 
-HRESULT ThreadData::SetExceptionCatcherFunction(FunctionID functionId)
+void ThreadData::PopCompletedFilterExceptions()
 {
-    IfFalseLogRet(NoFunctionId != functionId, E_INVALIDARG);
-    IfFalseLogRet(_hasException, E_UNEXPECTED);
-
-    _exceptionCatcherFunctionId = functionId;
+    // A handler being found for an enclosing exception means the filters it ran have completed,
+    // including any exceptions thrown and unwound within them.
+    while (_exceptionCount > 1 && GetInnermostException().InFilter && GetInnermostException().Unwinding)
+    {
+        _exceptionCount--;
+    }
+}
 
-    return S_OK;
+void ThreadData::RemoveException(size_t index)
+{
+    for (size_t i = index + 1; i < _exceptionCount; i++)
+    {
+        _exceptions[i - 1] = _exceptions[i];
+    }
+    _exceptionCount--;
 }
 #endif // DOTNETMONITOR_FEATURE_EXCEPTIONS
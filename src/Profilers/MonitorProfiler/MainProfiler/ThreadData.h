@@ -4,31 +4,81 @@
 #pragma once
 
 #ifdef DOTNETMONITOR_FEATURE_EXCEPTIONS
-#include <memory>
 #include "corhlpr.h"
 #include "corprof.h"
-#include "../Logging/Logger.h"
+
+/// <summary>
+/// Outcome of a frame being unwound by the innermost exception of a thread.
+/// </summary>
+enum class ExceptionUnwindResult
+{
+    // Nothing to report for this frame.
+    None,
+    // The exception has no handler. Reported once per exception.
+    Unhandled,
+    // The frame contains the handler of the exception; the exception is complete.
+    Handled
+};
 
 /// <summary>
 /// Class representing common data for a single thread.
+/// Instances live in thread local storage, so they are only ever accessed by the thread they describe.
 /// </summary>
+/// <remarks>
+/// Exceptions thrown while another exception is being processed (from a filter, finally or fault block)
+/// are tracked in a fixed size stack, innermost last. If the stack is full, the outermost exception is discarded.
+/// </remarks>
 class ThreadData
 {
 public:
     static const FunctionID NoFunctionId = 0;
+    static const size_t MaxExceptionDepth = 8;
 
 private:
-    FunctionID _exceptionCatcherFunctionId;
-    bool _hasException;
-    std::shared_ptr<ILogger> _logger;
+    class ExceptionState
+    {
+        public:
+            FunctionID CatcherFunctionId;
+            // Set once the first frame is unwound; until then the runtime is searching for a handler.
+            bool Unwinding;
+            // Thrown while the enclosing exception was searching for a handler, i.e. from a filter.
+            // The runtime swallows exceptions that escape a filter, so these are never unhandled.
+            bool InFilter;
+            bool ReportedUnhandled;
+
+            constexpr ExceptionState() :
+                CatcherFunctionId(NoFunctionId),
+                Unwinding(false),
+                InFilter(false),
+                ReportedUnhandled(false)
+            {
+            }
+    };
+
+    ThreadID _threadId;
+    ExceptionState _exceptions[MaxExceptionDepth];
+    size_t _exceptionCount;
 
 public:
-    ThreadData(const std::shared_ptr<ILogger>& logger);
+    // constexpr so that thread local instances are constant initialized and need no initialization guard.
+    constexpr ThreadData() :
+        _threadId(0),
+        _exceptions(),
+        _exceptionCount(0)
+    {
+    }
+
+    ThreadID GetThreadId() const { return _threadId; }
+    void Reset(ThreadID threadId);
 
     // Exceptions
-    void ClearException();
-    HRESULT GetException(bool* hasException, FunctionID* catcherFunctionId);
-    HRESULT SetHasException();
+    void PushException();
     HRESULT SetExceptionCatcherFunction(FunctionID functionId);
+    HRESULT ExceptionUnwindFunctionEnter(FunctionID functionId, ExceptionUnwindResult& result);
+
+private:
+    ExceptionState& GetInnermostException() { return _exceptions[_exceptionCount - 1]; }
+    void PopCompletedFilterExceptions();
+    void RemoveException(size_t index);
 };
 #endif // DOTNETMONITOR_FEATURE_EXCEPTIONS
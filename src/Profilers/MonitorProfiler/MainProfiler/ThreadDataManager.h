@@ -5,21 +5,23 @@
 
 #ifdef DOTNETMONITOR_FEATURE_EXCEPTIONS
 #include <memory>
-#include <mutex>
-#include <unordered_map>
 #include "corhlpr.h"
 #include "corprof.h"
 #include "ThreadData.h"
-#include "../Logging/Logger.h"
+#include "Logging/Logger.h"
 
 /// <summary>
 /// Class for managing common thread information.
 /// </summary>
+/// <remarks>
+/// Thread data is kept in thread local storage rather than a shared map so that the exception callbacks,
+/// which can fire once per frame during unwinding, never take a lock.
+/// The methods must be called on the thread identified by threadId; the runtime raises
+/// exception callbacks on the thread that the exception is being processed on.
+/// </remarks>
 class ThreadDataManager
 {
 private:
-    std::unordered_map<ThreadID, std::shared_ptr<ThreadData>> _dataMap;
-    std::mutex _dataMapMutex;
     std::shared_ptr<ILogger> _logger;
 
 public:
@@ -30,17 +32,12 @@ public:
     /// </summary>
     static void AddProfilerEventMask(DWORD& eventsLow);
 
-    // Threads
-    HRESULT ThreadCreated(ThreadID threadId);
-    HRESULT ThreadDestroyed(ThreadID threadId);
-
     // Exceptions
-    HRESULT ClearException(ThreadID threadId);
-    HRESULT GetException(ThreadID threadId, bool* hasException, FunctionID* catcherFunctionId);
-    HRESULT SetHasException(ThreadID threadId);
+    HRESULT PushException(ThreadID threadId);
     HRESULT SetExceptionCatcherFunction(ThreadID threadId, FunctionID catcherFunctionId);
+    HRESULT ExceptionUnwindFunctionEnter(ThreadID threadId, FunctionID functionId, ExceptionUnwindResult& result);
 
 private:
-    HRESULT GetThreadData(ThreadID threadId, std::shared_ptr<ThreadData>& threadData);
+    static ThreadData& GetThreadData(ThreadID threadId);
 };
 #endif // DOTNETMONITOR_FEATURE_EXCEPTIONS
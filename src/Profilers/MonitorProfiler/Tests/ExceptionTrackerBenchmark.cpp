@@ -0,0 +1,286 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+//
+// Measures the overhead that exception tracking adds to each thrown and caught exception, with the logger at
+// Information and at Debug, against runtime stubs. Not run as a test; usage: ExceptionTrackerBenchmark [exceptions]
+//
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include "RuntimeStubs.h"
+#include "MainProfiler/ExceptionTracker.h"
+#include "MainProfiler/ThreadDataManager.h"
+
+using namespace std;
+using namespace std::chrono;
+
+namespace
+{
+    const ThreadID BenchmarkThreadId = 0x1;
+    const ObjectID ExceptionObjectId = 0x1000;
+    const ModuleID BenchmarkModuleId = 0x2000;
+    const ClassID ExceptionClassId = 0x3000;
+    const ClassID ThrowingClassId = 0x3010;
+    const FunctionID ThrowingFunctionId = 0x4000;
+    const FunctionID CatchingFunctionId = 0x4010;
+    const mdTypeDef ExceptionTypeDef = 0x02000002;
+    const mdTypeDef ThrowingTypeDef = 0x02000003;
+    const mdMethodDef ThrowingMethodDef = 0x06000001;
+    const mdMethodDef CatchingMethodDef = 0x06000002;
+
+    // Frames below the thrower, walked only when the whole stack is captured.
+    const unsigned StackDepth = 20;
+
+    volatile size_t s_sink = 0;
+
+    /// <summary>
+    /// Formats messages at or above its level and discards them, so that only the cost of producing them is measured.
+    /// </summary>
+    class DiscardingLogger final :
+        public ILogger
+    {
+    private:
+        LogLevel _level;
+
+    public:
+        DiscardingLogger(LogLevel level) : _level(level)
+        {
+        }
+
+        STDMETHOD_(bool, IsEnabled)(LogLevel level) override
+        {
+            return level >= _level;
+        }
+
+        STDMETHOD(Log)(LogLevel level, const lstring& message) override
+        {
+            s_sink += message.length();
+            return S_OK;
+        }
+    };
+
+    HRESULT CopyName(const WCHAR* name, LPWSTR buffer, ULONG bufferLength, ULONG* pLength)
+    {
+        ULONG length = 0;
+        while (name[length] != 0)
+        {
+            length++;
+        }
+
+        if (nullptr != pLength)
+        {
+            *pLength = length + 1;
+        }
+
+        if (nullptr != buffer && bufferLength > length)
+        {
+            memcpy(buffer, name, (length + 1) * sizeof(WCHAR));
+        }
+
+        return S_OK;
+    }
+
+    class BenchmarkMetaDataImport final :
+        public MetaDataImportStub
+    {
+    public:
+        STDMETHOD(GetScopeProps)(LPWSTR szName, ULONG cchName, ULONG* pchName, GUID* pmvid) override
+        {
+            if (nullptr != pmvid)
+            {
+                *pmvid = {};
+            }
+            return CopyName(W("/app/Benchmark.dll"), szName, cchName, pchName);
+        }
+
+        STDMETHOD(GetTypeDefProps)(mdTypeDef td, LPWSTR szTypeDef, ULONG cchTypeDef, ULONG* pchTypeDef, DWORD* pdwTypeDefFlags, mdToken* ptkExtends) override
+        {
+            if (nullptr != pdwTypeDefFlags)
+            {
+                *pdwTypeDefFlags = tdPublic;
+            }
+            if (nullptr != ptkExtends)
+            {
+                *ptkExtends = mdTokenNil;
+            }
+            return CopyName(td == ExceptionTypeDef ? W("Benchmark.BenchmarkException") : W("Benchmark.Thrower"), szTypeDef, cchTypeDef, pchTypeDef);
+        }
+
+        STDMETHOD(GetMethodProps)(mdMethodDef mb, mdTypeDef* pClass, LPWSTR szMethod, ULONG cchMethod, ULONG* pchMethod, DWORD* pdwAttr, PCCOR_SIGNATURE* ppvSigBlob, ULONG* pcbSigBlob, ULONG* pulCodeRVA, DWORD* pdwImplFlags) override
+        {
+            if (nullptr != pClass)
+            {
+                *pClass = ThrowingTypeDef;
+            }
+            return CopyName(mb == ThrowingMethodDef ? W("Throw") : W("Catch"), szMethod, cchMethod, pchMethod);
+        }
+
+        STDMETHOD(GetCustomAttributeByName)(mdToken tkObj, LPCWSTR szName, const void** ppData, ULONG* pcbData) override
+        {
+            return S_FALSE;
+        }
+    };
+
+    /// <summary>
+    /// Describes one module with an exception type and a class whose methods throw and catch it.
+    /// </summary>
+    class BenchmarkProfilerInfo final :
+        public ProfilerInfoStub
+    {
+    private:
+        BenchmarkMetaDataImport _metaDataImport;
+
+    public:
+        STDMETHOD(GetClassFromObject)(ObjectID objectId, ClassID* pClassId) override
+        {
+            *pClassId = ExceptionClassId;
+            return S_OK;
+        }
+
+        STDMETHOD(GetClassIDInfo2)(ClassID classId, ModuleID* pModuleId, mdTypeDef* pTypeDefToken, ClassID* pParentClassId, ULONG32 cNumTypeArgs, ULONG32* pcNumTypeArgs, ClassID typeArgs[]) override
+        {
+            if (nullptr != pModuleId)
+            {
+                *pModuleId = BenchmarkModuleId;
+            }
+            if (nullptr != pTypeDefToken)
+            {
+                *pTypeDefToken = classId == ExceptionClassId ? ExceptionTypeDef : ThrowingTypeDef;
+            }
+            if (nullptr != pParentClassId)
+            {
+                *pParentClassId = 0;
+            }
+            if (nullptr != pcNumTypeArgs)
+            {
+                *pcNumTypeArgs = 0;
+            }
+            return S_OK;
+        }
+
+        STDMETHOD(GetFunctionInfo2)(FunctionID funcId, COR_PRF_FRAME_INFO frameInfo, ClassID* pClassId, ModuleID* pModuleId, mdToken* pToken, ULONG32 cTypeArgs, ULONG32* pcTypeArgs, ClassID typeArgs[]) override
+        {
+            if (nullptr != pClassId)
+            {
+                *pClassId = ThrowingClassId;
+            }
+            if (nullptr != pModuleId)
+            {
+                *pModuleId = BenchmarkModuleId;
+            }
+            if (nullptr != pToken)
+            {
+                *pToken = funcId == ThrowingFunctionId ? ThrowingMethodDef : CatchingMethodDef;
+            }
+            if (nullptr != pcTypeArgs)
+            {
+                *pcTypeArgs = 0;
+            }
+            return S_OK;
+        }
+
+        STDMETHOD(GetModuleMetaData)(ModuleID moduleId, DWORD dwOpenFlags, REFIID riid, IUnknown** ppOut) override
+        {
+            *ppOut = &_metaDataImport;
+            return S_OK;
+        }
+
+        STDMETHOD(DoStackSnapshot)(ThreadID thread, StackSnapshotCallback* callback, ULONG32 infoFlags, void* clientData, BYTE context[], ULONG32 contextSize) override
+        {
+            // The runtime's throw helper, then the thrower and its callers.
+            if (callback(0, 0, 0, 0, nullptr, clientData) == S_FALSE)
+            {
+                return CORPROF_E_STACKSNAPSHOT_ABORTED;
+            }
+
+            for (unsigned i = 0; i <= StackDepth; i++)
+            {
+                FunctionID functionId = i == 0 ? ThrowingFunctionId : CatchingFunctionId;
+                UINT_PTR ip = 0x10000 + i * 0x10;
+                COR_PRF_FRAME_INFO frameInfo = static_cast<COR_PRF_FRAME_INFO>(i + 1);
+                if (callback(functionId, ip, frameInfo, 0, nullptr, clientData) == S_FALSE)
+                {
+                    return CORPROF_E_STACKSNAPSHOT_ABORTED;
+                }
+            }
+
+            return S_OK;
+        }
+    };
+
+    /// <summary>
+    /// Raises the callbacks of an exception thrown by one method and caught by its caller.
+    /// </summary>
+    bool ThrowAndCatch(ExceptionTracker& tracker)
+    {
+        return SUCCEEDED(tracker.ExceptionThrown(BenchmarkThreadId, ExceptionObjectId)) &&
+            SUCCEEDED(tracker.ExceptionSearchCatcherFound(BenchmarkThreadId, CatchingFunctionId)) &&
+            SUCCEEDED(tracker.ExceptionUnwindFunctionEnter(BenchmarkThreadId, ThrowingFunctionId)) &&
+            SUCCEEDED(tracker.ExceptionUnwindFunctionEnter(BenchmarkThreadId, CatchingFunctionId));
+    }
+
+    /// <summary>
+    /// Returns the average nanoseconds per exception, or a negative value if a callback failed.
+    /// Unloading the module before each exception resolves every name again, as when names were not cached.
+    /// </summary>
+    double Measure(unsigned exceptions, LogLevel level, bool unloadEachTime)
+    {
+        BenchmarkProfilerInfo profilerInfo;
+        shared_ptr<ILogger> logger = make_shared<DiscardingLogger>(level);
+        shared_ptr<ThreadDataManager> threadDataManager = make_shared<ThreadDataManager>(logger);
+        ExceptionTracker tracker(logger, threadDataManager, &profilerInfo);
+
+        // Warm up the caches before timing.
+        for (unsigned i = 0; i < exceptions / 10 + 1; i++)
+        {
+            if (!ThrowAndCatch(tracker))
+            {
+                return -1;
+            }
+        }
+
+        steady_clock::time_point start = steady_clock::now();
+        for (unsigned i = 0; i < exceptions; i++)
+        {
+            if (unloadEachTime)
+            {
+                tracker.ModuleUnloadStarted(BenchmarkModuleId);
+            }
+            if (!ThrowAndCatch(tracker))
+            {
+                return -1;
+            }
+        }
+        return duration<double, nano>(steady_clock::now() - start).count() / exceptions;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    unsigned exceptions = argc > 1 ? static_cast<unsigned>(strtoul(argv[1], nullptr, 10)) : 200000;
+    if (exceptions == 0)
+    {
+        fprintf(stderr, "usage: ExceptionTrackerBenchmark [exceptions]\n");
+        return 1;
+    }
+
+    double informationNanoseconds = Measure(exceptions, LogLevel::Information, false);
+    double debugNanoseconds = Measure(exceptions, LogLevel::Debug, false);
+    double debugUncachedNanoseconds = Measure(exceptions, LogLevel::Debug, true);
+    if (informationNanoseconds < 0 || debugNanoseconds < 0 || debugUncachedNanoseconds < 0)
+    {
+        fprintf(stderr, "Exception callback failed\n");
+        return 1;
+    }
+
+    printf("%u exceptions, per exception:\n", exceptions);
+    printf("  Information:                 %10.1f ns\n", informationNanoseconds);
+    printf("  Debug, cached names:         %10.1f ns\n", debugNanoseconds);
+    printf("  Debug, names resolved again: %10.1f ns\n", debugUncachedNanoseconds);
+
+    return 0;
+}
@@ -29,7 +29,7 @@ STDMETHODIMP MutatingMonitorProfiler::Initialize(IUnknown *pICorProfilerInfoUnk)
     // These should always be initialized first
     IfFailRet(ProfilerBase::Initialize(pICorProfilerInfoUnk));
 
-    IfFailRet(InitializeCommon());
+    IfFailRet(InitializeCommon(false));
 
     return S_OK;
 }
@@ -45,6 +45,13 @@ STDMETHODIMP MutatingMonitorProfiler::Shutdown()
         m_pProbeInstrumentation.reset();
     }
 
+    // Last, so that messages logged while stopping probe instrumentation are written.
+    if (m_pAsyncLogger)
+    {
+        m_pAsyncLogger->Shutdown();
+        m_pAsyncLogger.reset();
+    }
+
     return ProfilerBase::Shutdown();
 }
 
@@ -55,7 +62,7 @@ STDMETHODIMP MutatingMonitorProfiler::InitializeForAttach(IUnknown* pCorProfiler
     // These should always be initialized first
     IfFailRet(ProfilerBase::Initialize(pCorProfilerInfoUnk));
 
-    IfFailRet(InitializeCommon());
+    IfFailRet(InitializeCommon(true));
 
     return S_OK;
 }
@@ -69,13 +76,13 @@ STDMETHODIMP MutatingMonitorProfiler::LoadAsNotificationOnly(BOOL *pbNotificatio
     return S_OK;
 }
 
-HRESULT MutatingMonitorProfiler::InitializeCommon()
+HRESULT MutatingMonitorProfiler::InitializeCommon(bool isAttach)
 {
     HRESULT hr = S_OK;
 
     // These are created in dependency order!
     IfFailRet(InitializeEnvironment());
-    IfFailRet(LoggerFactory::Create(m_pEnvironment, m_pLogger));
+    IfFailRet(LoggerFactory::Create(m_pEnvironment, m_pLogger, m_pAsyncLogger));
     IfFailRet(InitializeEnvironmentHelper());
 
     // Logging is initialized and can now be used
@@ -100,7 +107,53 @@ HRESULT MutatingMonitorProfiler::InitializeCommon()
     {
         m_pProbeInstrumentation.reset(new (nothrow) ProbeInstrumentation(m_pLogger, m_pCorProfilerInfo));
         IfNullRet(m_pProbeInstrumentation);
+
+        bool trackInliners;
+        IfFailLogRet(_environmentHelper->GetIsFeatureEnabled(ParameterCapturingTrackInlinersEnvVar, trackInliners));
+        m_pProbeInstrumentation->SetTrackInliners(trackInliners);
+
+        // Must be loaded before the event mask is set. Methods that were jitted before an attach can't be timed from
+        // their first call, and the callbacks the plan needs can't be enabled after attach.
+        if (!isAttach)
+        {
+            IfFailLogRet(LoadStartupProbePlan());
+        }
         m_pProbeInstrumentation->AddProfilerEventMask(eventsLow);
+
+        UINT32 samplingInterval = ProbeInstrumentation::DefaultSamplingInterval;
+        hr = _environmentHelper->GetUInt32Value(ParameterCapturingSamplingIntervalEnvVar, samplingInterval);
+        if (FAILED(hr))
+        {
+            m_pLogger->Log(LogLevel::Warning, _LS("Invalid probe sampling interval, using the default: 0x%08x"), hr);
+            samplingInterval = ProbeInstrumentation::DefaultSamplingInterval;
+        }
+        m_pProbeInstrumentation->SetDefaultSamplingInterval(samplingInterval);
+
+        // A budget of 0 is unlimited.
+        UINT32 maxProbeInvocationsPerSecond = 0;
+        hr = _environmentHelper->GetUInt32Value(ParameterCapturingMaxProbeInvocationsPerSecondEnvVar, maxProbeInvocationsPerSecond);
+        if (FAILED(hr))
+        {
+            m_pLogger->Log(LogLevel::Warning, _LS("Invalid probe invocation budget, probe invocations are not limited: 0x%08x"), hr);
+            maxProbeInvocationsPerSecond = 0;
+        }
+        UINT32 maxProbeMicrosecondsPerSecond = 0;
+        hr = _environmentHelper->GetUInt32Value(ParameterCapturingMaxProbeMicrosecondsPerSecondEnvVar, maxProbeMicrosecondsPerSecond);
+        if (FAILED(hr))
+        {
+            m_pLogger->Log(LogLevel::Warning, _LS("Invalid probe time budget, probe time is not limited: 0x%08x"), hr);
+            maxProbeMicrosecondsPerSecond = 0;
+        }
+        m_pProbeInstrumentation->SetProbeBudgets(maxProbeInvocationsPerSecond, maxProbeMicrosecondsPerSecond);
+
+        UINT32 latencyFlushInterval = ProbeInstrumentation::DefaultLatencyFlushIntervalMilliseconds;
+        hr = _environmentHelper->GetUInt32Value(FunctionLatencyFlushIntervalEnvVar, latencyFlushInterval);
+        if (FAILED(hr))
+        {
+            m_pLogger->Log(LogLevel::Warning, _LS("Invalid latency flush interval, using the default: 0x%08x"), hr);
+            latencyFlushInterval = ProbeInstrumentation::DefaultLatencyFlushIntervalMilliseconds;
+        }
+        m_pProbeInstrumentation->SetLatencyFlushInterval(latencyFlushInterval);
     }
     else
     {
@@ -138,6 +191,51 @@ HRESULT MutatingMonitorProfiler::InitializeEnvironmentHelper()
     return S_OK;
 }
 
+HRESULT MutatingMonitorProfiler::LoadStartupProbePlan()
+{
+    HRESULT hr = S_OK;
+
+    // The plan is named after the runtime instance; without one there is no plan.
+    tstring instanceId;
+    if (FAILED(_environmentHelper->GetRuntimeInstanceId(instanceId)))
+    {
+        return S_FALSE;
+    }
+
+#if TARGET_UNIX
+    tstring separator = _T("/");
+#else
+    tstring separator = _T("\\");
+#endif
+
+    tstring sharedPath;
+    IfFailRet(_environmentHelper->GetSharedPath(sharedPath));
+
+    IfFailRet(m_pProbeInstrumentation->LoadStartupProbePlan(sharedPath + separator + instanceId + StartupProbePlanExtension));
+
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE MutatingMonitorProfiler::ModuleLoadFinished(ModuleID moduleId, HRESULT hrStatus)
+{
+    if (m_pProbeInstrumentation && SUCCEEDED(hrStatus))
+    {
+        return m_pProbeInstrumentation->ModuleLoadFinished(moduleId);
+    }
+
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE MutatingMonitorProfiler::ModuleUnloadStarted(ModuleID moduleId)
+{
+    if (m_pProbeInstrumentation)
+    {
+        return m_pProbeInstrumentation->ModuleUnloadStarted(moduleId);
+    }
+
+    return S_OK;
+}
+
 HRESULT STDMETHODCALLTYPE MutatingMonitorProfiler::GetReJITParameters(ModuleID moduleId, mdMethodDef methodId, ICorProfilerFunctionControl* pFunctionControl)
 {
     if (m_pProbeInstrumentation)
@@ -145,5 +243,35 @@ HRESULT STDMETHODCALLTYPE MutatingMonitorProfiler::GetReJITParameters(ModuleID m
         return m_pProbeInstrumentation->GetReJITParameters(moduleId, methodId, pFunctionControl);
     }
 
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE MutatingMonitorProfiler::JITCompilationStarted(FunctionID functionId, BOOL fIsSafeToBlock)
+{
+    if (m_pProbeInstrumentation)
+    {
+        return m_pProbeInstrumentation->JITCompilationStarted(functionId);
+    }
+
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE MutatingMonitorProfiler::JITInlining(FunctionID callerId, FunctionID calleeId, BOOL* pfShouldInline)
+{
+    if (m_pProbeInstrumentation)
+    {
+        return m_pProbeInstrumentation->JITInlining(callerId, calleeId, pfShouldInline);
+    }
+
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE MutatingMonitorProfiler::JITCachedFunctionSearchStarted(FunctionID functionId, BOOL* pbUseCachedFunction)
+{
+    if (m_pProbeInstrumentation)
+    {
+        return m_pProbeInstrumentation->JITCachedFunctionSearchStarted(functionId, pbUseCachedFunction);
+    }
+
     return S_OK;
 }
\ No newline at end of file
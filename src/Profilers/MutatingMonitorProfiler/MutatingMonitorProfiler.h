@@ -7,6 +7,7 @@
 #include "Environment/Environment.h"
 #include "Environment/EnvironmentHelper.h"
 #include "Logging/Logger.h"
+#include "Logging/AsyncLogger.h"
 #include "CommonUtilities/ThreadNameCache.h"
 #include "ProbeInstrumentation/ProbeInstrumentation.h"
 #include <memory>
@@ -17,11 +18,20 @@ class MutatingMonitorProfiler final :
 private:
     static constexpr LPCWSTR ProfilerVersionEnvVar = _T("DotnetMonitor_MutatingMonitorProfiler_ProductVersion");
     static constexpr LPCWSTR EnableParameterCapturingEnvVar = _T("DotnetMonitor_InProcessFeatures_ParameterCapturing_Enable");
+    static constexpr LPCWSTR ParameterCapturingSamplingIntervalEnvVar = _T("DotnetMonitor_InProcessFeatures_ParameterCapturing_SamplingInterval");
+    static constexpr LPCWSTR ParameterCapturingMaxProbeInvocationsPerSecondEnvVar = _T("DotnetMonitor_InProcessFeatures_ParameterCapturing_MaxProbeInvocationsPerSecond");
+    static constexpr LPCWSTR ParameterCapturingMaxProbeMicrosecondsPerSecondEnvVar = _T("DotnetMonitor_InProcessFeatures_ParameterCapturing_MaxProbeMicrosecondsPerSecond");
+    static constexpr LPCWSTR ParameterCapturingTrackInlinersEnvVar = _T("DotnetMonitor_InProcessFeatures_ParameterCapturing_TrackInliners");
+    static constexpr LPCWSTR FunctionLatencyFlushIntervalEnvVar = _T("DotnetMonitor_InProcessFeatures_FunctionLatency_FlushIntervalMilliseconds");
+    // <SharedPath>/<RuntimeInstanceId>.probeplan
+    static constexpr LPCWSTR StartupProbePlanExtension = _T(".probeplan");
 
 private:
     std::shared_ptr<IEnvironment> m_pEnvironment;
     std::shared_ptr<EnvironmentHelper> _environmentHelper;
     std::shared_ptr<ILogger> m_pLogger;
+    // Set when stderr is written on a background thread; flushed by Shutdown.
+    std::shared_ptr<AsyncLogger> m_pAsyncLogger;
     std::unique_ptr<ProbeInstrumentation> m_pProbeInstrumentation;
 
 public:
@@ -31,11 +41,17 @@ public:
     STDMETHOD(Shutdown)() override;
     STDMETHOD(InitializeForAttach)(IUnknown* pCorProfilerInfoUnk, void* pvClientData, UINT cbClientData) override;
     STDMETHOD(LoadAsNotificationOnly)(BOOL *pbNotificationOnly) override;
+    STDMETHOD(ModuleLoadFinished)(ModuleID moduleId, HRESULT hrStatus) override;
+    STDMETHOD(ModuleUnloadStarted)(ModuleID moduleId) override;
     STDMETHOD(GetReJITParameters)(ModuleID moduleId, mdMethodDef methodId, ICorProfilerFunctionControl* pFunctionControl) override;
+    STDMETHOD(JITCompilationStarted)(FunctionID functionId, BOOL fIsSafeToBlock) override;
+    STDMETHOD(JITInlining)(FunctionID callerId, FunctionID calleeId, BOOL* pfShouldInline) override;
+    STDMETHOD(JITCachedFunctionSearchStarted)(FunctionID functionId, BOOL* pbUseCachedFunction) override;
 
 private:
-    HRESULT InitializeCommon();
+    HRESULT InitializeCommon(bool isAttach);
     HRESULT InitializeEnvironment();
     HRESULT InitializeEnvironmentHelper();
+    HRESULT LoadStartupProbePlan();
 };
 
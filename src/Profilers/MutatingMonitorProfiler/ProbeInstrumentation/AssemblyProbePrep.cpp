@@ -9,13 +9,18 @@
 #include "CommonUtilities/MetadataEnumCloser.h"
 #include "CommonUtilities/StringUtilities.h"
 
+#include <atomic>
+#include <functional>
+#include <unordered_set>
+
 using namespace std;
 
 #define ENUM_BUFFER_SIZE 10
 #define STRING_BUFFER_LEN 256
 
-AssemblyProbePrep::AssemblyProbePrep(ICorProfilerInfo12* profilerInfo, FunctionID probeFunctionId) :
+AssemblyProbePrep::AssemblyProbePrep(ICorProfilerInfo12* profilerInfo, FunctionID probeFunctionId, AssemblyProbePrepWorkers* pWorkers) :
     m_pCorProfilerInfo(profilerInfo),
+    m_pWorkers(pWorkers),
     m_resolvedCorLibId(0),
     m_probeFunctionId(probeFunctionId),
     m_didHydrateProbeCache(false)
@@ -35,38 +40,152 @@ bool AssemblyProbePrep::TryGetAssemblyPrepData(ModuleID moduleId, shared_ptr<Ass
 }
 
 HRESULT AssemblyProbePrep::PrepareAssemblyForProbes(ModuleID moduleId)
+{
+    vector<ModuleID> moduleIds;
+    IfOomRetMem(moduleIds.push_back(moduleId));
+
+    return PrepareAssembliesForProbes(moduleIds);
+}
+
+HRESULT AssemblyProbePrep::PrepareAssembliesForProbes(const vector<ModuleID>& moduleIds)
 {
     HRESULT hr;
 
-    auto const& it = m_assemblyProbeCache.find(moduleId);
-    if (it != m_assemblyProbeCache.end())
+    START_NO_OOM_THROW_REGION;
+
+    vector<ModuleID> pendingModuleIds;
+    unordered_set<ModuleID> seenModuleIds;
+    for (ModuleID moduleId : moduleIds)
+    {
+        if (m_assemblyProbeCache.find(moduleId) == m_assemblyProbeCache.end() &&
+            seenModuleIds.insert(moduleId).second)
+        {
+            pendingModuleIds.push_back(moduleId);
+        }
+    }
+
+    if (pendingModuleIds.empty())
     {
         return S_OK;
     }
 
+    //
+    // Resolve everything shared between modules up front. After this, preparing a module
+    // only reads the hydrated caches and emits into that module's own metadata.
+    //
+    IfFailRet(HydrateResolvedCorLib());
+    if (m_probeFunctionId != 0)
+    {
+        IfFailRet(HydrateProbeMetadata());
+    }
+
+    vector<shared_ptr<AssemblyProbePrepData>> prepData(pendingModuleIds.size());
+    vector<HRESULT> results(pendingModuleIds.size(), E_UNEXPECTED);
+    atomic<size_t> nextModule(0);
+
+    function<void()> prepareModules = [&]()
+    {
+        size_t i;
+        while ((i = nextModule.fetch_add(1)) < pendingModuleIds.size())
+        {
+            // Must not throw on a worker thread.
+            try
+            {
+                results[i] = CreateAssemblyPrepData(pendingModuleIds[i], prepData[i]);
+            }
+            catch (const bad_alloc&)
+            {
+                results[i] = E_OUTOFMEMORY;
+            }
+        }
+    };
+
+    // The calling thread prepares modules too, so a single module never waits on a worker.
+    if (m_pWorkers != nullptr && pendingModuleIds.size() > 1)
+    {
+        m_pWorkers->Run(pendingModuleIds.size() - 1, prepareModules);
+    }
+    else
+    {
+        prepareModules();
+    }
+
+    hr = S_OK;
+    for (size_t i = 0; i < pendingModuleIds.size(); i++)
+    {
+        if (SUCCEEDED(results[i]))
+        {
+            m_assemblyProbeCache.insert({pendingModuleIds[i], prepData[i]});
+        }
+        else if (SUCCEEDED(hr))
+        {
+            hr = results[i];
+        }
+    }
+
+    END_NO_OOM_THROW_REGION;
+
+    return hr;
+}
+
+HRESULT AssemblyProbePrep::CreateAssemblyPrepData(ModuleID moduleId, shared_ptr<AssemblyProbePrepData>& data)
+{
+    HRESULT hr;
+
     COR_LIB_TYPE_TOKENS corLibTypeTokens = {};
     IfFailRet(EmitNecessaryCorLibTypeTokens(moduleId, corLibTypeTokens));
 
-    mdMemberRef probeMemberRef;
-    IfFailRet(EmitProbeReference(moduleId, probeMemberRef));
-
+    mdMemberRef probeMemberRef = mdMemberRefNil;
+    mdMemberRef typedProbeMemberRef = mdMemberRefNil;
+    if (m_probeFunctionId != 0)
+    {
+        IfFailRet(EmitProbeReference(moduleId, probeMemberRef, typedProbeMemberRef));
+    }
 
     mdSignature faultingProbeCallbackSignature;
-    IfFailRet(EmitFaultingProbeCallbackSignature(moduleId, faultingProbeCallbackSignature));
+    IfFailRet(EmitCallbackSignature(
+        moduleId,
+        FaultingProbeCallbackCorSignature,
+        sizeof(FaultingProbeCallbackCorSignature),
+        faultingProbeCallbackSignature));
+
+    mdSignature latencyProbeEnterCallbackSignature;
+    IfFailRet(EmitCallbackSignature(
+        moduleId,
+        LatencyProbeEnterCallbackCorSignature,
+        sizeof(LatencyProbeEnterCallbackCorSignature),
+        latencyProbeEnterCallbackSignature));
+
+    mdSignature latencyProbeLeaveCallbackSignature;
+    IfFailRet(EmitCallbackSignature(
+        moduleId,
+        LatencyProbeLeaveCallbackCorSignature,
+        sizeof(LatencyProbeLeaveCallbackCorSignature),
+        latencyProbeLeaveCallbackSignature));
+
+    START_NO_OOM_THROW_REGION;
 
-    shared_ptr<AssemblyProbePrepData> data(new (nothrow) AssemblyProbePrepData(probeMemberRef, faultingProbeCallbackSignature, corLibTypeTokens));
-    IfNullRet(data);
-    IfOomRetMem(m_assemblyProbeCache.insert({moduleId, data}));
+    data.reset(new AssemblyProbePrepData(
+        probeMemberRef,
+        typedProbeMemberRef,
+        faultingProbeCallbackSignature,
+        latencyProbeEnterCallbackSignature,
+        latencyProbeLeaveCallbackSignature,
+        corLibTypeTokens));
+
+    END_NO_OOM_THROW_REGION;
 
     return S_OK;
 }
 
-HRESULT AssemblyProbePrep::EmitFaultingProbeCallbackSignature(
+HRESULT AssemblyProbePrep::EmitCallbackSignature(
     ModuleID moduleId,
-    mdSignature& faultingProbeCallbackSignature)
+    PCCOR_SIGNATURE pCorSignature,
+    ULONG cbCorSignature,
+    mdSignature& callbackSignature)
 {
     HRESULT hr;
-    faultingProbeCallbackSignature = mdSignatureNil;
+    callbackSignature = mdSignatureNil;
 
     ComPtr<IMetaDataEmit> pMetadataEmit;
     IfFailRet(m_pCorProfilerInfo->GetModuleMetaData(
@@ -77,28 +196,26 @@ HRESULT AssemblyProbePrep::EmitFaultingProbeCallbackSignature(
 
     mdSignature signature;
     IfFailRet(pMetadataEmit->GetTokenFromSig(
-        FaultingProbeCallbackCorSignature,
-        sizeof(FaultingProbeCallbackCorSignature),
+        pCorSignature,
+        cbCorSignature,
         &signature));
 
-    faultingProbeCallbackSignature = signature;
+    callbackSignature = signature;
 
     return S_OK;
 }
 
 HRESULT AssemblyProbePrep::EmitProbeReference(
     ModuleID moduleId,
-    mdMemberRef& probeMemberRef)
+    mdMemberRef& probeMemberRef,
+    mdMemberRef& typedProbeMemberRef)
 {
     HRESULT hr;
     probeMemberRef = mdMemberRefNil;
+    typedProbeMemberRef = mdMemberRefNil;
 
-    IfFailRet(HydrateProbeMetadata());
-
-    std::shared_ptr<FunctionData> probeFunctionData;
-    std::shared_ptr<ModuleData> probeModuleData;
-    if (!m_nameCache.TryGetFunctionData(m_probeFunctionId, probeFunctionData) ||
-        !m_nameCache.TryGetModuleData(probeFunctionData->GetModuleId(), probeModuleData))
+    // Expects the probe metadata to be hydrated; this may run concurrently for different modules.
+    if (!m_didHydrateProbeCache)
     {
         return E_UNEXPECTED;
     }
@@ -123,25 +240,34 @@ HRESULT AssemblyProbePrep::EmitProbeReference(
         m_probeCache.assemblyFlags,
         &probeAssemblyRefToken));
 
-    tstring typeName;
-    IfFailRet(m_nameCache.GetFullyQualifiedTypeName(probeFunctionData->GetClass(), typeName));
-
     mdTypeRef classTypeRef;
     IfFailRet(pMetadataEmit->DefineTypeRefByName(
         probeAssemblyRefToken,
-        typeName.c_str(),
+        m_probeCache.typeName.c_str(),
         &classTypeRef));
 
     mdMemberRef memberRef;
     IfFailRet(pMetadataEmit->DefineMemberRef(
         classTypeRef,
-        probeFunctionData->GetName().c_str(),
+        m_probeCache.methodName.c_str(),
         m_probeCache.signature.data(),
         static_cast<ULONG>(m_probeCache.signature.size()),
         &memberRef));
 
     probeMemberRef = memberRef;
 
+    if (m_probeCache.hasTypedProbe)
+    {
+        IfFailRet(pMetadataEmit->DefineMemberRef(
+            classTypeRef,
+            TypedProbeName,
+            TypedProbeCorSignature,
+            sizeof(TypedProbeCorSignature),
+            &memberRef));
+
+        typedProbeMemberRef = memberRef;
+    }
+
     return S_OK;
 }
 
@@ -231,7 +357,11 @@ HRESULT AssemblyProbePrep::GetOrEmitTokenForCorLibAssemblyRef(
     HRESULT hr;
     corlibAssemblyRef = mdAssemblyRefNil;
 
-    IfFailRet(HydrateResolvedCorLib());
+    // Expects the corlib to be resolved; this may run concurrently for different modules.
+    if (m_resolvedCorLibId == 0)
+    {
+        return E_UNEXPECTED;
+    }
 
     ComPtr<IMetaDataAssemblyImport> pMetadataAssemblyImport;
     IfFailRet(pMetadataImport->QueryInterface(IID_IMetaDataAssemblyImport, reinterpret_cast<void **>(&pMetadataAssemblyImport)));
@@ -468,12 +598,15 @@ HRESULT AssemblyProbePrep::HydrateProbeMetadata()
     m_probeCache.assemblyMetadata = metadata;
     m_probeCache.assemblyName = tstring(assemblyName);
     m_probeCache.publicKey = vector<BYTE>(pPublicKey, pPublicKey + publicKeyLength);
+    m_probeCache.methodName = probeFunctionData->GetName();
+    IfFailRet(m_nameCache.GetFullyQualifiedTypeName(probeFunctionData->GetClass(), m_probeCache.typeName));
 
+    mdTypeDef probeClassToken;
     PCCOR_SIGNATURE pProbeSignature;
     ULONG signatureLength;
     IfFailRet(pProbeMetadataImport->GetMethodProps(
         probeFunctionData->GetMethodToken(),
-        nullptr,
+        &probeClassToken,
         nullptr,
         NULL,
         nullptr,
@@ -485,6 +618,15 @@ HRESULT AssemblyProbePrep::HydrateProbeMetadata()
 
     m_probeCache.signature = vector<BYTE>(pProbeSignature, pProbeSignature + signatureLength);
 
+    // Older probe assemblies only provide the boxing probe.
+    mdMethodDef typedProbeToken;
+    m_probeCache.hasTypedProbe = SUCCEEDED(pProbeMetadataImport->FindMethod(
+        probeClassToken,
+        TypedProbeName,
+        TypedProbeCorSignature,
+        sizeof(TypedProbeCorSignature),
+        &typedProbeToken));
+
     m_didHydrateProbeCache = true;
     return S_OK;
 }
@@ -8,6 +8,7 @@
 #include "tstring.h"
 #include "Logging/Logger.h"
 #include "CommonUtilities/NameCache.h"
+#include "AssemblyProbePrepWorkers.h"
 
 #include <unordered_map>
 #include <vector>
@@ -36,34 +37,63 @@ typedef struct _COR_LIB_TYPE_TOKENS
 class AssemblyProbePrepData
 {
 public:
-    AssemblyProbePrepData(mdMemberRef probeMemberRef, mdSignature faultingProbeCallbackSignature, COR_LIB_TYPE_TOKENS corLibTypeTokens) :
-        m_probeMemberRef(probeMemberRef), m_faultingProbeCallbackSignature(faultingProbeCallbackSignature), m_corLibTypeTokens(corLibTypeTokens)
+    AssemblyProbePrepData(
+        mdMemberRef probeMemberRef,
+        mdMemberRef typedProbeMemberRef,
+        mdSignature faultingProbeCallbackSignature,
+        mdSignature latencyProbeEnterCallbackSignature,
+        mdSignature latencyProbeLeaveCallbackSignature,
+        COR_LIB_TYPE_TOKENS corLibTypeTokens) :
+        m_probeMemberRef(probeMemberRef),
+        m_typedProbeMemberRef(typedProbeMemberRef),
+        m_faultingProbeCallbackSignature(faultingProbeCallbackSignature),
+        m_latencyProbeEnterCallbackSignature(latencyProbeEnterCallbackSignature),
+        m_latencyProbeLeaveCallbackSignature(latencyProbeLeaveCallbackSignature),
+        m_corLibTypeTokens(corLibTypeTokens)
     {
     }
 
     const mdMemberRef GetProbeMemberRef() const { return m_probeMemberRef; }
+    // mdMemberRefNil if the probe assembly does not provide a typed probe.
+    const mdMemberRef GetTypedProbeMemberRef() const { return m_typedProbeMemberRef; }
     const mdSignature GetFaultingProbeCallbackSignature() const { return m_faultingProbeCallbackSignature; }
+    const mdSignature GetLatencyProbeEnterCallbackSignature() const { return m_latencyProbeEnterCallbackSignature; }
+    const mdSignature GetLatencyProbeLeaveCallbackSignature() const { return m_latencyProbeLeaveCallbackSignature; }
     const COR_LIB_TYPE_TOKENS& GetCorLibTypeTokens() const { return m_corLibTypeTokens; }
 
 private:
     mdMemberRef m_probeMemberRef;
+    mdMemberRef m_typedProbeMemberRef;
     mdSignature m_faultingProbeCallbackSignature;
+    mdSignature m_latencyProbeEnterCallbackSignature;
+    mdSignature m_latencyProbeLeaveCallbackSignature;
     COR_LIB_TYPE_TOKENS m_corLibTypeTokens;
 };
 
 typedef struct _PROBE_INFO_CACHE
 {
     tstring assemblyName;
+    tstring typeName;
+    tstring methodName;
     std::vector<BYTE> signature;
     std::vector<BYTE> publicKey;
     ASSEMBLYMETADATA assemblyMetadata;
     DWORD assemblyFlags;
+    bool hasTypedProbe;
 } PROBE_INFO_CACHE;
 
+//
+// Emits the references needed by probes into instrumented modules. Preparation data is cached per module for the
+// lifetime of the profiler. Not thread-safe; modules passed to PrepareAssembliesForProbes are prepared in parallel on the
+// shared workers, if any.
+// Without a probe function (0), only latency probes can use the prepared data: the probe member refs are nil.
+//
 class AssemblyProbePrep
 {
     private:
         ICorProfilerInfo12* m_pCorProfilerInfo;
+        // Not owned; may be null.
+        AssemblyProbePrepWorkers* m_pWorkers;
 
         NameCache m_nameCache;
 
@@ -79,11 +109,19 @@ class AssemblyProbePrep
     public:
         AssemblyProbePrep(
             ICorProfilerInfo12* profilerInfo,
-            FunctionID probeFunctionId);
+            FunctionID probeFunctionId,
+            AssemblyProbePrepWorkers* pWorkers);
 
         HRESULT PrepareAssemblyForProbes(
             ModuleID moduleId);
 
+        /// <summary>
+        /// Prepares every module that has not been prepared yet, spreading distinct modules across the workers.
+        /// Modules that were prepared successfully are cached even if another module fails.
+        /// </summary>
+        HRESULT PrepareAssembliesForProbes(
+            const std::vector<ModuleID>& moduleIds);
+
         bool TryGetAssemblyPrepData(
             ModuleID moduleId,
             std::shared_ptr<AssemblyProbePrepData>& data);
@@ -92,6 +130,10 @@ class AssemblyProbePrep
         HRESULT HydrateResolvedCorLib();
         HRESULT HydrateProbeMetadata();
 
+        HRESULT CreateAssemblyPrepData(
+            ModuleID moduleId,
+            std::shared_ptr<AssemblyProbePrepData>& data);
+
         HRESULT GetTokenForType(
             IMetaDataEmit* pMetadataEmit,
             mdToken resolutionScope,
@@ -100,11 +142,14 @@ class AssemblyProbePrep
 
         HRESULT EmitProbeReference(
             ModuleID moduleId,
-            mdMemberRef& probeMemberRef);
+            mdMemberRef& probeMemberRef,
+            mdMemberRef& typedProbeMemberRef);
 
-        HRESULT EmitFaultingProbeCallbackSignature(
+        HRESULT EmitCallbackSignature(
             ModuleID moduleId,
-            mdSignature& faultingProbeCallbackSignature);
+            PCCOR_SIGNATURE pCorSignature,
+            ULONG cbCorSignature,
+            mdSignature& callbackSignature);
 
         HRESULT EmitNecessaryCorLibTypeTokens(
             ModuleID moduleId,
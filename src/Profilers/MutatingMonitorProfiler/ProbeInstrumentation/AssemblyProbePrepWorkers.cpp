@@ -0,0 +1,136 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#include "AssemblyProbePrepWorkers.h"
+
+#include <algorithm>
+#include <system_error>
+
+using namespace std;
+
+AssemblyProbePrepWorkers::AssemblyProbePrepWorkers(ICorProfilerInfo12* profilerInfo) :
+    m_pCorProfilerInfo(profilerInfo),
+    m_didStart(false),
+    m_pJob(nullptr),
+    m_jobGeneration(0),
+    m_jobSlots(0),
+    m_busyWorkers(0),
+    m_stopped(false)
+{
+}
+
+AssemblyProbePrepWorkers::~AssemblyProbePrepWorkers()
+{
+    Shutdown();
+}
+
+void AssemblyProbePrepWorkers::Run(size_t workerCount, const function<void()>& job)
+{
+    lock_guard<mutex> runLock(m_runMutex);
+
+    if (!m_didStart)
+    {
+        m_didStart = true;
+        StartWorkers();
+    }
+
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_pJob = &job;
+        m_jobSlots = min(workerCount, m_threads.size());
+        m_jobGeneration++;
+    }
+    m_jobCondition.notify_all();
+
+    job();
+
+    unique_lock<mutex> lock(m_mutex);
+    // The job has run out of work on this thread, so workers that have not joined yet have nothing left to do.
+    m_jobSlots = 0;
+    m_doneCondition.wait(lock, [this]() { return m_busyWorkers == 0; });
+    m_pJob = nullptr;
+}
+
+void AssemblyProbePrepWorkers::Shutdown()
+{
+    lock_guard<mutex> runLock(m_runMutex);
+
+    // Later batches run on the calling thread only.
+    m_didStart = true;
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_stopped = true;
+    }
+    m_jobCondition.notify_all();
+
+    for (thread& worker : m_threads)
+    {
+        worker.join();
+    }
+    m_threads.clear();
+}
+
+void AssemblyProbePrepWorkers::StartWorkers()
+{
+    // The calling thread always takes part, so it counts against the hardware threads.
+    size_t workerCount = MaxWorkers;
+    unsigned int hardwareThreads = thread::hardware_concurrency();
+    if (hardwareThreads != 0)
+    {
+        workerCount = min(workerCount, static_cast<size_t>(hardwareThreads - 1));
+    }
+
+    try
+    {
+        m_threads.reserve(workerCount);
+        for (size_t i = 0; i < workerCount; i++)
+        {
+            m_threads.emplace_back(&AssemblyProbePrepWorkers::WorkerThread, this);
+        }
+    }
+    catch (const bad_alloc&)
+    {
+        // Run with the workers that did start.
+    }
+    catch (const system_error&)
+    {
+    }
+}
+
+void AssemblyProbePrepWorkers::WorkerThread()
+{
+    // A worker that cannot call into the runtime never takes a job; the others, and the calling thread, do its share.
+    if (FAILED(m_pCorProfilerInfo->InitializeCurrentThread()))
+    {
+        return;
+    }
+
+    unique_lock<mutex> lock(m_mutex);
+    UINT64 seenGeneration = 0;
+    while (true)
+    {
+        m_jobCondition.wait(lock, [this, &seenGeneration]()
+        {
+            return m_stopped || (m_jobGeneration != seenGeneration && m_jobSlots > 0);
+        });
+
+        if (m_stopped)
+        {
+            return;
+        }
+
+        seenGeneration = m_jobGeneration;
+        m_jobSlots--;
+        m_busyWorkers++;
+        const function<void()>* pJob = m_pJob;
+
+        lock.unlock();
+        (*pJob)();
+        lock.lock();
+
+        if (--m_busyWorkers == 0)
+        {
+            m_doneCondition.notify_all();
+        }
+    }
+}
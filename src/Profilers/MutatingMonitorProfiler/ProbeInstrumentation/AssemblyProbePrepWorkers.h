@@ -0,0 +1,57 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#pragma once
+
+#include "cor.h"
+#include "corprof.h"
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//
+// Long-lived threads that help AssemblyProbePrep prepare several modules at once. The threads are created and
+// initialized with the runtime the first time they are needed, and are reused for every later batch until Shutdown.
+//
+class AssemblyProbePrepWorkers
+{
+    private:
+        ICorProfilerInfo12* m_pCorProfilerInfo;
+
+        // Serializes Run; a batch has the workers to itself.
+        std::mutex m_runMutex;
+
+        std::vector<std::thread> m_threads;
+        bool m_didStart;
+
+        std::mutex m_mutex;
+        std::condition_variable m_jobCondition;
+        std::condition_variable m_doneCondition;
+        const std::function<void()>* m_pJob;
+        UINT64 m_jobGeneration;
+        // Workers that may still join the current job.
+        size_t m_jobSlots;
+        size_t m_busyWorkers;
+        bool m_stopped;
+
+    public:
+        static const size_t MaxWorkers = 3;
+
+        AssemblyProbePrepWorkers(ICorProfilerInfo12* profilerInfo);
+        ~AssemblyProbePrepWorkers();
+
+        /// <summary>
+        /// Runs the job on the calling thread and on up to workerCount workers, and returns once every copy has returned.
+        /// The job must not throw. Without workers (they could not be started, or after Shutdown) it only runs on the calling thread.
+        /// </summary>
+        void Run(size_t workerCount, const std::function<void()>& job);
+
+        void Shutdown();
+
+    private:
+        void StartWorkers();
+        void WorkerThread();
+};
@@ -4,6 +4,40 @@
 #pragma once
 
 #include "cor.h"
+#include "tstring.h"
 
 typedef void (STDMETHODCALLTYPE *FaultingProbeCallback)(ULONG64);
 constexpr COR_SIGNATURE FaultingProbeCallbackCorSignature [] = { IMAGE_CEE_CS_CALLCONV_STDCALL, 0x01, ELEMENT_TYPE_VOID, ELEMENT_TYPE_I8 };
+
+//
+// Optional non-boxing probe, defined on the same type as the registered probe:
+// static void EnterProbeStubTyped(nint primitiveArgs, ulong uniquifier, object[] args)
+//
+// primitiveArgs points to one 8-byte slot per parameter; primitive parameters are stored in their slot
+// (zero/sign-extended integers, or a double for floating point) and their entry in args is unused.
+// args is null when every supported parameter is primitive.
+//
+constexpr LPCWSTR TypedProbeName = _T("EnterProbeStubTyped");
+constexpr COR_SIGNATURE TypedProbeCorSignature [] = { IMAGE_CEE_CS_CALLCONV_DEFAULT, 0x03, ELEMENT_TYPE_VOID, ELEMENT_TYPE_I, ELEMENT_TYPE_U8, ELEMENT_TYPE_SZARRAY, ELEMENT_TYPE_OBJECT };
+constexpr ULONG TypedProbeSlotSize = sizeof(UINT64);
+
+//
+// Latency probes, called through calli on entry to and on every exit from a timed method:
+// INT64 start = (*pLatencyProbeEnterCallback)();
+// try { ... } finally { (*pLatencyProbeLeaveCallback)(pLatencyHistogram, start); }
+//
+typedef INT64 (STDMETHODCALLTYPE *LatencyProbeEnterCallback)();
+constexpr COR_SIGNATURE LatencyProbeEnterCallbackCorSignature [] = { IMAGE_CEE_CS_CALLCONV_STDCALL, 0x00, ELEMENT_TYPE_I8 };
+
+class LatencyHistogram;
+typedef void (STDMETHODCALLTYPE *LatencyProbeLeaveCallback)(LatencyHistogram*, INT64);
+constexpr COR_SIGNATURE LatencyProbeLeaveCallbackCorSignature [] = { IMAGE_CEE_CS_CALLCONV_STDCALL, 0x02, ELEMENT_TYPE_VOID, ELEMENT_TYPE_I, ELEMENT_TYPE_I8 };
+
+//
+// Probe overhead counters time the registered probe call with the same callback shapes as the latency probes:
+// INT64 start = (*pLatencyProbeEnterCallback)();
+// try { <probe> } catch { ... }
+// (*pProbeOverheadLeaveCallback)(pOverheadCounters, start);
+//
+class ProbeOverheadCounters;
+typedef void (STDMETHODCALLTYPE *ProbeOverheadLeaveCallback)(ProbeOverheadCounters*, INT64);
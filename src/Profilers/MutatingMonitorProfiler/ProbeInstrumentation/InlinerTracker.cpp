@@ -0,0 +1,342 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#include "corhlpr.h"
+#include "macros.h"
+#include "com.h"
+#include "InlinerTracker.h"
+#include "CommonUtilities/HashUtilities.h"
+
+using namespace std;
+
+#define ENUM_BUFFER_SIZE 10
+
+InlinerTracker::InlinerTracker(const shared_ptr<ILogger>& logger, ICorProfilerInfo12* profilerInfo) :
+    m_pCorProfilerInfo(profilerInfo),
+    m_pLogger(logger)
+{
+    for (atomic<ModuleID>& entry : m_moduleEligibility)
+    {
+        entry.store(0, memory_order_relaxed);
+    }
+}
+
+HRESULT InlinerTracker::OnJITInlining(FunctionID callerId, FunctionID calleeId, BOOL* pfShouldInline)
+{
+    HRESULT hr;
+
+    ExpectedPtr(pfShouldInline);
+
+    pair<ModuleID, mdMethodDef> callee;
+    IfFailRet(m_pCorProfilerInfo->GetFunctionInfo2(
+        calleeId,
+        NULL,
+        nullptr,
+        &callee.first,
+        &callee.second,
+        0,
+        nullptr,
+        nullptr));
+
+    // Never probed, so never blocked.
+    bool isEligible;
+    IfFailRet(IsEligibleModule(callee.first, isEligible));
+    if (!isEligible)
+    {
+        return S_OK;
+    }
+
+    pair<ModuleID, mdMethodDef> caller;
+    IfFailRet(m_pCorProfilerInfo->GetFunctionInfo2(
+        callerId,
+        NULL,
+        nullptr,
+        &caller.first,
+        &caller.second,
+        0,
+        nullptr,
+        nullptr));
+
+    bool isCallerEligible = true;
+    if (caller.first != callee.first)
+    {
+        IfFailRet(IsEligibleModule(caller.first, isCallerEligible));
+    }
+
+    START_NO_OOM_THROW_REGION;
+
+    InlinerShard& shard = GetShard(callee);
+    lock_guard<mutex> lock(shard.mutex);
+
+    if (shard.blockedMethods.find(callee) != shard.blockedMethods.end())
+    {
+        *pfShouldInline = FALSE;
+        return S_OK;
+    }
+
+    if (isCallerEligible)
+    {
+        shard.inliners[callee].insert(caller);
+    }
+
+    END_NO_OOM_THROW_REGION;
+
+    return S_OK;
+}
+
+void InlinerTracker::OnModuleUnloadStarted(ModuleID moduleId)
+{
+    atomic<ModuleID>& entry = m_moduleEligibility[HashUtilities::Mix(moduleId) & (ModuleCacheSize - 1)];
+    ModuleID cachedModuleId = entry.load(memory_order_relaxed);
+    if ((cachedModuleId & ~ModuleFlagsMask) == moduleId)
+    {
+        entry.compare_exchange_strong(cachedModuleId, 0, memory_order_relaxed);
+    }
+
+    lock_guard<mutex> lock(m_mutex);
+
+    // Unloads are rare, so every shard is scanned rather than indexing the methods by module.
+    for (InlinerShard& shard : m_shards)
+    {
+        lock_guard<mutex> shardLock(shard.mutex);
+
+        for (auto it = shard.inliners.begin(); it != shard.inliners.end();)
+        {
+            if (it->first.first == moduleId)
+            {
+                it = shard.inliners.erase(it);
+                continue;
+            }
+
+            MethodSet& inliners = it->second;
+            for (auto inlinerIt = inliners.begin(); inlinerIt != inliners.end();)
+            {
+                inlinerIt = inlinerIt->first == moduleId ? inliners.erase(inlinerIt) : std::next(inlinerIt);
+            }
+            it = inliners.empty() ? shard.inliners.erase(it) : std::next(it);
+        }
+
+        for (auto it = shard.blockedMethods.begin(); it != shard.blockedMethods.end();)
+        {
+            it = it->first == moduleId ? shard.blockedMethods.erase(it) : std::next(it);
+        }
+    }
+
+    for (auto it = m_blockedMethods.begin(); it != m_blockedMethods.end();)
+    {
+        if (it->first.first != moduleId)
+        {
+            ++it;
+            continue;
+        }
+
+        for (auto const& inliner : it->second)
+        {
+            auto const& inlinerIt = m_rejittedInliners.find(inliner);
+            if (inlinerIt != m_rejittedInliners.end() && --inlinerIt->second == 0)
+            {
+                m_rejittedInliners.erase(inlinerIt);
+            }
+        }
+        it = m_blockedMethods.erase(it);
+    }
+
+    for (auto it = m_rejittedInliners.begin(); it != m_rejittedInliners.end();)
+    {
+        it = it->first.first == moduleId ? m_rejittedInliners.erase(it) : std::next(it);
+    }
+}
+
+HRESULT InlinerTracker::BlockInlining(
+    const vector<pair<ModuleID, mdMethodDef>>& methods,
+    vector<pair<ModuleID, mdMethodDef>>& inliners)
+{
+    HRESULT hr;
+
+    START_NO_OOM_THROW_REGION;
+
+    lock_guard<mutex> lock(m_mutex);
+
+    vector<ModuleID> moduleIds;
+    bool enumeratedModules = false;
+
+    MethodSet newInliners;
+    for (auto const& method : methods)
+    {
+        if (m_blockedMethods.find(method) != m_blockedMethods.end())
+        {
+            continue;
+        }
+
+        // Only needed once some method is blocked.
+        if (!enumeratedModules)
+        {
+            ComPtr<ICorProfilerModuleEnum> pEnum;
+            IfFailRet(m_pCorProfilerInfo->EnumModules(&pEnum));
+
+            ModuleID moduleId;
+            while (pEnum->Next(1, &moduleId, NULL) == S_OK)
+            {
+                moduleIds.push_back(moduleId);
+            }
+            enumeratedModules = true;
+        }
+
+        // Blocked in the same step that the inliners are read, so that no inliner is recorded after it.
+        MethodSet methodInliners;
+        {
+            InlinerShard& shard = GetShard(method);
+            lock_guard<mutex> shardLock(shard.mutex);
+
+            auto const& it = shard.inliners.find(method);
+            if (it != shard.inliners.end())
+            {
+                methodInliners = it->second;
+            }
+            shard.blockedMethods.insert(method);
+        }
+        IfFailRet(AddPrecompiledInliners(moduleIds, method, methodInliners));
+
+        // A recursive method is rejitted for its own probe.
+        methodInliners.erase(method);
+
+        vector<pair<ModuleID, mdMethodDef>>& rejittedInliners = m_blockedMethods[method];
+        rejittedInliners.assign(methodInliners.begin(), methodInliners.end());
+        for (auto const& inliner : rejittedInliners)
+        {
+            m_rejittedInliners[inliner]++;
+            newInliners.insert(inliner);
+        }
+    }
+
+    inliners.assign(newInliners.begin(), newInliners.end());
+
+    END_NO_OOM_THROW_REGION;
+
+    return S_OK;
+}
+
+HRESULT InlinerTracker::UnblockInlining(
+    const vector<pair<ModuleID, mdMethodDef>>& methods,
+    vector<pair<ModuleID, mdMethodDef>>& inliners)
+{
+    START_NO_OOM_THROW_REGION;
+
+    lock_guard<mutex> lock(m_mutex);
+
+    inliners.clear();
+    for (auto const& method : methods)
+    {
+        {
+            InlinerShard& shard = GetShard(method);
+            lock_guard<mutex> shardLock(shard.mutex);
+            shard.blockedMethods.erase(method);
+        }
+
+        auto const& it = m_blockedMethods.find(method);
+        if (it == m_blockedMethods.end())
+        {
+            continue;
+        }
+
+        for (auto const& inliner : it->second)
+        {
+            auto const& inlinerIt = m_rejittedInliners.find(inliner);
+            if (inlinerIt != m_rejittedInliners.end() && --inlinerIt->second == 0)
+            {
+                m_rejittedInliners.erase(inlinerIt);
+                inliners.push_back(inliner);
+            }
+        }
+
+        m_blockedMethods.erase(it);
+    }
+
+    END_NO_OOM_THROW_REGION;
+
+    return S_OK;
+}
+
+bool InlinerTracker::IsRejittedInliner(const pair<ModuleID, mdMethodDef>& method)
+{
+    lock_guard<mutex> lock(m_mutex);
+
+    return m_rejittedInliners.find(method) != m_rejittedInliners.end();
+}
+
+InlinerTracker::InlinerShard& InlinerTracker::GetShard(const pair<ModuleID, mdMethodDef>& method)
+{
+    return m_shards[HashUtilities::Mix(static_cast<UINT64>(method.first) ^ HashUtilities::Mix(method.second)) & (ShardCount - 1)];
+}
+
+HRESULT InlinerTracker::IsEligibleModule(ModuleID moduleId, bool& isEligible)
+{
+    HRESULT hr;
+
+    atomic<ModuleID>& entry = m_moduleEligibility[HashUtilities::Mix(moduleId) & (ModuleCacheSize - 1)];
+    ModuleID cachedModuleId = entry.load(memory_order_relaxed);
+    if ((cachedModuleId & ~ModuleFlagsMask) == moduleId)
+    {
+        isEligible = (cachedModuleId & EligibleModuleFlag) != 0;
+        return S_OK;
+    }
+
+    DWORD moduleFlags = 0;
+    IfFailRet(m_pCorProfilerInfo->GetModuleInfo2(
+        moduleId,
+        nullptr,
+        0,
+        nullptr,
+        nullptr,
+        nullptr,
+        &moduleFlags));
+
+    // Dynamic modules can't be rejitted, and resource modules have no code.
+    isEligible = (moduleFlags & (COR_PRF_MODULE_DYNAMIC | COR_PRF_MODULE_RESOURCE)) == 0;
+    entry.store(moduleId | (isEligible ? EligibleModuleFlag : IneligibleModuleFlag), memory_order_relaxed);
+
+    return S_OK;
+}
+
+HRESULT InlinerTracker::AddPrecompiledInliners(
+    const vector<ModuleID>& moduleIds,
+    const pair<ModuleID, mdMethodDef>& method,
+    MethodSet& inliners)
+{
+    for (ModuleID inlinersModuleId : moduleIds)
+    {
+        BOOL incompleteData = FALSE;
+        ComPtr<ICorProfilerMethodEnum> pEnum;
+
+        // Fails for modules without precompiled code.
+        if (FAILED(m_pCorProfilerInfo->EnumNgenModuleMethodsInliningThisMethod(
+            inlinersModuleId,
+            method.first,
+            method.second,
+            &incompleteData,
+            &pEnum)) ||
+            pEnum == nullptr)
+        {
+            continue;
+        }
+
+        if (incompleteData)
+        {
+            m_pLogger->Log(LogLevel::Debug, _LS("Incomplete inlining data - moduleId: 0x%08x"), inlinersModuleId);
+        }
+
+        COR_PRF_METHOD inlinerMethods[ENUM_BUFFER_SIZE];
+        HRESULT hr;
+        do
+        {
+            ULONG count = 0;
+            hr = pEnum->Next(ENUM_BUFFER_SIZE, inlinerMethods, &count);
+            for (ULONG i = 0; SUCCEEDED(hr) && i < count; i++)
+            {
+                inliners.insert({inlinerMethods[i].moduleId, inlinerMethods[i].methodId});
+            }
+        } while (hr == S_OK);
+    }
+
+    return S_OK;
+}
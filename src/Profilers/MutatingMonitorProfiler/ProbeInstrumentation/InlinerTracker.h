@@ -0,0 +1,109 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#pragma once
+
+#include "cor.h"
+#include "corprof.h"
+#include "Logging/Logger.h"
+#include "CommonUtilities/PairHash.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+//
+// Records which callers inlined which methods, so that inlining of probed methods is blocked only while they are probed
+// instead of for the rest of the process (COR_PRF_REJIT_BLOCK_INLINING).
+//
+// Jitted inliners are observed through JITInlining, which is also where inlining of blocked methods is denied.
+// Precompiled inliners are read from the inlining data of the loaded ReadyToRun images when a method is blocked.
+//
+// Only methods in modules that can be rejitted are recorded: a method in a dynamic or resource module can never be
+// probed, and an inliner in one could not be rejitted. Everything recorded for a module is dropped when it unloads.
+//
+class InlinerTracker
+{
+    private:
+        typedef std::unordered_set<std::pair<ModuleID, mdMethodDef>, PairHash<ModuleID, mdMethodDef>> MethodSet;
+
+        //
+        // The inlining callbacks arrive on every jitting thread, so the methods are split across shards by callee
+        // and a callback only locks the callee's shard.
+        //
+        struct InlinerShard
+        {
+            std::mutex mutex;
+            // Callers that have inlined each method.
+            std::unordered_map<std::pair<ModuleID, mdMethodDef>, MethodSet, PairHash<ModuleID, mdMethodDef>> inliners;
+            // The blocked methods of the shard, denied in the inlining callback.
+            MethodSet blockedMethods;
+        };
+
+        static const size_t ShardCount = 16;
+        static const size_t ModuleCacheSize = 64;
+
+        // Low bits of a cached module id, which is aligned.
+        static const ModuleID EligibleModuleFlag = 0x1;
+        static const ModuleID IneligibleModuleFlag = 0x2;
+        static const ModuleID ModuleFlagsMask = EligibleModuleFlag | IneligibleModuleFlag;
+
+        ICorProfilerInfo12* m_pCorProfilerInfo;
+        std::shared_ptr<ILogger> m_pLogger;
+
+        InlinerShard m_shards[ShardCount];
+
+        // Whether recently seen modules can be rejitted, so that the callbacks rarely have to ask the runtime.
+        // Each entry is a module id tagged with one of the module flags, or 0.
+        std::atomic<ModuleID> m_moduleEligibility[ModuleCacheSize];
+
+        // Guards the blocked and rejitted methods below. Taken before any shard.
+        std::mutex m_mutex;
+
+        // Methods that must not be inlined, with the inliners that were rejitted for each.
+        std::unordered_map<std::pair<ModuleID, mdMethodDef>, std::vector<std::pair<ModuleID, mdMethodDef>>, PairHash<ModuleID, mdMethodDef>> m_blockedMethods;
+
+        // Rejitted inliners, with the number of blocked methods each was rejitted for.
+        std::unordered_map<std::pair<ModuleID, mdMethodDef>, ULONG, PairHash<ModuleID, mdMethodDef>> m_rejittedInliners;
+
+    public:
+        InlinerTracker(
+            const std::shared_ptr<ILogger>& logger,
+            ICorProfilerInfo12* profilerInfo);
+
+        HRESULT OnJITInlining(FunctionID callerId, FunctionID calleeId, BOOL* pfShouldInline);
+
+        /// <summary>
+        /// Forgets every method of the module, since its id can be reused by a module loaded later.
+        /// </summary>
+        void OnModuleUnloadStarted(ModuleID moduleId);
+
+        /// <summary>
+        /// Blocks inlining of the methods, and gets the callers that inlined them and must be rejitted.
+        /// Methods that are already blocked are ignored.
+        /// </summary>
+        HRESULT BlockInlining(
+            const std::vector<std::pair<ModuleID, mdMethodDef>>& methods,
+            std::vector<std::pair<ModuleID, mdMethodDef>>& inliners);
+
+        /// <summary>
+        /// Allows the methods to be inlined again, and gets the rejitted inliners that no longer call a blocked method
+        /// and can be reverted.
+        /// </summary>
+        HRESULT UnblockInlining(
+            const std::vector<std::pair<ModuleID, mdMethodDef>>& methods,
+            std::vector<std::pair<ModuleID, mdMethodDef>>& inliners);
+
+        bool IsRejittedInliner(const std::pair<ModuleID, mdMethodDef>& method);
+
+    private:
+        InlinerShard& GetShard(const std::pair<ModuleID, mdMethodDef>& method);
+        HRESULT IsEligibleModule(ModuleID moduleId, bool& isEligible);
+        HRESULT AddPrecompiledInliners(
+            const std::vector<ModuleID>& moduleIds,
+            const std::pair<ModuleID, mdMethodDef>& method,
+            MethodSet& inliners);
+};
@@ -0,0 +1,41 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#include "LatencyEventProvider.h"
+#include "corhlpr.h"
+#include "cor.h"
+
+const WCHAR* LatencyEventProvider::ProviderName = _T("DotnetMonitorFunctionLatencyEventProvider");
+
+HRESULT LatencyEventProvider::CreateProvider(ICorProfilerInfo12* profilerInfo, std::unique_ptr<LatencyEventProvider>& eventProvider)
+{
+    std::unique_ptr<ProfilerEventProvider> provider;
+    HRESULT hr;
+
+    IfFailRet(ProfilerEventProvider::CreateProvider(ProviderName, profilerInfo, provider));
+
+    eventProvider = std::unique_ptr<LatencyEventProvider>(new LatencyEventProvider(profilerInfo, provider));
+    IfFailRet(eventProvider->DefineEvents());
+
+    return S_OK;
+}
+
+HRESULT LatencyEventProvider::DefineEvents()
+{
+    HRESULT hr;
+
+    IfFailRet(_provider->DefineEvent(_T("LatencyHistogram"), _latencyHistogramEvent, LatencyHistogramPayloads));
+
+    return S_OK;
+}
+
+HRESULT LatencyEventProvider::WriteLatencyHistogram(FunctionID functionId, const LATENCY_HISTOGRAM_SNAPSHOT& snapshot)
+{
+    return _latencyHistogramEvent->WritePayload(
+        static_cast<UINT64>(functionId),
+        snapshot.count,
+        snapshot.sum,
+        snapshot.max,
+        snapshot.bucketLowerBounds,
+        snapshot.bucketCounts);
+}
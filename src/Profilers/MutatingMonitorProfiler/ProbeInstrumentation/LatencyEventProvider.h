@@ -0,0 +1,38 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#pragma once
+
+#include "EventProvider/ProfilerEventProvider.h"
+#include "LatencyHistogram.h"
+#include <memory>
+#include <vector>
+
+/// <summary>
+/// Writes the latency histograms of methods instrumented with latency probes.
+/// Each event covers the calls that completed since the previous event for the same function.
+/// </summary>
+class LatencyEventProvider
+{
+    public:
+        static HRESULT CreateProvider(ICorProfilerInfo12* profilerInfo, std::unique_ptr<LatencyEventProvider>& eventProvider);
+
+        HRESULT WriteLatencyHistogram(FunctionID functionId, const LATENCY_HISTOGRAM_SNAPSHOT& snapshot);
+
+    private:
+        LatencyEventProvider(ICorProfilerInfo12* profilerInfo, std::unique_ptr<ProfilerEventProvider> & eventProvider) :
+            _profilerInfo(profilerInfo), _provider(std::move(eventProvider))
+        {
+        }
+
+        static const WCHAR* ProviderName;
+
+        HRESULT DefineEvents();
+
+        ComPtr<ICorProfilerInfo12> _profilerInfo;
+        std::unique_ptr<ProfilerEventProvider> _provider;
+
+        //Durations are in nanoseconds. BucketLowerBounds and BucketCounts only include non-empty buckets.
+        const WCHAR* LatencyHistogramPayloads[6] = { _T("FunctionId"), _T("Count"), _T("Sum"), _T("Max"), _T("BucketLowerBounds"), _T("BucketCounts") };
+        std::unique_ptr<ProfilerEvent<UINT64, UINT64, UINT64, UINT64, std::vector<UINT64>, std::vector<UINT64>>> _latencyHistogramEvent;
+};
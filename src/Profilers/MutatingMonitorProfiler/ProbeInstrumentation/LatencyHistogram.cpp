@@ -0,0 +1,118 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#include "LatencyHistogram.h"
+#include "CallbackDefinitions.h"
+
+#include <chrono>
+#include <type_traits>
+
+using namespace std;
+
+static_assert(std::is_same<decltype(&LatencyHistogram::OnEnter), LatencyProbeEnterCallback>::value, "OnEnter must match LatencyProbeEnterCallback");
+static_assert(std::is_same<decltype(&LatencyHistogram::OnLeave), LatencyProbeLeaveCallback>::value, "OnLeave must match LatencyProbeLeaveCallback");
+
+LatencyHistogram::LatencyHistogram(FunctionID functionId) :
+    m_functionId(functionId),
+    m_sum(0),
+    m_max(0)
+{
+    for (atomic<UINT64>& bucket : m_buckets)
+    {
+        bucket.store(0, memory_order_relaxed);
+    }
+}
+
+void LatencyHistogram::Record(UINT64 nanoseconds)
+{
+    m_buckets[GetBucketIndex(nanoseconds)].fetch_add(1, memory_order_relaxed);
+    m_sum.fetch_add(nanoseconds, memory_order_relaxed);
+
+    UINT64 max = m_max.load(memory_order_relaxed);
+    while (nanoseconds > max && !m_max.compare_exchange_weak(max, nanoseconds, memory_order_relaxed))
+    {
+    }
+}
+
+bool LatencyHistogram::Drain(LATENCY_HISTOGRAM_SNAPSHOT& snapshot)
+{
+    snapshot.count = 0;
+    snapshot.bucketLowerBounds.clear();
+    snapshot.bucketCounts.clear();
+
+    for (UINT32 i = 0; i < BucketCount; i++)
+    {
+        // Cheap check first so that idle buckets are never written to.
+        if (m_buckets[i].load(memory_order_relaxed) == 0)
+        {
+            continue;
+        }
+
+        UINT64 count = m_buckets[i].exchange(0, memory_order_relaxed);
+        if (count == 0)
+        {
+            continue;
+        }
+
+        snapshot.count += count;
+        snapshot.bucketLowerBounds.push_back(GetBucketLowerBound(i));
+        snapshot.bucketCounts.push_back(count);
+    }
+
+    snapshot.sum = m_sum.exchange(0, memory_order_relaxed);
+    snapshot.max = m_max.exchange(0, memory_order_relaxed);
+
+    return snapshot.count != 0;
+}
+
+INT64 STDMETHODCALLTYPE LatencyHistogram::OnEnter()
+{
+    //
+    // This is called on entry to every timed method; keep it to a clock read.
+    //
+    return static_cast<INT64>(chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void STDMETHODCALLTYPE LatencyHistogram::OnLeave(LatencyHistogram* pHistogram, INT64 startTimestamp)
+{
+    INT64 now = OnEnter();
+    pHistogram->Record(now > startTimestamp ? static_cast<UINT64>(now - startTimestamp) : 0);
+}
+
+UINT32 LatencyHistogram::GetBucketIndex(UINT64 value)
+{
+    if (value < SubBucketCount)
+    {
+        return static_cast<UINT32>(value);
+    }
+
+    // Keep the SubBucketBits bits below the highest set bit; the rest only select the power of two.
+    UINT32 shift = GetHighestSetBit(value) - SubBucketBits;
+    return (shift + 1) * SubBucketCount + static_cast<UINT32>((value >> shift) - SubBucketCount);
+}
+
+UINT64 LatencyHistogram::GetBucketLowerBound(UINT32 index)
+{
+    if (index < SubBucketCount)
+    {
+        return index;
+    }
+
+    UINT32 shift = index / SubBucketCount - 1;
+    return static_cast<UINT64>(SubBucketCount + index % SubBucketCount) << shift;
+}
+
+UINT32 LatencyHistogram::GetHighestSetBit(UINT64 value)
+{
+    UINT32 bit = 0;
+    for (UINT32 width = 32; width > 0; width /= 2)
+    {
+        if (value >= (static_cast<UINT64>(1) << width))
+        {
+            value >>= width;
+            bit += width;
+        }
+    }
+    return bit;
+}
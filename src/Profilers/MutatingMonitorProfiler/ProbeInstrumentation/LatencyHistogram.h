@@ -0,0 +1,64 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#pragma once
+
+#include "cor.h"
+#include "corprof.h"
+
+#include <atomic>
+#include <vector>
+
+typedef struct _LATENCY_HISTOGRAM_SNAPSHOT
+{
+    UINT64 count;
+    UINT64 sum;
+    UINT64 max;
+
+    // Only buckets with at least one value; each bucket ends where the next possible bucket begins.
+    std::vector<UINT64> bucketLowerBounds;
+    std::vector<UINT64> bucketCounts;
+} LATENCY_HISTOGRAM_SNAPSHOT;
+
+//
+// Lock-free log-linear (HDR-style) histogram of a method's latency, in nanoseconds.
+//
+// Values below SubBucketCount are counted exactly. Larger values fall into one of SubBucketCount linear
+// sub-buckets per power of two, so a bucket is never wider than 1/SubBucketCount of its lower bound.
+// Recording only performs relaxed atomic updates and never allocates, so it is safe on any application thread.
+//
+class LatencyHistogram
+{
+    private:
+        static const UINT32 SubBucketBits = 3;
+        static const UINT32 SubBucketCount = 1 << SubBucketBits;
+        static const UINT32 BucketCount = (64 - SubBucketBits + 1) * SubBucketCount;
+
+        FunctionID m_functionId;
+
+        std::atomic<UINT64> m_buckets[BucketCount];
+        std::atomic<UINT64> m_sum;
+        std::atomic<UINT64> m_max;
+
+    public:
+        LatencyHistogram(FunctionID functionId);
+
+        FunctionID GetFunctionId() const { return m_functionId; }
+
+        void Record(UINT64 nanoseconds);
+
+        //
+        // Moves the recorded values into the snapshot and resets the histogram.
+        // Returns false if nothing was recorded since the last drain.
+        // A value recorded concurrently may have its count and sum reported in different snapshots.
+        //
+        bool Drain(LATENCY_HISTOGRAM_SNAPSHOT& snapshot);
+
+        static INT64 STDMETHODCALLTYPE OnEnter();
+        static void STDMETHODCALLTYPE OnLeave(LatencyHistogram* pHistogram, INT64 startTimestamp);
+
+    private:
+        static UINT32 GetBucketIndex(UINT64 value);
+        static UINT64 GetBucketLowerBound(UINT32 index);
+        static UINT32 GetHighestSetBit(UINT64 value);
+};
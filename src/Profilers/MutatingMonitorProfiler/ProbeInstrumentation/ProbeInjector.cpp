@@ -5,7 +5,6 @@
 #include "corprof.h"
 #include "macros.h"
 #include "ProbeInjector.h"
-#include "../Utilities/ILRewriter.h"
 
 #include <vector>
 
@@ -16,7 +15,6 @@ HRESULT ProbeInjector::InstallProbe(
     const INSTRUMENTATION_REQUEST& request)
 {
     ExpectedPtr(pICorProfilerInfo);
-    ExpectedPtr(pICorProfilerFunctionControl);
     ExpectedPtr(pFaultingProbeCallback);
 
     if (request.boxingInstructions.size() > UINT32_MAX)
@@ -24,20 +22,63 @@ HRESULT ProbeInjector::InstallProbe(
         return E_INVALIDARG;
     }
 
-    constexpr OPCODE CEE_LDC_NATIVE_I = sizeof(size_t) == 8 ? CEE_LDC_I8 : CEE_LDC_I4;
-
     HRESULT hr;
+    bool isTimed = true;
 
     START_NO_OOM_THROW_REGION;
 
-    ILRewriter rewriter(pICorProfilerInfo, pICorProfilerFunctionControl, request.moduleId, request.methodDef);
+    ProfilerILRewriter rewriter(pICorProfilerInfo, pICorProfilerFunctionControl, request.moduleId, request.methodDef);
     IfFailRet(rewriter.Import());
 
+    //
+    // The latency probes wrap the original code, and the argument probe runs before them
+    // so that capturing arguments does not count towards the method's latency.
+    //
+
+    if (request.pLatencyHistogram != nullptr ||
+        (request.captureArguments && request.pOverheadCounters != nullptr))
+    {
+        // Needed to add locals.
+        IfFailRet(rewriter.Initialize());
+    }
+
+    if (request.pLatencyHistogram != nullptr)
+    {
+        IfFailRet(EmitLatencyProbes(rewriter, request));
+        isTimed = (hr == S_OK);
+    }
+
+    if (request.captureArguments)
+    {
+        IfFailRet(EmitArgumentProbe(rewriter, pFaultingProbeCallback, request));
+    }
+
+    IfFailRet(rewriter.Export());
+
+    END_NO_OOM_THROW_REGION;
+
+    return isTimed ? S_OK : S_FALSE;
+}
+
+HRESULT ProbeInjector::EmitArgumentProbe(
+    ILRewriter& rewriter,
+    FaultingProbeCallback pFaultingProbeCallback,
+    const INSTRUMENTATION_REQUEST& request)
+{
+    HRESULT hr;
+
+    constexpr OPCODE CEE_LDC_NATIVE_I = sizeof(size_t) == 8 ? CEE_LDC_I8 : CEE_LDC_I4;
+    constexpr COR_SIGNATURE TimestampLocalType[] = { ELEMENT_TYPE_I8 };
+
     const COR_LIB_TYPE_TOKENS& corLibTypeTokens = request.pAssemblyData->GetCorLibTypeTokens();
 
     ILInstr* pInsertProbeBeforeThisInstr = rewriter.GetILList()->m_pNext;
     ILInstr* pNewInstr = nullptr;
 
+    // Where the probe's protected regions leave to: the original code, or the overhead counters' leave call.
+    ILInstr* pProbeEnd = pInsertProbeBeforeThisInstr;
+    unsigned startLocal = 0;
+
     ILInstr* pTryBegin = nullptr;
     ILInstr* pCatchBegin = nullptr;
     ILInstr* pCatchEnd = nullptr;
@@ -47,8 +88,6 @@ HRESULT ProbeInjector::InstallProbe(
     ILInstr* pNestedCatchBegin = nullptr;
     ILInstr* pNestedCatchEnd = nullptr;
 
-    UINT32 numArgs = static_cast<UINT32>(request.boxingInstructions.size());
-
     //
     // The below IL is equivalent to:
     // try {
@@ -60,98 +99,63 @@ HRESULT ProbeInjector::InstallProbe(
     //   }
     // }
     //
+    // With overhead counters, the above is preceded by "INT64 start = (*pLatencyProbeEnterCallback)();"
+    // and followed by "(*pProbeOverheadLeaveCallback)(pOverheadCounters, start);".
+    //
     // When an argument isn't supported, pass null in its place.
+    // If the probe assembly provides a typed probe, it is called instead so that primitive arguments
+    // are neither boxed nor stored in an array (see EmitTypedProbeCall).
     //
 
-    // START: Try block
-
-    /* uniquifier */
-    pTryBegin = rewriter.NewILInstr();
-    pTryBegin->m_opcode = CEE_LDC_I8;
-    pTryBegin->m_Arg64 = request.uniquifier;
-    rewriter.InsertBefore(pInsertProbeBeforeThisInstr, pTryBegin);
-
-    /* Args */
-
-    // Size of array
-    pNewInstr = rewriter.NewILInstr();
-    pNewInstr->m_opcode = CEE_LDC_I4;
-    pNewInstr->m_Arg32 = numArgs;
-    rewriter.InsertBefore(pInsertProbeBeforeThisInstr, pNewInstr);
+    if (request.predicate.comparison != ProbePredicateComparison::NONE)
+    {
+        IfFailRet(EmitPredicateGate(rewriter, pInsertProbeBeforeThisInstr, request));
+    }
 
-    // Create the array
-    pNewInstr = rewriter.NewILInstr();
-    pNewInstr->m_opcode = CEE_NEWARR;
-    pNewInstr->m_Arg32 = corLibTypeTokens.systemObjectType;
-    rewriter.InsertBefore(pInsertProbeBeforeThisInstr, pNewInstr);
+    if (request.samplingInterval > 1)
+    {
+        IfFailRet(EmitSamplingGate(rewriter, pInsertProbeBeforeThisInstr, request));
+    }
 
-    for (UINT32 i = 0; i < numArgs; i++)
+    if (request.pOverheadCounters != nullptr)
     {
-        // New entry on the evaluation stack
+        IfFailRet(rewriter.AddLocal(TimestampLocalType, sizeof(TimestampLocalType), startLocal));
+
         pNewInstr = rewriter.NewILInstr();
-        pNewInstr->m_opcode = CEE_DUP;
+        pNewInstr->m_opcode = CEE_LDC_NATIVE_I;
+        pNewInstr->m_Arg64 = reinterpret_cast<INT64>(&LatencyHistogram::OnEnter);
         rewriter.InsertBefore(pInsertProbeBeforeThisInstr, pNewInstr);
 
-        // Index to set
         pNewInstr = rewriter.NewILInstr();
-        pNewInstr->m_opcode = CEE_LDC_I4;
-        pNewInstr->m_Arg32 = i;
+        pNewInstr->m_opcode = CEE_CALLI;
+        pNewInstr->m_Arg32 = request.pAssemblyData->GetLatencyProbeEnterCallbackSignature();
         rewriter.InsertBefore(pInsertProbeBeforeThisInstr, pNewInstr);
 
-        // Load arg
-        PARAMETER_BOXING_INSTRUCTIONS boxingInstructions = request.boxingInstructions.at(i);
-        if (boxingInstructions.instructionType == InstructionType::SPECIAL_CASE_TOKEN &&
-            boxingInstructions.token.specialCaseToken == SpecialCaseBoxingTypes::TYPE_UNKNOWN)
-        {
-            pNewInstr = rewriter.NewILInstr();
-            pNewInstr->m_opcode = CEE_LDNULL;
-            rewriter.InsertBefore(pInsertProbeBeforeThisInstr, pNewInstr);
-        }
-        else
-        {
-            pNewInstr = rewriter.NewILInstr();
-            pNewInstr->m_opcode = CEE_LDARG_S;
-            pNewInstr->m_Arg32 = i;
-            rewriter.InsertBefore(pInsertProbeBeforeThisInstr, pNewInstr);
-
-            // Resolve the boxing token.
-            mdToken boxedTypeToken;
-            if (boxingInstructions.instructionType == InstructionType::SPECIAL_CASE_TOKEN)
-            {
-                IfFailRet(GetSpecialCaseBoxingToken(boxingInstructions.token.specialCaseToken, corLibTypeTokens, boxedTypeToken));
-            }
-            else if (boxingInstructions.instructionType == InstructionType::METADATA_TOKEN)
-            {
-                boxedTypeToken = boxingInstructions.token.mdToken;
-            }
-            else
-            {
-                return E_UNEXPECTED;
-            }
-
-            if (boxedTypeToken != mdTokenNil)
-            {
-                pNewInstr = rewriter.NewILInstr();
-                pNewInstr->m_opcode = CEE_BOX;
-                pNewInstr->m_Arg32 = boxedTypeToken;
-                rewriter.InsertBefore(pInsertProbeBeforeThisInstr, pNewInstr);
-            }
-        }
-
-        // Replace the i'th element in our new array with what we just pushed on the stack
         pNewInstr = rewriter.NewILInstr();
-        pNewInstr->m_opcode = CEE_STELEM_REF;
+        pNewInstr->m_opcode = CEE_STLOC;
+        pNewInstr->m_Arg16 = static_cast<INT16>(startLocal);
         rewriter.InsertBefore(pInsertProbeBeforeThisInstr, pNewInstr);
+
+        // Inserted after the catch block.
+        pProbeEnd = rewriter.NewILInstr();
+        pProbeEnd->m_opcode = CEE_LDC_NATIVE_I;
+        pProbeEnd->m_Arg64 = reinterpret_cast<INT64>(request.pOverheadCounters);
     }
 
-    pNewInstr = rewriter.NewILInstr();
-    pNewInstr->m_opcode = CEE_CALL;
-    pNewInstr->m_Arg32 = request.pAssemblyData->GetProbeMemberRef();
-    rewriter.InsertBefore(pInsertProbeBeforeThisInstr, pNewInstr);
+    // START: Try block
+
+    if (request.pAssemblyData->GetTypedProbeMemberRef() != mdMemberRefNil)
+    {
+        IfFailRet(EmitTypedProbeCall(rewriter, pInsertProbeBeforeThisInstr, request, pTryBegin));
+    }
+    else
+    {
+        IfFailRet(EmitBoxedProbeCall(rewriter, pInsertProbeBeforeThisInstr, request, pTryBegin));
+    }
 
     pNewInstr = pNewInstr = rewriter.NewILInstr();
     pNewInstr->m_opcode = CEE_LEAVE;
-    pNewInstr->m_pTarget = pInsertProbeBeforeThisInstr;
+    pNewInstr->m_pTarget = pProbeEnd;
     rewriter.InsertBefore(pInsertProbeBeforeThisInstr, pNewInstr);
 
     // END: Try block
@@ -197,11 +201,32 @@ HRESULT ProbeInjector::InstallProbe(
 
     pCatchEnd = rewriter.NewILInstr();
     pCatchEnd->m_opcode = CEE_LEAVE;
-    pCatchEnd->m_pTarget = pInsertProbeBeforeThisInstr;
+    pCatchEnd->m_pTarget = pProbeEnd;
     rewriter.InsertBefore(pInsertProbeBeforeThisInstr, pCatchEnd);
 
     // END: Catch block
 
+    if (request.pOverheadCounters != nullptr)
+    {
+        rewriter.InsertBefore(pInsertProbeBeforeThisInstr, pProbeEnd);
+
+        pNewInstr = rewriter.NewILInstr();
+        pNewInstr->m_opcode = CEE_LDLOC;
+        pNewInstr->m_Arg16 = static_cast<INT16>(startLocal);
+        rewriter.InsertBefore(pInsertProbeBeforeThisInstr, pNewInstr);
+
+        pNewInstr = rewriter.NewILInstr();
+        pNewInstr->m_opcode = CEE_LDC_NATIVE_I;
+        pNewInstr->m_Arg64 = reinterpret_cast<INT64>(&ProbeOverheadCounters::OnLeave);
+        rewriter.InsertBefore(pInsertProbeBeforeThisInstr, pNewInstr);
+
+        // Same shape as the latency probes' leave callback.
+        pNewInstr = rewriter.NewILInstr();
+        pNewInstr->m_opcode = CEE_CALLI;
+        pNewInstr->m_Arg32 = request.pAssemblyData->GetLatencyProbeLeaveCallbackSignature();
+        rewriter.InsertBefore(pInsertProbeBeforeThisInstr, pNewInstr);
+    }
+
     pNestedTryLeave->m_pTarget = pNestedCatchEnd->m_pTarget = pCatchEnd;
 
     // The nested protected region must be registered in the exception handler table first
@@ -217,9 +242,696 @@ HRESULT ProbeInjector::InstallProbe(
         pCatchEnd,
         corLibTypeTokens.systemObjectType);
 
-    IfFailRet(rewriter.Export());
+    return S_OK;
+}
 
-    END_NO_OOM_THROW_REGION;
+HRESULT ProbeInjector::EmitLatencyProbes(
+    ILRewriter& rewriter,
+    const INSTRUMENTATION_REQUEST& request)
+{
+    HRESULT hr;
+
+    constexpr OPCODE CEE_LDC_NATIVE_I = sizeof(size_t) == 8 ? CEE_LDC_I8 : CEE_LDC_I4;
+    constexpr COR_SIGNATURE TimestampLocalType[] = { ELEMENT_TYPE_I8 };
+
+    ILInstr* pILList = rewriter.GetILList();
+    ILInstr* pNewInstr = nullptr;
+
+    //
+    // The below IL is equivalent to:
+    // INT64 start = (*pLatencyProbeEnterCallback)();
+    // try {
+    //   <original code, with every "return value;" replaced by "returnValue = value; leave epilogue;">
+    // } finally {
+    //   (*pLatencyProbeLeaveCallback)(pLatencyHistogram, start);
+    // }
+    // epilogue:
+    // return returnValue;
+    //
+    // The finally block records both normal and exceptional exits.
+    //
+
+    // jmp cannot leave a protected region, so such methods are left untimed; the caller reports them.
+    for (ILInstr* pInstr = pILList->m_pNext; pInstr != pILList; pInstr = pInstr->m_pNext)
+    {
+        if (pInstr->m_opcode == CEE_JMP)
+        {
+            return S_FALSE;
+        }
+    }
+
+    PCCOR_SIGNATURE pReturnType;
+    ULONG cbReturnType;
+    IfFailRet(rewriter.GetReturnType(pReturnType, cbReturnType));
+
+    bool hasReturnValue = !(cbReturnType == 1 && pReturnType[0] == ELEMENT_TYPE_VOID);
+
+    unsigned startLocal;
+    IfFailRet(rewriter.AddLocal(TimestampLocalType, sizeof(TimestampLocalType), startLocal));
+
+    unsigned returnValueLocal = 0;
+    if (hasReturnValue)
+    {
+        IfFailRet(rewriter.AddLocal(pReturnType, cbReturnType, returnValueLocal));
+    }
+
+    ILInstr* pTryBegin = pILList->m_pNext;
+
+    // START: Epilogue
+
+    ILInstr* pEpilogue = rewriter.NewILInstr();
+    if (hasReturnValue)
+    {
+        pEpilogue->m_opcode = CEE_LDLOC;
+        pEpilogue->m_Arg16 = static_cast<INT16>(returnValueLocal);
+        rewriter.InsertBefore(pILList, pEpilogue);
+
+        pNewInstr = rewriter.NewILInstr();
+        pNewInstr->m_opcode = CEE_RET;
+        rewriter.InsertBefore(pILList, pNewInstr);
+    }
+    else
+    {
+        pEpilogue->m_opcode = CEE_RET;
+        rewriter.InsertBefore(pILList, pEpilogue);
+    }
+
+    // END: Epilogue
+
+    //
+    // Redirect the original returns to the epilogue. Each ret is rewritten in place,
+    // so that branches targeting it still reach the rewritten instructions.
+    // Tail calls cannot be made from a protected region either; they become regular calls.
+    //
+    for (ILInstr* pInstr = pTryBegin; pInstr != pEpilogue; pInstr = pInstr->m_pNext)
+    {
+        if (pInstr->m_opcode == CEE_TAILCALL)
+        {
+            pInstr->m_opcode = CEE_NOP;
+        }
+        else if (pInstr->m_opcode == CEE_RET)
+        {
+            if (hasReturnValue)
+            {
+                pInstr->m_opcode = CEE_STLOC;
+                pInstr->m_Arg16 = static_cast<INT16>(returnValueLocal);
+
+                pNewInstr = rewriter.NewILInstr();
+                pNewInstr->m_opcode = CEE_LEAVE;
+                pNewInstr->m_pTarget = pEpilogue;
+                rewriter.InsertAfter(pInstr, pNewInstr);
+
+                pInstr = pNewInstr;
+            }
+            else
+            {
+                pInstr->m_opcode = CEE_LEAVE;
+                pInstr->m_pTarget = pEpilogue;
+            }
+        }
+    }
+
+    // START: Finally block
+
+    ILInstr* pFinallyBegin = rewriter.NewILInstr();
+    pFinallyBegin->m_opcode = CEE_LDC_NATIVE_I;
+    pFinallyBegin->m_Arg64 = reinterpret_cast<INT64>(request.pLatencyHistogram);
+    rewriter.InsertBefore(pEpilogue, pFinallyBegin);
+
+    pNewInstr = rewriter.NewILInstr();
+    pNewInstr->m_opcode = CEE_LDLOC;
+    pNewInstr->m_Arg16 = static_cast<INT16>(startLocal);
+    rewriter.InsertBefore(pEpilogue, pNewInstr);
+
+    pNewInstr = rewriter.NewILInstr();
+    pNewInstr->m_opcode = CEE_LDC_NATIVE_I;
+    pNewInstr->m_Arg64 = reinterpret_cast<INT64>(&LatencyHistogram::OnLeave);
+    rewriter.InsertBefore(pEpilogue, pNewInstr);
+
+    pNewInstr = rewriter.NewILInstr();
+    pNewInstr->m_opcode = CEE_CALLI;
+    pNewInstr->m_Arg32 = request.pAssemblyData->GetLatencyProbeLeaveCallbackSignature();
+    rewriter.InsertBefore(pEpilogue, pNewInstr);
+
+    ILInstr* pFinallyEnd = rewriter.NewILInstr();
+    pFinallyEnd->m_opcode = CEE_ENDFINALLY;
+    rewriter.InsertBefore(pEpilogue, pFinallyEnd);
+
+    // END: Finally block
+    // START: Prologue
+
+    pNewInstr = rewriter.NewILInstr();
+    pNewInstr->m_opcode = CEE_LDC_NATIVE_I;
+    pNewInstr->m_Arg64 = reinterpret_cast<INT64>(&LatencyHistogram::OnEnter);
+    rewriter.InsertBefore(pTryBegin, pNewInstr);
+
+    pNewInstr = rewriter.NewILInstr();
+    pNewInstr->m_opcode = CEE_CALLI;
+    pNewInstr->m_Arg32 = request.pAssemblyData->GetLatencyProbeEnterCallbackSignature();
+    rewriter.InsertBefore(pTryBegin, pNewInstr);
+
+    pNewInstr = rewriter.NewILInstr();
+    pNewInstr->m_opcode = CEE_STLOC;
+    pNewInstr->m_Arg16 = static_cast<INT16>(startLocal);
+    rewriter.InsertBefore(pTryBegin, pNewInstr);
+
+    // END: Prologue
+
+    // Any protected regions of the original code are nested in this one, so it must be registered last.
+    rewriter.InsertTryFinally(pTryBegin, pFinallyBegin, pFinallyEnd);
+
+    return S_OK;
+}
+
+HRESULT ProbeInjector::EmitPredicateGate(
+    ILRewriter& rewriter,
+    ILInstr* pInsertBefore,
+    const INSTRUMENTATION_REQUEST& request)
+{
+    HRESULT hr;
+
+    IfFailRet(ValidatePredicate(request.predicate, request.boxingInstructions));
+
+    const PROBE_PREDICATE& predicate = request.predicate;
+    SpecialCaseBoxingTypes argumentType = request.boxingInstructions.at(predicate.argumentIndex).token.specialCaseToken;
+
+    OPCODE convertOpcode;
+    OPCODE storeOpcode;
+    IfFailRet(GetPrimitiveStoreOpcodes(argumentType, convertOpcode, storeOpcode));
+
+    OPCODE branchOpcode;
+    IfFailRet(GetPredicateBranchOpcode(argumentType, predicate.comparison, branchOpcode));
+
+    ILInstr* pNewInstr = nullptr;
+
+    //
+    // The below IL is equivalent to:
+    // if (!((INT64/UINT64/double)arg <comparison> constant)) goto original_code;
+    //
+    // Like the sampling gate, it runs before anything is allocated and outside of the probe's try block.
+    //
+
+    pNewInstr = rewriter.NewILInstr();
+    pNewInstr->m_opcode = CEE_LDARG_S;
+    pNewInstr->m_Arg32 = predicate.argumentIndex;
+    rewriter.InsertBefore(pInsertBefore, pNewInstr);
+
+    if (convertOpcode != CEE_NOP)
+    {
+        pNewInstr = rewriter.NewILInstr();
+        pNewInstr->m_opcode = convertOpcode;
+        rewriter.InsertBefore(pInsertBefore, pNewInstr);
+    }
+
+    pNewInstr = rewriter.NewILInstr();
+    pNewInstr->m_opcode = (storeOpcode == CEE_STIND_R8) ? CEE_LDC_R8 : CEE_LDC_I8;
+    pNewInstr->m_Arg64 = predicate.constant;
+    rewriter.InsertBefore(pInsertBefore, pNewInstr);
+
+    pNewInstr = rewriter.NewILInstr();
+    pNewInstr->m_opcode = branchOpcode;
+    pNewInstr->m_pTarget = pInsertBefore;
+    rewriter.InsertBefore(pInsertBefore, pNewInstr);
+
+    return S_OK;
+}
+
+HRESULT ProbeInjector::EmitSamplingGate(
+    ILRewriter& rewriter,
+    ILInstr* pInsertBefore,
+    const INSTRUMENTATION_REQUEST& request)
+{
+    ExpectedPtr(request.pSamplingCounter);
+
+    constexpr OPCODE CEE_LDC_NATIVE_I = sizeof(size_t) == 8 ? CEE_LDC_I8 : CEE_LDC_I4;
+
+    ILInstr* pNewInstr = nullptr;
+
+    //
+    // The below IL is equivalent to:
+    // if (--(*pSamplingCounter) > 0) goto original_code;
+    // *pSamplingCounter = samplingInterval;
+    //
+    // It runs before anything is allocated and outside of the probe's try block.
+    // The counter is not updated atomically; concurrent callers may occasionally sample more or less often.
+    //
+
+    auto emitCounterAddress = [&]()
+    {
+        pNewInstr = rewriter.NewILInstr();
+        pNewInstr->m_opcode = CEE_LDC_NATIVE_I;
+        pNewInstr->m_Arg64 = reinterpret_cast<INT64>(request.pSamplingCounter);
+        rewriter.InsertBefore(pInsertBefore, pNewInstr);
+
+        pNewInstr = rewriter.NewILInstr();
+        pNewInstr->m_opcode = CEE_CONV_I;
+        rewriter.InsertBefore(pInsertBefore, pNewInstr);
+    };
+
+    // *pSamplingCounter = *pSamplingCounter - 1
+    emitCounterAddress();
+    emitCounterAddress();
+
+    pNewInstr = rewriter.NewILInstr();
+    pNewInstr->m_opcode = CEE_LDIND_I4;
+    rewriter.InsertBefore(pInsertBefore, pNewInstr);
+
+    pNewInstr = rewriter.NewILInstr();
+    pNewInstr->m_opcode = CEE_LDC_I4;
+    pNewInstr->m_Arg32 = 1;
+    rewriter.InsertBefore(pInsertBefore, pNewInstr);
+
+    pNewInstr = rewriter.NewILInstr();
+    pNewInstr->m_opcode = CEE_SUB;
+    rewriter.InsertBefore(pInsertBefore, pNewInstr);
+
+    pNewInstr = rewriter.NewILInstr();
+    pNewInstr->m_opcode = CEE_STIND_I4;
+    rewriter.InsertBefore(pInsertBefore, pNewInstr);
+
+    // if (*pSamplingCounter > 0) goto original_code
+    emitCounterAddress();
+
+    pNewInstr = rewriter.NewILInstr();
+    pNewInstr->m_opcode = CEE_LDIND_I4;
+    rewriter.InsertBefore(pInsertBefore, pNewInstr);
+
+    pNewInstr = rewriter.NewILInstr();
+    pNewInstr->m_opcode = CEE_LDC_I4;
+    pNewInstr->m_Arg32 = 0;
+    rewriter.InsertBefore(pInsertBefore, pNewInstr);
+
+    pNewInstr = rewriter.NewILInstr();
+    pNewInstr->m_opcode = CEE_BGT;
+    pNewInstr->m_pTarget = pInsertBefore;
+    rewriter.InsertBefore(pInsertBefore, pNewInstr);
+
+    // *pSamplingCounter = samplingInterval
+    emitCounterAddress();
+
+    pNewInstr = rewriter.NewILInstr();
+    pNewInstr->m_opcode = CEE_LDC_I4;
+    pNewInstr->m_Arg32 = static_cast<INT32>(request.samplingInterval);
+    rewriter.InsertBefore(pInsertBefore, pNewInstr);
+
+    pNewInstr = rewriter.NewILInstr();
+    pNewInstr->m_opcode = CEE_STIND_I4;
+    rewriter.InsertBefore(pInsertBefore, pNewInstr);
+
+    return S_OK;
+}
+
+HRESULT ProbeInjector::EmitBoxedProbeCall(
+    ILRewriter& rewriter,
+    ILInstr* pInsertBefore,
+    const INSTRUMENTATION_REQUEST& request,
+    ILInstr*& pFirstInstr)
+{
+    HRESULT hr;
+
+    const COR_LIB_TYPE_TOKENS& corLibTypeTokens = request.pAssemblyData->GetCorLibTypeTokens();
+    UINT32 numArgs = static_cast<UINT32>(request.boxingInstructions.size());
+    ILInstr* pNewInstr = nullptr;
+
+    /* uniquifier */
+    pFirstInstr = rewriter.NewILInstr();
+    pFirstInstr->m_opcode = CEE_LDC_I8;
+    pFirstInstr->m_Arg64 = request.uniquifier;
+    rewriter.InsertBefore(pInsertBefore, pFirstInstr);
+
+    /* Args */
+
+    // Size of array
+    pNewInstr = rewriter.NewILInstr();
+    pNewInstr->m_opcode = CEE_LDC_I4;
+    pNewInstr->m_Arg32 = numArgs;
+    rewriter.InsertBefore(pInsertBefore, pNewInstr);
+
+    // Create the array
+    pNewInstr = rewriter.NewILInstr();
+    pNewInstr->m_opcode = CEE_NEWARR;
+    pNewInstr->m_Arg32 = corLibTypeTokens.systemObjectType;
+    rewriter.InsertBefore(pInsertBefore, pNewInstr);
+
+    for (UINT32 i = 0; i < numArgs; i++)
+    {
+        IfFailRet(EmitStoreArgInArray(rewriter, pInsertBefore, request, i));
+    }
+
+    pNewInstr = rewriter.NewILInstr();
+    pNewInstr->m_opcode = CEE_CALL;
+    pNewInstr->m_Arg32 = request.pAssemblyData->GetProbeMemberRef();
+    rewriter.InsertBefore(pInsertBefore, pNewInstr);
+
+    return S_OK;
+}
+
+HRESULT ProbeInjector::EmitTypedProbeCall(
+    ILRewriter& rewriter,
+    ILInstr* pInsertBefore,
+    const INSTRUMENTATION_REQUEST& request,
+    ILInstr*& pFirstInstr)
+{
+    HRESULT hr;
+
+    const COR_LIB_TYPE_TOKENS& corLibTypeTokens = request.pAssemblyData->GetCorLibTypeTokens();
+    UINT32 numArgs = static_cast<UINT32>(request.boxingInstructions.size());
+    ILInstr* pNewInstr = nullptr;
+
+    UINT32 numPrimitiveArgs = 0;
+    UINT32 numObjectArgs = 0;
+    for (UINT32 i = 0; i < numArgs; i++)
+    {
+        const PARAMETER_BOXING_INSTRUCTIONS& boxingInstructions = request.boxingInstructions.at(i);
+        if (IsPrimitive(boxingInstructions))
+        {
+            numPrimitiveArgs++;
+        }
+        else if (!IsUnsupported(boxingInstructions))
+        {
+            numObjectArgs++;
+        }
+    }
+
+    if (numArgs > UINT32_MAX / TypedProbeSlotSize)
+    {
+        return E_INVALIDARG;
+    }
+
+    //
+    // The below IL is equivalent to:
+    //   UINT64* slots = stackalloc UINT64[numArgs];
+    //   slots[i] = (UINT64)primitiveArg_i; ...
+    //   EnterProbeStubTyped(slots, uniquifier, numObjectArgs > 0 ? new object[numArgs] { ..., objectArg_j, ... } : null);
+    //
+    // localloc requires an otherwise empty evaluation stack, which is why the buffer is the first parameter.
+    //
+
+    /* Primitive args */
+    pFirstInstr = rewriter.NewILInstr();
+    pFirstInstr->m_opcode = CEE_LDC_I4;
+    rewriter.InsertBefore(pInsertBefore, pFirstInstr);
+
+    if (numPrimitiveArgs > 0)
+    {
+        pFirstInstr->m_Arg32 = numArgs * TypedProbeSlotSize;
+
+        pNewInstr = rewriter.NewILInstr();
+        pNewInstr->m_opcode = CEE_LOCALLOC;
+        rewriter.InsertBefore(pInsertBefore, pNewInstr);
+
+        for (UINT32 i = 0; i < numArgs; i++)
+        {
+            const PARAMETER_BOXING_INSTRUCTIONS& boxingInstructions = request.boxingInstructions.at(i);
+            if (!IsPrimitive(boxingInstructions))
+            {
+                continue;
+            }
+
+            OPCODE convertOpcode;
+            OPCODE storeOpcode;
+            IfFailRet(GetPrimitiveStoreOpcodes(boxingInstructions.token.specialCaseToken, convertOpcode, storeOpcode));
+
+            // Address of the slot
+            pNewInstr = rewriter.NewILInstr();
+            pNewInstr->m_opcode = CEE_DUP;
+            rewriter.InsertBefore(pInsertBefore, pNewInstr);
+
+            pNewInstr = rewriter.NewILInstr();
+            pNewInstr->m_opcode = CEE_LDC_I4;
+            pNewInstr->m_Arg32 = i * TypedProbeSlotSize;
+            rewriter.InsertBefore(pInsertBefore, pNewInstr);
+
+            pNewInstr = rewriter.NewILInstr();
+            pNewInstr->m_opcode = CEE_ADD;
+            rewriter.InsertBefore(pInsertBefore, pNewInstr);
+
+            // Widened value
+            pNewInstr = rewriter.NewILInstr();
+            pNewInstr->m_opcode = CEE_LDARG_S;
+            pNewInstr->m_Arg32 = i;
+            rewriter.InsertBefore(pInsertBefore, pNewInstr);
+
+            if (convertOpcode != CEE_NOP)
+            {
+                pNewInstr = rewriter.NewILInstr();
+                pNewInstr->m_opcode = convertOpcode;
+                rewriter.InsertBefore(pInsertBefore, pNewInstr);
+            }
+
+            pNewInstr = rewriter.NewILInstr();
+            pNewInstr->m_opcode = storeOpcode;
+            rewriter.InsertBefore(pInsertBefore, pNewInstr);
+        }
+    }
+    else
+    {
+        // No primitives; pass a null buffer.
+        pFirstInstr->m_Arg32 = 0;
+
+        pNewInstr = rewriter.NewILInstr();
+        pNewInstr->m_opcode = CEE_CONV_U;
+        rewriter.InsertBefore(pInsertBefore, pNewInstr);
+    }
+
+    /* uniquifier */
+    pNewInstr = rewriter.NewILInstr();
+    pNewInstr->m_opcode = CEE_LDC_I8;
+    pNewInstr->m_Arg64 = request.uniquifier;
+    rewriter.InsertBefore(pInsertBefore, pNewInstr);
+
+    /* Object args */
+    if (numObjectArgs > 0)
+    {
+        pNewInstr = rewriter.NewILInstr();
+        pNewInstr->m_opcode = CEE_LDC_I4;
+        pNewInstr->m_Arg32 = numArgs;
+        rewriter.InsertBefore(pInsertBefore, pNewInstr);
+
+        pNewInstr = rewriter.NewILInstr();
+        pNewInstr->m_opcode = CEE_NEWARR;
+        pNewInstr->m_Arg32 = corLibTypeTokens.systemObjectType;
+        rewriter.InsertBefore(pInsertBefore, pNewInstr);
+
+        for (UINT32 i = 0; i < numArgs; i++)
+        {
+            const PARAMETER_BOXING_INSTRUCTIONS& boxingInstructions = request.boxingInstructions.at(i);
+            if (IsPrimitive(boxingInstructions) || IsUnsupported(boxingInstructions))
+            {
+                continue;
+            }
+
+            IfFailRet(EmitStoreArgInArray(rewriter, pInsertBefore, request, i));
+        }
+    }
+    else
+    {
+        pNewInstr = rewriter.NewILInstr();
+        pNewInstr->m_opcode = CEE_LDNULL;
+        rewriter.InsertBefore(pInsertBefore, pNewInstr);
+    }
+
+    pNewInstr = rewriter.NewILInstr();
+    pNewInstr->m_opcode = CEE_CALL;
+    pNewInstr->m_Arg32 = request.pAssemblyData->GetTypedProbeMemberRef();
+    rewriter.InsertBefore(pInsertBefore, pNewInstr);
+
+    return S_OK;
+}
+
+HRESULT ProbeInjector::EmitStoreArgInArray(
+    ILRewriter& rewriter,
+    ILInstr* pInsertBefore,
+    const INSTRUMENTATION_REQUEST& request,
+    UINT32 argIndex)
+{
+    HRESULT hr;
+
+    const COR_LIB_TYPE_TOKENS& corLibTypeTokens = request.pAssemblyData->GetCorLibTypeTokens();
+    ILInstr* pNewInstr = nullptr;
+
+    // New entry on the evaluation stack
+    pNewInstr = rewriter.NewILInstr();
+    pNewInstr->m_opcode = CEE_DUP;
+    rewriter.InsertBefore(pInsertBefore, pNewInstr);
+
+    // Index to set
+    pNewInstr = rewriter.NewILInstr();
+    pNewInstr->m_opcode = CEE_LDC_I4;
+    pNewInstr->m_Arg32 = argIndex;
+    rewriter.InsertBefore(pInsertBefore, pNewInstr);
+
+    // Load arg
+    const PARAMETER_BOXING_INSTRUCTIONS& boxingInstructions = request.boxingInstructions.at(argIndex);
+    if (IsUnsupported(boxingInstructions))
+    {
+        pNewInstr = rewriter.NewILInstr();
+        pNewInstr->m_opcode = CEE_LDNULL;
+        rewriter.InsertBefore(pInsertBefore, pNewInstr);
+    }
+    else
+    {
+        pNewInstr = rewriter.NewILInstr();
+        pNewInstr->m_opcode = CEE_LDARG_S;
+        pNewInstr->m_Arg32 = argIndex;
+        rewriter.InsertBefore(pInsertBefore, pNewInstr);
+
+        // Resolve the boxing token.
+        mdToken boxedTypeToken;
+        if (boxingInstructions.instructionType == InstructionType::SPECIAL_CASE_TOKEN)
+        {
+            IfFailRet(GetSpecialCaseBoxingToken(boxingInstructions.token.specialCaseToken, corLibTypeTokens, boxedTypeToken));
+        }
+        else if (boxingInstructions.instructionType == InstructionType::METADATA_TOKEN)
+        {
+            boxedTypeToken = boxingInstructions.token.mdToken;
+        }
+        else
+        {
+            return E_UNEXPECTED;
+        }
+
+        if (boxedTypeToken != mdTokenNil)
+        {
+            pNewInstr = rewriter.NewILInstr();
+            pNewInstr->m_opcode = CEE_BOX;
+            pNewInstr->m_Arg32 = boxedTypeToken;
+            rewriter.InsertBefore(pInsertBefore, pNewInstr);
+        }
+    }
+
+    // Replace the i'th element in our new array with what we just pushed on the stack
+    pNewInstr = rewriter.NewILInstr();
+    pNewInstr->m_opcode = CEE_STELEM_REF;
+    rewriter.InsertBefore(pInsertBefore, pNewInstr);
+
+    return S_OK;
+}
+
+bool ProbeInjector::IsUnsupported(const PARAMETER_BOXING_INSTRUCTIONS& boxingInstructions)
+{
+    return boxingInstructions.instructionType == InstructionType::SPECIAL_CASE_TOKEN &&
+        boxingInstructions.token.specialCaseToken == SpecialCaseBoxingTypes::TYPE_UNKNOWN;
+}
+
+bool ProbeInjector::IsPrimitive(const PARAMETER_BOXING_INSTRUCTIONS& boxingInstructions)
+{
+    return boxingInstructions.instructionType == InstructionType::SPECIAL_CASE_TOKEN &&
+        boxingInstructions.token.specialCaseToken >= SpecialCaseBoxingTypes::TYPE_BOOLEAN &&
+        boxingInstructions.token.specialCaseToken <= SpecialCaseBoxingTypes::TYPE_DOUBLE;
+}
+
+HRESULT ProbeInjector::GetPrimitiveStoreOpcodes(
+    SpecialCaseBoxingTypes specialCaseType,
+    OPCODE& convertOpcode,
+    OPCODE& storeOpcode)
+{
+    convertOpcode = CEE_NOP;
+    storeOpcode = CEE_STIND_I8;
+
+    switch(specialCaseType)
+    {
+    case SpecialCaseBoxingTypes::TYPE_BOOLEAN:
+    case SpecialCaseBoxingTypes::TYPE_CHAR:
+    case SpecialCaseBoxingTypes::TYPE_BYTE:
+    case SpecialCaseBoxingTypes::TYPE_UINT16:
+    case SpecialCaseBoxingTypes::TYPE_UINT32:
+    case SpecialCaseBoxingTypes::TYPE_UINTPTR:
+        convertOpcode = CEE_CONV_U8;
+        break;
+    case SpecialCaseBoxingTypes::TYPE_SBYTE:
+    case SpecialCaseBoxingTypes::TYPE_INT16:
+    case SpecialCaseBoxingTypes::TYPE_INT32:
+    case SpecialCaseBoxingTypes::TYPE_INTPTR:
+        convertOpcode = CEE_CONV_I8;
+        break;
+    case SpecialCaseBoxingTypes::TYPE_INT64:
+    case SpecialCaseBoxingTypes::TYPE_UINT64:
+        break;
+    case SpecialCaseBoxingTypes::TYPE_SINGLE:
+        convertOpcode = CEE_CONV_R8;
+        storeOpcode = CEE_STIND_R8;
+        break;
+    case SpecialCaseBoxingTypes::TYPE_DOUBLE:
+        storeOpcode = CEE_STIND_R8;
+        break;
+    default:
+        return E_FAIL;
+    }
+
+    return S_OK;
+}
+
+HRESULT ProbeInjector::ValidatePredicate(
+    const PROBE_PREDICATE& predicate,
+    const std::vector<PARAMETER_BOXING_INSTRUCTIONS>& boxingInstructions)
+{
+    if (predicate.comparison == ProbePredicateComparison::NONE)
+    {
+        return S_OK;
+    }
+
+    if (predicate.comparison > ProbePredicateComparison::GREATER_THAN_OR_EQUAL ||
+        predicate.argumentIndex >= boxingInstructions.size() ||
+        // The argument is loaded with ldarg.s.
+        predicate.argumentIndex > UINT8_MAX ||
+        !IsPrimitive(boxingInstructions.at(predicate.argumentIndex)))
+    {
+        return E_INVALIDARG;
+    }
+
+    return S_OK;
+}
+
+HRESULT ProbeInjector::GetPredicateBranchOpcode(
+    SpecialCaseBoxingTypes specialCaseType,
+    ProbePredicateComparison comparison,
+    OPCODE& branchOpcode)
+{
+    //
+    // The branch skips the probe, so it tests the opposite of the comparison.
+    // Unsigned and floating point arguments use the unsigned/unordered forms.
+    // A NaN argument compares the same way as in C#: every comparison is false except NOT_EQUAL,
+    // so the unordered branches skip the probe and the beq for NOT_EQUAL falls through to it.
+    //
+    bool isSigned;
+    switch(specialCaseType)
+    {
+    case SpecialCaseBoxingTypes::TYPE_SBYTE:
+    case SpecialCaseBoxingTypes::TYPE_INT16:
+    case SpecialCaseBoxingTypes::TYPE_INT32:
+    case SpecialCaseBoxingTypes::TYPE_INT64:
+    case SpecialCaseBoxingTypes::TYPE_INTPTR:
+        isSigned = true;
+        break;
+    default:
+        isSigned = false;
+        break;
+    }
+
+    switch(comparison)
+    {
+    case ProbePredicateComparison::EQUAL:
+        branchOpcode = CEE_BNE_UN;
+        break;
+    case ProbePredicateComparison::NOT_EQUAL:
+        branchOpcode = CEE_BEQ;
+        break;
+    case ProbePredicateComparison::LESS_THAN:
+        branchOpcode = isSigned ? CEE_BGE : CEE_BGE_UN;
+        break;
+    case ProbePredicateComparison::LESS_THAN_OR_EQUAL:
+        branchOpcode = isSigned ? CEE_BGT : CEE_BGT_UN;
+        break;
+    case ProbePredicateComparison::GREATER_THAN:
+        branchOpcode = isSigned ? CEE_BLE : CEE_BLE_UN;
+        break;
+    case ProbePredicateComparison::GREATER_THAN_OR_EQUAL:
+        branchOpcode = isSigned ? CEE_BLT : CEE_BLT_UN;
+        break;
+    default:
+        return E_INVALIDARG;
+    }
 
     return S_OK;
 }
@@ -7,6 +7,9 @@
 #include "corhdr.h"
 #include "AssemblyProbePrep.h"
 #include "CallbackDefinitions.h"
+#include "LatencyHistogram.h"
+#include "ProbeOverheadCounters.h"
+#include "../Utilities/ProfilerILRewriter.h"
 
 #include <vector>
 #include <memory>
@@ -60,6 +63,26 @@ typedef struct _PARAMETER_BOXING_INSTRUCTIONS
     ULONG32 signatureBufferLength;
 } PARAMETER_BOXING_INSTRUCTIONS;
 
+enum class ProbePredicateComparison : ULONG32
+{
+    NONE = 0,
+    EQUAL,
+    NOT_EQUAL,
+    LESS_THAN,
+    LESS_THAN_OR_EQUAL,
+    GREATER_THAN,
+    GREATER_THAN_OR_EQUAL
+};
+
+// Only calls whose argument satisfies "argument <comparison> constant" reach the probe.
+// The argument must be a primitive. The constant holds the bits of an INT64, a UINT64 or, for floating point arguments, a double.
+typedef struct _PROBE_PREDICATE
+{
+    ProbePredicateComparison comparison;
+    ULONG32 argumentIndex;
+    INT64 constant;
+} PROBE_PREDICATE;
+
 typedef struct _INSTRUMENTATION_REQUEST
 {
     ULONG64 uniquifier;
@@ -69,18 +92,92 @@ typedef struct _INSTRUMENTATION_REQUEST
     mdMethodDef methodDef;
 
     std::shared_ptr<AssemblyProbePrepData> pAssemblyData;
+
+    // Whether to call the registered probe with the method's arguments.
+    bool captureArguments;
+
+    // When set, the method's latency is recorded into this histogram.
+    LatencyHistogram* pLatencyHistogram;
+
+    // When greater than 1, only every samplingInterval'th call reaches the probe.
+    // pSamplingCounter is the native slot counting down to the next sampled call.
+    ULONG32 samplingInterval;
+    LONG* pSamplingCounter;
+
+    // Evaluated before sampling; calls that don't match skip the probe. Unused when comparison is NONE.
+    PROBE_PREDICATE predicate;
+
+    // When set, calls to the probe (after the predicate and sampling) are counted and timed into these counters.
+    ProbeOverheadCounters* pOverheadCounters;
 } INSTRUMENTATION_REQUEST;
 
 class ProbeInjector
 {
     public:
+        // pICorProfilerFunctionControl is null when setting the body of a method that is being jitted for the first time.
+        // Returns S_FALSE if the method was rewritten without its latency probes, because it can't be timed.
         static HRESULT InstallProbe(
             ICorProfilerInfo* pICorProfilerInfo,
             ICorProfilerFunctionControl* pICorProfilerFunctionControl,
             FaultingProbeCallback pFaultingProbeCallback,
             const INSTRUMENTATION_REQUEST& request);
 
+        // Fails with E_INVALIDARG if the predicate can't be applied to the arguments.
+        static HRESULT ValidatePredicate(
+            const PROBE_PREDICATE& predicate,
+            const std::vector<PARAMETER_BOXING_INSTRUCTIONS>& boxingInstructions);
+
     private:
+        static HRESULT EmitArgumentProbe(
+            ILRewriter& rewriter,
+            FaultingProbeCallback pFaultingProbeCallback,
+            const INSTRUMENTATION_REQUEST& request);
+
+        static HRESULT EmitLatencyProbes(
+            ILRewriter& rewriter,
+            const INSTRUMENTATION_REQUEST& request);
+
+        static HRESULT EmitPredicateGate(
+            ILRewriter& rewriter,
+            ILInstr* pInsertBefore,
+            const INSTRUMENTATION_REQUEST& request);
+
+        static HRESULT EmitSamplingGate(
+            ILRewriter& rewriter,
+            ILInstr* pInsertBefore,
+            const INSTRUMENTATION_REQUEST& request);
+
+        static HRESULT EmitBoxedProbeCall(
+            ILRewriter& rewriter,
+            ILInstr* pInsertBefore,
+            const INSTRUMENTATION_REQUEST& request,
+            ILInstr*& pFirstInstr);
+
+        static HRESULT EmitTypedProbeCall(
+            ILRewriter& rewriter,
+            ILInstr* pInsertBefore,
+            const INSTRUMENTATION_REQUEST& request,
+            ILInstr*& pFirstInstr);
+
+        static HRESULT EmitStoreArgInArray(
+            ILRewriter& rewriter,
+            ILInstr* pInsertBefore,
+            const INSTRUMENTATION_REQUEST& request,
+            UINT32 argIndex);
+
+        static bool IsUnsupported(const PARAMETER_BOXING_INSTRUCTIONS& boxingInstructions);
+        static bool IsPrimitive(const PARAMETER_BOXING_INSTRUCTIONS& boxingInstructions);
+
+        static HRESULT GetPrimitiveStoreOpcodes(
+            SpecialCaseBoxingTypes specialCaseType,
+            OPCODE& convertOpcode,
+            OPCODE& storeOpcode);
+
+        static HRESULT GetPredicateBranchOpcode(
+            SpecialCaseBoxingTypes specialCaseType,
+            ProbePredicateComparison comparison,
+            OPCODE& branchOpcode);
+
         static HRESULT GetSpecialCaseBoxingToken(
             SpecialCaseBoxingTypes specialCaseType,
             const COR_LIB_TYPE_TOKENS& corLibTypeTokens,
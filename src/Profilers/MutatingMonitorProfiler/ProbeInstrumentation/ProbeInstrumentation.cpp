@@ -5,6 +5,7 @@
 #include "macros.h"
 #include "ProbeInstrumentation.h"
 #include "CommonUtilities/BlockingQueue.h"
+#include <algorithm>
 
 using namespace std;
 
@@ -18,6 +19,7 @@ typedef void (STDMETHODCALLTYPE *ProbeRegistrationCallback)(HRESULT);
 typedef void (STDMETHODCALLTYPE *ProbeInstallationCallback)(HRESULT);
 typedef void (STDMETHODCALLTYPE *ProbeUninstallationCallback)(HRESULT);
 typedef void (STDMETHODCALLTYPE *ProbeFaultCallback)(ULONG64);
+typedef void (STDMETHODCALLTYPE *ProbeDisabledCallback)(ULONG64);
 
 typedef struct _PROBE_MANAGEMENT_CALLBACKS
 {
@@ -25,19 +27,123 @@ typedef struct _PROBE_MANAGEMENT_CALLBACKS
     ProbeInstallationCallback pProbeInstallationCallback;
     ProbeUninstallationCallback pProbeUninstallationCallback;
     ProbeFaultCallback pProbeFaultCallback;
+    ProbeDisabledCallback pProbeDisabledCallback;
 } PROBE_MANAGEMENT_CALLBACKS;
 
 mutex g_probeManagementCallbacksMutex; // guards g_probeManagementCallbacks
 PROBE_MANAGEMENT_CALLBACKS g_probeManagementCallbacks = {};
 
 BlockingQueue<PROBE_WORKER_PAYLOAD> g_probeManagementQueue;
+MpscQueue<PROBE_FAULT_NOTIFICATION> g_probeFaultQueue;
+
+// Fault notifications are preallocated so that faulting application threads never allocate.
+// A notification is either in the pool, in g_probeFaultQueue, or being handled by the fault thread.
+const size_t ProbeFaultNotificationPoolSize = 64;
+atomic<PROBE_FAULT_NOTIFICATION*> g_probeFaultNotificationPool[ProbeFaultNotificationPoolSize];
+// Faults raised while every notification was in use.
+atomic<ULONG64> g_droppedProbeFaultCount(0);
+
+static PROBE_FAULT_NOTIFICATION* TakeProbeFaultNotification()
+{
+    for (auto& slot : g_probeFaultNotificationPool)
+    {
+        if (slot.load(memory_order_relaxed) != nullptr)
+        {
+            PROBE_FAULT_NOTIFICATION* notification = slot.exchange(nullptr, memory_order_acquire);
+            if (notification != nullptr)
+            {
+                return notification;
+            }
+        }
+    }
+
+    return nullptr;
+}
+
+static void ReturnProbeFaultNotification(PROBE_FAULT_NOTIFICATION* notification)
+{
+    // There is a free slot for every notification that is out of the pool.
+    for (auto& slot : g_probeFaultNotificationPool)
+    {
+        PROBE_FAULT_NOTIFICATION* expected = nullptr;
+        if (slot.compare_exchange_strong(expected, notification, memory_order_release, memory_order_relaxed))
+        {
+            return;
+        }
+    }
+}
 
 ProbeInstrumentation::ProbeInstrumentation(const shared_ptr<ILogger>& logger, ICorProfilerInfo12* profilerInfo) :
     m_pCorProfilerInfo(profilerInfo),
     m_pLogger(logger),
     m_probeFunctionId(0),
-    m_pAssemblyProbePrep(nullptr)
+    m_pAssemblyProbePrep(nullptr),
+    m_assemblyProbePrepWorkers(profilerInfo),
+    m_defaultSamplingInterval(DefaultSamplingInterval),
+    m_latencyFlushStopped(false),
+    m_latencyFlushIntervalMilliseconds(DefaultLatencyFlushIntervalMilliseconds),
+    m_maxProbeInvocationsPerSecond(0),
+    m_maxProbeMicrosecondsPerSecond(0),
+    m_probeBudgetStopped(false),
+    m_totalRejittedInliners(0)
+{
+}
+
+void ProbeInstrumentation::SetDefaultSamplingInterval(ULONG32 samplingInterval)
+{
+    m_defaultSamplingInterval = samplingInterval;
+}
+
+void ProbeInstrumentation::SetLatencyFlushInterval(ULONG32 milliseconds)
+{
+    if (milliseconds != 0)
+    {
+        m_latencyFlushIntervalMilliseconds = milliseconds;
+    }
+}
+
+HRESULT ProbeInstrumentation::LoadStartupProbePlan(const tstring& path)
+{
+    HRESULT hr;
+
+    unique_ptr<StartupProbePlan> pPlan(new (nothrow) StartupProbePlan(m_pLogger, m_pCorProfilerInfo));
+    IfNullRet(pPlan);
+
+    IfFailLogRet(pPlan->Load(path));
+    if (hr == S_FALSE || pPlan->IsEmpty())
+    {
+        return S_FALSE;
+    }
+
+    m_pStartupAssemblyProbePrep.reset(new (nothrow) AssemblyProbePrep(m_pCorProfilerInfo, 0, &m_assemblyProbePrepWorkers));
+    IfNullRet(m_pStartupAssemblyProbePrep);
+
+    m_pStartupProbePlan = std::move(pPlan);
+
+    return S_OK;
+}
+
+void ProbeInstrumentation::SetTrackInliners(bool trackInliners)
+{
+    if (trackInliners)
+    {
+        m_pInlinerTracker.reset(new (nothrow) InlinerTracker(m_pLogger, m_pCorProfilerInfo));
+    }
+    else
+    {
+        m_pInlinerTracker.reset();
+    }
+}
+
+void ProbeInstrumentation::SetProbeBudgets(ULONG32 maxInvocationsPerSecond, ULONG32 maxMicrosecondsPerSecond)
+{
+    m_maxProbeInvocationsPerSecond = maxInvocationsPerSecond;
+    m_maxProbeMicrosecondsPerSecond = maxMicrosecondsPerSecond;
+}
+
+bool ProbeInstrumentation::HasProbeBudget()
 {
+    return m_maxProbeInvocationsPerSecond != 0 || m_maxProbeMicrosecondsPerSecond != 0;
 }
 
 HRESULT ProbeInstrumentation::RegisterFunctionProbe(FunctionID enterProbeId)
@@ -51,7 +157,7 @@ HRESULT ProbeInstrumentation::RegisterFunctionProbe(FunctionID enterProbeId)
         return E_FAIL;
     }
 
-    m_pAssemblyProbePrep.reset(new (nothrow) AssemblyProbePrep(m_pCorProfilerInfo, enterProbeId));
+    m_pAssemblyProbePrep.reset(new (nothrow) AssemblyProbePrep(m_pCorProfilerInfo, enterProbeId, &m_assemblyProbePrepWorkers));
     IfNullRet(m_pAssemblyProbePrep);
 
     // Consider: Validate the probe's signature before pinning it.
@@ -62,7 +168,35 @@ HRESULT ProbeInstrumentation::RegisterFunctionProbe(FunctionID enterProbeId)
 
 HRESULT ProbeInstrumentation::InitBackgroundService()
 {
+    HRESULT hr = LatencyEventProvider::CreateProvider(m_pCorProfilerInfo, m_pLatencyEventProvider);
+    if (FAILED(hr))
+    {
+        // Latency probes will be rejected, everything else is unaffected.
+        m_pLogger->Log(LogLevel::Warning, _LS("Unable to create the latency event provider: 0x%08x"), hr);
+        m_pLatencyEventProvider.reset();
+    }
+    else
+    {
+        m_latencyFlushThread = thread(&ProbeInstrumentation::LatencyFlushThread, this);
+    }
+
+    if (HasProbeBudget())
+    {
+        m_probeBudgetThread = thread(&ProbeInstrumentation::ProbeBudgetThread, this);
+    }
+
+    for (auto& slot : g_probeFaultNotificationPool)
+    {
+        if (slot.load() == nullptr)
+        {
+            PROBE_FAULT_NOTIFICATION* notification = new (nothrow) PROBE_FAULT_NOTIFICATION();
+            IfNullRet(notification);
+            slot.store(notification);
+        }
+    }
+
     m_probeManagementThread = thread(&ProbeInstrumentation::WorkerThread, this);
+    m_probeFaultThread = thread(&ProbeInstrumentation::ProbeFaultThread, this);
     //
     // Create a dedicated thread for managed callbacks.
     // Performing the callbacks will prevent the calling thread
@@ -104,6 +238,8 @@ void ProbeInstrumentation::ManagedCallbackThread()
             break;
 
         case ProbeWorkerInstruction::INSTALL_PROBES:
+        case ProbeWorkerInstruction::ADD_PROBES:
+        case ProbeWorkerInstruction::ADD_LATENCY_PROBES:
             {
                 lock_guard<mutex> lock(g_probeManagementCallbacksMutex);
                 if (g_probeManagementCallbacks.pProbeInstallationCallback != nullptr)
@@ -123,7 +259,20 @@ void ProbeInstrumentation::ManagedCallbackThread()
             }
             break;
 
+        case ProbeWorkerInstruction::DISABLE_PROBES:
+            {
+                // Only this probe was removed, the others keep capturing.
+                lock_guard<mutex> lock(g_probeManagementCallbacksMutex);
+                if (g_probeManagementCallbacks.pProbeDisabledCallback != nullptr)
+                {
+                    g_probeManagementCallbacks.pProbeDisabledCallback(static_cast<ULONG64>(request.payload.functionId));
+                }
+            }
+            break;
+
         case ProbeWorkerInstruction::UNINSTALL_PROBES:
+        case ProbeWorkerInstruction::REMOVE_PROBES:
+        case ProbeWorkerInstruction::REMOVE_LATENCY_PROBES:
             {
                 lock_guard<mutex> lock(g_probeManagementCallbacksMutex);
                 if (g_probeManagementCallbacks.pProbeUninstallationCallback != nullptr)
@@ -151,64 +300,298 @@ void ProbeInstrumentation::WorkerThread()
     }
 
     MANAGED_CALLBACK_REQUEST callbackRequest = {};
+    vector<PROBE_WORKER_PAYLOAD> batch;
     while (true)
     {
-        PROBE_WORKER_PAYLOAD payload;
-        hr = g_probeManagementQueue.BlockingDequeue(payload);
+        batch.clear();
+        hr = g_probeManagementQueue.BlockingDequeueBatch(batch, MaxWorkerBatchSize);
         if (hr != S_OK)
         {
             break;
         }
 
-        callbackRequest.instruction = payload.instruction;
-        switch (payload.instruction)
+        for (PROBE_WORKER_PAYLOAD& payload : batch)
         {
-        case ProbeWorkerInstruction::REGISTER_PROBE:
-            hr = RegisterFunctionProbe(payload.functionId);
-            if (hr != S_OK)
+            callbackRequest.instruction = payload.instruction;
+            switch (payload.instruction)
             {
-                m_pLogger->Log(LogLevel::Error, _LS("Failed to register function probe: 0x%08x"), hr);
+            case ProbeWorkerInstruction::REGISTER_PROBE:
+                hr = RegisterFunctionProbe(payload.functionId);
+                if (hr != S_OK)
+                {
+                    m_pLogger->Log(LogLevel::Error, _LS("Failed to register function probe: 0x%08x"), hr);
+                }
+                callbackRequest.payload.hr = hr;
+                m_managedCallbackQueue.Enqueue(callbackRequest);
+                break;
+
+            case ProbeWorkerInstruction::INSTALL_PROBES:
+                hr = InstallProbes(payload.requests);
+                if (hr != S_OK)
+                {
+                    m_pLogger->Log(LogLevel::Error, _LS("Failed to install probes: 0x%08x"), hr);
+                }
+                callbackRequest.payload.hr = hr;
+                m_managedCallbackQueue.Enqueue(callbackRequest);
+                break;
+
+            case ProbeWorkerInstruction::UNINSTALL_PROBES:
+                hr = UninstallProbes();
+                if (hr != S_OK)
+                {
+                    m_pLogger->Log(LogLevel::Error, _LS("Failed to uninstall probes: 0x%08x"), hr);
+                }
+                callbackRequest.payload.hr = hr;
+                m_managedCallbackQueue.Enqueue(callbackRequest);
+                break;
+
+            case ProbeWorkerInstruction::ADD_PROBES:
+                hr = AddProbes(payload.requests);
+                if (FAILED(hr))
+                {
+                    m_pLogger->Log(LogLevel::Error, _LS("Failed to add probes: 0x%08x"), hr);
+                }
+                callbackRequest.payload.hr = hr;
+                m_managedCallbackQueue.Enqueue(callbackRequest);
+                break;
+
+            case ProbeWorkerInstruction::REMOVE_PROBES:
+                hr = RemoveProbes(payload.functionIds);
+                if (FAILED(hr))
+                {
+                    m_pLogger->Log(LogLevel::Error, _LS("Failed to remove probes: 0x%08x"), hr);
+                }
+                callbackRequest.payload.hr = hr;
+                m_managedCallbackQueue.Enqueue(callbackRequest);
+                break;
+
+            case ProbeWorkerInstruction::ADD_LATENCY_PROBES:
+                hr = AddLatencyProbes(payload.functionIds);
+                if (FAILED(hr))
+                {
+                    m_pLogger->Log(LogLevel::Error, _LS("Failed to add latency probes: 0x%08x"), hr);
+                }
+                callbackRequest.payload.hr = hr;
+                m_managedCallbackQueue.Enqueue(callbackRequest);
+                break;
+
+            case ProbeWorkerInstruction::REMOVE_LATENCY_PROBES:
+                hr = RemoveLatencyProbes(payload.functionIds);
+                if (FAILED(hr))
+                {
+                    m_pLogger->Log(LogLevel::Error, _LS("Failed to remove latency probes: 0x%08x"), hr);
+                }
+                callbackRequest.payload.hr = hr;
+                m_managedCallbackQueue.Enqueue(callbackRequest);
+                break;
+
+            case ProbeWorkerInstruction::DISABLE_PROBES:
+                // Not requested by the managed side; each disabled probe is reported individually.
+                hr = DisableProbes(payload.functionIds);
+                if (FAILED(hr))
+                {
+                    m_pLogger->Log(LogLevel::Error, _LS("Failed to disable probes: 0x%08x"), hr);
+                }
+                break;
+
+            default:
+                m_pLogger->Log(LogLevel::Error, _LS("Unknown message"));
+                break;
             }
-            callbackRequest.payload.hr = hr;
-            m_managedCallbackQueue.Enqueue(callbackRequest);
+        }
+    }
+}
+
+void ProbeInstrumentation::ProbeFaultThread()
+{
+    MANAGED_CALLBACK_REQUEST callbackRequest = {};
+    callbackRequest.instruction = ProbeWorkerInstruction::FAULTING_PROBE;
+
+    while (true)
+    {
+        unique_ptr<PROBE_FAULT_NOTIFICATION> notification;
+        HRESULT hr = g_probeFaultQueue.BlockingDequeue(notification);
+        if (hr != S_OK)
+        {
             break;
+        }
 
-        case ProbeWorkerInstruction::INSTALL_PROBES:
-            hr = InstallProbes(payload.requests);
-            if (hr != S_OK)
+        m_pLogger->Log(LogLevel::Error, _LS("Function probe faulting in function: 0x%08x"), notification->functionId);
+        callbackRequest.payload.functionId = notification->functionId;
+        m_managedCallbackQueue.Enqueue(callbackRequest);
+
+        ReturnProbeFaultNotification(notification.release());
+
+        ULONG64 droppedCount = g_droppedProbeFaultCount.exchange(0, memory_order_relaxed);
+        if (droppedCount > 0)
+        {
+            m_pLogger->Log(LogLevel::Error, _LS("Dropped %llu probe fault notifications"), static_cast<unsigned long long>(droppedCount));
+        }
+    }
+}
+
+void ProbeInstrumentation::LatencyFlushThread()
+{
+    HRESULT hr = m_pCorProfilerInfo->InitializeCurrentThread();
+    if (FAILED(hr))
+    {
+        m_pLogger->Log(LogLevel::Error, _LS("Unable to initialize thread: 0x%08x"), hr);
+        return;
+    }
+
+    unique_lock<mutex> lock(m_latencyFlushMutex);
+    while (!m_latencyFlushStopped)
+    {
+        m_latencyFlushCondition.wait_for(
+            lock,
+            chrono::milliseconds(m_latencyFlushIntervalMilliseconds),
+            [this]() { return m_latencyFlushStopped; });
+
+        // Also flushes once more on shutdown, so that the last interval is not lost.
+        lock.unlock();
+        FlushLatencyHistograms();
+        lock.lock();
+    }
+}
+
+void ProbeInstrumentation::FlushLatencyHistograms()
+{
+    HRESULT hr;
+
+    try
+    {
+        // Histograms are never freed, so they can be drained without holding the lock.
+        vector<LatencyHistogram*> histograms;
+        {
+            lock_guard<mutex> lock(m_latencyHistogramsMutex);
+            histograms.reserve(m_latencyHistograms.size());
+            for (auto const& histogram : m_latencyHistograms)
             {
-                m_pLogger->Log(LogLevel::Error, _LS("Failed to install probes: 0x%08x"), hr);
+                histograms.push_back(histogram.second.get());
             }
-            callbackRequest.payload.hr = hr;
-            m_managedCallbackQueue.Enqueue(callbackRequest);
-            break;
+        }
 
-        case ProbeWorkerInstruction::FAULTING_PROBE:
-            m_pLogger->Log(LogLevel::Error, _LS("Function probe faulting in function: 0x%08x"), payload.functionId);
-            callbackRequest.payload.functionId = payload.functionId;
-            m_managedCallbackQueue.Enqueue(callbackRequest);
-            break;
+        LATENCY_HISTOGRAM_SNAPSHOT snapshot;
+        for (LatencyHistogram* pHistogram : histograms)
+        {
+            if (!pHistogram->Drain(snapshot))
+            {
+                continue;
+            }
 
-        case ProbeWorkerInstruction::UNINSTALL_PROBES:
-            hr = UninstallProbes();
-            if (hr != S_OK)
+            hr = m_pLatencyEventProvider->WriteLatencyHistogram(pHistogram->GetFunctionId(), snapshot);
+            if (FAILED(hr))
             {
-                m_pLogger->Log(LogLevel::Error, _LS("Failed to uninstall probes: 0x%08x"), hr);
+                m_pLogger->Log(LogLevel::Error, _LS("Failed to write latency histogram: 0x%08x"), hr);
             }
-            callbackRequest.payload.hr = hr;
-            m_managedCallbackQueue.Enqueue(callbackRequest);
-            break;
+        }
+    }
+    catch (const std::bad_alloc&)
+    {
+        m_pLogger->Log(LogLevel::Error, _LS("Failed to flush latency histograms: 0x%08x"), E_OUTOFMEMORY);
+    }
+}
 
-        default:
-            m_pLogger->Log(LogLevel::Error, _LS("Unknown message"));
+HRESULT ProbeInstrumentation::UnregisterLatencyHistogram(ModuleID moduleId, mdMethodDef methodDef)
+{
+    m_pLogger->Log(LogLevel::Warning, _LS("Method uses jmp and can't be timed - moduleId: 0x%08x, methodDef: 0x%04x"), moduleId, methodDef);
+
+    START_NO_OOM_THROW_REGION;
+
+    lock_guard<mutex> lock(m_latencyHistogramsMutex);
+
+    auto it = m_latencyHistograms.find({moduleId, methodDef});
+    if (it != m_latencyHistograms.end())
+    {
+        m_unregisteredLatencyHistograms.push_back(std::move(it->second));
+        m_latencyHistograms.erase(it);
+    }
+
+    END_NO_OOM_THROW_REGION;
+
+    return S_OK;
+}
+
+void ProbeInstrumentation::ProbeBudgetThread()
+{
+    unique_lock<mutex> lock(m_probeBudgetMutex);
+    chrono::steady_clock::time_point lastCheck = chrono::steady_clock::now();
+    while (!m_probeBudgetStopped)
+    {
+        m_probeBudgetCondition.wait_for(
+            lock,
+            chrono::milliseconds(static_cast<ULONG32>(ProbeBudgetIntervalMilliseconds)),
+            [this]() { return m_probeBudgetStopped; });
+
+        if (m_probeBudgetStopped)
+        {
             break;
         }
+
+        chrono::steady_clock::time_point now = chrono::steady_clock::now();
+        UINT64 elapsedMilliseconds = static_cast<UINT64>(chrono::duration_cast<chrono::milliseconds>(now - lastCheck).count());
+        lastCheck = now;
+
+        lock.unlock();
+        CheckProbeBudgets(elapsedMilliseconds);
+        lock.lock();
+    }
+}
+
+void ProbeInstrumentation::CheckProbeBudgets(UINT64 elapsedMilliseconds)
+{
+    if (elapsedMilliseconds == 0)
+    {
+        return;
+    }
+
+    try
+    {
+        PROBE_WORKER_PAYLOAD payload = {};
+        payload.instruction = ProbeWorkerInstruction::DISABLE_PROBES;
+
+        {
+            // Counters are only read by this thread; the lock only protects the map.
+            lock_guard<mutex> lock(m_overheadCountersMutex);
+            for (auto const& counters : m_overheadCounters)
+            {
+                UINT64 invocations;
+                UINT64 nanoseconds;
+                counters.second->GetDelta(invocations, nanoseconds);
+
+                UINT64 invocationsPerSecond = invocations * 1000 / elapsedMilliseconds;
+                UINT64 microsecondsPerSecond = nanoseconds / elapsedMilliseconds;
+
+                if ((m_maxProbeInvocationsPerSecond != 0 && invocationsPerSecond > m_maxProbeInvocationsPerSecond) ||
+                    (m_maxProbeMicrosecondsPerSecond != 0 && microsecondsPerSecond > m_maxProbeMicrosecondsPerSecond))
+                {
+                    m_pLogger->Log(
+                        LogLevel::Warning,
+                        _LS("Disabling function probe in function 0x%08x: %llu calls/s, %llu us/s"),
+                        counters.second->GetFunctionId(),
+                        invocationsPerSecond,
+                        microsecondsPerSecond);
+                    payload.functionIds.push_back(counters.second->GetFunctionId());
+                }
+            }
+        }
+
+        if (!payload.functionIds.empty())
+        {
+            // Probes are only changed on the worker thread.
+            g_probeManagementQueue.Enqueue(std::move(payload));
+        }
+    }
+    catch (const std::bad_alloc&)
+    {
+        m_pLogger->Log(LogLevel::Error, _LS("Failed to check probe budgets: 0x%08x"), E_OUTOFMEMORY);
     }
 }
 
 void ProbeInstrumentation::DisableIncomingRequests()
 {
     g_probeManagementQueue.Complete();
+    g_probeFaultQueue.Complete();
 }
 
 void ProbeInstrumentation::ShutdownBackgroundService()
@@ -217,26 +600,70 @@ void ProbeInstrumentation::ShutdownBackgroundService()
     m_managedCallbackQueue.Complete();
     m_managedCallbackThread.join();
     m_probeManagementThread.join();
+    m_probeFaultThread.join();
+    m_assemblyProbePrepWorkers.Shutdown();
+
+    for (auto& slot : g_probeFaultNotificationPool)
+    {
+        delete slot.exchange(nullptr);
+    }
+
+    {
+        lock_guard<mutex> lock(m_latencyFlushMutex);
+        m_latencyFlushStopped = true;
+    }
+    m_latencyFlushCondition.notify_all();
+    if (m_latencyFlushThread.joinable())
+    {
+        m_latencyFlushThread.join();
+    }
+
+    {
+        lock_guard<mutex> lock(m_probeBudgetMutex);
+        m_probeBudgetStopped = true;
+    }
+    m_probeBudgetCondition.notify_all();
+    if (m_probeBudgetThread.joinable())
+    {
+        m_probeBudgetThread.join();
+    }
 }
 
 void STDMETHODCALLTYPE ProbeInstrumentation::OnFunctionProbeFault(ULONG64 uniquifier)
 {
-    PROBE_WORKER_PAYLOAD payload = {};
-    payload.instruction = ProbeWorkerInstruction::FAULTING_PROBE;
+    //
+    // This is called on the application thread that hit the fault.
+    // Avoid any locks or allocations so that the thread never blocks on the probe management threads.
+    //
+    PROBE_FAULT_NOTIFICATION* notification = TakeProbeFaultNotification();
+    if (notification == nullptr)
+    {
+        g_droppedProbeFaultCount.fetch_add(1, memory_order_relaxed);
+        return;
+    }
 
     //
     // For now the uniquifier can only ever be the function's id.
-    // If this changes in the future, add a new payload field.
+    // If this changes in the future, add a new field.
     //
-    payload.functionId = static_cast<FunctionID>(uniquifier);
-    g_probeManagementQueue.Enqueue(payload);
+    notification->functionId = static_cast<FunctionID>(uniquifier);
+
+    unique_ptr<PROBE_FAULT_NOTIFICATION> pendingNotification(notification);
+    if (FAILED(g_probeFaultQueue.Enqueue(std::move(pendingNotification))))
+    {
+        // The queue no longer accepts notifications once the profiler is shutting down.
+        ReturnProbeFaultNotification(pendingNotification.release());
+    }
 }
 
-STDAPI DLLEXPORT RequestFunctionProbeInstallation(
+static HRESULT EnqueueInstrumentationRequests(
+    ProbeWorkerInstruction instruction,
     ULONG64 functionIds[],
     ULONG32 count,
     PARAMETER_BOXING_INSTRUCTIONS boxingInstructions[],
-    ULONG32 parameterCounts[])
+    ULONG32 parameterCounts[],
+    ULONG32 samplingIntervals[],
+    PROBE_PREDICATE predicates[])
 {
     HRESULT hr;
 
@@ -287,186 +714,880 @@ STDAPI DLLEXPORT RequestFunctionProbeInstallation(
 
         UNPROCESSED_INSTRUMENTATION_REQUEST request;
         request.functionId = static_cast<FunctionID>(functionIds[i]);
-        request.boxingInstructions = instructions;
+        request.boxingInstructions = std::move(instructions);
+        request.samplingInterval = (samplingIntervals != nullptr) ? samplingIntervals[i] : 0;
+        request.predicate = {};
+        if (predicates != nullptr)
+        {
+            IfFailRet(ProbeInjector::ValidatePredicate(predicates[i], request.boxingInstructions));
+            request.predicate = predicates[i];
+        }
 
-        requests.push_back(request);
+        requests.push_back(std::move(request));
     }
 
     PROBE_WORKER_PAYLOAD payload = {};
-    payload.instruction = ProbeWorkerInstruction::INSTALL_PROBES;
-    payload.requests = requests;
-    IfFailRet(g_probeManagementQueue.Enqueue(payload));
+    payload.instruction = instruction;
+    payload.requests = std::move(requests);
+    IfFailRet(g_probeManagementQueue.Enqueue(std::move(payload)));
 
     END_NO_OOM_THROW_REGION;
 
     return S_OK;
 }
 
-STDAPI DLLEXPORT RequestFunctionProbeUninstallation()
+static HRESULT EnqueueFunctionIds(
+    ProbeWorkerInstruction instruction,
+    ULONG64 functionIds[],
+    ULONG32 count)
 {
     HRESULT hr;
 
+    START_NO_OOM_THROW_REGION;
+
     PROBE_WORKER_PAYLOAD payload = {};
-    payload.instruction = ProbeWorkerInstruction::UNINSTALL_PROBES;
-    IfFailRet(g_probeManagementQueue.Enqueue(payload));
+    payload.instruction = instruction;
+    payload.functionIds.reserve(count);
+    for (ULONG32 i = 0; i < count; i++)
+    {
+        payload.functionIds.push_back(static_cast<FunctionID>(functionIds[i]));
+    }
+    IfFailRet(g_probeManagementQueue.Enqueue(std::move(payload)));
+
+    END_NO_OOM_THROW_REGION;
 
     return S_OK;
 }
 
-STDAPI DLLEXPORT RequestFunctionProbeRegistration(ULONG64 enterProbeId)
+STDAPI DLLEXPORT RequestFunctionProbeInstallation(
+    ULONG64 functionIds[],
+    ULONG32 count,
+    PARAMETER_BOXING_INSTRUCTIONS boxingInstructions[],
+    ULONG32 parameterCounts[],
+    PROBE_PREDICATE predicates[])
 {
-    HRESULT hr;
-
-    PROBE_WORKER_PAYLOAD payload = {};
-    payload.instruction = ProbeWorkerInstruction::REGISTER_PROBE;
-    payload.functionId = static_cast<FunctionID>(enterProbeId);
-    IfFailRet(g_probeManagementQueue.Enqueue(payload));
-
-    return S_OK;
+    //
+    // Installs probes into exactly the requested functions.
+    // Fails if any probes are already installed; see RequestFunctionProbeAddition.
+    //
+    // predicates is optional; when provided, only calls into function i whose arguments
+    // satisfy predicates[i] reach the probe (a comparison of NONE matches every call).
+    //
+    return EnqueueInstrumentationRequests(
+        ProbeWorkerInstruction::INSTALL_PROBES,
+        functionIds,
+        count,
+        boxingInstructions,
+        parameterCounts,
+        nullptr,
+        predicates);
 }
 
-bool ProbeInstrumentation::HasRegisteredProbe()
+STDAPI DLLEXPORT RequestFunctionProbeAddition(
+    ULONG64 functionIds[],
+    ULONG32 count,
+    PARAMETER_BOXING_INSTRUCTIONS boxingInstructions[],
+    ULONG32 parameterCounts[],
+    ULONG32 samplingIntervals[],
+    PROBE_PREDICATE predicates[])
 {
-    return m_probeFunctionId != 0;
+    //
+    // Adds probes to the requested functions alongside any that are already installed.
+    // Only functions that are not yet instrumented are rejitted; the others gain a reference.
+    // Completion is reported through the installation callback.
+    //
+    // samplingIntervals is optional; when provided, only every samplingIntervals[i]'th call
+    // into function i reaches the probe (0 uses the default interval).
+    // predicates is optional, see RequestFunctionProbeInstallation. Sampling only counts matching calls.
+    //
+    return EnqueueInstrumentationRequests(
+        ProbeWorkerInstruction::ADD_PROBES,
+        functionIds,
+        count,
+        boxingInstructions,
+        parameterCounts,
+        samplingIntervals,
+        predicates);
 }
 
-HRESULT ProbeInstrumentation::InstallProbes(vector<UNPROCESSED_INSTRUMENTATION_REQUEST>& requests)
+STDAPI DLLEXPORT RequestFunctionProbeRemoval(
+    ULONG64 functionIds[],
+    ULONG32 count)
 {
-    HRESULT hr;
+    //
+    // Releases one reference on each of the requested functions' probes,
+    // reverting only the functions that are no longer referenced.
+    // Completion is reported through the uninstallation callback.
+    //
+    return EnqueueFunctionIds(ProbeWorkerInstruction::REMOVE_PROBES, functionIds, count);
+}
 
+STDAPI DLLEXPORT RequestFunctionLatencyProbeAddition(
+    ULONG64 functionIds[],
+    ULONG32 count)
+{
+    //
+    // Times every call to the requested functions, alongside any probes they already have.
+    // Latency probes are reference counted independently of argument probes.
+    // Completion is reported through the installation callback.
+    //
+    return EnqueueFunctionIds(ProbeWorkerInstruction::ADD_LATENCY_PROBES, functionIds, count);
+}
+
+STDAPI DLLEXPORT RequestFunctionLatencyProbeRemoval(
+    ULONG64 functionIds[],
+    ULONG32 count)
+{
+    //
+    // Releases one reference on each of the requested functions' latency probes.
+    // Completion is reported through the uninstallation callback.
+    //
+    return EnqueueFunctionIds(ProbeWorkerInstruction::REMOVE_LATENCY_PROBES, functionIds, count);
+}
+
+STDAPI DLLEXPORT RequestFunctionProbeUninstallation()
+{
+    HRESULT hr;
+
+    PROBE_WORKER_PAYLOAD payload = {};
+    payload.instruction = ProbeWorkerInstruction::UNINSTALL_PROBES;
+    IfFailRet(g_probeManagementQueue.Enqueue(std::move(payload)));
+
+    return S_OK;
+}
+
+STDAPI DLLEXPORT RequestFunctionProbeRegistration(ULONG64 enterProbeId)
+{
+    HRESULT hr;
+
+    PROBE_WORKER_PAYLOAD payload = {};
+    payload.instruction = ProbeWorkerInstruction::REGISTER_PROBE;
+    payload.functionId = static_cast<FunctionID>(enterProbeId);
+    IfFailRet(g_probeManagementQueue.Enqueue(std::move(payload)));
+
+    return S_OK;
+}
+
+bool ProbeInstrumentation::HasRegisteredProbe()
+{
+    return m_probeFunctionId != 0;
+}
+
+HRESULT ProbeInstrumentation::InstallProbes(vector<UNPROCESSED_INSTRUMENTATION_REQUEST>& requests)
+{
     m_pLogger->Log(LogLevel::Debug, _LS("Installing function probes"));
 
     lock_guard<mutex> lock(m_instrumentationProcessingMutex);
 
     if (!HasRegisteredProbe() ||
-        AreProbesInstalled())
+        AreProbesInstalled())
+    {
+        return E_FAIL;
+    }
+
+    return AddProbesInternal(requests);
+}
+
+HRESULT ProbeInstrumentation::AddProbes(vector<UNPROCESSED_INSTRUMENTATION_REQUEST>& requests)
+{
+    m_pLogger->Log(LogLevel::Debug, _LS("Adding function probes"));
+
+    lock_guard<mutex> lock(m_instrumentationProcessingMutex);
+
+    if (!HasRegisteredProbe())
+    {
+        return E_FAIL;
+    }
+
+    return AddProbesInternal(requests);
+}
+
+HRESULT ProbeInstrumentation::AddProbesInternal(vector<UNPROCESSED_INSTRUMENTATION_REQUEST>& requests)
+{
+    HRESULT hr;
+
+    //
+    // Expects m_instrumentationProcessingMutex to be held.
+    // Nothing is committed to m_activeInstrumentationRequests until the rejit has been requested,
+    // so a failure leaves the installed probes untouched.
+    //
+
+    START_NO_OOM_THROW_REGION;
+
+    unordered_map<pair<ModuleID, mdMethodDef>, ACTIVE_INSTRUMENTATION_REQUEST, PairHash<ModuleID, mdMethodDef>> newRequests;
+    vector<pair<ModuleID, mdMethodDef>> addedReferences;
+
+    vector<ModuleID> requestedModuleIds;
+    vector<mdMethodDef> requestedMethodDefs;
+
+    requestedModuleIds.reserve(requests.size());
+    requestedMethodDefs.reserve(requests.size());
+
+    // New methods are processed once all of their modules have been prepared.
+    vector<pair<const UNPROCESSED_INSTRUMENTATION_REQUEST*, pair<ModuleID, mdMethodDef>>> pendingRequests;
+
+    for (auto const& req : requests)
+    {
+        INSTRUMENTATION_REQUEST processedRequest;
+
+        if (req.functionId == m_probeFunctionId)
+        {
+            return E_INVALIDARG;
+        }
+
+        IfFailLogRet(m_pCorProfilerInfo->GetFunctionInfo2(
+            req.functionId,
+            NULL,
+            nullptr,
+            &processedRequest.moduleId,
+            &processedRequest.methodDef,
+            0,
+            nullptr,
+            nullptr));
+
+        pair<ModuleID, mdMethodDef> key(processedRequest.moduleId, processedRequest.methodDef);
+
+        // Already instrumented (or requested twice); only take another reference.
+        if (m_activeInstrumentationRequests.find(key) != m_activeInstrumentationRequests.end())
+        {
+            addedReferences.push_back(key);
+            continue;
+        }
+
+        auto const& newIt = newRequests.find(key);
+        if (newIt != newRequests.end())
+        {
+            newIt->second.refCount++;
+            continue;
+        }
+
+        requestedModuleIds.push_back(processedRequest.moduleId);
+        requestedMethodDefs.push_back(processedRequest.methodDef);
+        pendingRequests.push_back({&req, key});
+
+        ACTIVE_INSTRUMENTATION_REQUEST activeRequest;
+        activeRequest.request = std::move(processedRequest);
+        activeRequest.refCount = 1;
+        newRequests.insert({key, std::move(activeRequest)});
+    }
+
+    // Distinct modules are prepared in parallel; previously prepared modules are served from the cache.
+    IfFailLogRet(m_pAssemblyProbePrep->PrepareAssembliesForProbes(requestedModuleIds));
+
+    for (auto const& pendingRequest : pendingRequests)
+    {
+        IfFailRet(ProcessRequest(*pendingRequest.first, newRequests[pendingRequest.second].request));
+    }
+
+    IfFailRet(RequestProbeReJIT(requestedModuleIds, requestedMethodDefs));
+
+    m_activeInstrumentationRequests.reserve(m_activeInstrumentationRequests.size() + newRequests.size());
+    for (auto& newRequest : newRequests)
+    {
+        m_activeInstrumentationRequests.insert(std::move(newRequest));
+    }
+
+    for (auto const& key : addedReferences)
+    {
+        m_activeInstrumentationRequests[key].refCount++;
+    }
+
+    m_pLogger->Log(LogLevel::Debug, _LS("Rejitting %zu of %zu requested functions"), requestedModuleIds.size(), requests.size());
+
+    END_NO_OOM_THROW_REGION;
+
+    return S_OK;
+}
+
+HRESULT ProbeInstrumentation::ProcessRequest(const UNPROCESSED_INSTRUMENTATION_REQUEST& req, INSTRUMENTATION_REQUEST& processedRequest)
+{
+    HRESULT hr;
+
+    // For now just use the function id as the uniquifier.
+    // Consider allowing the caller to specify one.
+    processedRequest.uniquifier = static_cast<ULONG64>(req.functionId);
+    processedRequest.captureArguments = true;
+    processedRequest.pLatencyHistogram = nullptr;
+
+    ComPtr<IMetaDataEmit> pMetadataEmit;
+    IfFailRet(m_pCorProfilerInfo->GetModuleMetaData(
+        processedRequest.moduleId,
+        ofRead | ofWrite,
+        IID_IMetaDataEmit,
+        reinterpret_cast<IUnknown **>(&pMetadataEmit)));
+
+    START_NO_OOM_THROW_REGION;
+
+    // Process the boxing instructions, converting any typespecs into metadata tokens.
+    processedRequest.boxingInstructions.reserve(req.boxingInstructions.size());
+    for (auto const& instructions : req.boxingInstructions)
+    {
+        PARAMETER_BOXING_INSTRUCTIONS newInstructions = {};
+        if (instructions.instructionType == InstructionType::TYPESPEC)
+        {
+            newInstructions.instructionType = InstructionType::METADATA_TOKEN;
+            IfFailRet(pMetadataEmit->GetTokenFromTypeSpec(
+                instructions.signatureBufferPointer,
+                instructions.signatureBufferLength,
+                &newInstructions.token.mdToken));
+        }
+        else
+        {
+            newInstructions = instructions;
+        }
+
+        processedRequest.boxingInstructions.push_back(newInstructions);
+    }
+
+    END_NO_OOM_THROW_REGION;
+
+    // The module is prepared by the caller.
+    if (!m_pAssemblyProbePrep->TryGetAssemblyPrepData(processedRequest.moduleId, processedRequest.pAssemblyData))
+    {
+        return E_UNEXPECTED;
+    }
+
+    processedRequest.predicate = req.predicate;
+    processedRequest.pOverheadCounters = nullptr;
+    if (HasProbeBudget())
+    {
+        START_NO_OOM_THROW_REGION;
+
+        lock_guard<mutex> lock(m_overheadCountersMutex);
+
+        unique_ptr<ProbeOverheadCounters>& pCounters = m_overheadCounters[{processedRequest.moduleId, processedRequest.methodDef}];
+        if (!pCounters)
+        {
+            pCounters.reset(new ProbeOverheadCounters(req.functionId));
+        }
+        processedRequest.pOverheadCounters = pCounters.get();
+
+        END_NO_OOM_THROW_REGION;
+    }
+    processedRequest.samplingInterval = (req.samplingInterval != 0) ? req.samplingInterval : m_defaultSamplingInterval;
+    processedRequest.pSamplingCounter = nullptr;
+    if (processedRequest.samplingInterval > 1)
+    {
+        if (processedRequest.samplingInterval > INT32_MAX)
+        {
+            return E_INVALIDARG;
+        }
+
+        START_NO_OOM_THROW_REGION;
+
+        unique_ptr<LONG>& pCounter = m_samplingCounters[{processedRequest.moduleId, processedRequest.methodDef}];
+        if (!pCounter)
+        {
+            pCounter.reset(new LONG);
+        }
+
+        // Sample the first call.
+        *pCounter = 1;
+        processedRequest.pSamplingCounter = pCounter.get();
+
+        END_NO_OOM_THROW_REGION;
+    }
+
+    return S_OK;
+}
+
+HRESULT ProbeInstrumentation::RemoveProbes(const vector<FunctionID>& functionIds)
+{
+    m_pLogger->Log(LogLevel::Debug, _LS("Removing function probes"));
+
+    lock_guard<mutex> lock(m_instrumentationProcessingMutex);
+
+    if (!HasRegisteredProbe())
+    {
+        return E_FAIL;
+    }
+
+    return RemoveProbesInternal(m_activeInstrumentationRequests, m_activeLatencyRequests, functionIds);
+}
+
+HRESULT ProbeInstrumentation::AddLatencyProbes(const vector<FunctionID>& functionIds)
+{
+    HRESULT hr;
+
+    m_pLogger->Log(LogLevel::Debug, _LS("Adding latency probes"));
+
+    lock_guard<mutex> lock(m_instrumentationProcessingMutex);
+
+    // The registered probe is only needed to prepare the module's metadata.
+    if (!HasRegisteredProbe() ||
+        !m_pLatencyEventProvider)
+    {
+        return E_FAIL;
+    }
+
+    START_NO_OOM_THROW_REGION;
+
+    ActiveInstrumentationRequests newRequests;
+    vector<pair<ModuleID, mdMethodDef>> addedReferences;
+
+    vector<ModuleID> requestedModuleIds;
+    vector<mdMethodDef> requestedMethodDefs;
+
+    for (FunctionID functionId : functionIds)
+    {
+        INSTRUMENTATION_REQUEST request;
+
+        if (functionId == m_probeFunctionId)
+        {
+            return E_INVALIDARG;
+        }
+
+        IfFailLogRet(m_pCorProfilerInfo->GetFunctionInfo2(
+            functionId,
+            NULL,
+            nullptr,
+            &request.moduleId,
+            &request.methodDef,
+            0,
+            nullptr,
+            nullptr));
+
+        pair<ModuleID, mdMethodDef> key(request.moduleId, request.methodDef);
+
+        // Already timed since its first call.
+        if (IsStartupProbedMethod(key))
+        {
+            continue;
+        }
+
+        if (m_activeLatencyRequests.find(key) != m_activeLatencyRequests.end())
+        {
+            addedReferences.push_back(key);
+            continue;
+        }
+
+        auto const& newIt = newRequests.find(key);
+        if (newIt != newRequests.end())
+        {
+            newIt->second.refCount++;
+            continue;
+        }
+
+        request.uniquifier = static_cast<ULONG64>(functionId);
+        request.captureArguments = false;
+        request.samplingInterval = 0;
+        request.pSamplingCounter = nullptr;
+        request.predicate = {};
+        request.pOverheadCounters = nullptr;
+
+        {
+            lock_guard<mutex> histogramsLock(m_latencyHistogramsMutex);
+
+            unique_ptr<LatencyHistogram>& pHistogram = m_latencyHistograms[key];
+            if (!pHistogram)
+            {
+                pHistogram.reset(new LatencyHistogram(functionId));
+            }
+            request.pLatencyHistogram = pHistogram.get();
+        }
+
+        requestedModuleIds.push_back(request.moduleId);
+        requestedMethodDefs.push_back(request.methodDef);
+
+        ACTIVE_INSTRUMENTATION_REQUEST activeRequest;
+        activeRequest.request = std::move(request);
+        activeRequest.refCount = 1;
+        newRequests.insert({key, std::move(activeRequest)});
+    }
+
+    IfFailLogRet(m_pAssemblyProbePrep->PrepareAssembliesForProbes(requestedModuleIds));
+
+    for (auto& newRequest : newRequests)
+    {
+        INSTRUMENTATION_REQUEST& request = newRequest.second.request;
+        if (!m_pAssemblyProbePrep->TryGetAssemblyPrepData(request.moduleId, request.pAssemblyData))
+        {
+            return E_UNEXPECTED;
+        }
+    }
+
+    IfFailRet(RequestProbeReJIT(requestedModuleIds, requestedMethodDefs));
+
+    m_activeLatencyRequests.reserve(m_activeLatencyRequests.size() + newRequests.size());
+    for (auto& newRequest : newRequests)
+    {
+        m_activeLatencyRequests.insert(std::move(newRequest));
+    }
+
+    for (auto const& key : addedReferences)
+    {
+        m_activeLatencyRequests[key].refCount++;
+    }
+
+    m_pLogger->Log(LogLevel::Debug, _LS("Timing %zu of %zu requested functions"), requestedModuleIds.size(), functionIds.size());
+
+    END_NO_OOM_THROW_REGION;
+
+    return S_OK;
+}
+
+HRESULT ProbeInstrumentation::RemoveLatencyProbes(const vector<FunctionID>& functionIds)
+{
+    m_pLogger->Log(LogLevel::Debug, _LS("Removing latency probes"));
+
+    lock_guard<mutex> lock(m_instrumentationProcessingMutex);
+
+    if (!HasRegisteredProbe())
+    {
+        return E_FAIL;
+    }
+
+    return RemoveProbesInternal(m_activeLatencyRequests, m_activeInstrumentationRequests, functionIds);
+}
+
+HRESULT ProbeInstrumentation::DisableProbes(const vector<FunctionID>& functionIds)
+{
+    HRESULT hr;
+
+    m_pLogger->Log(LogLevel::Debug, _LS("Disabling function probes"));
+
+    lock_guard<mutex> lock(m_instrumentationProcessingMutex);
+
+    START_NO_OOM_THROW_REGION;
+
+    vector<pair<ModuleID, mdMethodDef>> methods;
+    vector<FunctionID> disabledFunctionIds;
+    for (FunctionID functionId : functionIds)
+    {
+        ModuleID moduleId;
+        mdMethodDef methodDef;
+        IfFailLogRet(m_pCorProfilerInfo->GetFunctionInfo2(
+            functionId,
+            NULL,
+            nullptr,
+            &moduleId,
+            &methodDef,
+            0,
+            nullptr,
+            nullptr));
+
+        // The method's previous code can still be running after its probe was removed.
+        pair<ModuleID, mdMethodDef> key(moduleId, methodDef);
+        if (m_activeInstrumentationRequests.find(key) == m_activeInstrumentationRequests.end() ||
+            find(methods.begin(), methods.end(), key) != methods.end())
+        {
+            continue;
+        }
+
+        methods.push_back(key);
+        disabledFunctionIds.push_back(functionId);
+    }
+
+    // Latency probes are not affected.
+    IfFailRet(ReleaseMethods(methods, m_activeLatencyRequests));
+
+    for (auto const& method : methods)
+    {
+        m_activeInstrumentationRequests.erase(method);
+    }
+
+    MANAGED_CALLBACK_REQUEST callbackRequest = {};
+    callbackRequest.instruction = ProbeWorkerInstruction::DISABLE_PROBES;
+    for (FunctionID functionId : disabledFunctionIds)
+    {
+        callbackRequest.payload.functionId = functionId;
+        m_managedCallbackQueue.Enqueue(callbackRequest);
+    }
+
+    END_NO_OOM_THROW_REGION;
+
+    return S_OK;
+}
+
+HRESULT ProbeInstrumentation::RemoveProbesInternal(
+    ActiveInstrumentationRequests& activeRequests,
+    const ActiveInstrumentationRequests& otherActiveRequests,
+    const vector<FunctionID>& functionIds)
+{
+    HRESULT hr;
+
+    //
+    // Expects m_instrumentationProcessingMutex to be held.
+    // Methods that are no longer referenced in activeRequests are reverted,
+    // or rejitted with only their remaining probes if otherActiveRequests still references them.
+    //
+
+    bool allFound = true;
+
+    START_NO_OOM_THROW_REGION;
+
+    unordered_map<pair<ModuleID, mdMethodDef>, ULONG, PairHash<ModuleID, mdMethodDef>> releasedReferences;
+    for (FunctionID functionId : functionIds)
+    {
+        ModuleID moduleId;
+        mdMethodDef methodDef;
+        IfFailLogRet(m_pCorProfilerInfo->GetFunctionInfo2(
+            functionId,
+            NULL,
+            nullptr,
+            &moduleId,
+            &methodDef,
+            0,
+            nullptr,
+            nullptr));
+
+        pair<ModuleID, mdMethodDef> key(moduleId, methodDef);
+        auto const& it = activeRequests.find(key);
+        if (it == activeRequests.end() ||
+            it->second.refCount <= releasedReferences[key])
+        {
+            // Not instrumented, or every reference has already been released by this request.
+            allFound = false;
+            continue;
+        }
+
+        releasedReferences[key]++;
+    }
+
+    vector<pair<ModuleID, mdMethodDef>> releasedMethods;
+
+    for (auto const& released : releasedReferences)
+    {
+        if (released.second > 0 &&
+            activeRequests[released.first].refCount == released.second)
+        {
+            releasedMethods.push_back(released.first);
+        }
+    }
+
+    IfFailRet(ReleaseMethods(releasedMethods, otherActiveRequests));
+
+    for (auto const& released : releasedReferences)
+    {
+        auto const& it = activeRequests.find(released.first);
+        if (it == activeRequests.end())
+        {
+            continue;
+        }
+
+        it->second.refCount -= released.second;
+        if (it->second.refCount == 0)
+        {
+            activeRequests.erase(it);
+        }
+    }
+
+    m_pLogger->Log(LogLevel::Debug, _LS("Releasing %zu of %zu requested functions"), releasedMethods.size(), functionIds.size());
+
+    END_NO_OOM_THROW_REGION;
+
+    return allFound ? S_OK : S_FALSE;
+}
+
+HRESULT ProbeInstrumentation::UninstallProbes()
+{
+    HRESULT hr;
+
+    m_pLogger->Log(LogLevel::Debug, _LS("Uninstalling function probes"));
+
+    lock_guard<mutex> lock(m_instrumentationProcessingMutex);
+
+    if (!HasRegisteredProbe() ||
+        !AreProbesInstalled())
     {
-        return E_FAIL;
+        return S_FALSE;
     }
 
     START_NO_OOM_THROW_REGION;
 
-    unordered_map<pair<ModuleID, mdMethodDef>, INSTRUMENTATION_REQUEST, PairHash<ModuleID, mdMethodDef>> newRequests;
+    vector<pair<ModuleID, mdMethodDef>> methods;
+    methods.reserve(m_activeInstrumentationRequests.size());
 
-    vector<ModuleID> requestedModuleIds;
-    vector<mdMethodDef> requestedMethodDefs;
+    for (auto const& requestData: m_activeInstrumentationRequests)
+    {
+        methods.push_back(requestData.first);
+    }
 
-    requestedModuleIds.reserve(requests.size());
-    requestedMethodDefs.reserve(requests.size());
+    // Latency probes are not affected.
+    IfFailRet(ReleaseMethods(methods, m_activeLatencyRequests));
 
-    for (auto const& req : requests)
-    {
-        INSTRUMENTATION_REQUEST processedRequest;
+    m_activeInstrumentationRequests.clear();
 
-        if (req.functionId == m_probeFunctionId)
-        {
-            return E_INVALIDARG;
-        }
+    END_NO_OOM_THROW_REGION;
 
-        // For now just use the function id as the uniquifier.
-        // Consider allowing the caller to specify one.
-        processedRequest.uniquifier = static_cast<ULONG64>(req.functionId);
+    return S_OK;
+}
 
-        IfFailLogRet(m_pCorProfilerInfo->GetFunctionInfo2(
-            req.functionId,
-            NULL,
-            nullptr,
-            &processedRequest.moduleId,
-            &processedRequest.methodDef,
-            0,
-            nullptr,
-            nullptr));
+HRESULT ProbeInstrumentation::ReleaseMethods(
+    const vector<pair<ModuleID, mdMethodDef>>& methods,
+    const ActiveInstrumentationRequests& otherActiveRequests)
+{
+    HRESULT hr;
+
+    //
+    // Expects m_instrumentationProcessingMutex to be held, and the caller to remove the methods' requests
+    // before releasing it; GetReJITParameters then only finds the probes that remain.
+    //
 
-        ComPtr<IMetaDataEmit> pMetadataEmit;
-        IfFailRet(m_pCorProfilerInfo->GetModuleMetaData(
-            processedRequest.moduleId,
-            ofRead | ofWrite,
-            IID_IMetaDataEmit,
-            reinterpret_cast<IUnknown **>(&pMetadataEmit)));
+    START_NO_OOM_THROW_REGION;
 
-        // Process the boxing instructions, converting any typespecs into metadata tokens.
-        processedRequest.boxingInstructions.reserve(req.boxingInstructions.size());
-        for (auto const& instructions : req.boxingInstructions)
-        {
-            PARAMETER_BOXING_INSTRUCTIONS newInstructions = {};
-            if (instructions.instructionType == InstructionType::TYPESPEC)
-            {
-                newInstructions.instructionType = InstructionType::METADATA_TOKEN;
-                IfFailRet(pMetadataEmit->GetTokenFromTypeSpec(
-                    instructions.signatureBufferPointer,
-                    instructions.signatureBufferLength,
-                    &newInstructions.token.mdToken));
-            }
-            else
-            {
-                newInstructions = instructions;
-            }
+    vector<ModuleID> revertModuleIds;
+    vector<mdMethodDef> revertMethodDefs;
+    vector<ModuleID> rejitModuleIds;
+    vector<mdMethodDef> rejitMethodDefs;
+    vector<ModuleID> inlinerModuleIds;
+    vector<mdMethodDef> inlinerMethodDefs;
 
-            processedRequest.boxingInstructions.push_back(newInstructions);
+    vector<pair<ModuleID, mdMethodDef>> releasedMethods;
+    for (auto const& method : methods)
+    {
+        if (otherActiveRequests.find(method) != otherActiveRequests.end())
+        {
+            rejitModuleIds.push_back(method.first);
+            rejitMethodDefs.push_back(method.second);
+        }
+        else
+        {
+            releasedMethods.push_back(method);
         }
+    }
 
-        IfFailLogRet(m_pAssemblyProbePrep->PrepareAssemblyForProbes(processedRequest.moduleId));
+    vector<pair<ModuleID, mdMethodDef>> releasedInliners;
+    if (m_pInlinerTracker)
+    {
+        // The released methods can be inlined again, so the inliners rejitted for them can go back to their original code.
+        IfFailLogRet(m_pInlinerTracker->UnblockInlining(releasedMethods, releasedInliners));
+    }
 
-        requestedModuleIds.push_back(processedRequest.moduleId);
-        requestedMethodDefs.push_back(processedRequest.methodDef);
+    for (auto const& method : releasedMethods)
+    {
+        if (m_pInlinerTracker && m_pInlinerTracker->IsRejittedInliner(method))
+        {
+            // Its original code may have inlined a method that is still probed.
+            inlinerModuleIds.push_back(method.first);
+            inlinerMethodDefs.push_back(method.second);
+        }
+        else
+        {
+            revertModuleIds.push_back(method.first);
+            revertMethodDefs.push_back(method.second);
+        }
+    }
 
-        if (!m_pAssemblyProbePrep->TryGetAssemblyPrepData(processedRequest.moduleId, processedRequest.pAssemblyData))
+    for (auto const& inliner : releasedInliners)
+    {
+        // Methods that still have probes keep their instrumented code.
+        if (find(methods.begin(), methods.end(), inliner) != methods.end() ||
+            m_activeInstrumentationRequests.find(inliner) != m_activeInstrumentationRequests.end() ||
+            m_activeLatencyRequests.find(inliner) != m_activeLatencyRequests.end())
         {
-            return E_UNEXPECTED;
+            continue;
         }
 
-        newRequests.insert({{processedRequest.moduleId, processedRequest.methodDef}, processedRequest});
+        revertModuleIds.push_back(inliner.first);
+        revertMethodDefs.push_back(inliner.second);
+    }
+
+    if (!revertModuleIds.empty())
+    {
+        IfFailLogRet(m_pCorProfilerInfo->RequestRevert(
+            static_cast<ULONG>(revertModuleIds.size()),
+            revertModuleIds.data(),
+            revertMethodDefs.data(),
+            nullptr));
     }
 
-    IfFailLogRet(m_pCorProfilerInfo->RequestReJITWithInliners(
-        COR_PRF_REJIT_BLOCK_INLINING,
-        static_cast<ULONG>(requestedModuleIds.size()),
-        requestedModuleIds.data(),
-        requestedMethodDefs.data()));
+    IfFailRet(RequestProbeReJIT(rejitModuleIds, rejitMethodDefs));
 
-    m_activeInstrumentationRequests = newRequests;
+    if (!inlinerModuleIds.empty())
+    {
+        IfFailLogRet(m_pCorProfilerInfo->RequestReJIT(
+            static_cast<ULONG>(inlinerModuleIds.size()),
+            inlinerModuleIds.data(),
+            inlinerMethodDefs.data()));
+    }
 
     END_NO_OOM_THROW_REGION;
 
     return S_OK;
 }
 
-HRESULT ProbeInstrumentation::UninstallProbes()
+HRESULT ProbeInstrumentation::RequestProbeReJIT(vector<ModuleID>& moduleIds, vector<mdMethodDef>& methodDefs)
 {
     HRESULT hr;
 
-    m_pLogger->Log(LogLevel::Debug, _LS("Uninstalling function probes"));
+    //
+    // Expects m_instrumentationProcessingMutex to be held.
+    // Without inliner tracking, the runtime rejits the methods' inliners and blocks inlining of the methods
+    // for the rest of the process. With it, inlining is blocked only until the methods are released.
+    //
 
-    lock_guard<mutex> lock(m_instrumentationProcessingMutex);
+    if (moduleIds.empty())
+    {
+        return S_OK;
+    }
 
-    if (!HasRegisteredProbe() ||
-        !AreProbesInstalled())
+    if (!m_pInlinerTracker)
     {
-        return S_FALSE;
+        IfFailLogRet(m_pCorProfilerInfo->RequestReJITWithInliners(
+            COR_PRF_REJIT_BLOCK_INLINING,
+            static_cast<ULONG>(moduleIds.size()),
+            moduleIds.data(),
+            methodDefs.data()));
+
+        return S_OK;
     }
 
     START_NO_OOM_THROW_REGION;
 
-    vector<ModuleID> moduleIds;
-    vector<mdMethodDef> methodDefs;
+    vector<pair<ModuleID, mdMethodDef>> methods;
+    methods.reserve(moduleIds.size());
+    for (size_t i = 0; i < moduleIds.size(); i++)
+    {
+        methods.push_back({moduleIds[i], methodDefs[i]});
+    }
 
-    moduleIds.reserve(m_activeInstrumentationRequests.size());
-    methodDefs.reserve(m_activeInstrumentationRequests.size());
+    vector<pair<ModuleID, mdMethodDef>> inliners;
+    IfFailLogRet(m_pInlinerTracker->BlockInlining(methods, inliners));
 
-    for (auto const& requestData: m_activeInstrumentationRequests)
+    vector<ModuleID> rejitModuleIds(moduleIds);
+    vector<mdMethodDef> rejitMethodDefs(methodDefs);
+    size_t inlinerCount = 0;
+    for (auto const& inliner : inliners)
     {
-        auto const& methodInfo = requestData.first;
-        moduleIds.push_back(methodInfo.first);
-        methodDefs.push_back(methodInfo.second);
+        if (find(methods.begin(), methods.end(), inliner) == methods.end())
+        {
+            rejitModuleIds.push_back(inliner.first);
+            rejitMethodDefs.push_back(inliner.second);
+            inlinerCount++;
+        }
     }
 
-    IfFailLogRet(m_pCorProfilerInfo->RequestRevert(
-        static_cast<ULONG>(moduleIds.size()),
-        moduleIds.data(),
-        methodDefs.data(),
-        nullptr));
+    hr = m_pCorProfilerInfo->RequestReJIT(
+        static_cast<ULONG>(rejitModuleIds.size()),
+        rejitModuleIds.data(),
+        rejitMethodDefs.data());
+    if (FAILED(hr))
+    {
+        m_pLogger->Log(LogLevel::Error, _LS("Unable to rejit probed functions: 0x%08x"), hr);
 
-    m_activeInstrumentationRequests.clear();
+        // Methods that were not probed before can be inlined again.
+        vector<pair<ModuleID, mdMethodDef>> newMethods;
+        for (auto const& method : methods)
+        {
+            if (m_activeInstrumentationRequests.find(method) == m_activeInstrumentationRequests.end() &&
+                m_activeLatencyRequests.find(method) == m_activeLatencyRequests.end())
+            {
+                newMethods.push_back(method);
+            }
+        }
+        m_pInlinerTracker->UnblockInlining(newMethods, inliners);
+
+        return hr;
+    }
+
+    m_totalRejittedInliners += inlinerCount;
+    m_pLogger->Log(
+        LogLevel::Information,
+        _LS("Rejitting %zu inliners of %zu probed functions (%llu since startup)"),
+        inlinerCount,
+        methods.size(),
+        static_cast<unsigned long long>(m_totalRejittedInliners));
 
     END_NO_OOM_THROW_REGION;
 
@@ -482,13 +1603,265 @@ void ProbeInstrumentation::AddProfilerEventMask(DWORD& eventsLow)
 {
     //
     // Workaround:
-    // Enable COR_PRF_MONITOR_JIT_COMPILATION even though we don't need the callbacks.
+    // Enable COR_PRF_MONITOR_JIT_COMPILATION even when neither startup probes nor inliner tracking need the callbacks.
     // It appears that without this flag set our RequestReJITWithInliners calls will sometimes
     // not actually trigger a rejit despite returning successfully.
     //
     // This issue most commonly occurs on MacOS.
     //
     eventsLow |= COR_PRF_MONITOR::COR_PRF_ENABLE_REJIT | COR_PRF_MONITOR::COR_PRF_MONITOR_JIT_COMPILATION;
+
+    if (m_pStartupProbePlan)
+    {
+        // Precompiled code can't be rewritten, so planned methods must be jitted.
+        // Planned methods are resolved as their modules load.
+        eventsLow |= COR_PRF_MONITOR::COR_PRF_MONITOR_CACHE_SEARCHES | COR_PRF_MONITOR::COR_PRF_MONITOR_MODULE_LOADS;
+    }
+
+    if (m_pInlinerTracker)
+    {
+        // Recorded inliners are dropped as their modules unload.
+        eventsLow |= COR_PRF_MONITOR::COR_PRF_MONITOR_MODULE_LOADS;
+    }
+}
+
+HRESULT STDMETHODCALLTYPE ProbeInstrumentation::ModuleLoadFinished(ModuleID moduleId)
+{
+    HRESULT hr;
+
+    if (!m_pStartupProbePlan || !m_pLatencyEventProvider)
+    {
+        return S_OK;
+    }
+
+    START_NO_OOM_THROW_REGION;
+
+    unique_ptr<unordered_set<mdMethodDef>> pMethodDefs;
+    hr = m_pStartupProbePlan->ResolveModule(moduleId, pMethodDefs);
+    if (FAILED(hr))
+    {
+        m_pLogger->Log(LogLevel::Warning, _LS("Unable to resolve startup probes for module 0x%08x: 0x%08x"), moduleId, hr);
+        return S_OK;
+    }
+
+    if (!pMethodDefs)
+    {
+        return S_OK;
+    }
+
+    //
+    // Prepared before the module is published, so that JIT callbacks only have to look up the prepared data.
+    // Only compilations of planned methods wait on the prep lock; claiming and installing probes don't.
+    //
+    {
+        lock_guard<mutex> lock(m_startupAssemblyProbePrepMutex);
+        IfFailLogRet(m_pStartupAssemblyProbePrep->PrepareAssemblyForProbes(moduleId));
+    }
+
+    IfFailLogRet(m_pStartupProbePlan->AddModule(moduleId, std::move(pMethodDefs)));
+
+    END_NO_OOM_THROW_REGION;
+
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE ProbeInstrumentation::ModuleUnloadStarted(ModuleID moduleId)
+{
+    if (m_pInlinerTracker)
+    {
+        m_pInlinerTracker->OnModuleUnloadStarted(moduleId);
+    }
+
+    if (m_pStartupProbePlan)
+    {
+        m_pStartupProbePlan->RemoveModule(moduleId);
+
+        // The id can be reused by a module loaded later.
+        lock_guard<mutex> lock(m_startupProbesMutex);
+        for (auto it = m_startupProbedMethods.begin(); it != m_startupProbedMethods.end();)
+        {
+            it = it->first.first == moduleId ? m_startupProbedMethods.erase(it) : std::next(it);
+        }
+    }
+
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE ProbeInstrumentation::JITCompilationStarted(FunctionID functionId)
+{
+    HRESULT hr;
+
+    if (!m_pStartupProbePlan || !m_pLatencyEventProvider)
+    {
+        return S_OK;
+    }
+
+    ModuleID moduleId;
+    mdMethodDef methodDef;
+    bool isPlanned;
+    IfFailRet(IsPlannedStartupProbe(functionId, moduleId, methodDef, isPlanned));
+    if (!isPlanned)
+    {
+        return S_OK;
+    }
+
+    START_NO_OOM_THROW_REGION;
+
+    INSTRUMENTATION_REQUEST request;
+    request.uniquifier = static_cast<ULONG64>(functionId);
+    request.moduleId = moduleId;
+    request.methodDef = methodDef;
+    request.captureArguments = false;
+    request.samplingInterval = 0;
+    request.pSamplingCounter = nullptr;
+    request.predicate = {};
+    request.pOverheadCounters = nullptr;
+
+    //
+    // Each instantiation and tier of the method is compiled from the same body; only the first to claim it rewrites it.
+    // Other compilations of the method wait for the rewrite, so that they compile the rewritten body.
+    //
+    pair<ModuleID, mdMethodDef> key(moduleId, methodDef);
+
+    // Allocated before the method is claimed, so that nothing can throw while a claim is held.
+    {
+        lock_guard<mutex> histogramsLock(m_latencyHistogramsMutex);
+
+        unique_ptr<LatencyHistogram>& pHistogram = m_latencyHistograms[key];
+        if (!pHistogram)
+        {
+            pHistogram.reset(new LatencyHistogram(functionId));
+        }
+        request.pLatencyHistogram = pHistogram.get();
+    }
+
+    // The module was prepared when it loaded.
+    {
+        lock_guard<mutex> prepLock(m_startupAssemblyProbePrepMutex);
+        if (!m_pStartupAssemblyProbePrep->TryGetAssemblyPrepData(moduleId, request.pAssemblyData))
+        {
+            return E_UNEXPECTED;
+        }
+    }
+
+    {
+        unique_lock<mutex> lock(m_startupProbesMutex);
+        m_startupProbesCondition.wait(lock, [this, &key]()
+        {
+            auto it = m_startupProbedMethods.find(key);
+            return it == m_startupProbedMethods.end() || it->second;
+        });
+
+        if (m_startupProbedMethods.find(key) != m_startupProbedMethods.end())
+        {
+            return S_OK;
+        }
+
+        m_startupProbedMethods.insert({key, false});
+    }
+
+    hr = ProbeInjector::InstallProbe(
+        m_pCorProfilerInfo,
+        nullptr,
+        &OnFunctionProbeFault,
+        request);
+
+    {
+        lock_guard<mutex> lock(m_startupProbesMutex);
+        auto it = m_startupProbedMethods.find(key);
+        if (it != m_startupProbedMethods.end())
+        {
+            if (SUCCEEDED(hr))
+            {
+                it->second = true;
+            }
+            else
+            {
+                m_startupProbedMethods.erase(it);
+            }
+        }
+    }
+    m_startupProbesCondition.notify_all();
+
+    IfFailLogRet(hr);
+
+    if (S_FALSE == hr)
+    {
+        IfFailLogRet(UnregisterLatencyHistogram(moduleId, methodDef));
+        return S_OK;
+    }
+
+    m_pLogger->Log(LogLevel::Debug, _LS("Timing from startup - moduleId: 0x%08x, methodDef: 0x%04x"), moduleId, methodDef);
+
+    END_NO_OOM_THROW_REGION;
+
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE ProbeInstrumentation::JITInlining(FunctionID callerId, FunctionID calleeId, BOOL* pfShouldInline)
+{
+    if (!m_pInlinerTracker)
+    {
+        return S_OK;
+    }
+
+    return m_pInlinerTracker->OnJITInlining(callerId, calleeId, pfShouldInline);
+}
+
+HRESULT STDMETHODCALLTYPE ProbeInstrumentation::JITCachedFunctionSearchStarted(FunctionID functionId, BOOL* pbUseCachedFunction)
+{
+    HRESULT hr;
+
+    ExpectedPtr(pbUseCachedFunction);
+
+    if (!m_pStartupProbePlan)
+    {
+        return S_OK;
+    }
+
+    ModuleID moduleId;
+    mdMethodDef methodDef;
+    bool isPlanned;
+    IfFailRet(IsPlannedStartupProbe(functionId, moduleId, methodDef, isPlanned));
+    if (isPlanned)
+    {
+        *pbUseCachedFunction = FALSE;
+    }
+
+    return S_OK;
+}
+
+HRESULT ProbeInstrumentation::IsPlannedStartupProbe(FunctionID functionId, ModuleID& moduleId, mdMethodDef& methodDef, bool& isPlanned)
+{
+    HRESULT hr;
+
+    isPlanned = false;
+
+    IfFailRet(m_pCorProfilerInfo->GetFunctionInfo2(
+        functionId,
+        NULL,
+        nullptr,
+        &moduleId,
+        &methodDef,
+        0,
+        nullptr,
+        nullptr));
+
+    isPlanned = m_pStartupProbePlan->IsPlannedMethod(moduleId, methodDef);
+
+    return S_OK;
+}
+
+bool ProbeInstrumentation::IsStartupProbedMethod(const pair<ModuleID, mdMethodDef>& method)
+{
+    if (!m_pStartupProbePlan)
+    {
+        return false;
+    }
+
+    lock_guard<mutex> lock(m_startupProbesMutex);
+    // Includes methods whose probe is being installed.
+    return m_startupProbedMethods.find(method) != m_startupProbedMethods.end();
 }
 
 HRESULT STDMETHODCALLTYPE ProbeInstrumentation::GetReJITParameters(ModuleID moduleId, mdMethodDef methodDef, ICorProfilerFunctionControl* pFunctionControl)
@@ -504,12 +1877,23 @@ HRESULT STDMETHODCALLTYPE ProbeInstrumentation::GetReJITParameters(ModuleID modu
     {
         lock_guard<mutex> lock(m_instrumentationProcessingMutex);
         auto const& it = m_activeInstrumentationRequests.find({moduleId, methodDef});
-        if (it == m_activeInstrumentationRequests.end())
+        auto const& latencyIt = m_activeLatencyRequests.find({moduleId, methodDef});
+        if (it == m_activeInstrumentationRequests.end() &&
+            latencyIt == m_activeLatencyRequests.end())
         {
+            if (m_pInlinerTracker && m_pInlinerTracker->IsRejittedInliner({moduleId, methodDef}))
+            {
+                // Recompiled from its original IL so that it calls, rather than inlines, the probed methods.
+                return S_OK;
+            }
+
             m_pLogger->Log(LogLevel::Debug, _LS("ReJIT cache miss - moduleId: 0x%08x, methodDef: 0x%04x"));
             return E_FAIL;
         }
-        request = it->second;
+
+        // Combine the method's argument and latency probes.
+        request = (it != m_activeInstrumentationRequests.end()) ? it->second.request : latencyIt->second.request;
+        request.pLatencyHistogram = (latencyIt != m_activeLatencyRequests.end()) ? latencyIt->second.request.pLatencyHistogram : nullptr;
     }
 
     hr = ProbeInjector::InstallProbe(
@@ -525,6 +1909,11 @@ HRESULT STDMETHODCALLTYPE ProbeInstrumentation::GetReJITParameters(ModuleID modu
         return hr;
     }
 
+    if (S_FALSE == hr)
+    {
+        IfFailLogRet(UnregisterLatencyHistogram(moduleId, methodDef));
+    }
+
     return S_OK;
 }
 
@@ -532,12 +1921,14 @@ STDAPI DLLEXPORT RegisterFunctionProbeCallbacks(
     ProbeRegistrationCallback pRegistrationCallback,
     ProbeInstallationCallback pInstallationCallback,
     ProbeUninstallationCallback pUninstallationCallback,
-    ProbeFaultCallback pFaultCallback)
+    ProbeFaultCallback pFaultCallback,
+    ProbeDisabledCallback pDisabledCallback)
 {
     ExpectedPtr(pRegistrationCallback);
     ExpectedPtr(pInstallationCallback);
     ExpectedPtr(pUninstallationCallback);
     ExpectedPtr(pFaultCallback);
+    ExpectedPtr(pDisabledCallback);
 
     //
     // Note: Require locking to access probe callbacks as it is
@@ -564,6 +1955,7 @@ STDAPI DLLEXPORT RegisterFunctionProbeCallbacks(
     g_probeManagementCallbacks.pProbeInstallationCallback = pInstallationCallback;
     g_probeManagementCallbacks.pProbeUninstallationCallback = pUninstallationCallback;
     g_probeManagementCallbacks.pProbeFaultCallback = pFaultCallback;
+    g_probeManagementCallbacks.pProbeDisabledCallback = pDisabledCallback;
 
     return S_OK;
 }
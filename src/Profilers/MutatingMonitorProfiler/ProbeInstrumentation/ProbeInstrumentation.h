@@ -9,11 +9,19 @@
 #include "AssemblyProbePrep.h"
 #include "ProbeInjector.h"
 #include "CallbackDefinitions.h"
+#include "LatencyEventProvider.h"
+#include "LatencyHistogram.h"
+#include "ProbeOverheadCounters.h"
+#include "InlinerTracker.h"
+#include "StartupProbePlan.h"
 #include "Logging/Logger.h"
 #include "CommonUtilities/PairHash.h"
 #include "CommonUtilities/BlockingQueue.h"
+#include "CommonUtilities/MpscQueue.h"
 
+#include <condition_variable>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <memory>
 #include <mutex>
@@ -23,6 +31,9 @@ typedef struct _UNPROCESSED_INSTRUMENTATION_REQUEST
 {
     FunctionID functionId;
     std::vector<PARAMETER_BOXING_INSTRUCTIONS> boxingInstructions;
+    // 0 to use the default sampling interval.
+    ULONG32 samplingInterval;
+    PROBE_PREDICATE predicate;
 } UNPROCESSED_INSTRUMENTATION_REQUEST;
 
 enum class ProbeWorkerInstruction
@@ -30,6 +41,11 @@ enum class ProbeWorkerInstruction
     REGISTER_PROBE,
     INSTALL_PROBES,
     UNINSTALL_PROBES,
+    ADD_PROBES,
+    REMOVE_PROBES,
+    ADD_LATENCY_PROBES,
+    REMOVE_LATENCY_PROBES,
+    DISABLE_PROBES,
     FAULTING_PROBE
 };
 
@@ -40,8 +56,31 @@ typedef struct _PROBE_WORKER_PAYLOAD
     // Optional instruction-specific fields
     FunctionID functionId;
     std::vector<UNPROCESSED_INSTRUMENTATION_REQUEST> requests;
+    std::vector<FunctionID> functionIds;
 } PROBE_WORKER_PAYLOAD;
 
+//
+// An installed probe. The same method can be requested by several callers;
+// it stays instrumented until every request for it has been removed.
+//
+typedef struct _ACTIVE_INSTRUMENTATION_REQUEST
+{
+    INSTRUMENTATION_REQUEST request;
+    ULONG refCount;
+} ACTIVE_INSTRUMENTATION_REQUEST;
+
+typedef std::unordered_map<std::pair<ModuleID, mdMethodDef>, ACTIVE_INSTRUMENTATION_REQUEST, PairHash<ModuleID, mdMethodDef>> ActiveInstrumentationRequests;
+
+//
+// Raised on application threads by faulting probes.
+// These are handed off through a lock-free queue so that the faulting thread never blocks on the profiler.
+//
+class PROBE_FAULT_NOTIFICATION final : public MpscQueueNode
+{
+    public:
+        FunctionID functionId;
+};
+
 typedef struct _MANAGED_CALLBACK_REQUEST
 {
     ProbeWorkerInstruction instruction;
@@ -60,23 +99,120 @@ class ProbeInstrumentation
 
         FunctionID m_probeFunctionId;
         std::unique_ptr<AssemblyProbePrep> m_pAssemblyProbePrep;
+        // Shared by both preps, and stopped in ShutdownBackgroundService.
+        AssemblyProbePrepWorkers m_assemblyProbePrepWorkers;
 
         /* Probe management */
         std::thread m_managedCallbackThread;
         BlockingQueue<MANAGED_CALLBACK_REQUEST> m_managedCallbackQueue;
 
         std::thread m_probeManagementThread;
-        std::unordered_map<std::pair<ModuleID, mdMethodDef>, INSTRUMENTATION_REQUEST, PairHash<ModuleID, mdMethodDef>> m_activeInstrumentationRequests;
+        std::thread m_probeFaultThread;
+        ActiveInstrumentationRequests m_activeInstrumentationRequests;
+        // Methods timed by latency probes. A method in both maps is rejitted with both probes.
+        ActiveInstrumentationRequests m_activeLatencyRequests;
         std::mutex m_instrumentationProcessingMutex;
         std::mutex m_probePinningMutex;
 
+        //
+        // Sampling counters referenced by the IL of instrumented methods, one per method.
+        // They are never freed: code from a previous ReJIT can still be running after its probe is reverted.
+        //
+        std::unordered_map<std::pair<ModuleID, mdMethodDef>, std::unique_ptr<LONG>, PairHash<ModuleID, mdMethodDef>> m_samplingCounters;
+        ULONG32 m_defaultSamplingInterval;
+
+        //
+        // Latency histograms referenced by the IL of timed methods, one per method.
+        // Like the sampling counters they are never freed. Guarded by m_latencyHistogramsMutex,
+        // which is also taken by the flush thread.
+        //
+        std::unordered_map<std::pair<ModuleID, mdMethodDef>, std::unique_ptr<LatencyHistogram>, PairHash<ModuleID, mdMethodDef>> m_latencyHistograms;
+        // Histograms of methods that can't be timed; no longer flushed, but the flush thread may still be draining them.
+        std::vector<std::unique_ptr<LatencyHistogram>> m_unregisteredLatencyHistograms;
+        std::mutex m_latencyHistogramsMutex;
+
+        std::unique_ptr<LatencyEventProvider> m_pLatencyEventProvider;
+        std::thread m_latencyFlushThread;
+        std::mutex m_latencyFlushMutex;
+        std::condition_variable m_latencyFlushCondition;
+        bool m_latencyFlushStopped;
+        ULONG32 m_latencyFlushIntervalMilliseconds;
+
+        //
+        // Overhead counters referenced by the IL of instrumented methods, one per method. Only used when a probe budget
+        // is configured. Like the sampling counters they are never freed. Guarded by m_overheadCountersMutex,
+        // which is also taken by the budget thread.
+        //
+        std::unordered_map<std::pair<ModuleID, mdMethodDef>, std::unique_ptr<ProbeOverheadCounters>, PairHash<ModuleID, mdMethodDef>> m_overheadCounters;
+        std::mutex m_overheadCountersMutex;
+
+        // 0 disables the respective budget.
+        ULONG32 m_maxProbeInvocationsPerSecond;
+        ULONG32 m_maxProbeMicrosecondsPerSecond;
+
+        std::thread m_probeBudgetThread;
+        std::mutex m_probeBudgetMutex;
+        std::condition_variable m_probeBudgetCondition;
+        bool m_probeBudgetStopped;
+
+        //
+        // Methods timed from their first call. Their latency probe is part of the IL set at first JIT,
+        // so it is never rejitted or reverted and stays for the lifetime of the process.
+        // The prep is separate from m_pAssemblyProbePrep because no probe function is registered at startup.
+        // Modules with planned methods are prepared as they load, under m_startupAssemblyProbePrepMutex.
+        // m_startupProbesMutex guards the probed methods; neither is held while a probe is installed.
+        //
+        std::unique_ptr<StartupProbePlan> m_pStartupProbePlan;
+        std::unique_ptr<AssemblyProbePrep> m_pStartupAssemblyProbePrep;
+        std::mutex m_startupAssemblyProbePrepMutex;
+        // Probed methods, with whether their probe has been installed yet.
+        std::unordered_map<std::pair<ModuleID, mdMethodDef>, bool, PairHash<ModuleID, mdMethodDef>> m_startupProbedMethods;
+        std::mutex m_startupProbesMutex;
+        // Signaled when a method's probe is installed or fails to install.
+        std::condition_variable m_startupProbesCondition;
+
+        // Null unless inlining of probed methods is only blocked while they are probed.
+        std::unique_ptr<InlinerTracker> m_pInlinerTracker;
+        UINT64 m_totalRejittedInliners;
+
+        static const size_t MaxWorkerBatchSize = 8;
+        static const ULONG32 ProbeBudgetIntervalMilliseconds = 1000;
+
+    public:
+        static const ULONG32 DefaultSamplingInterval = 1;
+        static const ULONG32 DefaultLatencyFlushIntervalMilliseconds = 10000;
+
     private:
         void WorkerThread();
         void ManagedCallbackThread();
+        void ProbeFaultThread();
+        void LatencyFlushThread();
+        void FlushLatencyHistograms();
+        HRESULT UnregisterLatencyHistogram(ModuleID moduleId, mdMethodDef methodDef);
+        void ProbeBudgetThread();
+        void CheckProbeBudgets(UINT64 elapsedMilliseconds);
+        bool HasProbeBudget();
         HRESULT RegisterFunctionProbe(FunctionID enterProbeId);
         HRESULT InstallProbes(std::vector<UNPROCESSED_INSTRUMENTATION_REQUEST>& requests);
         HRESULT UninstallProbes();
+        HRESULT AddProbes(std::vector<UNPROCESSED_INSTRUMENTATION_REQUEST>& requests);
+        HRESULT RemoveProbes(const std::vector<FunctionID>& functionIds);
+        HRESULT AddLatencyProbes(const std::vector<FunctionID>& functionIds);
+        HRESULT RemoveLatencyProbes(const std::vector<FunctionID>& functionIds);
+        HRESULT DisableProbes(const std::vector<FunctionID>& functionIds);
+        HRESULT AddProbesInternal(std::vector<UNPROCESSED_INSTRUMENTATION_REQUEST>& requests);
+        HRESULT RemoveProbesInternal(
+            ActiveInstrumentationRequests& activeRequests,
+            const ActiveInstrumentationRequests& otherActiveRequests,
+            const std::vector<FunctionID>& functionIds);
+        HRESULT ReleaseMethods(
+            const std::vector<std::pair<ModuleID, mdMethodDef>>& methods,
+            const ActiveInstrumentationRequests& otherActiveRequests);
+        HRESULT RequestProbeReJIT(std::vector<ModuleID>& moduleIds, std::vector<mdMethodDef>& methodDefs);
+        HRESULT ProcessRequest(const UNPROCESSED_INSTRUMENTATION_REQUEST& request, INSTRUMENTATION_REQUEST& processedRequest);
         bool HasRegisteredProbe();
+        bool IsStartupProbedMethod(const std::pair<ModuleID, mdMethodDef>& method);
+        HRESULT IsPlannedStartupProbe(FunctionID functionId, ModuleID& moduleId, mdMethodDef& methodDef, bool& isPlanned);
 
     private:
         static void STDMETHODCALLTYPE OnFunctionProbeFault(ULONG64 uniquifier);
@@ -91,9 +227,44 @@ class ProbeInstrumentation
 
         bool AreProbesInstalled();
 
+        /// <summary>
+        /// Sets the sampling interval used by probes that do not request one. 0 and 1 probe every call.
+        /// Must be called before InitBackgroundService.
+        /// </summary>
+        void SetDefaultSamplingInterval(ULONG32 samplingInterval);
+
+        /// <summary>
+        /// Sets how often latency histograms are written. Must be called before InitBackgroundService.
+        /// </summary>
+        void SetLatencyFlushInterval(ULONG32 milliseconds);
+
+        /// <summary>
+        /// Sets the budgets for a single method's probe. A probe that exceeds either budget is removed from its method,
+        /// regardless of how many requests reference it, and reported through the fault callback.
+        /// 0 disables a budget. Must be called before InitBackgroundService.
+        /// </summary>
+        void SetProbeBudgets(ULONG32 maxInvocationsPerSecond, ULONG32 maxMicrosecondsPerSecond);
+
+        /// <summary>
+        /// Tracks the callers that inline each method, so that only they are rejitted when the method is probed and
+        /// inlining is blocked only while it is probed. Must be called before AddProfilerEventMask.
+        /// </summary>
+        void SetTrackInliners(bool trackInliners);
+
+        /// <summary>
+        /// Reads the methods to time from their first call. Returns S_FALSE if the plan does not exist.
+        /// Must be called before AddProfilerEventMask.
+        /// </summary>
+        HRESULT LoadStartupProbePlan(const tstring& path);
+
         void AddProfilerEventMask(DWORD& eventsLow);
 
+        HRESULT STDMETHODCALLTYPE ModuleLoadFinished(ModuleID moduleId);
+        HRESULT STDMETHODCALLTYPE ModuleUnloadStarted(ModuleID moduleId);
         HRESULT STDMETHODCALLTYPE GetReJITParameters(ModuleID moduleId, mdMethodDef methodId, ICorProfilerFunctionControl* pFunctionControl);
+        HRESULT STDMETHODCALLTYPE JITCompilationStarted(FunctionID functionId);
+        HRESULT STDMETHODCALLTYPE JITInlining(FunctionID callerId, FunctionID calleeId, BOOL* pfShouldInline);
+        HRESULT STDMETHODCALLTYPE JITCachedFunctionSearchStarted(FunctionID functionId, BOOL* pbUseCachedFunction);
 
     public:
         static void DisableIncomingRequests();
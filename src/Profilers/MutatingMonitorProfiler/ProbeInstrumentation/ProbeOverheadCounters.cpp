@@ -0,0 +1,45 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#include "ProbeOverheadCounters.h"
+#include "CallbackDefinitions.h"
+#include "LatencyHistogram.h"
+
+#include <type_traits>
+
+using namespace std;
+
+static_assert(std::is_same<decltype(&ProbeOverheadCounters::OnLeave), ProbeOverheadLeaveCallback>::value, "OnLeave must match ProbeOverheadLeaveCallback");
+
+ProbeOverheadCounters::ProbeOverheadCounters(FunctionID functionId) :
+    m_functionId(functionId),
+    m_invocations(0),
+    m_nanoseconds(0),
+    m_lastInvocations(0),
+    m_lastNanoseconds(0)
+{
+}
+
+void ProbeOverheadCounters::Record(UINT64 nanoseconds)
+{
+    m_invocations.fetch_add(1, memory_order_relaxed);
+    m_nanoseconds.fetch_add(nanoseconds, memory_order_relaxed);
+}
+
+void ProbeOverheadCounters::GetDelta(UINT64& invocations, UINT64& nanoseconds)
+{
+    UINT64 currentInvocations = m_invocations.load(memory_order_relaxed);
+    UINT64 currentNanoseconds = m_nanoseconds.load(memory_order_relaxed);
+
+    invocations = currentInvocations - m_lastInvocations;
+    nanoseconds = currentNanoseconds - m_lastNanoseconds;
+
+    m_lastInvocations = currentInvocations;
+    m_lastNanoseconds = currentNanoseconds;
+}
+
+void STDMETHODCALLTYPE ProbeOverheadCounters::OnLeave(ProbeOverheadCounters* pCounters, INT64 startTimestamp)
+{
+    INT64 now = LatencyHistogram::OnEnter();
+    pCounters->Record(now > startTimestamp ? static_cast<UINT64>(now - startTimestamp) : 0);
+}
@@ -0,0 +1,42 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#pragma once
+
+#include "cor.h"
+#include "corprof.h"
+
+#include <atomic>
+
+//
+// Counts the calls made to a method's registered probe and the time spent in them, in nanoseconds.
+// Recording only performs relaxed atomic updates, so it is safe on any application thread.
+//
+class ProbeOverheadCounters
+{
+    private:
+        FunctionID m_functionId;
+
+        std::atomic<UINT64> m_invocations;
+        std::atomic<UINT64> m_nanoseconds;
+
+        // Only used by the thread that enforces probe budgets.
+        UINT64 m_lastInvocations;
+        UINT64 m_lastNanoseconds;
+
+    public:
+        ProbeOverheadCounters(FunctionID functionId);
+
+        FunctionID GetFunctionId() const { return m_functionId; }
+
+        void Record(UINT64 nanoseconds);
+
+        //
+        // Gets the invocations and time recorded since the last call.
+        // Must not be called concurrently with itself.
+        //
+        void GetDelta(UINT64& invocations, UINT64& nanoseconds);
+
+        // The probe call is started with LatencyHistogram::OnEnter.
+        static void STDMETHODCALLTYPE OnLeave(ProbeOverheadCounters* pCounters, INT64 startTimestamp);
+};
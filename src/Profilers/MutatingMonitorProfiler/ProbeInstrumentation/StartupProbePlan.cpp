@@ -0,0 +1,294 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#include "corhlpr.h"
+#include "macros.h"
+#include "com.h"
+#include "StartupProbePlan.h"
+#include "CommonUtilities/MetadataEnumCloser.h"
+#include "CommonUtilities/StringUtilities.h"
+
+#include <cwctype>
+#include <fstream>
+
+using namespace std;
+
+#define ENUM_BUFFER_SIZE 10
+#define STRING_BUFFER_LEN 256
+
+StartupProbePlan::StartupProbePlan(const shared_ptr<ILogger>& logger, ICorProfilerInfo12* profilerInfo) :
+    m_pCorProfilerInfo(profilerInfo),
+    m_pLogger(logger)
+{
+    for (size_t i = 0; i < MaxPlannedModules; i++)
+    {
+        m_moduleIds[i].store(0, memory_order_relaxed);
+        m_moduleMethodDefs[i].store(nullptr, memory_order_relaxed);
+    }
+}
+
+HRESULT StartupProbePlan::Load(const tstring& path)
+{
+    START_NO_OOM_THROW_REGION;
+
+#if TARGET_WINDOWS
+    ifstream file(path);
+#else
+    ifstream file(to_string(path));
+#endif
+    if (!file.is_open())
+    {
+        return S_FALSE;
+    }
+
+    string line;
+    size_t lineNumber = 0;
+    while (getline(file, line))
+    {
+        lineNumber++;
+
+        tstring entry = Trim(to_tstring(line));
+        if (entry.empty() || entry[0] == _T('#'))
+        {
+            continue;
+        }
+
+        PLANNED_METHOD method;
+        if (TryParseLine(entry, method))
+        {
+            m_plannedMethods.push_back(std::move(method));
+        }
+        else
+        {
+            m_pLogger->Log(LogLevel::Warning, _LS("Skipping malformed probe plan line %zu"), lineNumber);
+        }
+    }
+
+    m_pLogger->Log(LogLevel::Debug, _LS("Loaded %zu planned startup probes"), m_plannedMethods.size());
+
+    END_NO_OOM_THROW_REGION;
+
+    return S_OK;
+}
+
+bool StartupProbePlan::IsEmpty() const
+{
+    return m_plannedMethods.empty();
+}
+
+HRESULT StartupProbePlan::AddModule(ModuleID moduleId, unique_ptr<unordered_set<mdMethodDef>> methodDefs)
+{
+    START_NO_OOM_THROW_REGION;
+
+    lock_guard<mutex> lock(m_modulesMutex);
+
+    for (size_t i = 0; i < MaxPlannedModules; i++)
+    {
+        if (m_moduleIds[i].load(memory_order_relaxed) != 0)
+        {
+            continue;
+        }
+
+        m_methodDefSets.push_back(std::move(methodDefs));
+        m_moduleMethodDefs[i].store(m_methodDefSets.back().get(), memory_order_relaxed);
+        m_moduleIds[i].store(moduleId, memory_order_release);
+        return S_OK;
+    }
+
+    END_NO_OOM_THROW_REGION;
+
+    m_pLogger->Log(LogLevel::Warning, _LS("Unable to time module 0x%08x from startup: more than %zu modules are planned"), moduleId, static_cast<size_t>(MaxPlannedModules));
+
+    return S_FALSE;
+}
+
+void StartupProbePlan::RemoveModule(ModuleID moduleId)
+{
+    if (moduleId == 0)
+    {
+        return;
+    }
+
+    lock_guard<mutex> lock(m_modulesMutex);
+
+    for (size_t i = 0; i < MaxPlannedModules; i++)
+    {
+        if (m_moduleIds[i].load(memory_order_relaxed) == moduleId)
+        {
+            m_moduleIds[i].store(0, memory_order_release);
+        }
+    }
+}
+
+bool StartupProbePlan::IsPlannedMethod(ModuleID moduleId, mdMethodDef methodDef) const
+{
+    // Free slots hold 0.
+    if (moduleId == 0)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < MaxPlannedModules; i++)
+    {
+        if (m_moduleIds[i].load(memory_order_acquire) == moduleId)
+        {
+            const unordered_set<mdMethodDef>* pMethodDefs = m_moduleMethodDefs[i].load(memory_order_relaxed);
+            return pMethodDefs->find(methodDef) != pMethodDefs->end();
+        }
+    }
+
+    return false;
+}
+
+HRESULT StartupProbePlan::ResolveModule(ModuleID moduleId, unique_ptr<unordered_set<mdMethodDef>>& methodDefs)
+{
+    HRESULT hr;
+
+    methodDefs.reset();
+
+    START_NO_OOM_THROW_REGION;
+
+    unordered_set<mdMethodDef> resolvedMethodDefs;
+
+    ComPtr<IMetaDataImport> pMetadataImport;
+    IfFailRet(m_pCorProfilerInfo->GetModuleMetaData(
+        moduleId,
+        ofRead,
+        IID_IMetaDataImport,
+        reinterpret_cast<IUnknown **>(&pMetadataImport)));
+
+    WCHAR moduleFullName[STRING_BUFFER_LEN];
+    ULONG nameLength = 0;
+    IfFailRet(pMetadataImport->GetScopeProps(
+        moduleFullName,
+        STRING_BUFFER_LEN,
+        &nameLength,
+        nullptr));
+
+    tstring moduleName(moduleFullName);
+    size_t pathSeparatorIndex = moduleName.find_last_of(_T("\\/"));
+    if (pathSeparatorIndex != tstring::npos)
+    {
+        moduleName.erase(0, pathSeparatorIndex + 1);
+    }
+
+    for (auto const& method : m_plannedMethods)
+    {
+        if (!EqualsCaseInsensitive(method.moduleName, moduleName))
+        {
+            continue;
+        }
+
+        // Types and methods the module does not define are not an error; the plan may target other versions of it.
+        mdTypeDef typeDef = mdTokenNil;
+        bool foundType = true;
+        for (auto const& typeName : method.typeNames)
+        {
+            if (pMetadataImport->FindTypeDefByName(typeName.c_str(), typeDef, &typeDef) != S_OK)
+            {
+                foundType = false;
+                break;
+            }
+        }
+
+        if (!foundType)
+        {
+            continue;
+        }
+
+        mdMethodDef methodTokens[ENUM_BUFFER_SIZE];
+        ULONG count = 0;
+        MetadataEnumCloser<IMetaDataImport> enumCloser(pMetadataImport, NULL);
+        while (pMetadataImport->EnumMethodsWithName(
+            enumCloser.GetEnumPtr(),
+            typeDef,
+            method.methodName.c_str(),
+            methodTokens,
+            ENUM_BUFFER_SIZE,
+            &count) == S_OK)
+        {
+            resolvedMethodDefs.insert(methodTokens, methodTokens + count);
+        }
+    }
+
+    if (resolvedMethodDefs.empty())
+    {
+        return S_FALSE;
+    }
+
+    methodDefs.reset(new unordered_set<mdMethodDef>(std::move(resolvedMethodDefs)));
+
+    END_NO_OOM_THROW_REGION;
+
+    return S_OK;
+}
+
+tstring StartupProbePlan::Trim(const tstring& line)
+{
+    size_t begin = 0;
+    size_t end = line.length();
+    while (begin < end && iswspace(line[begin]))
+    {
+        begin++;
+    }
+    while (end > begin && iswspace(line[end - 1]))
+    {
+        end--;
+    }
+
+    return line.substr(begin, end - begin);
+}
+
+bool StartupProbePlan::TryParseLine(const tstring& entry, PLANNED_METHOD& method)
+{
+    size_t moduleSeparatorIndex = entry.find(ModuleSeparator);
+    if (moduleSeparatorIndex == tstring::npos || moduleSeparatorIndex == 0)
+    {
+        return false;
+    }
+
+    // Constructors (".ctor", ".cctor") start with the separator themselves.
+    size_t functionSeparatorIndex = entry.rfind(FunctionSeparator);
+    if (functionSeparatorIndex != tstring::npos &&
+        functionSeparatorIndex > moduleSeparatorIndex + 1 &&
+        entry[functionSeparatorIndex - 1] == FunctionSeparator)
+    {
+        functionSeparatorIndex--;
+    }
+
+    if (functionSeparatorIndex == tstring::npos ||
+        functionSeparatorIndex <= moduleSeparatorIndex + 1 ||
+        functionSeparatorIndex == entry.length() - 1)
+    {
+        return false;
+    }
+
+    method.moduleName = entry.substr(0, moduleSeparatorIndex);
+    method.methodName = entry.substr(functionSeparatorIndex + 1);
+
+    tstring typeName = entry.substr(moduleSeparatorIndex + 1, functionSeparatorIndex - moduleSeparatorIndex - 1);
+    size_t typeBegin = 0;
+    size_t nestedSeparatorIndex;
+    while ((nestedSeparatorIndex = typeName.find(NestedSeparator, typeBegin)) != tstring::npos)
+    {
+        method.typeNames.push_back(typeName.substr(typeBegin, nestedSeparatorIndex - typeBegin));
+        typeBegin = nestedSeparatorIndex + 1;
+    }
+    method.typeNames.push_back(typeName.substr(typeBegin));
+
+    for (auto const& name : method.typeNames)
+    {
+        if (name.empty())
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool StartupProbePlan::EqualsCaseInsensitive(const tstring& left, const tstring& right)
+{
+    return left.length() == right.length() &&
+        StringUtilities::EndsWithCaseInsensitive(left, right);
+}
@@ -0,0 +1,93 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#pragma once
+
+#include "cor.h"
+#include "corprof.h"
+#include "tstring.h"
+#include "Logging/Logger.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+/// <summary>
+/// Methods to time from their first call, read from a plan file when the profiler is initialized.
+/// </summary>
+/// <remarks>
+/// Each line names one method as Module.dll!Namespace.Type.Method, with nested types separated by '+'.
+/// Every overload of a named method is planned. Blank lines and lines starting with '#' are ignored.
+/// A module's entries are resolved to method tokens once, when it loads. Only modules with planned methods are kept,
+/// in a small fixed table that JIT callbacks search without taking a lock.
+/// </remarks>
+class StartupProbePlan
+{
+    private:
+        typedef struct _PLANNED_METHOD
+        {
+            tstring moduleName;
+            // The outermost type first.
+            std::vector<tstring> typeNames;
+            tstring methodName;
+        } PLANNED_METHOD;
+
+        // Same separators as the names in NameCache.
+        static constexpr WCHAR ModuleSeparator = _T('!');
+        static constexpr WCHAR FunctionSeparator = _T('.');
+        static constexpr WCHAR NestedSeparator = _T('+');
+
+        static const size_t MaxPlannedModules = 64;
+
+        ICorProfilerInfo12* m_pCorProfilerInfo;
+        std::shared_ptr<ILogger> m_pLogger;
+
+        std::vector<PLANNED_METHOD> m_plannedMethods;
+
+        //
+        // Loaded modules with planned methods. A slot's method set is written before its module id is published,
+        // and a slot is freed by clearing the id. Sets are never freed before the plan: a reader may still hold one.
+        //
+        std::atomic<ModuleID> m_moduleIds[MaxPlannedModules];
+        std::atomic<const std::unordered_set<mdMethodDef>*> m_moduleMethodDefs[MaxPlannedModules];
+        std::vector<std::unique_ptr<const std::unordered_set<mdMethodDef>>> m_methodDefSets;
+        // Serializes AddModule and RemoveModule.
+        std::mutex m_modulesMutex;
+
+    public:
+        StartupProbePlan(
+            const std::shared_ptr<ILogger>& logger,
+            ICorProfilerInfo12* profilerInfo);
+
+        /// <summary>
+        /// Reads the plan. Returns S_FALSE if the file does not exist. Malformed lines are logged and skipped.
+        /// </summary>
+        HRESULT Load(const tstring& path);
+
+        bool IsEmpty() const;
+
+        /// <summary>
+        /// Resolves the module's planned methods. Returns S_FALSE, with no methods, if the plan has none in the module.
+        /// The result is not visible to IsPlannedMethod until it is passed to AddModule.
+        /// </summary>
+        HRESULT ResolveModule(ModuleID moduleId, std::unique_ptr<std::unordered_set<mdMethodDef>>& methodDefs);
+
+        /// <summary>
+        /// Publishes the planned methods of a loaded module. Returns S_FALSE if the table of modules is full.
+        /// </summary>
+        HRESULT AddModule(ModuleID moduleId, std::unique_ptr<std::unordered_set<mdMethodDef>> methodDefs);
+
+        void RemoveModule(ModuleID moduleId);
+
+        /// <summary>
+        /// Determines whether the method is planned. Does not lock or allocate; safe to call from any thread.
+        /// </summary>
+        bool IsPlannedMethod(ModuleID moduleId, mdMethodDef methodDef) const;
+
+    private:
+        static tstring Trim(const tstring& line);
+        static bool TryParseLine(const tstring& entry, PLANNED_METHOD& method);
+        static bool EqualsCaseInsensitive(const tstring& left, const tstring& right);
+};
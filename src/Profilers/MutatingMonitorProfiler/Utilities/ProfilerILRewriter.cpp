@@ -0,0 +1,123 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#include "ProfilerILRewriter.h"
+
+ProfilerILRewriter::ProfilerILRewriter(ICorProfilerInfo * pICorProfilerInfo, ICorProfilerFunctionControl * pICorProfilerFunctionControl, ModuleID moduleID, mdToken tkMethod)
+    : m_pICorProfilerInfo(pICorProfilerInfo), m_pICorProfilerFunctionControl(pICorProfilerFunctionControl),
+    m_moduleId(moduleID), m_tkMethod(tkMethod), m_pIMethodMalloc(NULL),
+    m_pMetaDataImport(NULL), m_pMetaDataEmit(NULL)
+{
+}
+
+ProfilerILRewriter::~ProfilerILRewriter()
+{
+    if (m_pIMethodMalloc)
+        m_pIMethodMalloc->Release();
+    if (m_pMetaDataImport)
+        m_pMetaDataImport->Release();
+    if (m_pMetaDataEmit)
+        m_pMetaDataEmit->Release();
+}
+
+HRESULT ProfilerILRewriter::Initialize()
+{
+    HRESULT hr;
+
+    // Get metadata interfaces ready
+
+    IfFailRet(m_pICorProfilerInfo->GetModuleMetaData(
+        m_moduleId, ofRead | ofWrite, IID_IMetaDataImport, (IUnknown**)&m_pMetaDataImport));
+
+    IfFailRet(m_pMetaDataImport->QueryInterface(IID_IMetaDataEmit, (void **)&m_pMetaDataEmit));
+
+    return S_OK;
+}
+
+HRESULT ProfilerILRewriter::Import()
+{
+    HRESULT hr = S_OK;
+    LPCBYTE pMethodBytes;
+
+    IfFailRet(m_pICorProfilerInfo->GetILFunctionBody(
+        m_moduleId, m_tkMethod, &pMethodBytes, NULL));
+
+    IfFailRet(Import(pMethodBytes));
+
+    return S_OK;
+}
+
+HRESULT ProfilerILRewriter::Export()
+{
+    HRESULT hr = S_OK;
+    LPBYTE pBody;
+    unsigned cbBody;
+
+    IfFailRet(Export(pBody, cbBody));
+
+    hr = SetILFunctionBody(cbBody, pBody);
+    DeallocateILMemory(pBody);
+
+    return hr;
+}
+
+HRESULT ProfilerILRewriter::SetILFunctionBody(unsigned size, LPBYTE pBody)
+{
+    HRESULT hr = S_OK;
+    if (m_pICorProfilerFunctionControl != NULL)
+    {
+        // We're supplying IL for a rejit, so use the rejit mechanism
+        IfFailRet(m_pICorProfilerFunctionControl->SetILFunctionBody(size, pBody));
+    }
+    else
+    {
+        // "classic-style" instrumentation on first JIT, so use old mechanism
+        IfFailRet(m_pICorProfilerInfo->SetILFunctionBody(m_moduleId, m_tkMethod, pBody));
+    }
+
+    return S_OK;
+}
+
+LPBYTE ProfilerILRewriter::AllocateILMemory(unsigned size)
+{
+    if (m_pICorProfilerFunctionControl != NULL)
+    {
+        // We're supplying IL for a rejit, so we can just allocate from
+        // the heap
+        return new (std::nothrow) BYTE[size];
+    }
+
+    // Else, this is "classic-style" instrumentation on first JIT, and
+    // need to use the CLR's IL allocator
+
+    if (m_pIMethodMalloc == NULL && FAILED(m_pICorProfilerInfo->GetILFunctionBodyAllocator(m_moduleId, &m_pIMethodMalloc)))
+        return NULL;
+
+    return (LPBYTE)m_pIMethodMalloc->Alloc(size);
+}
+
+void ProfilerILRewriter::DeallocateILMemory(LPBYTE pBody)
+{
+    if (m_pICorProfilerFunctionControl == NULL)
+    {
+        // Old-style instrumentation does not provide a way to free up bytes
+        return;
+    }
+
+    delete[] pBody;
+}
+
+HRESULT ProfilerILRewriter::GetSigFromToken(mdSignature tkSig, PCCOR_SIGNATURE& pSig, ULONG& cbSig)
+{
+    return m_pMetaDataImport->GetSigFromToken(tkSig, &pSig, &cbSig);
+}
+
+HRESULT ProfilerILRewriter::GetTokenFromSig(PCCOR_SIGNATURE pSig, ULONG cbSig, mdSignature& tkSig)
+{
+    return m_pMetaDataEmit->GetTokenFromSig(pSig, cbSig, &tkSig);
+}
+
+HRESULT ProfilerILRewriter::GetMethodSignature(PCCOR_SIGNATURE& pSig, ULONG& cbSig)
+{
+    return m_pMetaDataImport->GetMethodProps(m_tkMethod, NULL, NULL, 0, NULL, NULL, &pSig, &cbSig, NULL, NULL);
+}
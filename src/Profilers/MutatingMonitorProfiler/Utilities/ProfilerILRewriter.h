@@ -0,0 +1,52 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#pragma once
+
+#include "cor.h"
+#include "corprof.h"
+#include "ILRewriter.h"
+
+/// <summary>
+/// Rewrites the IL of a method through the profiler APIs: the body is read from and written back to the runtime,
+/// and signatures are read from and added to the method's module metadata.
+/// </summary>
+class ProfilerILRewriter : public ILRewriter
+{
+private:
+    ICorProfilerInfo * m_pICorProfilerInfo;
+    ICorProfilerFunctionControl * m_pICorProfilerFunctionControl;
+
+    ModuleID    m_moduleId;
+    mdToken     m_tkMethod;
+
+    IMethodMalloc * m_pIMethodMalloc;
+
+    IMetaDataImport * m_pMetaDataImport;
+    IMetaDataEmit * m_pMetaDataEmit;
+
+public:
+    ProfilerILRewriter(ICorProfilerInfo * pICorProfilerInfo, ICorProfilerFunctionControl * pICorProfilerFunctionControl, ModuleID moduleID, mdToken tkMethod);
+    ~ProfilerILRewriter();
+
+    // Required before using the signature methods.
+    HRESULT Initialize();
+
+    using ILRewriter::Import;
+    using ILRewriter::Export;
+
+    // Imports the method's current body.
+    HRESULT Import();
+    // Exports the rewritten body and sets it as the method's body.
+    HRESULT Export();
+
+protected:
+    LPBYTE AllocateILMemory(unsigned size) override;
+    HRESULT GetSigFromToken(mdSignature tkSig, PCCOR_SIGNATURE& pSig, ULONG& cbSig) override;
+    HRESULT GetTokenFromSig(PCCOR_SIGNATURE pSig, ULONG cbSig, mdSignature& tkSig) override;
+    HRESULT GetMethodSignature(PCCOR_SIGNATURE& pSig, ULONG& cbSig) override;
+
+private:
+    HRESULT SetILFunctionBody(unsigned size, LPBYTE pBody);
+    void DeallocateILMemory(LPBYTE pBody);
+};
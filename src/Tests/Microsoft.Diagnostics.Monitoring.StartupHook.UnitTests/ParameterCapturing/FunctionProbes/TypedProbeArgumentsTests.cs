@@ -0,0 +1,159 @@
+﻿// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+using Microsoft.Diagnostics.Monitoring.StartupHook.ParameterCapturing.FunctionProbes;
+using Microsoft.Diagnostics.Monitoring.StartupHook.ParameterCapturing.ObjectFormatting;
+using Microsoft.Diagnostics.Monitoring.StartupHook.ParameterCapturing.ObjectFormatting.Formatters;
+using Microsoft.Diagnostics.Monitoring.TestCommon;
+using System;
+using Xunit;
+
+namespace Microsoft.Diagnostics.Monitoring.StartupHook.UnitTests.ParameterCapturing.FunctionProbes
+{
+    [TargetFrameworkMonikerTrait(TargetFrameworkMonikerExtensions.CurrentTargetFrameworkMoniker)]
+    public class TypedProbeArgumentsTests
+    {
+        [Fact]
+        public unsafe void GetArguments_DecodesPrimitiveSlots()
+        {
+            // Arrange
+            SpecialCaseBoxingTypes[] types =
+            [
+                SpecialCaseBoxingTypes.Boolean,
+                SpecialCaseBoxingTypes.Char,
+                SpecialCaseBoxingTypes.SByte,
+                SpecialCaseBoxingTypes.Int32,
+                SpecialCaseBoxingTypes.UInt64,
+                SpecialCaseBoxingTypes.IntPtr,
+                SpecialCaseBoxingTypes.Single,
+                SpecialCaseBoxingTypes.Double,
+            ];
+
+            // Widened the same way as the profiler.
+            ulong* slots = stackalloc ulong[types.Length];
+            slots[0] = 1;
+            slots[1] = 'Φ';
+            slots[2] = unchecked((ulong)(long)(sbyte)-5);
+            slots[3] = unchecked((ulong)(long)int.MinValue);
+            slots[4] = ulong.MaxValue;
+            slots[5] = unchecked((ulong)(long)(nint)(-1));
+            slots[6] = BitConverter.DoubleToUInt64Bits(1.5f);
+            slots[7] = BitConverter.DoubleToUInt64Bits(-2.25);
+
+            // Act
+            object[] args = TypedProbeArguments.GetArguments(types, (IntPtr)slots, args: null);
+
+            // Assert
+            Assert.Equal(new object[] { true, 'Φ', (sbyte)-5, int.MinValue, ulong.MaxValue, (nint)(-1), 1.5f, -2.25 }, args);
+        }
+
+        [Fact]
+        public unsafe void GetArguments_PreservesObjectArguments()
+        {
+            // Arrange
+            SpecialCaseBoxingTypes[] types = [SpecialCaseBoxingTypes.Unknown, SpecialCaseBoxingTypes.UInt16, SpecialCaseBoxingTypes.Unknown];
+            object[] objectArgs = ["value", null!, null!];
+
+            ulong* slots = stackalloc ulong[types.Length];
+            slots[1] = ushort.MaxValue;
+
+            // Act
+            object[] args = TypedProbeArguments.GetArguments(types, (IntPtr)slots, objectArgs);
+
+            // Assert
+            Assert.Same(objectArgs, args);
+            Assert.Equal(new object?[] { "value", ushort.MaxValue, null }, args);
+        }
+
+        [Fact]
+        public void GetArguments_NoPrimitiveBuffer()
+        {
+            // Arrange
+            SpecialCaseBoxingTypes[] types = [SpecialCaseBoxingTypes.Unknown];
+            object[] objectArgs = ["value"];
+
+            // Act
+            object[] args = TypedProbeArguments.GetArguments(types, IntPtr.Zero, objectArgs);
+
+            // Assert
+            Assert.Same(objectArgs, args);
+        }
+
+        [Fact]
+        public void FormatPrimitive_MatchesBoxedFormatting()
+        {
+            // Arrange
+            (SpecialCaseBoxingTypes Type, ulong Slot, object Boxed)[] cases =
+            [
+                (SpecialCaseBoxingTypes.Boolean, 1, true),
+                (SpecialCaseBoxingTypes.Char, 'Φ', 'Φ'),
+                (SpecialCaseBoxingTypes.Int16, unchecked((ulong)(long)short.MinValue), short.MinValue),
+                (SpecialCaseBoxingTypes.UInt32, uint.MaxValue, uint.MaxValue),
+                (SpecialCaseBoxingTypes.Int64, unchecked((ulong)long.MinValue), long.MinValue),
+                (SpecialCaseBoxingTypes.Single, BitConverter.DoubleToUInt64Bits(0.1f), 0.1f),
+                (SpecialCaseBoxingTypes.Double, BitConverter.DoubleToUInt64Bits(-2.25), -2.25),
+            ];
+
+            foreach ((SpecialCaseBoxingTypes type, ulong slot, object boxed) in cases)
+            {
+                // Act
+                string formatted = TypedProbeArguments.FormatPrimitive(type, slot);
+
+                // Assert
+                Assert.Equal(RuntimeFormatters.IConvertibleFormatter(boxed, FormatSpecifier.NoQuotes).FormattedValue, formatted);
+            }
+        }
+
+        [Fact]
+        public void FormatPrimitive_IntPtr_MatchesBoxedFormatting()
+        {
+            // Arrange
+            ulong slot = unchecked((ulong)(long)(nint)(-1));
+
+            // Act
+            string formatted = TypedProbeArguments.FormatPrimitive(SpecialCaseBoxingTypes.IntPtr, slot);
+
+            // Assert
+            Assert.Equal(RuntimeFormatters.IFormattableFormatter((nint)(-1), FormatSpecifier.NoQuotes).FormattedValue, formatted);
+        }
+
+        [Fact]
+        public unsafe void ProbeArguments_ReadsPrimitivesWithoutBoxing()
+        {
+            // Arrange
+            SpecialCaseBoxingTypes[] types = [SpecialCaseBoxingTypes.Int32, SpecialCaseBoxingTypes.Unknown];
+            object[] objectArgs = [null!, "value"];
+
+            ulong* slots = stackalloc ulong[types.Length];
+            slots[0] = 42;
+
+            // Act
+            ProbeArguments args = new(types, (IntPtr)slots, objectArgs);
+
+            // Assert
+            Assert.Equal(2, args.Length);
+            Assert.True(args.IsPrimitive(0));
+            Assert.False(args.IsPrimitive(1));
+            Assert.Equal("42", args.FormatPrimitive(0));
+            Assert.Null(args.GetObject(0));
+            Assert.Equal("value", args.GetObject(1));
+            Assert.Equal(new object[] { 42, "value" }, args.ToArray());
+        }
+
+        [Fact]
+        public void ProbeArguments_ObjectArguments()
+        {
+            // Arrange
+            object[] objectArgs = [5, "value"];
+
+            // Act
+            ProbeArguments args = new(objectArgs);
+
+            // Assert
+            Assert.Equal(2, args.Length);
+            Assert.False(args.IsPrimitive(0));
+            Assert.Equal(5, args.GetObject(0));
+            Assert.Same(objectArgs, args.ToArray());
+        }
+    }
+}
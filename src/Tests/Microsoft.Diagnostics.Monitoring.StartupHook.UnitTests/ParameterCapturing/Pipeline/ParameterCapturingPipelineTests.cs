@@ -26,6 +26,8 @@ internal sealed class TestFunctionProbesManager : IFunctionProbesManager
 
         public event EventHandler<InstrumentedMethod>? OnProbeFault;
 
+        public event EventHandler<InstrumentedMethod>? OnProbeDisabled;
+
         public TestFunctionProbesManager(Action<IList<MethodInfo>, IFunctionProbes>? onStart = null, Action? onStop = null)
         {
             _onStart = onStart;
@@ -38,6 +40,12 @@ public void TriggerFault(MethodInfo method)
             OnProbeFault?.Invoke(this, faultingMethod);
         }
 
+        public void TriggerDisable(MethodInfo method)
+        {
+            InstrumentedMethod disabledMethod = new(method, BoxingInstructions.GetBoxingInstructions(method));
+            OnProbeDisabled?.Invoke(this, disabledMethod);
+        }
+
         public Task StartCapturingAsync(IList<MethodInfo> methods, IFunctionProbes probes, CancellationToken token)
         {
             _onStart?.Invoke(methods, probes);
@@ -61,17 +69,20 @@ internal sealed class TestParameterCapturingCallbacks : IParameterCapturingPipel
         private readonly Action<Guid>? _onCapturingStop;
         private readonly Action<Guid, ParameterCapturingEvents.CapturingFailedReason, string>? _onCapturingFailed;
         private readonly Action<Guid, InstrumentedMethod>? _onProbeFault;
+        private readonly Action<Guid, InstrumentedMethod>? _onProbeDisabled;
 
         public TestParameterCapturingCallbacks(
             Action<StartCapturingParametersPayload, IList<MethodInfo>>? onCapturingStart = null,
             Action<Guid>? onCapturingStop = null,
             Action<Guid, ParameterCapturingEvents.CapturingFailedReason, string>? onCapturingFailed = null,
-            Action<Guid, InstrumentedMethod>? onProbeFault = null)
+            Action<Guid, InstrumentedMethod>? onProbeFault = null,
+            Action<Guid, InstrumentedMethod>? onProbeDisabled = null)
         {
             _onCapturingStart = onCapturingStart;
             _onCapturingStop = onCapturingStop;
             _onCapturingFailed = onCapturingFailed;
             _onProbeFault = onProbeFault;
+            _onProbeDisabled = onProbeDisabled;
         }
 
         public void CapturingStart(StartCapturingParametersPayload request, IList<MethodInfo> methods)
@@ -93,6 +104,11 @@ public void ProbeFault(Guid requestId, InstrumentedMethod faultingMethod)
         {
             _onProbeFault?.Invoke(requestId, faultingMethod);
         }
+
+        public void ProbeDisabled(Guid requestId, InstrumentedMethod disabledMethod)
+        {
+            _onProbeDisabled?.Invoke(requestId, disabledMethod);
+        }
     }
 
     internal sealed class TestMethodDescriptionValidator : IMethodDescriptionValidator
@@ -442,6 +458,70 @@ public async Task ProbeFault_DoesNotify()
             Assert.Equal(instrumentedMethod.GetFunctionId(), faultingMethod.FunctionId);
         }
 
+        [Fact]
+        public async Task ProbeDisabled_DoesNotifyWithoutStopping()
+        {
+            // Arrange
+            using CancellationTokenSource cts = new();
+            cts.CancelAfter(CommonTestTimeouts.GeneralTimeout);
+
+            TaskCompletionSource<(Guid, IList<MethodInfo>)> onStartCallbackSource = new(TaskCreationOptions.RunContinuationsAsynchronously);
+            TaskCompletionSource<(Guid, InstrumentedMethod)> onProbeDisabledCallbackSource = new(TaskCreationOptions.RunContinuationsAsynchronously);
+            TaskCompletionSource<Guid> onStopCallbackSource = new(TaskCreationOptions.RunContinuationsAsynchronously);
+            bool faulted = false;
+
+            using IDisposable registration = cts.Token.Register(() =>
+            {
+                _ = onStartCallbackSource.TrySetCanceled(cts.Token);
+                _ = onProbeDisabledCallbackSource.TrySetCanceled(cts.Token);
+                _ = onStopCallbackSource.TrySetCanceled(cts.Token);
+            });
+
+            TestFunctionProbes probes = new();
+            TestFunctionProbesManager probeManager = new();
+
+            TestParameterCapturingCallbacks callbacks = new(
+                onCapturingStart: (payload, methods) =>
+                {
+                    onStartCallbackSource.TrySetResult((payload.RequestId, methods));
+                },
+                onCapturingStop: (requestId) =>
+                {
+                    onStopCallbackSource.TrySetResult(requestId);
+                },
+                onProbeFault: (requestId, faultingMethod) =>
+                {
+                    faulted = true;
+                },
+                onProbeDisabled: (requestId, disabledMethod) =>
+                {
+                    onProbeDisabledCallbackSource.TrySetResult((requestId, disabledMethod));
+                });
+
+            ParameterCapturingPipeline pipeline = new(probeManager, callbacks, new TestMethodDescriptionValidator());
+            StartCapturingParametersPayload payload = CreateStartCapturingPayload(Timeout.InfiniteTimeSpan);
+
+            Task pipelineTask = pipeline.RunAsync(cts.Token);
+            pipeline.SubmitRequest(payload, probes);
+            (Guid startedRequest, IList<MethodInfo> methods) = await onStartCallbackSource.Task;
+            Assert.Equal(payload.RequestId, startedRequest);
+            MethodInfo instrumentedMethod = Assert.Single(methods);
+
+            // Act
+            probeManager.TriggerDisable(instrumentedMethod);
+
+            // Assert
+            (Guid disabledRequest, InstrumentedMethod disabledMethod) = await onProbeDisabledCallbackSource.Task;
+            Assert.Equal(payload.RequestId, disabledRequest);
+            Assert.Equal(instrumentedMethod.GetFunctionId(), disabledMethod.FunctionId);
+            Assert.False(faulted);
+            Assert.False(onStopCallbackSource.Task.IsCompleted);
+
+            // The request is still running until it is stopped.
+            pipeline.RequestStop(payload.RequestId);
+            Assert.Equal(payload.RequestId, await onStopCallbackSource.Task);
+        }
+
         [Fact]
         public async Task RunAsync_ThrowsOnCapturingStopFailure()
         {
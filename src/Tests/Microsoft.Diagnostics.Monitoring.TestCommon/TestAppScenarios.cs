@@ -85,6 +85,8 @@ public static class SubScenarios
                 public const string ProbeInstallation = nameof(ProbeInstallation);
                 public const string ProbeUninstallation = nameof(ProbeUninstallation);
                 public const string ProbeReinstallation = nameof(ProbeReinstallation);
+                public const string ProbeAddition = nameof(ProbeAddition);
+                public const string ProbePredicate = nameof(ProbePredicate);
 
                 /* Parameter capturing */
                 public const string CapturePrimitives = nameof(CapturePrimitives);
@@ -33,6 +33,8 @@ public static Command Command()
                 { TestAppScenarios.FunctionProbes.SubScenarios.ProbeInstallation, Test_ProbeInstallationAsync},
                 { TestAppScenarios.FunctionProbes.SubScenarios.ProbeUninstallation, Test_ProbeUninstallationAsync},
                 { TestAppScenarios.FunctionProbes.SubScenarios.ProbeReinstallation, Test_ProbeReinstallationAsync},
+                { TestAppScenarios.FunctionProbes.SubScenarios.ProbeAddition, Test_ProbeAdditionAsync},
+                { TestAppScenarios.FunctionProbes.SubScenarios.ProbePredicate, Test_ProbePredicateAsync},
 
                 /* Parameter capturing */
                 { TestAppScenarios.FunctionProbes.SubScenarios.CapturePrimitives, Test_CapturePrimitivesAsync},
@@ -117,6 +119,62 @@ private static async Task Test_ProbeReinstallationAsync(FunctionProbesManager pr
             await Test_ProbeUninstallationAsync(probeManager, probeProxy, token);
         }
 
+        private static async Task Test_ProbeAdditionAsync(FunctionProbesManager probeManager, PerFunctionProbeProxy probeProxy, CancellationToken token)
+        {
+            MethodInfo method = typeof(StaticTestMethodSignatures).GetMethod(nameof(StaticTestMethodSignatures.NoArgs));
+            MethodInfo addedMethod = typeof(StaticTestMethodSignatures).GetMethod(nameof(StaticTestMethodSignatures.ValueType_TypeDef));
+            probeProxy.RegisterPerFunctionProbe(method, (object[] args) => { });
+            probeProxy.RegisterPerFunctionProbe(addedMethod, (object[] args) => { });
+
+            await probeManager.StartCapturingAsync(new[] { method }, probeProxy, token);
+            StaticTestMethodSignatures.NoArgs();
+
+            // The second capture only adds the method that is not yet instrumented; the first keeps its probe.
+            await probeManager.StartCapturingAsync(new[] { method, addedMethod }, probeProxy, token);
+            StaticTestMethodSignatures.NoArgs();
+            StaticTestMethodSignatures.ValueType_TypeDef(MyEnum.ValueA);
+
+            Assert.Equal(2, probeProxy.GetProbeInvokeCount(method));
+            Assert.Equal(1, probeProxy.GetProbeInvokeCount(addedMethod));
+
+            await probeManager.StopCapturingAsync(token);
+            StaticTestMethodSignatures.NoArgs();
+            StaticTestMethodSignatures.ValueType_TypeDef(MyEnum.ValueA);
+
+            Assert.Equal(2, probeProxy.GetProbeInvokeCount(method));
+            Assert.Equal(1, probeProxy.GetProbeInvokeCount(addedMethod));
+        }
+
+        private static async Task Test_ProbePredicateAsync(FunctionProbesManager probeManager, PerFunctionProbeProxy probeProxy, CancellationToken token)
+        {
+            MethodInfo method = typeof(StaticTestMethodSignatures).GetMethod(nameof(StaticTestMethodSignatures.AmbiguousMethod), new[] { typeof(int), typeof(int) });
+            probeProxy.RegisterPerFunctionProbe(method, (object[] args) =>
+            {
+                Assert.Equal(2, args.Length);
+                Assert.True((int)args[1] > 10);
+            });
+
+            // The probe is only called when the second argument is greater than 10.
+            ProbePredicate predicate = new()
+            {
+                Comparison = ProbePredicateComparison.GreaterThan,
+                ArgumentIndex = 1,
+                Constant = 10
+            };
+
+            await probeManager.StartCapturingAsync(new[] { method }, new[] { predicate }, probeProxy, token);
+            _ = StaticTestMethodSignatures.AmbiguousMethod(1, -20);
+            _ = StaticTestMethodSignatures.AmbiguousMethod(1, 10);
+            _ = StaticTestMethodSignatures.AmbiguousMethod(1, 11);
+            _ = StaticTestMethodSignatures.AmbiguousMethod(1, 20);
+
+            Assert.Equal(2, probeProxy.GetProbeInvokeCount(method));
+            if (probeProxy.TryGetProbeAssertException(method, out XunitException assertException))
+            {
+                throw assertException;
+            }
+        }
+
         private static async Task Test_CapturePrimitivesAsync(FunctionProbesManager probeManager, PerFunctionProbeProxy probeProxy, CancellationToken token)
         {
             MethodInfo method = typeof(StaticTestMethodSignatures).GetMethod(nameof(StaticTestMethodSignatures.Primitives));
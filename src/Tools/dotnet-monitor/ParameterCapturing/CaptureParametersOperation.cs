@@ -209,6 +209,9 @@ private void OnCapturingFailed(object? sender, CapturingFailedArgs args)
             Exception ex;
             switch (args.Reason)
             {
+                case ParameterCapturingEvents.CapturingFailedReason.ProbeDisabled:
+                    // Only one method stopped being captured, the request continues.
+                    return;
                 case ParameterCapturingEvents.CapturingFailedReason.UnresolvedMethods:
                 case ParameterCapturingEvents.CapturingFailedReason.InvalidRequest:
                     ex = new MonitoringException(args.Details);
@@ -53,7 +53,8 @@ public enum CapturingFailedReason : uint
             InvalidRequest,
             TooManyRequests,
             InternalError,
-            ProbeFaulted
+            ProbeFaulted,
+            ProbeDisabled
         }
 
         public static class CapturingFailedPayloads
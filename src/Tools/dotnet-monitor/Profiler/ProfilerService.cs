@@ -83,17 +83,17 @@ public async Task ApplyProfilersAsync(IEndpointInfo endpointInfo, CancellationTo
                     // Profiler already applied. We will reset state to discard all previous data collection.
 
                     // Currently this is a no-op but ideally will interrupt all callstack collections
-                    await _profilerChannel.SendMessage(endpointInfo,
+                    await _profilerChannel.SendMessageAndWaitForCompletion(endpointInfo,
                         new CommandOnlyProfilerMessage(ProfilerCommand.StopAllFeatures),
                         cancellationToken, ResetTimeout);
-                    await _profilerChannel.SendMessage(endpointInfo,
+                    await _profilerChannel.SendMessageAndWaitForCompletion(endpointInfo,
                         new CommandOnlyProfilerMessage(ProfilerCommand.StartAllFeatures),
                         cancellationToken, ResetTimeout);
 
                     if (_inProcessFeatures.IsStartupHookRequired)
                     {
                         // This will stop all exception pipelines from collecting data and request all parameter captures to be uninstrumented
-                        await _profilerChannel.SendMessage(endpointInfo,
+                        await _profilerChannel.SendMessageAndWaitForCompletion(endpointInfo,
                             new CommandOnlyProfilerMessage(StartupHookCommand.StopAllFeatures),
                             cancellationToken, ResetTimeout);
 
@@ -101,7 +101,7 @@ public async Task ApplyProfilersAsync(IEndpointInfo endpointInfo, CancellationTo
                         // which features need to be started rather than 1 stop/start for the entire command set.
                         if (_inProcessFeatures.CollectExceptionsOnStartup)
                         {
-                            await _profilerChannel.SendMessage(endpointInfo,
+                            await _profilerChannel.SendMessageAndWaitForCompletion(endpointInfo,
                                 new CommandOnlyProfilerMessage(StartupHookCommand.StartAllFeatures),
                                 cancellationToken, ResetTimeout);
                         }
@@ -20,6 +20,10 @@
 #define E_NOT_SUPPORTED HRESULT_FROM_WIN32(50L) //ERROR_NOT_SUPPORTED
 #endif
 
+#ifndef E_BUSY
+#define E_BUSY HRESULT_FROM_WIN32(170L) //ERROR_BUSY
+#endif
+
 #ifndef IfOomRetMem
 #define START_NO_OOM_THROW_REGION try {
 #define END_NO_OOM_THROW_REGION } catch (const std::bad_alloc&) { return E_OUTOFMEMORY; }